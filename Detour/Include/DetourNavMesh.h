@@ -118,10 +118,12 @@ enum dtStraightPathOptions
 };
 
 
-/// Options for dtNavMeshQuery::initSlicedFindPath and updateSlicedFindPath
+/// Options for dtNavMeshQuery::findPath, initSlicedFindPath and updateSlicedFindPath
 enum dtFindPathOptions
 {
-	DT_FINDPATH_ANY_ANGLE	= 0x02		///< use raycasts during pathfind to "shortcut" (raycast still consider costs)
+	DT_FINDPATH_ANY_ANGLE	= 0x02,		///< use raycasts during pathfind to "shortcut" (raycast still consider costs). Sliced queries only.
+	DT_FINDPATH_BIDIRECTIONAL	= 0x04,	///< search from both ends at once and join the two searches where they meet. Ignores DT_FINDPATH_ANY_ANGLE.
+	DT_FINDPATH_LANDMARKS	= 0x08		///< use the query's landmark tables in the heuristic. Visits fewer nodes, but the bound is not admissible so the path may not be the cheapest.
 };
 
 /// Options for dtNavMeshQuery::raycast
@@ -219,6 +221,17 @@ struct dtLink
 	int OffMeshID = -1;				///< If an off-mesh connection, this will be the UserID of the connection that made this link
 };
 
+/// Precomputed portal geometry for a link, so searches can read it without
+/// re-deriving it from the polygon and tile data every time they cross the link.
+/// @see dtMeshTile::linkPortals, dtNavMesh::setLinkPortalsEnabled
+struct dtLinkPortal
+{
+	float left[3];						///< Left portal point. (Same as dtNavMeshQuery::getPortalPoints)
+	float right[3];						///< Right portal point.
+	float mid[3];						///< Midpoint of the portal edge. (Same as dtNavMeshQuery::getEdgeMidPoint)
+	const struct dtMeshTile* tile;		///< The tile the neighbour polygon lives in.
+};
+
 /// Bounding volume node.
 /// @note This structure is rarely if ever used by the end user.
 /// @see dtMeshTile
@@ -318,6 +331,8 @@ struct dtMeshTile
 	dtPoly* polys;						///< The tile polygons. [Size: dtMeshHeader::polyCount]
 	float* verts;						///< The tile vertices. [(x, y, z) * dtMeshHeader::vertCount]
 	dtLink* links;						///< The tile links. [Size: dtMeshHeader::maxLinkCount]
+	dtLinkPortal* linkPortals;			///< Portal geometry for each link, indexed like #links. [Size: dtMeshHeader::maxLinkCount] (Null unless enabled with dtNavMesh::setLinkPortalsEnabled.)
+	float* polyClearance;				///< 2D distance from each polygon to the nearest wall, capped at the mesh's clearance limit. [Size: dtMeshHeader::polyCount] (Null unless enabled with dtNavMesh::setPolyClearance.)
 	dtPolyDetail* detailMeshes;			///< The tile's detail sub-meshes. [Size: dtMeshHeader::detailMeshCount]
 	
 	/// The detail mesh's unique vertices. [(x, y, z) * dtMeshHeader::detailVertCount]
@@ -391,6 +406,36 @@ public:
 	/// The navigation mesh initialization params.
 	const dtNavMeshParams* getParams() const;
 
+	/// Enables the per-tile link portal tables. (See: #dtMeshTile::linkPortals)
+	/// Must be called before any tiles are added, tiles already in the mesh do not get a table.
+	///  @param[in]	enabled		True to build a link portal table for each tile as it is added.
+	void setLinkPortalsEnabled(bool enabled) { m_linkPortals = enabled; }
+
+	/// True if tiles get a link portal table when they are added.
+	bool getLinkPortalsEnabled() const { return m_linkPortals; }
+
+	/// True if an off-mesh connection which can only be taken one way has ever been linked into the mesh.
+	/// Until then every link has a matching link back.
+	bool hasOneWayLinks() const { return m_hasOneWayLinks; }
+
+	/// Enables the per-tile polygon clearance field. (See: #dtMeshTile::polyClearance)
+	/// Edges into polygons the flags would filter out count as walls, same as a query filter would see them.
+	/// Tiles already in the mesh get their field built here, so when loading many tiles it is cheapest
+	/// to call this once they are all added. Tiles added or removed afterwards refresh the polygons
+	/// within the limit of their bounds. The limit should be less than a tile's width.
+	///  @param[in]	maxClearance	Clearance is measured up to this distance. Zero disables the field.
+	///  @param[in]	includeFlags	Polygons need at least one of these flags to not count as a wall.
+	///  @param[in]	excludeFlags	Polygons with any of these flags count as a wall.
+	void setPolyClearance(const float maxClearance, const unsigned int includeFlags, const unsigned int excludeFlags);
+
+	/// The distance clearance is measured up to. Zero if the clearance field is disabled.
+	float getPolyClearanceLimit() const { return m_maxClearance; }
+
+	/// Gets the 2D distance from anywhere on the polygon to the nearest wall. Never more than the clearance limit.
+	///  @param[in]	ref		The polygon reference.
+	/// @return The clearance, or zero if the polygon is invalid or its tile has no clearance field.
+	float getPolyClearance(dtPolyRef ref) const;
+
 	/// Adds a tile to the navigation mesh.
 	///  @param[in]		data		Data for the new tile mesh. (See: #dtCreateNavMeshData)
 	///  @param[in]		dataSize	Data size of the new tile mesh.
@@ -676,6 +721,21 @@ private:
 	
 	/// Removes external links at specified side.
 	void unconnectLinks(dtMeshTile* tile, dtMeshTile* target);
+
+	/// Recomputes the link portal table of a tile after its links or vertices changed. Does nothing if the tile has no table.
+	void updateLinkPortals(dtMeshTile* tile);
+	/// Computes the portal points of a link, the same way dtNavMeshQuery::getPortalPoints does.
+	bool calcLinkPortal(const dtMeshTile* tile, const dtPoly* poly, const dtLink* link,
+						const dtMeshTile* toTile, const dtPoly* toPoly, float* left, float* right) const;
+
+	/// Recomputes the clearance field of a tile, or only of the polygons overlapping [qmin, qmax] on xz if given.
+	/// Does nothing if the tile has no field.
+	void updatePolyClearance(dtMeshTile* tile, const float* qmin, const float* qmax);
+	/// Recomputes the clearance of the tiles at the specified tile location, and of neighbouring
+	/// polygons within the clearance limit of it.
+	void updatePolyClearanceAround(const int x, const int y);
+	/// True if the polygon passes the clearance flags, i.e. its edges with other polygons are not walls.
+	bool passClearanceFlags(const dtPoly* poly) const;
 	
 
 	// TODO: These methods are duplicates from dtNavMeshQuery, but are needed for off-mesh connection finding.
@@ -701,6 +761,11 @@ private:
 	dtMeshTile** m_posLookup;			///< Tile hash lookup.
 	dtMeshTile* m_nextFree;				///< Freelist of tiles.
 	dtMeshTile* m_tiles;				///< List of tiles.
+	bool m_linkPortals;					///< Build a link portal table for each tile added.
+	bool m_hasOneWayLinks;				///< Set once a one-way off-mesh connection is linked, never cleared.
+	float m_maxClearance;				///< Clearance field limit, zero if disabled.
+	unsigned int m_clearanceIncludeFlags;	///< Flags a polygon needs to not count as a wall for clearance.
+	unsigned int m_clearanceExcludeFlags;	///< Flags which make a polygon count as a wall for clearance.
 		
 #ifndef DT_POLYREF64
 	unsigned int m_saltBits;			///< Number of salt bits in the tile ID.
@@ -119,6 +119,87 @@ public:
 
 };
 
+/// The maximum number of landmark tables that can be attached to a query.
+/// @ingroup detour
+static const int DT_MAX_LANDMARK_TABLES = 8;
+
+/// Precomputed path costs between every polygon and a small set of landmark polygons.
+/// Gives findPath a much tighter lower bound on the remaining cost than straight-line
+/// distance (ALT: A*, landmarks and the triangle inequality), which matters on meshes
+/// with a lot of off-mesh connections and expensive areas.
+/// A table is only valid for the filter it was built with, see #isCompatible.
+/// @ingroup detour
+class dtLandmarkTable
+{
+public:
+	dtLandmarkTable();
+	~dtLandmarkTable();
+
+	/// Allocates the cost tables. All costs start as FLT_MAX (unreachable).
+	///  @param[in]		maxTiles		The maximum tiles of the navigation mesh the table is for.
+	///  @param[in]		polyCount		The total number of polygons in the navigation mesh.
+	///  @param[in]		landmarkCount	The number of landmarks. [Limit: > 0]
+	///  @param[in]		filter			The filter the costs will be calculated with.
+	/// @returns The status flags for the operation.
+	dtStatus init(const int maxTiles, const int polyCount, const int landmarkCount, const dtQueryFilter* filter);
+
+	/// Sets where a tile's polygons are stored in the cost tables.
+	///  @param[in]		tileIndex		The index of the tile in the navigation mesh.
+	///  @param[in]		salt			The tile's salt, so polygons of a rebuilt tile are not looked up.
+	///  @param[in]		firstPoly		The index of the tile's first polygon in the cost tables.
+	///  @param[in]		polyCount		The number of polygons in the tile.
+	void setTile(const int tileIndex, const unsigned int salt, const unsigned int firstPoly, const unsigned int polyCount);
+
+	/// Returns the index of the polygon in the cost tables, or -1 if it has no entry.
+	int getPolyIndex(const dtNavMesh* nav, const dtPolyRef ref) const;
+
+	/// Returns a lower bound on the cost of travelling between two polygons.
+	///  @param[in]		fromIndex		The cost table index of the start polygon.
+	///  @param[in]		toIndex			The cost table index of the end polygon.
+	float getLowerBound(const int fromIndex, const int toIndex) const;
+
+	/// Returns true if the table was built with a filter matching this one.
+	bool isCompatible(const dtQueryFilter* filter) const;
+
+	/// Stores the costs for one landmark.
+	///  @param[in]		landmark	The landmark. [Limit: < landmarkCount]
+	///  @param[in]		costTo		The cost from each polygon to the landmark, FLT_MAX if unreachable. [(cost) * polyCount]
+	///  @param[in]		costFrom	The cost from the landmark to each polygon, FLT_MAX if unreachable. [(cost) * polyCount]
+	void setLandmarkCosts(const int landmark, const float* costTo, const float* costFrom);
+
+	inline int getLandmarkCount() const { return m_landmarkCount; }
+	inline int getPolyCount() const { return m_polyCount; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtLandmarkTable(const dtLandmarkTable&);
+	dtLandmarkTable& operator=(const dtLandmarkTable&);
+
+	void purge();
+
+	int m_maxTiles;
+	int m_polyCount;
+	int m_landmarkCount;
+	unsigned int* m_tileSalt;			///< Salt of each tile when the table was built.
+	unsigned int* m_tileFirstPoly;		///< Index of each tile's first polygon in the cost tables.
+	unsigned int* m_tilePolyCount;		///< Number of polygons each tile had when the table was built.
+	float* m_costs;						///< Cost to and from each landmark, grouped by polygon. [(to, from) * landmarkCount * polyCount]
+
+	float m_areaCost[DT_MAX_AREAS];		///< Area costs of the filter the table was built with.
+	unsigned int m_includeFlags;		///< Include flags of the filter the table was built with.
+	unsigned int m_excludeFlags;		///< Exclude flags of the filter the table was built with.
+};
+
+/// Allocates a landmark table object using the Detour allocator.
+/// @return An allocated landmark table, or null on failure.
+/// @ingroup detour
+dtLandmarkTable* dtAllocLandmarkTable();
+
+/// Frees the specified landmark table using the Detour allocator.
+///  @param[in]		table		A landmark table allocated using #dtAllocLandmarkTable
+/// @ingroup detour
+void dtFreeLandmarkTable(dtLandmarkTable* table);
+
 /// Provides information about raycast hit
 /// filled by dtNavMeshQuery::raycast
 /// @ingroup detour
@@ -142,6 +223,9 @@ struct dtRaycastHit
 	/// The maximum number of polygons the @p path array can hold.
 	int maxPath;
 
+	/// The last polygon the ray visited, even if @p path was too small to hold it. (Zero if it visited none.)
+	dtPolyRef lastRef;
+
 	///  The cost of the path until hit.
 	float pathCost;
 };
@@ -173,6 +257,12 @@ public:
 	///  @param[in]		maxNodes	Maximum number of search nodes. [Limits: 0 < value <= 65535]
 	/// @returns The status flags for the query.
 	dtStatus init(const dtNavMesh* nav, const int maxNodes);
+
+	/// Sets the landmark tables findPath and the sliced path functions use for their heuristic when asked to with #DT_FINDPATH_LANDMARKS.
+	/// The first table compatible with the query's filter is used. The query does not own the tables.
+	///  @param[in]		tables		The landmark tables, or null to stop using landmarks. [(table) * count]
+	///  @param[in]		count		The number of tables. [Limit: <= #DT_MAX_LANDMARK_TABLES]
+	void setLandmarkTables(const dtLandmarkTable* const* tables, const int count);
 	
 	/// @name Standard Pathfinding Functions
 	/// @{
@@ -187,10 +277,14 @@ public:
 	///  							[(polyRef) * @p pathCount]
 	///  @param[out]	pathCount	The number of polygons returned in the @p path array.
 	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	///  @param[in]		options		Query options. (see: #dtFindPathOptions)
+	///  @param[in]		heuristicWeight	Scales the heuristic. Values above 1 trade optimality for fewer visited nodes,
+	///  							the path found costs at most this many times the optimal. [Limit: >= 1]
 	dtStatus findPath(dtPolyRef startRef, dtPolyRef endRef,
 					  const float* startPos, const float* endPos,
 					  const dtQueryFilter* filter,
-					  dtPolyRef* path, int* pathCount, const int maxPath) const;
+					  dtPolyRef* path, int* pathCount, const int maxPath,
+					  const unsigned int options = 0, const float heuristicWeight = 1.0f) const;
 
 	/// Finds the straight path from the start to the end position within the polygon corridor.
 	///  @param[in]		startPos			Path start position. [(x, y, z)]
@@ -224,10 +318,12 @@ public:
 	///  @param[in]		endPos		A position within the end polygon. [(x, y, z)]
 	///  @param[in]		filter		The polygon filter to apply to the query.
 	///  @param[in]		options		query options (see: #dtFindPathOptions)
+	///  @param[in]		heuristicWeight	Scales the heuristic, see #findPath. [Limit: >= 1]
 	/// @returns The status flags for the query.
 	dtStatus initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef,
 								const float* startPos, const float* endPos,
-								const dtQueryFilter* filter, const unsigned int options = 0);
+								const dtQueryFilter* filter, const unsigned int options = 0,
+								const float heuristicWeight = 1.0f);
 
 	/// Updates an in-progress sliced path query.
 	///  @param[in]		maxIter		The maximum number of iterations to perform.
@@ -294,6 +390,23 @@ public:
 								  dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
 								  int* resultCount, const int maxResult) const;
 	
+	/// Finds the cost of travelling from the start polygon to each of the goal polygons with a single Dijkstra search.
+	///  @param[in]		startRef		The reference id of the polygon where the search starts.
+	///  @param[in]		startPos		A position within the start polygon. [(x, y, z)]
+	///  @param[in]		goalRefs		The reference ids of the goal polygons. [(polyRef) * @p goalCount]
+	///  @param[in]		goalPos			A position within each goal polygon. [(x, y, z) * @p goalCount]
+	///  @param[in]		goalCount		The number of goals.
+	///  @param[in]		filter			The polygon filter to apply to the query.
+	///  @param[in]		maxCost			The search stops expanding once the cheapest open polygon costs more than this.
+	///  @param[out]	resultCost		The cost from @p startPos to each goal position, or FLT_MAX if the goal was not reached. 
+	///  								[(cost) * @p goalCount]
+	///  @param[out]	resultCount		The number of goals reached. [opt]
+	/// @returns The status flags for the query.
+	dtStatus findPathCostsToPolys(dtPolyRef startRef, const float* startPos,
+								  const dtPolyRef* goalRefs, const float* goalPos, const int goalCount,
+								  const dtQueryFilter* filter, const float maxCost,
+								  float* resultCost, int* resultCount) const;
+	
 	/// Gets a path from the explored nodes in the previous search.
 	///  @param[in]		endRef		The reference id of the end polygon.
 	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to end.)
@@ -305,7 +418,8 @@ public:
 	///  				if @p path cannot contain the entire path. In this case it is filled to capacity with a partial path.
 	///  				Otherwise returns DT_SUCCESS.
 	///  @remarks		The result of this function depends on the state of the query object. For that reason it should only
-	///  				be used immediately after one of the two Dijkstra searches, findPolysAroundCircle or findPolysAroundShape.
+	///  				be used immediately after one of the Dijkstra searches, findPolysAroundCircle, findPolysAroundShape 
+	///  				or findPathCostsToPolys.
 	dtStatus getPathFromDijkstraSearch(dtPolyRef endRef, dtPolyRef* path, int* pathCount, int maxPath) const;
 
 	/// @}
@@ -338,6 +452,20 @@ public:
 	dtStatus findNearestPoly(const float* center, const float* halfExtents,
 							 const dtQueryFilter* filter,
 							 dtPolyRef* nearestRef, float* nearestPt, bool* isOverPoly) const;
+
+	/// Finds the polygon nearest to each of several center points, walking the tiles and BV trees once for all of them.
+	/// Gives the same results as calling findNearestPoly for each point. Meant for clusters of nearby points,
+	/// widely spread points are cheaper as separate findNearestPoly calls.
+	///  @param[in]		centers		The centers of the search boxes. [(x, y, z) * @p count]
+	///  @param[in]		count		The number of center points.
+	///  @param[in]		halfExtents	The search distance along each axis, shared by every point. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[out]	nearestRefs	The reference id of the nearest polygon for each point. Set to 0 where no polygon is found. [(polyRef) * @p count]
+	///  @param[out]	nearestPts	The nearest point on the polygon for each point. Unchanged where no polygon is found. [opt] [(x, y, z) * @p count]
+	/// @returns The status flags for the query.
+	dtStatus findNearestPolys(const float* centers, const int count, const float* halfExtents,
+							  const dtQueryFilter* filter,
+							  dtPolyRef* nearestRefs, float* nearestPts) const;
 	
 	/// Finds polygons that overlap the search box.
 	///  @param[in]		center		The center of the search box. [(x, y, z)]
@@ -422,6 +550,20 @@ public:
 					 const dtQueryFilter* filter, const unsigned int options,
 					 dtRaycastHit* hit, dtPolyRef prevRef = 0) const;
 
+	/// Casts several 'walkability' rays from the same start position. See raycast(..., dtRaycastHit*, ...).
+	///  @param[in]		startRef	The reference id of the start polygon.
+	///  @param[in]		startPos	A position within the start polygon representing 
+	///  							the start of every ray. [(x, y, z)]
+	///  @param[in]		endPos		The positions to cast the rays toward. [(x, y, z) * @p count]
+	///  @param[in]		count		The number of rays.
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[in]		options		govern how the raycasts behave. See dtRaycastOptions
+	///  @param[out]	hits		One raycast hit structure per ray, filled as raycast would fill it. [(dtRaycastHit) * @p count]
+	/// @returns The status flags for the query. Buffer and cost flags are combined from all rays.
+	dtStatus raycasts(dtPolyRef startRef, const float* startPos, const float* endPos, const int count,
+					  const dtQueryFilter* filter, const unsigned int options,
+					  dtRaycastHit* hits) const;
+
 
 	/// Finds the distance from the specified position to the nearest polygon wall.
 	///  @param[in]		startRef		The reference id of the polygon containing @p centerPos.
@@ -548,6 +690,23 @@ private:
 	dtStatus getEdgeMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
 							 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
 							 float* mid) const;
+
+	/// Returns the neighbour tile and polygon behind a link, read from the tile's link portal table when it has one.
+	inline void getLinkNeighbour(const dtMeshTile* tile, const unsigned int link, const dtPolyRef ref,
+								 const dtMeshTile** neighbourTile, const dtPoly** neighbourPoly) const
+	{
+		if (tile->linkPortals && tile->linkPortals[link].tile)
+		{
+			*neighbourTile = tile->linkPortals[link].tile;
+			*neighbourPoly = &(*neighbourTile)->polys[m_nav->decodePolyIdPoly(ref)];
+		}
+		else
+			m_nav->getTileAndPolyByRefUnsafe(ref, neighbourTile, neighbourPoly);
+	}
+
+	/// Returns edge mid point of a link, read from the tile's link portal table when it has one.
+	void getLinkMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile, const unsigned int link,
+						 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile, float* mid) const;
 	
 	// Appends vertex to a straight path
 	dtStatus appendVertex(const float* pos, const unsigned char flags, const dtPolyRef ref,
@@ -561,9 +720,54 @@ private:
 
 	// Gets the path leading to the specified end node.
 	dtStatus getPathToNode(struct dtNode* endNode, dtPolyRef* path, int* pathCount, int maxPath) const;
+
+	// Returns the first landmark table compatible with the filter, or null if there isn't one.
+	const dtLandmarkTable* findLandmarkTable(const dtQueryFilter* filter) const;
+
+	// Returns the A* heuristic from a node to the end, using the landmark table if there is one.
+	float getHeuristic(const dtLandmarkTable* landmarks, const int landmarkEnd, const dtPolyRef ref,
+					   const float* pos, const float* endPos) const;
+
+	// Returns the A* heuristic from the start to a node, for the backward half of a bidirectional search.
+	float getReverseHeuristic(const dtLandmarkTable* landmarks, const int landmarkStart, const dtPolyRef ref,
+							  const float* pos, const float* startPos) const;
+
+	// State of a bidirectional search, shared by findPath and the sliced functions.
+	struct dtBidirQuery
+	{
+		dtStatus status;
+		dtPolyRef startRef, endRef;
+		float startPos[3], endPos[3];
+		const dtQueryFilter* filter;
+		const dtLandmarkTable* landmarks;
+		int landmarkStart, landmarkEnd;
+		float heuristicWeight;
+		struct dtNode* meetNode;		///< Forward node where the best path found so far crosses the backward search.
+		struct dtNode* meetBackNode;	///< Backward node for the same polygon.
+		float meetCost;					///< Cost of the best path found so far, FLT_MAX until the searches meet.
+		struct dtNode* lastBestNode;	///< Forward node nearest the end, for partial results.
+		float lastBestNodeCost;
+	};
+
+	// Starts a bidirectional search, clearing both node pools.
+	dtStatus initBidirSearch(dtBidirQuery* query, dtPolyRef startRef, dtPolyRef endRef,
+							 const float* startPos, const float* endPos,
+							 const dtQueryFilter* filter, const float heuristicWeight, const bool useLandmarks) const;
+
+	// Expands up to maxIter nodes of a bidirectional search. Validates refs when called from the sliced functions.
+	dtStatus updateBidirSearch(dtBidirQuery* query, const int maxIter, int* doneIters, const bool validateRefs) const;
+
+	// Records a path through the polygon if it is cheaper than the best one so far.
+	void checkBidirMeeting(dtBidirQuery* query, struct dtNode* node, struct dtNode* backNode) const;
+
+	// Gets the best path found by a bidirectional search, or the partial path towards the end.
+	dtStatus getBidirPath(const dtBidirQuery* query, dtPolyRef* path, int* pathCount, const int maxPath) const;
 	
 	const dtNavMesh* m_nav;				///< Pointer to navmesh data.
 
+	const dtLandmarkTable* m_landmarks[DT_MAX_LANDMARK_TABLES];	///< Landmark tables for the heuristic. (Not owned.)
+	int m_nlandmarks;					///< Number of landmark tables.
+
 	struct dtQueryData
 	{
 		dtStatus status;
@@ -574,12 +778,18 @@ private:
 		const dtQueryFilter* filter;
 		unsigned int options;
 		float raycastLimitSqr;
+		const dtLandmarkTable* landmarks;
+		int landmarkEnd;
+		float heuristicWeight;
+		dtBidirQuery bidir;
 	};
 	dtQueryData m_query;				///< Sliced query state.
 
 	class dtNodePool* m_tinyNodePool;	///< Pointer to small node pool.
 	class dtNodePool* m_nodePool;		///< Pointer to node pool.
 	class dtNodeQueue* m_openList;		///< Pointer to open list queue.
+	class dtNodePool* m_backNodePool;	///< Pointer to node pool for the backward half of bidirectional searches.
+	class dtNodeQueue* m_backOpenList;	///< Pointer to open list queue for the backward half of bidirectional searches.
 };
 
 /// Allocates a query object using the Detour allocator.
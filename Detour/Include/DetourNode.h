@@ -20,6 +20,7 @@
 #define DETOURNODE_H
 
 #include "DetourNavMesh.h"
+#include "DetourAssert.h"
 
 enum dtNodeFlags
 {
@@ -42,6 +43,7 @@ struct dtNode
 	unsigned int state : DT_NODE_STATE_BITS;	///< extra state information. A polyRef can have multiple nodes with different extra info. see DT_MAX_STATES_PER_NODE
 	unsigned int flags : 3;						///< Node flags. A combination of dtNodeFlags.
 	dtPolyRef id;								///< Polygon ref the node corresponds to.
+	int heapIdx;								///< Position of the node in the open list while it is open. Lets dtNodeQueue::modify() skip the linear search.
 };
 
 static const int DT_MAX_STATES_PER_NODE = 1 << DT_NODE_STATE_BITS;	// number of extra states per node. See dtNode::state
@@ -82,13 +84,14 @@ public:
 		return sizeof(*this) +
 			sizeof(dtNode)*m_maxNodes +
 			sizeof(dtNodeIndex)*m_maxNodes +
-			sizeof(dtNodeIndex)*m_hashSize;
+			sizeof(dtNodeIndex)*m_hashSize +
+			sizeof(unsigned int)*m_hashSize;
 	}
 	
 	inline int getMaxNodes() const { return m_maxNodes; }
 	
 	inline int getHashSize() const { return m_hashSize; }
-	inline dtNodeIndex getFirst(int bucket) const { return m_first[bucket]; }
+	inline dtNodeIndex getFirst(int bucket) const { return m_bucketGen[bucket] == m_generation ? m_first[bucket] : DT_NULL_IDX; }
 	inline dtNodeIndex getNext(int i) const { return m_next[i]; }
 	inline int getNodeCount() const { return m_nodeCount; }
 	
@@ -96,15 +99,26 @@ private:
 	// Explicitly disabled copy constructor and copy assignment operator.
 	dtNodePool(const dtNodePool&);
 	dtNodePool& operator=(const dtNodePool&);
+
+	/// A bucket only counts as filled if it was written during the current generation,
+	/// which is what lets clear() skip wiping the whole hash table between searches.
+	inline dtNodeIndex getBucketHead(unsigned int bucket) const
+	{
+		return m_bucketGen[bucket] == m_generation ? m_first[bucket] : DT_NULL_IDX;
+	}
 	
 	dtNode* m_nodes;
 	dtNodeIndex* m_first;
 	dtNodeIndex* m_next;
+	unsigned int* m_bucketGen;
+	unsigned int m_generation;
 	const int m_maxNodes;
 	const int m_hashSize;
 	int m_nodeCount;
 };
 
+/// Open list used by the searches. A 4-ary min-heap on dtNode::total: half the depth of a
+/// binary heap, and all four children of a slot share a cache line, so pops touch less memory.
 class dtNodeQueue
 {
 public:
@@ -119,7 +133,8 @@ public:
 	{
 		dtNode* result = m_heap[0];
 		m_size--;
-		trickleDown(0, m_heap[m_size]);
+		if (m_size > 0)
+			trickleDown(0, m_heap[m_size]);
 		return result;
 	}
 	
@@ -129,16 +144,11 @@ public:
 		bubbleUp(m_size-1, node);
 	}
 	
+	/// Restores heap order after the node's total went down. The node must currently be in this queue.
 	inline void modify(dtNode* node)
 	{
-		for (int i = 0; i < m_size; ++i)
-		{
-			if (m_heap[i] == node)
-			{
-				bubbleUp(i, node);
-				return;
-			}
-		}
+		dtAssert(node->heapIdx >= 0 && node->heapIdx < m_size && m_heap[node->heapIdx] == node);
+		bubbleUp(node->heapIdx, node);
 	}
 	
 	inline bool empty() const { return m_size == 0; }
@@ -193,7 +193,12 @@ dtNavMesh::dtNavMesh() :
 	m_tileLutMask(0),
 	m_posLookup(0),
 	m_nextFree(0),
-	m_tiles(0)
+	m_tiles(0),
+	m_linkPortals(false),
+	m_hasOneWayLinks(false),
+	m_maxClearance(0),
+	m_clearanceIncludeFlags(0),
+	m_clearanceExcludeFlags(0)
 {
 #ifndef DT_POLYREF64
 	m_saltBits = 0;
@@ -216,6 +221,10 @@ dtNavMesh::~dtNavMesh()
 			m_tiles[i].data = 0;
 			m_tiles[i].dataSize = 0;
 		}
+		dtFree(m_tiles[i].linkPortals);
+		m_tiles[i].linkPortals = 0;
+		dtFree(m_tiles[i].polyClearance);
+		m_tiles[i].polyClearance = 0;
 	}
 	dtFree(m_posLookup);
 	dtFree(m_tiles);
@@ -384,6 +393,272 @@ void dtNavMesh::unconnectLinks(dtMeshTile* tile, dtMeshTile* target)
 	}
 }
 
+bool dtNavMesh::calcLinkPortal(const dtMeshTile* tile, const dtPoly* poly, const dtLink* link,
+							   const dtMeshTile* toTile, const dtPoly* toPoly, float* left, float* right) const
+{
+	// Off-mesh connections use the connection end point on both sides.
+	if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		const int v = link->edge;
+		dtVcopy(left, &tile->verts[poly->verts[v]*3]);
+		dtVcopy(right, &tile->verts[poly->verts[v]*3]);
+		return true;
+	}
+
+	if (toPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		const dtPolyRef from = getPolyRefBase(tile) | (dtPolyRef)(poly - tile->polys);
+		for (unsigned int i = toPoly->firstLink; i != DT_NULL_LINK; i = toTile->links[i].next)
+		{
+			if (toTile->links[i].ref == from)
+			{
+				const int v = toTile->links[i].edge;
+				dtVcopy(left, &toTile->verts[toPoly->verts[v]*3]);
+				dtVcopy(right, &toTile->verts[toPoly->verts[v]*3]);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	const int v0 = poly->verts[link->edge];
+	const int v1 = poly->verts[(link->edge+1) % (int)poly->vertCount];
+	dtVcopy(left, &tile->verts[v0*3]);
+	dtVcopy(right, &tile->verts[v1*3]);
+
+	// Tile boundary links only cover part of the edge.
+	if (link->side != 0xff && (link->bmin != 0 || link->bmax != 255))
+	{
+		const float s = 1.0f/255.0f;
+		dtVlerp(left, &tile->verts[v0*3], &tile->verts[v1*3], link->bmin*s);
+		dtVlerp(right, &tile->verts[v0*3], &tile->verts[v1*3], link->bmax*s);
+	}
+
+	return true;
+}
+
+void dtNavMesh::updateLinkPortals(dtMeshTile* tile)
+{
+	if (!tile || !tile->linkPortals || !tile->header) return;
+
+	for (int i = 0; i < tile->header->polyCount; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		for (unsigned int j = poly->firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+		{
+			const dtLink* link = &tile->links[j];
+			dtLinkPortal* portal = &tile->linkPortals[j];
+
+			const dtMeshTile* toTile = 0;
+			const dtPoly* toPoly = 0;
+			portal->tile = 0;
+			if (!link->ref || dtStatusFailed(getTileAndPolyByRef(link->ref, &toTile, &toPoly)))
+				continue;
+
+			if (!calcLinkPortal(tile, poly, link, toTile, toPoly, portal->left, portal->right))
+			{
+				// Off-mesh connection with no link back, nothing sensible to store.
+				dtVcopy(portal->left, &tile->verts[poly->verts[0]*3]);
+				dtVcopy(portal->right, portal->left);
+			}
+			dtVlerp(portal->mid, portal->left, portal->right, 0.5f);
+			portal->tile = toTile;
+		}
+	}
+}
+
+void dtNavMesh::setPolyClearance(const float maxClearance, const unsigned int includeFlags, const unsigned int excludeFlags)
+{
+	m_maxClearance = dtMax(maxClearance, 0.0f);
+	m_clearanceIncludeFlags = includeFlags;
+	m_clearanceExcludeFlags = excludeFlags;
+
+	// Tiles which are already in the mesh get their field built here, once each.
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		dtMeshTile* tile = &m_tiles[i];
+		if (!tile->header) continue;
+
+		dtFree(tile->polyClearance);
+		tile->polyClearance = 0;
+		if (m_maxClearance > 0)
+			tile->polyClearance = (float*)dtAlloc(sizeof(float)*tile->header->polyCount, DT_ALLOC_PERM);
+
+		updatePolyClearance(tile, 0, 0);
+	}
+}
+
+float dtNavMesh::getPolyClearance(dtPolyRef ref) const
+{
+	if (!isValidPolyRef(ref)) return 0;
+	const dtMeshTile* tile = &m_tiles[decodePolyIdTile(ref)];
+	if (!tile->polyClearance) return 0;
+	return tile->polyClearance[decodePolyIdPoly(ref)];
+}
+
+bool dtNavMesh::passClearanceFlags(const dtPoly* poly) const
+{
+	return poly->getType() == DT_POLYTYPE_GROUND &&
+		(poly->flags & m_clearanceIncludeFlags) != 0 &&
+		(poly->flags & m_clearanceExcludeFlags) == 0;
+}
+
+// Squared 2D distance between the outline of a convex polygon and a segment which doesn't cross it.
+// Two such shapes are closest at an end point of one of their edges.
+static float distancePolySegSqr2D(const float* verts, const int nverts, const float* p, const float* q)
+{
+	float t;
+	float best = FLT_MAX;
+	for (int i = 0, j = nverts-1; i < nverts; j = i++)
+	{
+		best = dtMin(best, dtDistancePtSegSqr2D(p, &verts[j*3], &verts[i*3], t));
+		best = dtMin(best, dtDistancePtSegSqr2D(q, &verts[j*3], &verts[i*3], t));
+		best = dtMin(best, dtDistancePtSegSqr2D(&verts[i*3], p, q, t));
+	}
+	return best;
+}
+
+/// @par
+///
+/// For each polygon this walks outward through passable edges, but only through edges closer than
+/// the nearest wall found so far. Any wall nearer than that has to be reached through such an edge,
+/// so the walk never misses one. If the walk runs out of room, the nearest edge it had to skip
+/// caps the result, which keeps the clearance conservative.
+void dtNavMesh::updatePolyClearance(dtMeshTile* tile, const float* qmin, const float* qmax)
+{
+	if (!tile || !tile->polyClearance || !tile->header) return;
+
+	static const int MAX_CLEARANCE_POLYS = 64;
+	static const int MAX_EDGE_LINKS = 8;
+	const dtPolyRef base = getPolyRefBase(tile);
+
+	for (int i = 0; i < tile->header->polyCount; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		if (poly->getType() != DT_POLYTYPE_GROUND)
+		{
+			tile->polyClearance[i] = 0;
+			continue;
+		}
+
+		float verts[DT_VERTS_PER_POLYGON*3];
+		const int nverts = (int)poly->vertCount;
+		for (int j = 0; j < nverts; ++j)
+			dtVcopy(&verts[j*3], &tile->verts[poly->verts[j]*3]);
+
+		if (qmin && qmax)
+		{
+			// Only polygons near the changed area can have a different clearance.
+			float pmin[3], pmax[3];
+			dtVcopy(pmin, verts);
+			dtVcopy(pmax, verts);
+			for (int j = 1; j < nverts; ++j)
+			{
+				dtVmin(pmin, &verts[j*3]);
+				dtVmax(pmax, &verts[j*3]);
+			}
+			if (pmax[0] < qmin[0] || pmin[0] > qmax[0] || pmax[2] < qmin[2] || pmin[2] > qmax[2])
+				continue;
+		}
+
+		dtPolyRef visited[MAX_CLEARANCE_POLYS];
+		int nvisited = 0;
+		int head = 0;
+		visited[nvisited++] = base | (dtPolyRef)i;
+
+		float bestSqr = dtSqr(m_maxClearance);
+
+		while (head < nvisited && bestSqr > 0)
+		{
+			const dtPolyRef curRef = visited[head++];
+			const dtMeshTile* curTile = 0;
+			const dtPoly* curPoly = 0;
+			getTileAndPolyByRefUnsafe(curRef, &curTile, &curPoly);
+
+			for (int j = 0; j < (int)curPoly->vertCount; ++j)
+			{
+				const float* va = &curTile->verts[curPoly->verts[j]*3];
+				const float* vb = &curTile->verts[curPoly->verts[(j+1) % (int)curPoly->vertCount]*3];
+
+				const float distSqr = distancePolySegSqr2D(verts, nverts, va, vb);
+				if (distSqr >= bestSqr)
+					continue;
+
+				// Collect whatever is on the other side of the edge.
+				dtPolyRef neis[MAX_EDGE_LINKS];
+				int nneis = 0;
+				if (curPoly->neis[j] & DT_EXT_LINK)
+				{
+					for (unsigned int k = curPoly->firstLink; k != DT_NULL_LINK && nneis < MAX_EDGE_LINKS; k = curTile->links[k].next)
+					{
+						if (curTile->links[k].edge == j && curTile->links[k].ref)
+							neis[nneis++] = curTile->links[k].ref;
+					}
+				}
+				else if (curPoly->neis[j])
+				{
+					neis[nneis++] = getPolyRefBase(curTile) | (dtPolyRef)(curPoly->neis[j]-1);
+				}
+
+				bool solid = true;
+				for (int k = 0; k < nneis; ++k)
+				{
+					const dtMeshTile* neiTile = 0;
+					const dtPoly* neiPoly = 0;
+					getTileAndPolyByRefUnsafe(neis[k], &neiTile, &neiPoly);
+					if (!passClearanceFlags(neiPoly))
+						continue;
+					solid = false;
+
+					bool seen = false;
+					for (int n = 0; n < nvisited && !seen; ++n)
+						seen = visited[n] == neis[k];
+					if (seen)
+						continue;
+
+					if (nvisited < MAX_CLEARANCE_POLYS)
+						visited[nvisited++] = neis[k];
+					else
+						bestSqr = distSqr;	// Can't look past this edge, so it's as far as we can vouch for.
+				}
+
+				if (solid)
+					bestSqr = distSqr;
+			}
+		}
+
+		tile->polyClearance[i] = dtMathSqrtf(bestSqr);
+	}
+}
+
+void dtNavMesh::updatePolyClearanceAround(const int x, const int y)
+{
+	if (m_maxClearance <= 0) return;
+
+	// Clearance can only change within the clearance limit of the tile's bounds.
+	float qmin[3], qmax[3];
+	qmin[0] = m_orig[0] + x*m_tileWidth - m_maxClearance;
+	qmin[1] = -FLT_MAX;
+	qmin[2] = m_orig[2] + y*m_tileHeight - m_maxClearance;
+	qmax[0] = m_orig[0] + (x+1)*m_tileWidth + m_maxClearance;
+	qmax[1] = FLT_MAX;
+	qmax[2] = m_orig[2] + (y+1)*m_tileHeight + m_maxClearance;
+
+	static const int MAX_NEIS = 32;
+	dtMeshTile* neis[MAX_NEIS];
+
+	int nneis = getTilesAt(x, y, neis, MAX_NEIS);
+	for (int j = 0; j < nneis; ++j)
+		updatePolyClearance(neis[j], 0, 0);
+
+	for (int i = 0; i < 8; ++i)
+	{
+		nneis = getNeighbourTilesAt(x, y, i, neis, MAX_NEIS);
+		for (int j = 0; j < nneis; ++j)
+			updatePolyClearance(neis[j], qmin, qmax);
+	}
+}
+
 void dtNavMesh::connectExtLinks(dtMeshTile* tile, dtMeshTile* target, int side)
 {
 	if (!tile) return;
@@ -517,6 +792,10 @@ void dtNavMesh::connectExtOffMeshLinks(dtMeshTile* tile, dtMeshTile* target, int
 				landPoly->firstLink = tidx;
 			}
 		}
+		else
+		{
+			m_hasOneWayLinks = true;
+		}
 	}
 
 }
@@ -616,6 +895,8 @@ void dtNavMesh::baseOffMeshLinks(dtOffMeshConnection* con)
 		landPoly->firstLink = tidx;
 	}
 
+	updateLinkPortals(tile);
+
 	con->bBased = true;
 }
 
@@ -1071,6 +1352,12 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	tile->data = data;
 	tile->dataSize = dataSize;
 	tile->flags = flags;
+	tile->linkPortals = 0;
+	if (m_linkPortals)
+		tile->linkPortals = (dtLinkPortal*)dtAlloc(sizeof(dtLinkPortal)*header->maxLinkCount, DT_ALLOC_PERM);
+	tile->polyClearance = 0;
+	if (m_maxClearance > 0)
+		tile->polyClearance = (float*)dtAlloc(sizeof(float)*header->polyCount, DT_ALLOC_PERM);
 
 	connectIntLinks(tile);
 
@@ -1094,6 +1381,7 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 		connectExtLinks(neis[j], tile, -1);
 		//connectExtOffMeshLinks(tile, neis[j], -1);
 		//connectExtOffMeshLinks(neis[j], tile, -1);
+		updateLinkPortals(neis[j]);
 	}
 	
 	// Connect with neighbour tiles.
@@ -1106,8 +1394,14 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 			connectExtLinks(neis[j], tile, dtOppositeTile(i));
 			//connectExtOffMeshLinks(tile, neis[j], i);
 			//connectExtOffMeshLinks(neis[j], tile, dtOppositeTile(i));
+			updateLinkPortals(neis[j]);
 		}
 	}
+
+	updateLinkPortals(tile);
+
+	// The new tile can change the clearance of neighbouring polygons near its border.
+	updatePolyClearanceAround(header->x, header->y);
 	
 	if (result)
 		*result = getTileRef(tile);
@@ -1310,8 +1604,12 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	if (tile->salt != tileSalt)
 		return DT_FAILURE | DT_INVALID_PARAM;
 	
+	// The header lives in the tile data, which may be freed below.
+	const int tileX = tile->header->x;
+	const int tileY = tile->header->y;
+
 	// Remove tile from hash lookup.
-	int h = computeTileHash(tile->header->x,tile->header->y,m_tileLutMask);
+	int h = computeTileHash(tileX,tileY,m_tileLutMask);
 	dtMeshTile* prev = 0;
 	dtMeshTile* cur = m_posLookup[h];
 	while (cur)
@@ -1365,6 +1663,12 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 		if (dataSize) *dataSize = tile->dataSize;
 	}
 
+	// Neighbours only lost links, their remaining link portals are still valid.
+	dtFree(tile->linkPortals);
+	tile->linkPortals = 0;
+	dtFree(tile->polyClearance);
+	tile->polyClearance = 0;
+
 	tile->header = 0;
 	tile->flags = 0;
 	tile->linksFreeList = 0;
@@ -1390,6 +1694,9 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	tile->next = m_nextFree;
 	m_nextFree = tile;
 
+	// Neighbours' edges that led into this tile are walls now.
+	updatePolyClearanceAround(tileX, tileY);
+
 	return DT_SUCCESS;
 }
 
@@ -1786,4 +2093,13 @@ void dtNavMesh::GlobalOffMeshLinks(dtOffMeshConnection* con)
 			landPoly->firstLink = tidx;
 		}
 	}
+	else
+	{
+		m_hasOneWayLinks = true;
+	}
+
+	// The off-mesh end vertex moved and both tiles gained links.
+	updateLinkPortals(tile);
+	if (TargetTile != tile)
+		updateLinkPortals(TargetTile);
 }
\ No newline at end of file
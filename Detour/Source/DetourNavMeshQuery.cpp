@@ -101,6 +101,182 @@ inline float dtQueryFilter::getCost(const float* pa, const float* pb,
 #endif	
 	
 static const float H_SCALE = 0.999f; // Search heuristic scale.
+static const float LANDMARK_H_SCALE = 0.9f; // Landmark costs are measured between polygon centres rather than portals, so they are scaled down to stay close to admissible. Only used with DT_FINDPATH_LANDMARKS.
+
+dtLandmarkTable* dtAllocLandmarkTable()
+{
+	void* mem = dtAlloc(sizeof(dtLandmarkTable), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtLandmarkTable;
+}
+
+void dtFreeLandmarkTable(dtLandmarkTable* table)
+{
+	if (!table) return;
+	table->~dtLandmarkTable();
+	dtFree(table);
+}
+
+/// @class dtLandmarkTable
+///
+/// The table does not calculate the costs itself, they are supplied per landmark
+/// with #setLandmarkCosts, typically from a Dijkstra search outwards from (and back
+/// towards) each landmark polygon using the same filter the table is initialised with.
+///
+/// Polygons belonging to a tile which has been rebuilt since #setTile was called
+/// have no entry, and the query falls back to the straight-line heuristic for them.
+///
+dtLandmarkTable::dtLandmarkTable() :
+	m_maxTiles(0),
+	m_polyCount(0),
+	m_landmarkCount(0),
+	m_tileSalt(0),
+	m_tileFirstPoly(0),
+	m_tilePolyCount(0),
+	m_costs(0),
+	m_includeFlags(0),
+	m_excludeFlags(0)
+{
+	for (int i = 0; i < DT_MAX_AREAS; ++i)
+		m_areaCost[i] = 1.0f;
+}
+
+dtLandmarkTable::~dtLandmarkTable()
+{
+	purge();
+}
+
+void dtLandmarkTable::purge()
+{
+	dtFree(m_tileSalt);
+	dtFree(m_tileFirstPoly);
+	dtFree(m_tilePolyCount);
+	dtFree(m_costs);
+	m_tileSalt = 0;
+	m_tileFirstPoly = 0;
+	m_tilePolyCount = 0;
+	m_costs = 0;
+	m_maxTiles = 0;
+	m_polyCount = 0;
+	m_landmarkCount = 0;
+}
+
+dtStatus dtLandmarkTable::init(const int maxTiles, const int polyCount, const int landmarkCount, const dtQueryFilter* filter)
+{
+	purge();
+
+	if (maxTiles <= 0 || polyCount <= 0 || landmarkCount <= 0 || !filter)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	m_tileSalt = (unsigned int*)dtAlloc(sizeof(unsigned int)*maxTiles, DT_ALLOC_PERM);
+	m_tileFirstPoly = (unsigned int*)dtAlloc(sizeof(unsigned int)*maxTiles, DT_ALLOC_PERM);
+	m_tilePolyCount = (unsigned int*)dtAlloc(sizeof(unsigned int)*maxTiles, DT_ALLOC_PERM);
+	m_costs = (float*)dtAlloc(sizeof(float)*2*landmarkCount*polyCount, DT_ALLOC_PERM);
+
+	if (!m_tileSalt || !m_tileFirstPoly || !m_tilePolyCount || !m_costs)
+	{
+		purge();
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	m_maxTiles = maxTiles;
+	m_polyCount = polyCount;
+	m_landmarkCount = landmarkCount;
+
+	memset(m_tileSalt, 0, sizeof(unsigned int)*maxTiles);
+	memset(m_tileFirstPoly, 0, sizeof(unsigned int)*maxTiles);
+	memset(m_tilePolyCount, 0, sizeof(unsigned int)*maxTiles);
+
+	for (int i = 0; i < 2*landmarkCount*polyCount; ++i)
+		m_costs[i] = FLT_MAX;
+
+	for (int i = 0; i < DT_MAX_AREAS; ++i)
+		m_areaCost[i] = filter->getAreaCost(i);
+	m_includeFlags = filter->getIncludeFlags();
+	m_excludeFlags = filter->getExcludeFlags();
+
+	return DT_SUCCESS;
+}
+
+void dtLandmarkTable::setTile(const int tileIndex, const unsigned int salt, const unsigned int firstPoly, const unsigned int polyCount)
+{
+	if (tileIndex < 0 || tileIndex >= m_maxTiles)
+		return;
+	if (firstPoly + polyCount > (unsigned int)m_polyCount)
+		return;
+
+	m_tileSalt[tileIndex] = salt;
+	m_tileFirstPoly[tileIndex] = firstPoly;
+	m_tilePolyCount[tileIndex] = polyCount;
+}
+
+void dtLandmarkTable::setLandmarkCosts(const int landmark, const float* costTo, const float* costFrom)
+{
+	if (landmark < 0 || landmark >= m_landmarkCount || !costTo || !costFrom)
+		return;
+
+	for (int i = 0; i < m_polyCount; ++i)
+	{
+		float* costs = &m_costs[(i*m_landmarkCount + landmark)*2];
+		costs[0] = costTo[i];
+		costs[1] = costFrom[i];
+	}
+}
+
+int dtLandmarkTable::getPolyIndex(const dtNavMesh* nav, const dtPolyRef ref) const
+{
+	if (!m_costs || !ref)
+		return -1;
+
+	unsigned int salt, it, ip;
+	nav->decodePolyId(ref, salt, it, ip);
+
+	if (it >= (unsigned int)m_maxTiles)
+		return -1;
+	if (m_tilePolyCount[it] == 0 || m_tileSalt[it] != salt || ip >= m_tilePolyCount[it])
+		return -1;
+
+	return (int)(m_tileFirstPoly[it] + ip);
+}
+
+float dtLandmarkTable::getLowerBound(const int fromIndex, const int toIndex) const
+{
+	const float* from = &m_costs[fromIndex*m_landmarkCount*2];
+	const float* to = &m_costs[toIndex*m_landmarkCount*2];
+
+	float bound = 0.0f;
+
+	for (int i = 0; i < m_landmarkCount; ++i)
+	{
+		// Triangle inequality both ways round the landmark:
+		// cost(from, to) >= cost(from, L) - cost(to, L), and cost(from, to) >= cost(L, to) - cost(L, from)
+		const float* fromCosts = &from[i*2];
+		const float* toCosts = &to[i*2];
+
+		if (fromCosts[0] != FLT_MAX && toCosts[0] != FLT_MAX)
+			bound = dtMax(bound, fromCosts[0] - toCosts[0]);
+		if (fromCosts[1] != FLT_MAX && toCosts[1] != FLT_MAX)
+			bound = dtMax(bound, toCosts[1] - fromCosts[1]);
+	}
+
+	return bound;
+}
+
+bool dtLandmarkTable::isCompatible(const dtQueryFilter* filter) const
+{
+	if (!m_costs || !filter)
+		return false;
+	if (filter->getIncludeFlags() != m_includeFlags || filter->getExcludeFlags() != m_excludeFlags)
+		return false;
+
+	for (int i = 0; i < DT_MAX_AREAS; ++i)
+	{
+		if (filter->getAreaCost(i) != m_areaCost[i])
+			return false;
+	}
+
+	return true;
+}
 
 
 dtNavMeshQuery* dtAllocNavMeshQuery()
@@ -142,11 +318,15 @@ dtPolyQuery::~dtPolyQuery()
 
 dtNavMeshQuery::dtNavMeshQuery() :
 	m_nav(0),
+	m_nlandmarks(0),
 	m_tinyNodePool(0),
 	m_nodePool(0),
-	m_openList(0)
+	m_openList(0),
+	m_backNodePool(0),
+	m_backOpenList(0)
 {
 	memset(&m_query, 0, sizeof(dtQueryData));
+	memset(m_landmarks, 0, sizeof(m_landmarks));
 }
 
 dtNavMeshQuery::~dtNavMeshQuery()
@@ -157,9 +337,15 @@ dtNavMeshQuery::~dtNavMeshQuery()
 		m_nodePool->~dtNodePool();
 	if (m_openList)
 		m_openList->~dtNodeQueue();
+	if (m_backNodePool)
+		m_backNodePool->~dtNodePool();
+	if (m_backOpenList)
+		m_backOpenList->~dtNodeQueue();
 	dtFree(m_tinyNodePool);
 	dtFree(m_nodePool);
 	dtFree(m_openList);
+	dtFree(m_backNodePool);
+	dtFree(m_backOpenList);
 }
 
 /// @par 
@@ -219,10 +405,105 @@ dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 	{
 		m_openList->clear();
 	}
+
+	// Bidirectional searches keep the backward half separate, the node state bits are already used for tile sides.
+	if (!m_backNodePool || m_backNodePool->getMaxNodes() < maxNodes)
+	{
+		if (m_backNodePool)
+		{
+			m_backNodePool->~dtNodePool();
+			dtFree(m_backNodePool);
+			m_backNodePool = 0;
+		}
+		m_backNodePool = new (dtAlloc(sizeof(dtNodePool), DT_ALLOC_PERM)) dtNodePool(maxNodes, dtNextPow2(maxNodes/4));
+		if (!m_backNodePool)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	else
+	{
+		m_backNodePool->clear();
+	}
+
+	if (!m_backOpenList || m_backOpenList->getCapacity() < maxNodes)
+	{
+		if (m_backOpenList)
+		{
+			m_backOpenList->~dtNodeQueue();
+			dtFree(m_backOpenList);
+			m_backOpenList = 0;
+		}
+		m_backOpenList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxNodes);
+		if (!m_backOpenList)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	else
+	{
+		m_backOpenList->clear();
+	}
 	
 	return DT_SUCCESS;
 }
 
+/// @par
+///
+/// The tables must stay alive (and unchanged) until they are replaced, or the query is destroyed.
+/// If a table is being rebuilt, detach it first.
+///
+void dtNavMeshQuery::setLandmarkTables(const dtLandmarkTable* const* tables, const int count)
+{
+	m_nlandmarks = 0;
+
+	if (!tables)
+		return;
+
+	for (int i = 0; i < count && m_nlandmarks < DT_MAX_LANDMARK_TABLES; ++i)
+	{
+		if (tables[i])
+			m_landmarks[m_nlandmarks++] = tables[i];
+	}
+}
+
+const dtLandmarkTable* dtNavMeshQuery::findLandmarkTable(const dtQueryFilter* filter) const
+{
+	for (int i = 0; i < m_nlandmarks; ++i)
+	{
+		if (m_landmarks[i]->isCompatible(filter))
+			return m_landmarks[i];
+	}
+
+	return 0;
+}
+
+float dtNavMeshQuery::getHeuristic(const dtLandmarkTable* landmarks, const int landmarkEnd, const dtPolyRef ref,
+								   const float* pos, const float* endPos) const
+{
+	const float heuristic = dtVdist(pos, endPos)*H_SCALE;
+
+	if (!landmarks || landmarkEnd < 0)
+		return heuristic;
+
+	const int idx = landmarks->getPolyIndex(m_nav, ref);
+	if (idx < 0)
+		return heuristic;
+
+	return dtMax(heuristic, landmarks->getLowerBound(idx, landmarkEnd)*LANDMARK_H_SCALE);
+}
+
+float dtNavMeshQuery::getReverseHeuristic(const dtLandmarkTable* landmarks, const int landmarkStart, const dtPolyRef ref,
+										  const float* pos, const float* startPos) const
+{
+	const float heuristic = dtVdist(pos, startPos)*H_SCALE;
+
+	if (!landmarks || landmarkStart < 0)
+		return heuristic;
+
+	const int idx = landmarks->getPolyIndex(m_nav, ref);
+	if (idx < 0)
+		return heuristic;
+
+	return dtMax(heuristic, landmarks->getLowerBound(landmarkStart, idx)*LANDMARK_H_SCALE);
+}
+
 dtStatus dtNavMeshQuery::findRandomPoint(const dtQueryFilter* filter, float (*frand)(),
 										 dtPolyRef* randomRef, float* randomPt) const
 {
@@ -803,6 +1084,94 @@ dtFindNearestPolyQuery::~dtFindNearestPolyQuery()
 	// Defined out of line to fix the weak v-tables warning
 }
 
+static const int DT_MAX_NEAREST_POLY_BATCH = 32;
+
+class dtFindNearestPolysQuery : public dtPolyQuery
+{
+	const dtNavMeshQuery* m_query;
+	const float* m_centers;
+	const int m_count;
+	float m_bmin[DT_MAX_NEAREST_POLY_BATCH*3];
+	float m_bmax[DT_MAX_NEAREST_POLY_BATCH*3];
+	float m_nearestDistanceSqr[DT_MAX_NEAREST_POLY_BATCH];
+	dtPolyRef m_nearestRef[DT_MAX_NEAREST_POLY_BATCH];
+	float m_nearestPoint[DT_MAX_NEAREST_POLY_BATCH*3];
+
+public:
+	dtFindNearestPolysQuery(const dtNavMeshQuery* query, const float* centers, const int count, const float* halfExtents)
+		: m_query(query), m_centers(centers), m_count(count)
+	{
+		dtAssert(count <= DT_MAX_NEAREST_POLY_BATCH);
+		for (int i = 0; i < m_count; ++i)
+		{
+			dtVsub(&m_bmin[i*3], &m_centers[i*3], halfExtents);
+			dtVadd(&m_bmax[i*3], &m_centers[i*3], halfExtents);
+			m_nearestDistanceSqr[i] = FLT_MAX;
+			m_nearestRef[i] = 0;
+		}
+	}
+
+	virtual ~dtFindNearestPolysQuery();
+
+	dtPolyRef nearestRef(const int i) const { return m_nearestRef[i]; }
+	const float* nearestPoint(const int i) const { return &m_nearestPoint[i*3]; }
+
+	void process(const dtMeshTile* tile, dtPoly** polys, dtPolyRef* refs, int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			const dtPoly* poly = polys[i];
+
+			float pmin[3], pmax[3];
+			dtVcopy(pmin, &tile->verts[poly->verts[0]*3]);
+			dtVcopy(pmax, pmin);
+			for (int j = 1; j < poly->vertCount; ++j)
+			{
+				const float* v = &tile->verts[poly->verts[j]*3];
+				dtVmin(pmin, v);
+				dtVmax(pmax, v);
+			}
+
+			for (int k = 0; k < m_count; ++k)
+			{
+				// The shared query box is bigger than each point's own box.
+				if (!dtOverlapBounds(&m_bmin[k*3], &m_bmax[k*3], pmin, pmax))
+					continue;
+
+				const float* center = &m_centers[k*3];
+				float closestPtPoly[3];
+				float diff[3];
+				bool posOverPoly = false;
+				float d;
+				m_query->closestPointOnPoly(refs[i], center, closestPtPoly, &posOverPoly);
+
+				// Same scoring as dtFindNearestPolyQuery.
+				dtVsub(diff, center, closestPtPoly);
+				if (posOverPoly)
+				{
+					d = dtAbs(diff[1]) - tile->header->walkableClimb;
+					d = d > 0 ? d*d : 0;
+				}
+				else
+				{
+					d = dtVlenSqr(diff);
+				}
+
+				if (d < m_nearestDistanceSqr[k])
+				{
+					dtVcopy(&m_nearestPoint[k*3], closestPtPoly);
+					m_nearestDistanceSqr[k] = d;
+					m_nearestRef[k] = refs[i];
+				}
+			}
+		}
+	}
+};
+
+dtFindNearestPolysQuery::~dtFindNearestPolysQuery()
+{
+}
+
 /// @par 
 ///
 /// @note If the search box does not intersect any polygons the search will 
@@ -848,6 +1217,65 @@ dtStatus dtNavMeshQuery::findNearestPoly(const float* center, const float* halfE
 	return DT_SUCCESS;
 }
 
+/// @par
+///
+/// The points are handled in groups of up to DT_MAX_NEAREST_POLY_BATCH. Each group runs a single
+/// queryPolygons over the box enclosing all of its search boxes, and every polygon found is scored
+/// against each point whose own search box it overlaps.
+dtStatus dtNavMeshQuery::findNearestPolys(const float* centers, const int count, const float* halfExtents,
+										  const dtQueryFilter* filter,
+										  dtPolyRef* nearestRefs, float* nearestPts) const
+{
+	dtAssert(m_nav);
+
+	if (!centers || count < 0 || !halfExtents || !dtVisfinite(halfExtents) || !nearestRefs)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	for (int start = 0; start < count; start += DT_MAX_NEAREST_POLY_BATCH)
+	{
+		const int n = dtMin(count - start, DT_MAX_NEAREST_POLY_BATCH);
+
+		float bmin[3], bmax[3];
+		for (int i = 0; i < n; ++i)
+		{
+			const float* c = &centers[(start+i)*3];
+			if (!dtVisfinite(c))
+				return DT_FAILURE | DT_INVALID_PARAM;
+			if (i == 0)
+			{
+				dtVcopy(bmin, c);
+				dtVcopy(bmax, c);
+			}
+			else
+			{
+				dtVmin(bmin, c);
+				dtVmax(bmax, c);
+			}
+		}
+
+		float center[3], extents[3];
+		dtVlerp(center, bmin, bmax, 0.5f);
+		dtVsub(extents, bmax, center);
+		dtVadd(extents, extents, halfExtents);
+
+		dtFindNearestPolysQuery query(this, &centers[start*3], n, halfExtents);
+
+		dtStatus status = queryPolygons(center, extents, filter, &query);
+		if (dtStatusFailed(status))
+			return status;
+
+		for (int i = 0; i < n; ++i)
+		{
+			nearestRefs[start+i] = query.nearestRef(i);
+			// Same as findNearestPoly, leave nearestPt alone when nothing was found.
+			if (nearestPts && nearestRefs[start+i])
+				dtVcopy(&nearestPts[(start+i)*3], query.nearestPoint(i));
+		}
+	}
+
+	return DT_SUCCESS;
+}
+
 void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
 										 const dtQueryFilter* filter, dtPolyQuery* query) const
 {
@@ -1092,7 +1520,8 @@ dtStatus dtNavMeshQuery::queryPolygons(const float* center, const float* halfExt
 dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 								  const float* startPos, const float* endPos,
 								  const dtQueryFilter* filter,
-								  dtPolyRef* path, int* pathCount, const int maxPath) const
+								  dtPolyRef* path, int* pathCount, const int maxPath,
+								  const unsigned int options, const float heuristicWeight) const
 {
 	dtAssert(m_nav);
 	dtAssert(m_nodePool);
@@ -1118,15 +1547,29 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 		*pathCount = 1;
 		return DT_SUCCESS;
 	}
+
+	const float weight = dtMax(heuristicWeight, 1.0f);
+
+	if (options & DT_FINDPATH_BIDIRECTIONAL)
+	{
+		dtBidirQuery query;
+		dtStatus status = initBidirSearch(&query, startRef, endRef, startPos, endPos, filter, weight, (options & DT_FINDPATH_LANDMARKS) != 0);
+		while (dtStatusInProgress(status))
+			status = updateBidirSearch(&query, 0x7fffffff, 0, false);
+		return getBidirPath(&query, path, pathCount, maxPath);
+	}
 	
 	m_nodePool->clear();
 	m_openList->clear();
+
+	const dtLandmarkTable* landmarks = (options & DT_FINDPATH_LANDMARKS) ? findLandmarkTable(filter) : 0;
+	const int landmarkEnd = landmarks ? landmarks->getPolyIndex(m_nav, endRef) : -1;
 	
 	dtNode* startNode = m_nodePool->getNode(startRef);
 	dtVcopy(startNode->pos, startPos);
 	startNode->pidx = 0;
 	startNode->cost = 0;
-	startNode->total = dtVdist(startPos, endPos) * H_SCALE;
+	startNode->total = getHeuristic(landmarks, landmarkEnd, startRef, startPos, endPos)*weight;
 	startNode->id = startRef;
 	startNode->flags = DT_NODE_OPEN;
 	m_openList->push(startNode);
@@ -1178,7 +1621,7 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 			// The API input has been checked already, skip checking internal data.
 			const dtMeshTile* neighbourTile = 0;
 			const dtPoly* neighbourPoly = 0;
-			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);			
+			getLinkNeighbour(bestTile, i, neighbourRef, &neighbourTile, &neighbourPoly);
 			
 			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
 				continue;
@@ -1199,7 +1642,7 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 			// If the node is visited the first time, calculate node position.
 			if (neighbourNode->flags == 0)
 			{
-				getEdgeMidPoint(bestRef, bestPoly, bestTile,
+				getLinkMidPoint(bestRef, bestPoly, bestTile, i,
 								neighbourRef, neighbourPoly, neighbourTile,
 								neighbourNode->pos);
 			}
@@ -1211,119 +1654,446 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 			// Special case for last node.
 			if (neighbourRef == endRef)
 			{
-				// Cost
-				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
-													  parentRef, parentTile, parentPoly,
-													  bestRef, bestTile, bestPoly,
-													  neighbourRef, neighbourTile, neighbourPoly);
-				const float endCost = filter->getCost(neighbourNode->pos, endPos,
-													  bestRef, bestTile, bestPoly,
+				// Cost
+				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
+													  parentRef, parentTile, parentPoly,
+													  bestRef, bestTile, bestPoly,
+													  neighbourRef, neighbourTile, neighbourPoly);
+				const float endCost = filter->getCost(neighbourNode->pos, endPos,
+													  bestRef, bestTile, bestPoly,
+													  neighbourRef, neighbourTile, neighbourPoly,
+													  0, 0, 0);
+				
+				cost = bestNode->cost + curCost + endCost;
+				heuristic = 0;
+			}
+			else
+			{
+				// Cost
+				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
+													  parentRef, parentTile, parentPoly,
+													  bestRef, bestTile, bestPoly,
+													  neighbourRef, neighbourTile, neighbourPoly);
+				cost = bestNode->cost + curCost;
+				heuristic = getHeuristic(landmarks, landmarkEnd, neighbourRef, neighbourNode->pos, endPos)*weight;
+			}
+
+			const float total = cost + heuristic;
+			
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+				continue;
+			// The node is already visited and process, and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+				continue;
+			
+			// Add or update the node.
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->id = neighbourRef;
+			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+			neighbourNode->cost = cost;
+			neighbourNode->total = total;
+			
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				// Already in open, update node location.
+				m_openList->modify(neighbourNode);
+			}
+			else
+			{
+				// Put the node in open list.
+				neighbourNode->flags |= DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
+			}
+			
+			// Update nearest node to target so far.
+			if (heuristic < lastBestNodeCost)
+			{
+				lastBestNodeCost = heuristic;
+				lastBestNode = neighbourNode;
+			}
+		}
+	}
+
+	dtStatus status = getPathToNode(lastBestNode, path, pathCount, maxPath);
+
+	if (lastBestNode->id != endRef)
+		status |= DT_PARTIAL_RESULT;
+
+	if (outOfNodes)
+		status |= DT_OUT_OF_NODES;
+	
+	return status;
+}
+
+dtStatus dtNavMeshQuery::getPathToNode(dtNode* endNode, dtPolyRef* path, int* pathCount, int maxPath) const
+{
+	// Find the length of the entire path.
+	dtNode* curNode = endNode;
+	int length = 0;
+	do
+	{
+		length++;
+		curNode = m_nodePool->getNodeAtIdx(curNode->pidx);
+	} while (curNode);
+
+	// If the path cannot be fully stored then advance to the last node we will be able to store.
+	curNode = endNode;
+	int writeCount;
+	for (writeCount = length; writeCount > maxPath; writeCount--)
+	{
+		dtAssert(curNode);
+
+		curNode = m_nodePool->getNodeAtIdx(curNode->pidx);
+	}
+
+	// Write path
+	for (int i = writeCount - 1; i >= 0; i--)
+	{
+		dtAssert(curNode);
+
+		path[i] = curNode->id;
+		curNode = m_nodePool->getNodeAtIdx(curNode->pidx);
+	}
+
+	dtAssert(!curNode);
+
+	*pathCount = dtMin(length, maxPath);
+
+	if (length > maxPath)
+		return DT_SUCCESS | DT_BUFFER_TOO_SMALL;
+
+	return DT_SUCCESS;
+}
+
+
+/// @par
+///
+/// The backward search walks links the wrong way round, only following a link from
+/// polygon B to A if A also links to B. The search stops once either side's cheapest
+/// open node can't improve on the best path found so far, as both are lower bounds
+/// on any path not yet found. One-way off-mesh connections are invisible to the
+/// backward search though, so on meshes which have any (see dtNavMesh::hasOneWayLinks)
+/// only the forward side can end the search, and it does strictly more work than findPath.
+///
+dtStatus dtNavMeshQuery::initBidirSearch(dtBidirQuery* query, dtPolyRef startRef, dtPolyRef endRef,
+										 const float* startPos, const float* endPos,
+										 const dtQueryFilter* filter, const float heuristicWeight, const bool useLandmarks) const
+{
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+	dtAssert(m_backNodePool);
+	dtAssert(m_backOpenList);
+
+	memset(query, 0, sizeof(dtBidirQuery));
+	query->startRef = startRef;
+	query->endRef = endRef;
+	dtVcopy(query->startPos, startPos);
+	dtVcopy(query->endPos, endPos);
+	query->filter = filter;
+	query->heuristicWeight = heuristicWeight;
+	query->meetCost = FLT_MAX;
+
+	m_nodePool->clear();
+	m_openList->clear();
+	m_backNodePool->clear();
+	m_backOpenList->clear();
+
+	query->landmarks = useLandmarks ? findLandmarkTable(filter) : 0;
+	query->landmarkStart = query->landmarks ? query->landmarks->getPolyIndex(m_nav, startRef) : -1;
+	query->landmarkEnd = query->landmarks ? query->landmarks->getPolyIndex(m_nav, endRef) : -1;
+
+	dtNode* startNode = m_nodePool->getNode(startRef);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = getHeuristic(query->landmarks, query->landmarkEnd, startRef, startPos, endPos)*heuristicWeight;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+
+	// Backward nodes sit on the portal leading out of their polygon towards the end, and their cost is from there to the end.
+	dtNode* endNode = m_backNodePool->getNode(endRef);
+	dtVcopy(endNode->pos, endPos);
+	endNode->pidx = 0;
+	endNode->cost = 0;
+	endNode->total = getReverseHeuristic(query->landmarks, query->landmarkStart, endRef, endPos, startPos)*heuristicWeight;
+	endNode->id = endRef;
+	endNode->flags = DT_NODE_OPEN;
+	m_backOpenList->push(endNode);
+
+	query->lastBestNode = startNode;
+	query->lastBestNodeCost = startNode->total;
+	query->status = DT_IN_PROGRESS;
+
+	return query->status;
+}
+
+void dtNavMeshQuery::checkBidirMeeting(dtBidirQuery* query, dtNode* node, dtNode* backNode) const
+{
+	if (!(node->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)) || !(backNode->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)))
+		return;
+
+	const dtPolyRef prevRef = node->pidx ? m_nodePool->getNodeAtIdx(node->pidx)->id : 0;
+	const dtPolyRef nextRef = backNode->pidx ? m_backNodePool->getNodeAtIdx(backNode->pidx)->id : 0;
+
+	const dtMeshTile* prevTile = 0;
+	const dtPoly* prevPoly = 0;
+	const dtMeshTile* curTile = 0;
+	const dtPoly* curPoly = 0;
+	const dtMeshTile* nextTile = 0;
+	const dtPoly* nextPoly = 0;
+
+	m_nav->getTileAndPolyByRefUnsafe(node->id, &curTile, &curPoly);
+	if (prevRef)
+		m_nav->getTileAndPolyByRefUnsafe(prevRef, &prevTile, &prevPoly);
+	if (nextRef)
+		m_nav->getTileAndPolyByRefUnsafe(nextRef, &nextTile, &nextPoly);
+
+	// Cost of crossing the polygon from where the forward search entered it to where the backward search leaves it.
+	const float crossCost = query->filter->getCost(node->pos, backNode->pos,
+												   prevRef, prevTile, prevPoly,
+												   node->id, curTile, curPoly,
+												   nextRef, nextTile, nextPoly);
+
+	const float total = node->cost + crossCost + backNode->cost;
+
+	if (total < query->meetCost)
+	{
+		query->meetCost = total;
+		query->meetNode = node;
+		query->meetBackNode = backNode;
+	}
+}
+
+dtStatus dtNavMeshQuery::updateBidirSearch(dtBidirQuery* query, const int maxIter, int* doneIters, const bool validateRefs) const
+{
+	if (!dtStatusInProgress(query->status))
+		return query->status;
+
+	const dtQueryFilter* filter = query->filter;
+
+	// Without one-way links every path the forward search can take, the backward search can take too.
+	const bool backwardBounds = !m_nav->hasOneWayLinks();
+
+	int iter = 0;
+	while (iter < maxIter)
+	{
+		// Any path not yet found has to pass through an open node on each side, so it can't cost less than either side's cheapest.
+		if (m_openList->empty() || m_openList->top()->total >= query->meetCost ||
+			(backwardBounds && !m_backOpenList->empty() && m_backOpenList->top()->total >= query->meetCost))
+		{
+			const dtStatus details = query->status & DT_STATUS_DETAIL_MASK;
+			query->status = DT_SUCCESS | details;
+			break;
+		}
+
+		iter++;
+
+		// Expand whichever side has the more promising node.
+		const bool backward = !m_backOpenList->empty() && m_backOpenList->top()->total < m_openList->top()->total;
+
+		dtNodePool* nodePool = backward ? m_backNodePool : m_nodePool;
+		dtNodeQueue* openList = backward ? m_backOpenList : m_openList;
+		dtNodePool* otherPool = backward ? m_nodePool : m_backNodePool;
+
+		dtNode* bestNode = openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		const dtPolyRef bestRef = bestNode->id;
+
+		// Join up with any node the other side has on this polygon.
+		dtNode* otherNodes[DT_MAX_STATES_PER_NODE];
+		const int otherCount = (int)otherPool->findNodes(bestRef, otherNodes, DT_MAX_STATES_PER_NODE);
+		for (int i = 0; i < otherCount; ++i)
+		{
+			if (backward)
+				checkBidirMeeting(query, otherNodes[i], bestNode);
+			else
+				checkBidirMeeting(query, bestNode, otherNodes[i]);
+		}
+
+		// Nothing past the far end is of any use.
+		if (bestRef == (backward ? query->startRef : query->endRef))
+			continue;
+
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		if (validateRefs)
+		{
+			if (dtStatusFailed(m_nav->getTileAndPolyByRef(bestRef, &bestTile, &bestPoly)))
+			{
+				// The polygon has disappeared during the sliced query, fail.
+				query->status = DT_FAILURE;
+				break;
+			}
+		}
+		else
+		{
+			m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+		}
+
+		// Forwards this is the previous polygon, backwards it is the next one.
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+			parentRef = nodePool->getNodeAtIdx(bestNode->pidx)->id;
+		if (parentRef)
+		{
+			if (validateRefs && !m_nav->isValidPolyRef(parentRef))
+			{
+				query->status = DT_FAILURE;
+				break;
+			}
+			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+		}
+
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		{
+			dtPolyRef neighbourRef = bestTile->links[i].ref;
+
+			// Skip invalid ids and do not expand back to where we came from.
+			if (!neighbourRef || neighbourRef == parentRef)
+				continue;
+
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			getLinkNeighbour(bestTile, i, neighbourRef, &neighbourTile, &neighbourPoly);
+
+			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+
+			// Backwards, the neighbour must be able to move into this polygon.
+			if (backward)
+			{
+				bool linksBack = false;
+				for (unsigned int j = neighbourPoly->firstLink; j != DT_NULL_LINK && !linksBack; j = neighbourTile->links[j].next)
+					linksBack = neighbourTile->links[j].ref == bestRef;
+				if (!linksBack)
+					continue;
+			}
+
+			// deal explicitly with crossing tile boundaries
+			unsigned char crossSide = 0;
+			if (bestTile->links[i].side != 0xff)
+				crossSide = bestTile->links[i].side >> 1;
+
+			dtNode* neighbourNode = nodePool->getNode(neighbourRef, crossSide);
+			if (!neighbourNode)
+			{
+				query->status |= DT_OUT_OF_NODES;
+				continue;
+			}
+
+			// If the node is visited the first time, calculate node position.
+			if (neighbourNode->flags == 0)
+			{
+				getLinkMidPoint(bestRef, bestPoly, bestTile, i,
+								neighbourRef, neighbourPoly, neighbourTile,
+								neighbourNode->pos);
+			}
+
+			float cost = 0;
+			float heuristic = 0;
+
+			if (backward)
+			{
+				// Crossing this polygon from the shared portal to where the path leaves it.
+				const float curCost = filter->getCost(neighbourNode->pos, bestNode->pos,
 													  neighbourRef, neighbourTile, neighbourPoly,
-													  0, 0, 0);
-				
-				cost = bestNode->cost + curCost + endCost;
-				heuristic = 0;
+													  bestRef, bestTile, bestPoly,
+													  parentRef, parentTile, parentPoly);
+				cost = bestNode->cost + curCost;
+				heuristic = getReverseHeuristic(query->landmarks, query->landmarkStart, neighbourRef, neighbourNode->pos, query->startPos)*query->heuristicWeight;
 			}
 			else
 			{
-				// Cost
 				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
 													  parentRef, parentTile, parentPoly,
 													  bestRef, bestTile, bestPoly,
 													  neighbourRef, neighbourTile, neighbourPoly);
 				cost = bestNode->cost + curCost;
-				heuristic = dtVdist(neighbourNode->pos, endPos)*H_SCALE;
+				heuristic = getHeuristic(query->landmarks, query->landmarkEnd, neighbourRef, neighbourNode->pos, query->endPos)*query->heuristicWeight;
 			}
 
 			const float total = cost + heuristic;
-			
+
 			// The node is already in open list and the new result is worse, skip.
 			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
 				continue;
 			// The node is already visited and process, and the new result is worse, skip.
 			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
 				continue;
-			
+
 			// Add or update the node.
-			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->pidx = nodePool->getNodeIdx(bestNode);
 			neighbourNode->id = neighbourRef;
 			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
 			neighbourNode->cost = cost;
 			neighbourNode->total = total;
-			
+
 			if (neighbourNode->flags & DT_NODE_OPEN)
 			{
 				// Already in open, update node location.
-				m_openList->modify(neighbourNode);
+				openList->modify(neighbourNode);
 			}
 			else
 			{
 				// Put the node in open list.
 				neighbourNode->flags |= DT_NODE_OPEN;
-				m_openList->push(neighbourNode);
+				openList->push(neighbourNode);
 			}
-			
+
 			// Update nearest node to target so far.
-			if (heuristic < lastBestNodeCost)
+			if (!backward && heuristic < query->lastBestNodeCost)
 			{
-				lastBestNodeCost = heuristic;
-				lastBestNode = neighbourNode;
+				query->lastBestNodeCost = heuristic;
+				query->lastBestNode = neighbourNode;
 			}
 		}
 	}
 
-	dtStatus status = getPathToNode(lastBestNode, path, pathCount, maxPath);
-
-	if (lastBestNode->id != endRef)
-		status |= DT_PARTIAL_RESULT;
+	if (doneIters)
+		*doneIters = iter;
 
-	if (outOfNodes)
-		status |= DT_OUT_OF_NODES;
-	
-	return status;
+	return query->status;
 }
 
-dtStatus dtNavMeshQuery::getPathToNode(dtNode* endNode, dtPolyRef* path, int* pathCount, int maxPath) const
+dtStatus dtNavMeshQuery::getBidirPath(const dtBidirQuery* query, dtPolyRef* path, int* pathCount, const int maxPath) const
 {
-	// Find the length of the entire path.
-	dtNode* curNode = endNode;
-	int length = 0;
-	do
-	{
-		length++;
-		curNode = m_nodePool->getNodeAtIdx(curNode->pidx);
-	} while (curNode);
+	const dtStatus details = query->status & DT_STATUS_DETAIL_MASK;
 
-	// If the path cannot be fully stored then advance to the last node we will be able to store.
-	curNode = endNode;
-	int writeCount;
-	for (writeCount = length; writeCount > maxPath; writeCount--)
+	// Never met, so give the partial path towards the end like findPath does.
+	if (!query->meetNode)
 	{
-		dtAssert(curNode);
+		if (!query->lastBestNode)
+			return DT_FAILURE;
 
-		curNode = m_nodePool->getNodeAtIdx(curNode->pidx);
+		dtStatus status = getPathToNode(query->lastBestNode, path, pathCount, maxPath);
+		return status | DT_PARTIAL_RESULT | details;
 	}
 
-	// Write path
-	for (int i = writeCount - 1; i >= 0; i--)
-	{
-		dtAssert(curNode);
+	// Start up to and including the meeting polygon, then the backward nodes already run towards the end.
+	dtStatus status = getPathToNode(query->meetNode, path, pathCount, maxPath);
 
-		path[i] = curNode->id;
-		curNode = m_nodePool->getNodeAtIdx(curNode->pidx);
+	int n = *pathCount;
+	const dtNode* node = m_backNodePool->getNodeAtIdx(query->meetBackNode->pidx);
+	while (node && n < maxPath)
+	{
+		path[n++] = node->id;
+		node = m_backNodePool->getNodeAtIdx(node->pidx);
 	}
 
-	dtAssert(!curNode);
-
-	*pathCount = dtMin(length, maxPath);
+	if (node)
+		status |= DT_BUFFER_TOO_SMALL;
 
-	if (length > maxPath)
-		return DT_SUCCESS | DT_BUFFER_TOO_SMALL;
+	*pathCount = n;
 
-	return DT_SUCCESS;
+	return status | details;
 }
 
-
 /// @par
 ///
 /// @warning Calling any non-slice methods before calling finalizeSlicedFindPath() 
@@ -1334,7 +2104,8 @@ dtStatus dtNavMeshQuery::getPathToNode(dtNode* endNode, dtPolyRef* path, int* pa
 ///
 dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef,
 											const float* startPos, const float* endPos,
-											const dtQueryFilter* filter, const unsigned int options)
+											const dtQueryFilter* filter, const unsigned int options,
+											const float heuristicWeight)
 {
 	dtAssert(m_nav);
 	dtAssert(m_nodePool);
@@ -1352,6 +2123,7 @@ dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef
 	m_query.filter = filter;
 	m_query.options = options;
 	m_query.raycastLimitSqr = FLT_MAX;
+	m_query.heuristicWeight = dtMax(heuristicWeight, 1.0f);
 	
 	// Validate input
 	if (!m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
@@ -1362,7 +2134,7 @@ dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef
 	}
 
 	// trade quality with performance?
-	if (options & DT_FINDPATH_ANY_ANGLE)
+	if ((options & DT_FINDPATH_ANY_ANGLE) && !(options & DT_FINDPATH_BIDIRECTIONAL))
 	{
 		// limiting to several times the character radius yields nice results. It is not sensitive 
 		// so it is enough to compute it from the first tile.
@@ -1376,15 +2148,24 @@ dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef
 		m_query.status = DT_SUCCESS;
 		return DT_SUCCESS;
 	}
+
+	if (options & DT_FINDPATH_BIDIRECTIONAL)
+	{
+		m_query.status = initBidirSearch(&m_query.bidir, startRef, endRef, startPos, endPos, filter, m_query.heuristicWeight, (options & DT_FINDPATH_LANDMARKS) != 0);
+		return m_query.status;
+	}
 	
 	m_nodePool->clear();
 	m_openList->clear();
+
+	m_query.landmarks = (options & DT_FINDPATH_LANDMARKS) ? findLandmarkTable(filter) : 0;
+	m_query.landmarkEnd = m_query.landmarks ? m_query.landmarks->getPolyIndex(m_nav, endRef) : -1;
 	
 	dtNode* startNode = m_nodePool->getNode(startRef);
 	dtVcopy(startNode->pos, startPos);
 	startNode->pidx = 0;
 	startNode->cost = 0;
-	startNode->total = dtVdist(startPos, endPos) * H_SCALE;
+	startNode->total = getHeuristic(m_query.landmarks, m_query.landmarkEnd, startRef, startPos, endPos)*m_query.heuristicWeight;
 	startNode->id = startRef;
 	startNode->flags = DT_NODE_OPEN;
 	m_openList->push(startNode);
@@ -1408,6 +2189,12 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 		return DT_FAILURE;
 	}
 
+	if (m_query.options & DT_FINDPATH_BIDIRECTIONAL)
+	{
+		m_query.status = updateBidirSearch(&m_query.bidir, maxIter, doneIters, true);
+		return m_query.status;
+	}
+
 	dtRaycastHit rayHit;
 	rayHit.maxPath = 0;
 		
@@ -1491,7 +2278,7 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 			// The API input has been checked already, skip checking internal data.
 			const dtMeshTile* neighbourTile = 0;
 			const dtPoly* neighbourPoly = 0;
-			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);			
+			getLinkNeighbour(bestTile, i, neighbourRef, &neighbourTile, &neighbourPoly);
 			
 			if (!m_query.filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
 				continue;
@@ -1511,7 +2298,7 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 			// If the node is visited the first time, calculate node position.
 			if (neighbourNode->flags == 0)
 			{
-				getEdgeMidPoint(bestRef, bestPoly, bestTile,
+				getLinkMidPoint(bestRef, bestPoly, bestTile, i,
 								neighbourRef, neighbourPoly, neighbourTile,
 								neighbourNode->pos);
 			}
@@ -1558,7 +2345,7 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 			}
 			else
 			{
-				heuristic = dtVdist(neighbourNode->pos, m_query.endPos)*H_SCALE;
+				heuristic = getHeuristic(m_query.landmarks, m_query.landmarkEnd, neighbourRef, neighbourNode->pos, m_query.endPos)*m_query.heuristicWeight;
 			}
 			
 			const float total = cost + heuristic;
@@ -1632,6 +2419,16 @@ dtStatus dtNavMeshQuery::finalizeSlicedFindPath(dtPolyRef* path, int* pathCount,
 
 	int n = 0;
 
+	if (m_query.startRef != m_query.endRef && (m_query.options & DT_FINDPATH_BIDIRECTIONAL))
+	{
+		const dtStatus status = getBidirPath(&m_query.bidir, path, pathCount, maxPath);
+
+		// Reset query.
+		memset(&m_query, 0, sizeof(dtQueryData));
+
+		return status;
+	}
+
 	if (m_query.startRef == m_query.endRef)
 	{
 		// Special case: the search starts and ends at same poly.
@@ -1722,6 +2519,17 @@ dtStatus dtNavMeshQuery::finalizeSlicedFindPathPartial(const dtPolyRef* existing
 	}
 	
 	int n = 0;
+
+	// The existing path isn't much use when half the search ran backwards, so return the best path so far instead.
+	if (m_query.startRef != m_query.endRef && (m_query.options & DT_FINDPATH_BIDIRECTIONAL))
+	{
+		const dtStatus status = getBidirPath(&m_query.bidir, path, pathCount, maxPath);
+
+		// Reset query.
+		memset(&m_query, 0, sizeof(dtQueryData));
+
+		return status;
+	}
 	
 	if (m_query.startRef == m_query.endRef)
 	{
@@ -2401,6 +3209,15 @@ dtStatus dtNavMeshQuery::getPortalPoints(dtPolyRef from, const dtPoly* fromPoly,
 	}
 	if (!link)
 		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Ground to ground portals are precomputed when the link is made.
+	if (fromTile->linkPortals && fromPoly->getType() == DT_POLYTYPE_GROUND && toPoly->getType() == DT_POLYTYPE_GROUND)
+	{
+		const dtLinkPortal* portal = &fromTile->linkPortals[link - fromTile->links];
+		dtVcopy(left, portal->left);
+		dtVcopy(right, portal->right);
+		return DT_SUCCESS;
+	}
 	
 	// Handle off-mesh connections.
 	if (fromPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
@@ -2484,6 +3301,15 @@ dtStatus dtNavMeshQuery::getEdgeMidPoint(dtPolyRef from, const dtPoly* fromPoly,
 	return DT_SUCCESS;
 }
 
+void dtNavMeshQuery::getLinkMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile, const unsigned int link,
+									 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile, float* mid) const
+{
+	if (fromTile->linkPortals)
+		dtVcopy(mid, fromTile->linkPortals[link].mid);
+	else
+		getEdgeMidPoint(from, fromPoly, fromTile, to, toPoly, toTile, mid);
+}
+
 
 
 /// @par
@@ -2594,6 +3420,7 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 	hit->t = 0;
 	hit->pathCount = 0;
 	hit->pathCost = 0;
+	hit->lastRef = 0;
 
 	// Validate input
 	if (!m_nav->isValidPolyRef(startRef) ||
@@ -2661,6 +3488,7 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 			hit->path[n++] = curRef;
 		else
 			status |= DT_BUFFER_TOO_SMALL;
+		hit->lastRef = curRef;
 
 		// Ray end is completely inside the polygon.
 		if (segMax == -1)
@@ -2807,6 +3635,36 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 	return status;
 }
 
+/// @par
+///
+/// For probing several directions from one spot. Each ray walks the mesh on its own,
+/// see raycast() for the caveats of the 2D check.
+dtStatus dtNavMeshQuery::raycasts(dtPolyRef startRef, const float* startPos, const float* endPos, const int count,
+								  const dtQueryFilter* filter, const unsigned int options,
+								  dtRaycastHit* hits) const
+{
+	dtAssert(m_nav);
+
+	if (!m_nav->isValidPolyRef(startRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || count < 0 || !filter || !hits)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	dtStatus status = DT_SUCCESS;
+
+	for (int i = 0; i < count; ++i)
+	{
+		const dtStatus rayStatus = raycast(startRef, startPos, &endPos[i*3], filter, options, &hits[i]);
+		if (dtStatusFailed(rayStatus))
+			return rayStatus;
+		status |= rayStatus;
+	}
+
+	return status;
+}
+
 /// @par
 ///
 /// At least one result array must be provided.
@@ -3171,6 +4029,177 @@ dtStatus dtNavMeshQuery::findPolysAroundShape(dtPolyRef startRef, const float* v
 	return status;
 }
 
+/// @par
+///
+/// The search expands outwards from @p startPos in order of increasing cost, the same as findPolysAroundCircle,
+/// and finishes as soon as every goal polygon has been reached, the cheapest open polygon costs more than 
+/// @p maxCost, or the graph is exhausted. This makes ranking many candidate destinations cost one search
+/// instead of one findPath per candidate.
+///
+/// Costs are measured between portal edge midpoints, so they are an approximation of the cost of the straight
+/// path, the same as the costs used by findPath. If the node pool runs out the result includes DT_OUT_OF_NODES
+/// and the goals which were not reached have a cost of FLT_MAX.
+///
+dtStatus dtNavMeshQuery::findPathCostsToPolys(dtPolyRef startRef, const float* startPos,
+											  const dtPolyRef* goalRefs, const float* goalPos, const int goalCount,
+											  const dtQueryFilter* filter, const float maxCost,
+											  float* resultCost, int* resultCount) const
+{
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+
+	if (resultCount)
+		*resultCount = 0;
+
+	if (!m_nav->isValidPolyRef(startRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!goalRefs || !goalPos || goalCount < 0 ||
+		!filter || !resultCost || maxCost < 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	int remaining = 0;
+	for (int i = 0; i < goalCount; ++i)
+	{
+		resultCost[i] = FLT_MAX;
+		if (goalRefs[i])
+			remaining++;
+	}
+
+	m_nodePool->clear();
+	m_openList->clear();
+
+	dtNode* startNode = m_nodePool->getNode(startRef);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = 0;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+
+	dtStatus status = DT_SUCCESS;
+
+	int n = 0;
+
+	while (!m_openList->empty() && remaining > 0)
+	{
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		// Everything left is even more expensive.
+		if (bestNode->total > maxCost)
+			break;
+
+		// Get poly and tile.
+		// The API input has been checked already, skip checking internal data.
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+
+		// Get parent poly and tile.
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
+		if (parentRef)
+			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+
+		// The polygon is closed, so its cost is final. Finish any goals inside it.
+		for (int i = 0; i < goalCount; ++i)
+		{
+			if (goalRefs[i] != bestRef || resultCost[i] != FLT_MAX)
+				continue;
+
+			const float* pos = &goalPos[i*3];
+			const float cost = bestNode->total + filter->getCost(bestNode->pos, pos,
+																 parentRef, parentTile, parentPoly,
+																 bestRef, bestTile, bestPoly,
+																 0, 0, 0);
+			if (cost <= maxCost)
+			{
+				resultCost[i] = cost;
+				++n;
+			}
+			remaining--;
+		}
+
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		{
+			const dtLink* link = &bestTile->links[i];
+			dtPolyRef neighbourRef = link->ref;
+			// Skip invalid neighbours and do not follow back to parent.
+			if (!neighbourRef || neighbourRef == parentRef)
+				continue;
+
+			// Expand to neighbour
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+
+			// Do not advance if the polygon is excluded by the filter.
+			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+
+			// Find edge.
+			float va[3], vb[3];
+			if (!getPortalPoints(bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
+				continue;
+
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef);
+			if (!neighbourNode)
+			{
+				status |= DT_OUT_OF_NODES;
+				continue;
+			}
+
+			if (neighbourNode->flags & DT_NODE_CLOSED)
+				continue;
+
+			// Cost
+			if (neighbourNode->flags == 0)
+				dtVlerp(neighbourNode->pos, va, vb, 0.5f);
+
+			float cost = filter->getCost(
+				bestNode->pos, neighbourNode->pos,
+				parentRef, parentTile, parentPoly,
+				bestRef, bestTile, bestPoly,
+				neighbourRef, neighbourTile, neighbourPoly);
+
+			const float total = bestNode->total + cost;
+
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+				continue;
+
+			neighbourNode->id = neighbourRef;
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->total = total;
+
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				m_openList->modify(neighbourNode);
+			}
+			else
+			{
+				neighbourNode->flags = DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
+			}
+		}
+	}
+
+	if (resultCount)
+		*resultCount = n;
+
+	return status;
+}
+
+
 dtStatus dtNavMeshQuery::getPathFromDijkstraSearch(dtPolyRef endRef, dtPolyRef* path, int* pathCount, int maxPath) const
 {
 	if (!m_nav->isValidPolyRef(endRef) || !path || !pathCount || maxPath < 0)
@@ -52,6 +52,8 @@ dtNodePool::dtNodePool(int maxNodes, int hashSize) :
 	m_nodes(0),
 	m_first(0),
 	m_next(0),
+	m_bucketGen(0),
+	m_generation(1),
 	m_maxNodes(maxNodes),
 	m_hashSize(hashSize),
 	m_nodeCount(0)
@@ -64,13 +66,16 @@ dtNodePool::dtNodePool(int maxNodes, int hashSize) :
 	m_nodes = (dtNode*)dtAlloc(sizeof(dtNode)*m_maxNodes, DT_ALLOC_PERM);
 	m_next = (dtNodeIndex*)dtAlloc(sizeof(dtNodeIndex)*m_maxNodes, DT_ALLOC_PERM);
 	m_first = (dtNodeIndex*)dtAlloc(sizeof(dtNodeIndex)*hashSize, DT_ALLOC_PERM);
+	m_bucketGen = (unsigned int*)dtAlloc(sizeof(unsigned int)*hashSize, DT_ALLOC_PERM);
 
 	dtAssert(m_nodes);
 	dtAssert(m_next);
 	dtAssert(m_first);
+	dtAssert(m_bucketGen);
 
 	memset(m_first, 0xff, sizeof(dtNodeIndex)*m_hashSize);
 	memset(m_next, 0xff, sizeof(dtNodeIndex)*m_maxNodes);
+	memset(m_bucketGen, 0, sizeof(unsigned int)*m_hashSize);
 }
 
 dtNodePool::~dtNodePool()
@@ -78,11 +83,19 @@ dtNodePool::~dtNodePool()
 	dtFree(m_nodes);
 	dtFree(m_next);
 	dtFree(m_first);
+	dtFree(m_bucketGen);
 }
 
 void dtNodePool::clear()
 {
-	memset(m_first, 0xff, sizeof(dtNodeIndex)*m_hashSize);
+	// Bumping the generation invalidates every bucket at once. Only wipe the stamps
+	// when the counter wraps, so a stale stamp can never match the new generation.
+	m_generation++;
+	if (m_generation == 0)
+	{
+		memset(m_bucketGen, 0, sizeof(unsigned int)*m_hashSize);
+		m_generation = 1;
+	}
 	m_nodeCount = 0;
 }
 
@@ -90,7 +103,7 @@ unsigned int dtNodePool::findNodes(dtPolyRef id, dtNode** nodes, const int maxNo
 {
 	int n = 0;
 	unsigned int bucket = dtHashRef(id) & (m_hashSize-1);
-	dtNodeIndex i = m_first[bucket];
+	dtNodeIndex i = getBucketHead(bucket);
 	while (i != DT_NULL_IDX)
 	{
 		if (m_nodes[i].id == id)
@@ -108,7 +121,7 @@ unsigned int dtNodePool::findNodes(dtPolyRef id, dtNode** nodes, const int maxNo
 dtNode* dtNodePool::findNode(dtPolyRef id, unsigned char state)
 {
 	unsigned int bucket = dtHashRef(id) & (m_hashSize-1);
-	dtNodeIndex i = m_first[bucket];
+	dtNodeIndex i = getBucketHead(bucket);
 	while (i != DT_NULL_IDX)
 	{
 		if (m_nodes[i].id == id && m_nodes[i].state == state)
@@ -121,7 +134,7 @@ dtNode* dtNodePool::findNode(dtPolyRef id, unsigned char state)
 dtNode* dtNodePool::getNode(dtPolyRef id, unsigned char state)
 {
 	unsigned int bucket = dtHashRef(id) & (m_hashSize-1);
-	dtNodeIndex i = m_first[bucket];
+	dtNodeIndex i = getBucketHead(bucket);
 	dtNode* node = 0;
 	while (i != DT_NULL_IDX)
 	{
@@ -144,9 +157,11 @@ dtNode* dtNodePool::getNode(dtPolyRef id, unsigned char state)
 	node->id = id;
 	node->state = state;
 	node->flags = 0;
+	node->heapIdx = -1;
 	
-	m_next[i] = m_first[bucket];
+	m_next[i] = getBucketHead(bucket);
 	m_first[bucket] = i;
+	m_bucketGen[bucket] = m_generation;
 	
 	return node;
 }
@@ -171,30 +186,37 @@ dtNodeQueue::~dtNodeQueue()
 
 void dtNodeQueue::bubbleUp(int i, dtNode* node)
 {
-	int parent = (i-1)/2;
+	int parent = (i-1)/4;
 	// note: (index > 0) means there is a parent
 	while ((i > 0) && (m_heap[parent]->total > node->total))
 	{
 		m_heap[i] = m_heap[parent];
+		m_heap[i]->heapIdx = i;
 		i = parent;
-		parent = (i-1)/2;
+		parent = (i-1)/4;
 	}
 	m_heap[i] = node;
+	node->heapIdx = i;
 }
 
 void dtNodeQueue::trickleDown(int i, dtNode* node)
 {
-	int child = (i*2)+1;
+	// Walk the smallest child all the way down to a leaf, then settle the node from there.
+	// Cheaper than comparing against the node at every level, as it usually ends up near the bottom anyway.
+	int child = (i*4)+1;
 	while (child < m_size)
 	{
-		if (((child+1) < m_size) && 
-			(m_heap[child]->total > m_heap[child+1]->total))
+		const int lastChild = dtMin(child+4, m_size);
+		int best = child;
+		for (int c = child+1; c < lastChild; ++c)
 		{
-			child++;
+			if (m_heap[c]->total < m_heap[best]->total)
+				best = c;
 		}
-		m_heap[i] = m_heap[child];
-		i = child;
-		child = (i*2)+1;
+		m_heap[i] = m_heap[best];
+		m_heap[i]->heapIdx = i;
+		i = best;
+		child = (i*4)+1;
 	}
 	bubbleUp(i, node);
 }
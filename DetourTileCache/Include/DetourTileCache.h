@@ -167,10 +167,41 @@ public:
 	///  							If the tile cache is up to date another (immediate) call to update will have no effect;
 	///  							otherwise another call will continue processing obstacle requests and tile rebuilds.
 	dtStatus update(const float dt, class dtNavMesh* navmesh, bool* upToDate = 0);
+
+	/// Returns true if there are obstacle or off-mesh requests, or tile rebuilds, still waiting for update() to process them.
+	inline bool hasPendingUpdates() const { return m_nreqs > 0 || m_nOffMeshReqs > 0 || m_nupdate > 0; }
+
+	/// Number of obstacle and off-mesh requests that the next update() will turn into tile rebuilds.
+	inline int getPendingRequestCount() const { return m_nreqs + m_nOffMeshReqs; }
+
+	/// Number of tiles waiting to be rebuilt. update() rebuilds one per call, starting with index 0.
+	inline int getPendingUpdateCount() const { return m_nupdate; }
+
+	/// Returns the compressed tile waiting to be rebuilt at the given position in the update queue.
+	inline dtCompressedTileRef getPendingUpdate(const int i) const { return m_update[i]; }
+
+	/// Moves a pending tile rebuild to the front of the update queue so the next call to update() builds it.
+	/// The order of the other pending rebuilds is preserved.
+	///  @param[in]		i			Position of the tile in the update queue. [Limit: 0 <= value < getPendingUpdateCount()]
+	void prioritiseUpdate(const int i);
 	
 	dtStatus buildNavMeshTilesAt(const int tx, const int ty, class dtNavMesh* navmesh);
 	
 	dtStatus buildNavMeshTile(const dtCompressedTileRef ref, class dtNavMesh* navmesh);
+
+	/// Builds the nav mesh data for a tile without adding it to a nav mesh. Does not modify the tile cache, so 
+	/// several tiles can be built at once from different threads as long as each uses its own allocator.
+	///  @param[in]		ref			The compressed tile to build.
+	///  @param[in]		talloc		Scratch allocator for the build. Must not be shared with another thread.
+	///  @param[out]	navData		The built tile data, allocated with dtAlloc. Null if the tile has no polys.
+	///  @param[out]	navDataSize	The size of the built tile data.
+	dtStatus buildNavMeshTileData(const dtCompressedTileRef ref, struct dtTileCacheAlloc* talloc,
+								  unsigned char** navData, int* navDataSize) const;
+
+	/// Replaces the nav mesh tile at the compressed tile's location with data from buildNavMeshTileData.
+	/// The nav mesh takes ownership of navData. A null navData just removes the existing tile.
+	dtStatus addNavMeshTileData(const dtCompressedTileRef ref, class dtNavMesh* navmesh,
+								unsigned char* navData, const int navDataSize);
 	
 	void calcTightTileBounds(const struct dtTileCacheLayerHeader* header, float* bmin, float* bmax) const;
 	
@@ -265,6 +296,27 @@ private:
 		int action;
 		dtOffMeshConnectionRef ref;
 	};
+
+	/// Adds a tile to the update queue if it isn't already in it. Returns false if the queue could not grow.
+	bool queueTileUpdate(const dtCompressedTileRef ref);
+
+	/// Adds the obstacle to the obstacle list of every tile it touches.
+	void linkObstacle(const int obIdx);
+
+	/// Removes the obstacle from the obstacle lists of the tiles it touches.
+	void unlinkObstacle(const int obIdx);
+
+	/// Unlinks the obstacle and returns it to the free list once it has been removed from all its tiles.
+	void freeObstacle(dtTileCacheObstacle* ob);
+
+	/// Link in a tile's obstacle list. Link i*DT_MAX_TOUCHED_TILES+j is obstacle i's entry in the list of the tile in touched[j].
+	struct TileObstacleLink
+	{
+		int next;							///< Next link in the tile's list, -1 at the end.
+		int prev;							///< Previous link in the tile's list, -1 at the head, UNLINKED if not in a list.
+	};
+
+	static const int UNLINKED = -2;
 	
 	int m_tileLutSize;						///< Tile hash lookup size (must be pot).
 	int m_tileLutMask;						///< Tile hash lookup mask.
@@ -285,19 +337,26 @@ private:
 	dtTileCacheObstacle* m_obstacles;
 	dtTileCacheObstacle* m_nextFreeObstacle;
 
+	int* m_tileObstacles;					///< Head of each tile's obstacle link list, -1 if no obstacles touch it. Indexed by tile index.
+	TileObstacleLink* m_obstacleLinks;		///< DT_MAX_TOUCHED_TILES links per obstacle.
+
 	dtOffMeshConnection* m_offMeshConnections;
 	dtOffMeshConnection* m_nextFreeOffMeshConnection;
 	
-	static const int MAX_REQUESTS = 64;
-	ObstacleRequest m_reqs[MAX_REQUESTS];
+	// Request and update queues start at this size and double whenever they fill up
+	static const int INITIAL_QUEUE_SIZE = 64;
+
+	ObstacleRequest* m_reqs;
 	int m_nreqs;
+	int m_maxReqs;
 
-	OffMeshRequest m_OffMeshReqs[MAX_REQUESTS];
+	OffMeshRequest* m_OffMeshReqs;
 	int m_nOffMeshReqs;
+	int m_maxOffMeshReqs;
 	
-	static const int MAX_UPDATE = 64;
-	dtCompressedTileRef m_update[MAX_UPDATE];
+	dtCompressedTileRef* m_update;
 	int m_nupdate;
+	int m_maxUpdate;
 };
 
 dtTileCache* dtAllocTileCache();
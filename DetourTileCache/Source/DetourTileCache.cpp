@@ -31,6 +31,24 @@ static bool contains(const dtCompressedTileRef* a, const int n, const dtCompress
 	return false;
 }
 
+// Makes sure the queue has room for at least one more item, doubling its size if it is full.
+template<class T> static bool reserveQueueSlot(T*& queue, const int count, int& capacity)
+{
+	if (count < capacity)
+		return true;
+	const int newCapacity = capacity > 0 ? capacity*2 : 64;
+	T* newQueue = (T*)dtAlloc(sizeof(T)*newCapacity, DT_ALLOC_PERM);
+	if (!newQueue)
+		return false;
+	if (count > 0)
+		memcpy(newQueue, queue, sizeof(T)*count);
+	memset(newQueue + count, 0, sizeof(T)*(newCapacity-count));
+	dtFree(queue);
+	queue = newQueue;
+	capacity = newCapacity;
+	return true;
+}
+
 inline int computeTileHash(int x, int y, const int mask)
 {
 	const unsigned int h1 = 0x8da6b343; // Large multiplicative constants;
@@ -73,12 +91,19 @@ dtTileCache::dtTileCache() :
 	m_tmproc(0),
 	m_obstacles(0),
 	m_nextFreeObstacle(0),
+	m_tileObstacles(0),
+	m_obstacleLinks(0),
+	m_reqs(0),
 	m_nreqs(0),
+	m_maxReqs(0),
+	m_OffMeshReqs(0),
 	m_nOffMeshReqs(0),
-	m_nupdate(0)
+	m_maxOffMeshReqs(0),
+	m_update(0),
+	m_nupdate(0),
+	m_maxUpdate(0)
 {
 	memset(&m_params, 0, sizeof(m_params));
-	memset(m_reqs, 0, sizeof(ObstacleRequest) * MAX_REQUESTS);
 }
 	
 dtTileCache::~dtTileCache()
@@ -93,13 +118,26 @@ dtTileCache::~dtTileCache()
 	}
 	dtFree(m_obstacles);
 	m_obstacles = 0;
+	dtFree(m_tileObstacles);
+	m_tileObstacles = 0;
+	dtFree(m_obstacleLinks);
+	m_obstacleLinks = 0;
 	dtFree(m_posLookup);
 	m_posLookup = 0;
 	dtFree(m_tiles);
 	m_tiles = 0;
+	dtFree(m_reqs);
+	m_reqs = 0;
+	dtFree(m_OffMeshReqs);
+	m_OffMeshReqs = 0;
+	dtFree(m_update);
+	m_update = 0;
 	m_nreqs = 0;
 	m_nOffMeshReqs = 0;
 	m_nupdate = 0;
+	m_maxReqs = 0;
+	m_maxOffMeshReqs = 0;
+	m_maxUpdate = 0;
 }
 
 const dtCompressedTile* dtTileCache::getTileByRef(dtCompressedTileRef ref) const
@@ -126,8 +164,28 @@ dtStatus dtTileCache::init(const dtTileCacheParams* params,
 	m_tcomp = tcomp;
 	m_tmproc = tmproc;
 	m_nreqs = 0;
+	m_nOffMeshReqs = 0;
+	m_nupdate = 0;
 	memcpy(&m_params, params, sizeof(m_params));
 	
+	// Alloc request and update queues. These grow as needed so bursts of requests are never dropped.
+	m_maxReqs = INITIAL_QUEUE_SIZE;
+	m_reqs = (ObstacleRequest*)dtAlloc(sizeof(ObstacleRequest)*m_maxReqs, DT_ALLOC_PERM);
+	if (!m_reqs)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_reqs, 0, sizeof(ObstacleRequest)*m_maxReqs);
+	
+	m_maxOffMeshReqs = INITIAL_QUEUE_SIZE;
+	m_OffMeshReqs = (OffMeshRequest*)dtAlloc(sizeof(OffMeshRequest)*m_maxOffMeshReqs, DT_ALLOC_PERM);
+	if (!m_OffMeshReqs)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_OffMeshReqs, 0, sizeof(OffMeshRequest)*m_maxOffMeshReqs);
+	
+	m_maxUpdate = INITIAL_QUEUE_SIZE;
+	m_update = (dtCompressedTileRef*)dtAlloc(sizeof(dtCompressedTileRef)*m_maxUpdate, DT_ALLOC_PERM);
+	if (!m_update)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	
 	// Alloc space for obstacles.
 	m_obstacles = (dtTileCacheObstacle*)dtAlloc(sizeof(dtTileCacheObstacle)*m_params.maxObstacles, DT_ALLOC_PERM);
 	if (!m_obstacles)
@@ -141,6 +199,16 @@ dtStatus dtTileCache::init(const dtTileCacheParams* params,
 		m_nextFreeObstacle = &m_obstacles[i];
 	}
 
+	// Alloc the obstacle links which make up each tile's obstacle list.
+	m_obstacleLinks = (TileObstacleLink*)dtAlloc(sizeof(TileObstacleLink)*m_params.maxObstacles*DT_MAX_TOUCHED_TILES, DT_ALLOC_PERM);
+	if (!m_obstacleLinks)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	for (int i = 0; i < m_params.maxObstacles*DT_MAX_TOUCHED_TILES; ++i)
+	{
+		m_obstacleLinks[i].next = UNLINKED;
+		m_obstacleLinks[i].prev = UNLINKED;
+	}
+
 	// Alloc space for off-mesh connections.
 	m_offMeshConnections = (dtOffMeshConnection*)dtAlloc(sizeof(dtOffMeshConnection) * m_params.maxOffMeshConnections, DT_ALLOC_PERM);
 	if (!m_offMeshConnections)
@@ -166,8 +234,13 @@ dtStatus dtTileCache::init(const dtTileCacheParams* params,
 	m_posLookup = (dtCompressedTile**)dtAlloc(sizeof(dtCompressedTile*)*m_tileLutSize, DT_ALLOC_PERM);
 	if (!m_posLookup)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_tileObstacles = (int*)dtAlloc(sizeof(int)*m_params.maxTiles, DT_ALLOC_PERM);
+	if (!m_tileObstacles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	memset(m_tiles, 0, sizeof(dtCompressedTile)*m_params.maxTiles);
 	memset(m_posLookup, 0, sizeof(dtCompressedTile*)*m_tileLutSize);
+	for (int i = 0; i < m_params.maxTiles; ++i)
+		m_tileObstacles[i] = -1;
 	m_nextFreeTile = 0;
 	for (int i = m_params.maxTiles-1; i >= 0; --i)
 	{
@@ -396,8 +469,8 @@ dtStatus dtTileCache::removeTile(dtCompressedTileRef ref, unsigned char** data,
 
 dtStatus dtTileCache::addObstacle(const float* pos, const float radius, const float height, const int area, dtObstacleRef* result)
 {
-	if (m_nreqs >= MAX_REQUESTS)
-		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+	if (!reserveQueueSlot(m_reqs, m_nreqs, m_maxReqs))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 
 	dtTileCacheObstacle* ob = 0;
 	if (m_nextFreeObstacle)
@@ -432,8 +505,8 @@ dtStatus dtTileCache::addObstacle(const float* pos, const float radius, const fl
 
 dtStatus dtTileCache::addBoxObstacle(const float* bmin, const float* bmax, dtObstacleRef* result)
 {
-	if (m_nreqs >= MAX_REQUESTS)
-		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+	if (!reserveQueueSlot(m_reqs, m_nreqs, m_maxReqs))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	
 	dtTileCacheObstacle* ob = 0;
 	if (m_nextFreeObstacle)
@@ -466,8 +539,8 @@ dtStatus dtTileCache::addBoxObstacle(const float* bmin, const float* bmax, dtObs
 
 dtStatus dtTileCache::addBoxObstacle(const float* center, const float* halfExtents, const float yRadians, dtObstacleRef* result)
 {
-	if (m_nreqs >= MAX_REQUESTS)
-		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+	if (!reserveQueueSlot(m_reqs, m_nreqs, m_maxReqs))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 
 	dtTileCacheObstacle* ob = 0;
 	if (m_nextFreeObstacle)
@@ -507,8 +580,8 @@ dtStatus dtTileCache::removeObstacle(const dtObstacleRef ref)
 {
 	if (!ref)
 		return DT_SUCCESS;
-	if (m_nreqs >= MAX_REQUESTS)
-		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+	if (!reserveQueueSlot(m_reqs, m_nreqs, m_maxReqs))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	
 	ObstacleRequest* req = &m_reqs[m_nreqs++];
 	memset(req, 0, sizeof(ObstacleRequest));
@@ -520,8 +593,8 @@ dtStatus dtTileCache::removeObstacle(const dtObstacleRef ref)
 
 dtStatus dtTileCache::addOffMeshConnection(const float* spos, const float* epos, const float radius, const unsigned char area, const unsigned int flags, const bool bBiDirectional, dtOffMeshConnectionRef* result)
 {
-	if (m_nOffMeshReqs >= MAX_REQUESTS)
-		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+	if (!reserveQueueSlot(m_OffMeshReqs, m_nOffMeshReqs, m_maxOffMeshReqs))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 
 	dtOffMeshConnection* con = 0;
 	if (m_nextFreeOffMeshConnection)
@@ -559,8 +632,8 @@ dtStatus dtTileCache::addOffMeshConnection(const float* spos, const float* epos,
 
 dtStatus dtTileCache::modifyOffMeshConnection(dtOffMeshConnectionRef ConRef, const unsigned int newFlag)
 {
-	if (m_nOffMeshReqs >= MAX_REQUESTS)
-		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+	if (!reserveQueueSlot(m_OffMeshReqs, m_nOffMeshReqs, m_maxOffMeshReqs))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 
 	dtOffMeshConnection* con = getOffMeshConnectionByRef(ConRef);
 
@@ -618,6 +691,77 @@ dtStatus dtTileCache::queryTiles(const float* bmin, const float* bmax,
 	return DT_SUCCESS;
 }
 
+bool dtTileCache::queueTileUpdate(const dtCompressedTileRef ref)
+{
+	if (!ref)
+		return false;
+	if (contains(m_update, m_nupdate, ref))
+		return true;
+	if (!reserveQueueSlot(m_update, m_nupdate, m_maxUpdate))
+		return false;
+	m_update[m_nupdate++] = ref;
+	return true;
+}
+
+void dtTileCache::prioritiseUpdate(const int i)
+{
+	if (i <= 0 || i >= m_nupdate)
+		return;
+	const dtCompressedTileRef ref = m_update[i];
+	memmove(m_update+1, m_update, i*sizeof(dtCompressedTileRef));
+	m_update[0] = ref;
+}
+
+void dtTileCache::linkObstacle(const int obIdx)
+{
+	const dtTileCacheObstacle* ob = &m_obstacles[obIdx];
+	for (int j = 0; j < (int)ob->ntouched; ++j)
+	{
+		const int tileIdx = (int)decodeTileIdTile(ob->touched[j]);
+		if (tileIdx >= m_params.maxTiles)
+			continue;
+		const int linkIdx = obIdx*DT_MAX_TOUCHED_TILES + j;
+		TileObstacleLink* link = &m_obstacleLinks[linkIdx];
+		link->prev = -1;
+		link->next = m_tileObstacles[tileIdx];
+		if (link->next != -1)
+			m_obstacleLinks[link->next].prev = linkIdx;
+		m_tileObstacles[tileIdx] = linkIdx;
+	}
+}
+
+void dtTileCache::unlinkObstacle(const int obIdx)
+{
+	const dtTileCacheObstacle* ob = &m_obstacles[obIdx];
+	for (int j = 0; j < DT_MAX_TOUCHED_TILES; ++j)
+	{
+		TileObstacleLink* link = &m_obstacleLinks[obIdx*DT_MAX_TOUCHED_TILES + j];
+		if (link->prev == UNLINKED)
+			continue;
+		if (link->prev != -1)
+			m_obstacleLinks[link->prev].next = link->next;
+		else
+			m_tileObstacles[decodeTileIdTile(ob->touched[j])] = link->next;
+		if (link->next != -1)
+			m_obstacleLinks[link->next].prev = link->prev;
+		link->next = UNLINKED;
+		link->prev = UNLINKED;
+	}
+}
+
+void dtTileCache::freeObstacle(dtTileCacheObstacle* ob)
+{
+	unlinkObstacle((int)(ob - m_obstacles));
+	ob->state = DT_OBSTACLE_EMPTY;
+	// Update salt, salt should never be zero.
+	ob->salt = (ob->salt+1) & ((1<<16)-1);
+	if (ob->salt == 0)
+		ob->salt++;
+	// Return obstacle to free list.
+	ob->next = m_nextFreeObstacle;
+	m_nextFreeObstacle = ob;
+}
+
 dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 							 bool* upToDate)
 {
@@ -642,20 +786,21 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 				float bmin[3], bmax[3];
 				getObstacleBounds(ob, bmin, bmax);
 
+				unlinkObstacle((int)idx);
 				int ntouched = 0;
 				queryTiles(bmin, bmax, ob->touched, &ntouched, DT_MAX_TOUCHED_TILES);
 				ob->ntouched = (unsigned char)ntouched;
+				linkObstacle((int)idx);
 				// Add tiles to update list.
 				ob->npending = 0;
 				for (int j = 0; j < ob->ntouched; ++j)
 				{
-					if (m_nupdate < MAX_UPDATE)
-					{
-						if (!contains(m_update, m_nupdate, ob->touched[j]))
-							m_update[m_nupdate++] = ob->touched[j];
+					if (queueTileUpdate(ob->touched[j]))
 						ob->pending[ob->npending++] = ob->touched[j];
-					}
 				}
+				// Nothing to rebuild, so no tile will ever finish processing it.
+				if (ob->npending == 0)
+					ob->state = DT_OBSTACLE_PROCESSED;
 			}
 			else if (req->action == REQUEST_REMOVE)
 			{
@@ -665,13 +810,11 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 				ob->npending = 0;
 				for (int j = 0; j < ob->ntouched; ++j)
 				{
-					if (m_nupdate < MAX_UPDATE)
-					{
-						if (!contains(m_update, m_nupdate, ob->touched[j]))
-							m_update[m_nupdate++] = ob->touched[j];
+					if (queueTileUpdate(ob->touched[j]))
 						ob->pending[ob->npending++] = ob->touched[j];
-					}
 				}
+				if (ob->npending == 0)
+					freeObstacle(ob);
 			}
 		}
 		
@@ -736,11 +879,7 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 				con->ToTileY = EndTile->header->ty;
 				con->ToTileLayer = EndTile->header->tlayer;
 
-				if (m_nupdate < MAX_UPDATE)
-				{
-					if (!contains(m_update, m_nupdate, StartTileRef))
-						m_update[m_nupdate++] = StartTileRef;
-				}
+				queueTileUpdate(StartTileRef);
 			}
 			else if (req->action == REQUEST_OFFMESH_REMOVE)
 			{
@@ -750,14 +889,10 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 
 				navmesh->unconnectOffMeshLink(con);
 
-				if (m_nupdate < MAX_UPDATE)
-				{
-					dtCompressedTile* Tile = getTileAt(con->FromTileX, con->FromTileY, con->FromTileLayer);
-					dtCompressedTileRef TileRef = getTileRef(Tile);
+				dtCompressedTile* Tile = getTileAt(con->FromTileX, con->FromTileY, con->FromTileLayer);
+				dtCompressedTileRef TileRef = getTileRef(Tile);
 
-					if (!contains(m_update, m_nupdate, TileRef))
-						m_update[m_nupdate++] = TileRef;
-				}
+				queueTileUpdate(TileRef);
 			}
 			else if (req->action == REQUEST_OFFMESH_REFRESH)
 			{
@@ -779,10 +914,14 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 		if (m_nupdate > 0)
 			memmove(m_update, m_update+1, m_nupdate*sizeof(dtCompressedTileRef));
 
-		// Update obstacle states.
-		for (int i = 0; i < m_params.maxObstacles; ++i)
+		// Update obstacle states. Only obstacles touching the tile can have it pending.
+		const unsigned int tileIdx = decodeTileIdTile(ref);
+		int linkIdx = (int)tileIdx < m_params.maxTiles ? m_tileObstacles[tileIdx] : -1;
+		while (linkIdx != -1)
 		{
-			dtTileCacheObstacle* ob = &m_obstacles[i];
+			// Freeing the obstacle unlinks it, so step first.
+			dtTileCacheObstacle* ob = &m_obstacles[linkIdx / DT_MAX_TOUCHED_TILES];
+			linkIdx = m_obstacleLinks[linkIdx].next;
 			if (ob->state == DT_OBSTACLE_PROCESSING || ob->state == DT_OBSTACLE_REMOVING)
 			{
 				// Remove handled tile from pending list.
@@ -805,14 +944,7 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 					}
 					else if (ob->state == DT_OBSTACLE_REMOVING)
 					{
-						ob->state = DT_OBSTACLE_EMPTY;
-						// Update salt, salt should never be zero.
-						ob->salt = (ob->salt+1) & ((1<<16)-1);
-						if (ob->salt == 0)
-							ob->salt++;
-						// Return obstacle to free list.
-						ob->next = m_nextFreeObstacle;
-						m_nextFreeObstacle = ob;
+						freeObstacle(ob);
 					}
 				}
 			}
@@ -871,34 +1003,52 @@ dtStatus dtTileCache::buildNavMeshTilesAt(const int tx, const int ty, dtNavMesh*
 dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh* navmesh)
 {	
 	dtAssert(m_talloc);
+	
+	unsigned char* navData = 0;
+	int navDataSize = 0;
+	dtStatus status = buildNavMeshTileData(ref, m_talloc, &navData, &navDataSize);
+	if (dtStatusFailed(status))
+		return status;
+	
+	return addNavMeshTileData(ref, navmesh, navData, navDataSize);
+}
+
+dtStatus dtTileCache::buildNavMeshTileData(const dtCompressedTileRef ref, dtTileCacheAlloc* talloc,
+										   unsigned char** navData, int* navDataSize) const
+{
+	dtAssert(talloc);
 	dtAssert(m_tcomp);
 	
+	*navData = 0;
+	*navDataSize = 0;
+	
 	unsigned int idx = decodeTileIdTile(ref);
-	if (idx > (unsigned int)m_params.maxTiles)
+	if (idx >= (unsigned int)m_params.maxTiles)
 		return DT_FAILURE | DT_INVALID_PARAM;
 	const dtCompressedTile* tile = &m_tiles[idx];
 	unsigned int salt = decodeTileIdSalt(ref);
 	if (tile->salt != salt)
 		return DT_FAILURE | DT_INVALID_PARAM;
 	
-	m_talloc->reset();
+	talloc->reset();
 	
-	NavMeshTileBuildContext bc(m_talloc);
+	NavMeshTileBuildContext bc(talloc);
 	const int walkableClimbVx = (int)(m_params.walkableClimb / m_params.ch);
 	dtStatus status;
 	
 	// Decompress tile layer data. 
-	status = dtDecompressTileCacheLayer(m_talloc, m_tcomp, tile->data, tile->dataSize, &bc.layer);
+	status = dtDecompressTileCacheLayer(talloc, m_tcomp, tile->data, tile->dataSize, &bc.layer);
 	if (dtStatusFailed(status))
 		return status;
 	
-	// Rasterize obstacles.
-	for (int i = 0; i < m_params.maxObstacles; ++i)
+	// Rasterize obstacles touching this tile.
+	for (int linkIdx = m_tileObstacles[idx]; linkIdx != -1; linkIdx = m_obstacleLinks[linkIdx].next)
 	{
-		const dtTileCacheObstacle* ob = &m_obstacles[i];
+		const dtTileCacheObstacle* ob = &m_obstacles[linkIdx / DT_MAX_TOUCHED_TILES];
 		if (ob->state == DT_OBSTACLE_EMPTY || ob->state == DT_OBSTACLE_REMOVING)
 			continue;
-		if (contains(ob->touched, ob->ntouched, ref))
+		// The link may be left over from a previous tile in this slot.
+		if (ob->touched[linkIdx % DT_MAX_TOUCHED_TILES] == ref)
 		{
 			if (ob->type == DT_OBSTACLE_CYLINDER)
 			{
@@ -919,32 +1069,28 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 	}
 	
 	// Build navmesh
-	status = dtBuildTileCacheRegions(m_talloc, *bc.layer, walkableClimbVx);
+	status = dtBuildTileCacheRegions(talloc, *bc.layer, walkableClimbVx);
 	if (dtStatusFailed(status))
 		return status;
 	
-	bc.lcset = dtAllocTileCacheContourSet(m_talloc);
+	bc.lcset = dtAllocTileCacheContourSet(talloc);
 	if (!bc.lcset)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
-	status = dtBuildTileCacheContours(m_talloc, *bc.layer, walkableClimbVx,
+	status = dtBuildTileCacheContours(talloc, *bc.layer, walkableClimbVx,
 									  m_params.maxSimplificationError, *bc.lcset);
 	if (dtStatusFailed(status))
 		return status;
 	
-	bc.lmesh = dtAllocTileCachePolyMesh(m_talloc);
+	bc.lmesh = dtAllocTileCachePolyMesh(talloc);
 	if (!bc.lmesh)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
-	status = dtBuildTileCachePolyMesh(m_talloc, *bc.lcset, *bc.lmesh);
+	status = dtBuildTileCachePolyMesh(talloc, *bc.lcset, *bc.lmesh);
 	if (dtStatusFailed(status))
 		return status;
 	
 	// Early out if the mesh tile is empty.
 	if (!bc.lmesh->npolys)
-	{
-		// Remove existing tile.
-		navmesh->removeTile(navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer),0,0);
 		return DT_SUCCESS;
-	}
 	
 	dtNavMeshCreateParams params;
 	memset(&params, 0, sizeof(params));
@@ -975,11 +1121,23 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 	params.GlobalOffMeshConnections = m_offMeshConnections;
 	params.NumOffMeshConnections = getOffMeshCount();
 	
-	unsigned char* navData = 0;
-	int navDataSize = 0;
-	if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
+	if (!dtCreateNavMeshData(&params, navData, navDataSize))
 		return DT_FAILURE;
+	
+	return DT_SUCCESS;
+}
 
+dtStatus dtTileCache::addNavMeshTileData(const dtCompressedTileRef ref, dtNavMesh* navmesh,
+										 unsigned char* navData, const int navDataSize)
+{
+	unsigned int idx = decodeTileIdTile(ref);
+	if (idx >= (unsigned int)m_params.maxTiles)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	const dtCompressedTile* tile = &m_tiles[idx];
+	unsigned int salt = decodeTileIdSalt(ref);
+	if (tile->salt != salt)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	
 	// Remove existing tile.
 	navmesh->removeTile(navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer),0,0);
 
@@ -987,7 +1145,7 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 	if (navData)
 	{
 		// Let the navmesh own the data.
-		status = navmesh->addTile(navData,navDataSize,DT_TILE_FREE_DATA,0,0);
+		dtStatus status = navmesh->addTile(navData,navDataSize,DT_TILE_FREE_DATA,0,0);
 		if (dtStatusFailed(status))
 		{
 			dtFree(navData);
@@ -1046,8 +1204,8 @@ dtStatus dtTileCache::removeOffMeshConnection(const dtOffMeshConnectionRef ref)
 	if (!ref)
 		return DT_SUCCESS;
 
-	if (m_nOffMeshReqs >= MAX_REQUESTS)
-		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+	if (!reserveQueueSlot(m_OffMeshReqs, m_nOffMeshReqs, m_maxOffMeshReqs))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 
 	OffMeshRequest* req = &m_OffMeshReqs[m_nOffMeshReqs++];
 	memset(req, 0, sizeof(OffMeshRequest));
@@ -0,0 +1,698 @@
+//
+// EvoBot - Neoptolemus' Natural Selection bot, based on Botman's HPB bot template
+//
+// AvHAIBSP.cpp
+//
+// Loads the current map's collision hulls from its .bsp so world traces can run without the engine
+//
+
+#include "AvHAIBSP.h"
+
+#include <extdll.h>
+#include <dllapi.h>
+#include <meta_api.h>
+
+#include <vector>
+#include <string.h>
+
+using namespace std;
+
+static const int BSP_VERSION = 30; // GoldSrc BSP format
+
+static const int BSP_LUMP_PLANES = 1;
+static const int BSP_LUMP_VISIBILITY = 4;
+static const int BSP_LUMP_NODES = 5;
+static const int BSP_LUMP_CLIPNODES = 9;
+static const int BSP_LUMP_LEAFS = 10;
+static const int BSP_LUMP_MODELS = 14;
+static const int BSP_NUM_LUMPS = 15;
+
+static const int BSP_CONTENTS_TRANSLUCENT = -15; // Only defined in the SDK's bspfile.h
+
+static const float BSP_DIST_EPSILON = 0.03125f; // Same nudge the engine uses to keep trace end points off the plane
+
+static const unsigned int BSP_MAX_PVS_BYTES = 32 * 1024 * 1024; // Maps whose decompressed PVS would be bigger than this go without visibility rejection
+
+// On-disk layouts, read with memcpy as the file buffer has no alignment guarantees
+
+typedef struct _BSP_FILE_LUMP
+{
+	int FileOfs;
+	int FileLen;
+} bsp_file_lump;
+
+typedef struct _BSP_FILE_PLANE
+{
+	float Normal[3];
+	float Dist;
+	int Type;
+} bsp_file_plane;
+
+typedef struct _BSP_FILE_NODE
+{
+	int PlaneNum;
+	short Children[2]; // Negative numbers are -(leafs + 1)
+	short Mins[3];
+	short Maxs[3];
+	unsigned short FirstFace;
+	unsigned short NumFaces;
+} bsp_file_node;
+
+typedef struct _BSP_FILE_CLIPNODE
+{
+	int PlaneNum;
+	short Children[2]; // Negative numbers are contents
+} bsp_file_clipnode;
+
+typedef struct _BSP_FILE_LEAF
+{
+	int Contents;
+	int VisOfs;
+	short Mins[3];
+	short Maxs[3];
+	unsigned short FirstMarkSurface;
+	unsigned short NumMarkSurfaces;
+	unsigned char AmbientLevel[4];
+} bsp_file_leaf;
+
+typedef struct _BSP_FILE_MODEL
+{
+	float Mins[3];
+	float Maxs[3];
+	float Origin[3];
+	int HeadNode[BSP_MAX_HULLS];
+	int VisLeafs;
+	int FirstFace;
+	int NumFaces;
+} bsp_file_model;
+
+typedef struct _BSP_PLANE
+{
+	Vector Normal = ZERO_VECTOR;
+	float Dist = 0.0f;
+	int Type = 0; // 0-2 for planes along the X, Y or Z axis
+} bsp_plane;
+
+typedef struct _BSP_CLIPNODE
+{
+	int PlaneNum = 0;
+	int Children[2] = { CONTENTS_EMPTY, CONTENTS_EMPTY }; // Negative numbers are contents
+} bsp_clipnode;
+
+// Read-only after BSP_LoadWorldHulls returns
+typedef struct _BSP_WORLD_HULLS
+{
+	bool bLoaded = false;
+	vector<bsp_plane> Planes;
+	vector<bsp_clipnode> PointHullNodes; // Hull 0, built from the render nodes and leafs
+	vector<bsp_clipnode> ClipNodes; // Hulls 1-3 share the clip node lump
+	vector<bsp_clipnode> Nodes; // The render nodes as stored in the file, negative children are -(leaf + 1)
+	int NumLeafs = 0;
+	int PVSRowBytes = 0; // 0 if the map has no usable visibility data
+	vector<unsigned char> PVS; // One decompressed row per leaf, bit (n - 1) is set if leaf n is potentially visible
+	int HeadNodes[BSP_MAX_HULLS] = { 0, 0, 0, 0 };
+	Vector Mins = ZERO_VECTOR;
+	Vector Maxs = ZERO_VECTOR;
+} bsp_world_hulls;
+
+bsp_world_hulls WorldHulls;
+
+static bool BSP_GetLump(const unsigned char* FileData, const int FileLength, const int LumpIndex, const int ElementSize, const unsigned char** LumpData, int* NumElements)
+{
+	bsp_file_lump Lump;
+	memcpy(&Lump, FileData + sizeof(int) + (LumpIndex * sizeof(bsp_file_lump)), sizeof(bsp_file_lump));
+
+	if (Lump.FileOfs < 0 || Lump.FileLen < 0 || Lump.FileOfs + Lump.FileLen > FileLength || (Lump.FileLen % ElementSize) != 0) { return false; }
+
+	*LumpData = FileData + Lump.FileOfs;
+	*NumElements = Lump.FileLen / ElementSize;
+
+	return true;
+}
+
+// Decompresses the run-length encoded PVS row for every leaf up front, so visibility checks are a single bit test
+static void BSP_LoadPVS(const unsigned char* VisData, const int VisLength, const unsigned char* LeafData, const int NumLeafs, const int NumVisLeafs)
+{
+	if (NumVisLeafs <= 0 || NumVisLeafs >= NumLeafs) { return; }
+
+	int RowBytes = (NumVisLeafs + 7) >> 3;
+
+	if ((unsigned int)RowBytes * (unsigned int)NumLeafs > BSP_MAX_PVS_BYTES) { return; }
+
+	WorldHulls.PVS.assign(RowBytes * NumLeafs, 0);
+
+	// Leaf 0 is the shared solid leaf and has no row of its own
+	for (int i = 1; i < NumLeafs; i++)
+	{
+		unsigned char* Row = &WorldHulls.PVS[i * RowBytes];
+
+		bsp_file_leaf FileLeaf;
+		memcpy(&FileLeaf, LeafData + (i * sizeof(bsp_file_leaf)), sizeof(bsp_file_leaf));
+
+		// No visibility for this leaf, assume it can see everything
+		if (FileLeaf.VisOfs < 0 || FileLeaf.VisOfs >= VisLength)
+		{
+			memset(Row, 0xFF, RowBytes);
+			continue;
+		}
+
+		const unsigned char* In = VisData + FileLeaf.VisOfs;
+		const unsigned char* InEnd = VisData + VisLength;
+		int OutByte = 0;
+
+		// Zero bytes are followed by a count of how many zero bytes they stand for
+		while (OutByte < RowBytes && In < InEnd)
+		{
+			if (*In)
+			{
+				Row[OutByte++] = *In++;
+				continue;
+			}
+
+			if (In + 1 >= InEnd) { break; }
+
+			OutByte += In[1];
+			In += 2;
+		}
+	}
+
+	WorldHulls.PVSRowBytes = RowBytes;
+}
+
+bool BSP_LoadWorldHulls(const char* MapName)
+{
+	BSP_UnloadWorldHulls();
+
+	char FileName[256];
+	sprintf(FileName, "maps/%s.bsp", MapName);
+
+	int FileLength = 0;
+	unsigned char* FileData = LOAD_FILE_FOR_ME(FileName, &FileLength);
+
+	if (!FileData) { return false; }
+
+	bool bSuccess = false;
+
+	const unsigned char* PlaneData = nullptr;
+	const unsigned char* NodeData = nullptr;
+	const unsigned char* ClipNodeData = nullptr;
+	const unsigned char* LeafData = nullptr;
+	const unsigned char* ModelData = nullptr;
+	int NumPlanes = 0;
+	int NumNodes = 0;
+	int NumClipNodes = 0;
+	int NumLeafs = 0;
+	int NumModels = 0;
+
+	int Version = 0;
+
+	if (FileLength >= (int)(sizeof(int) + BSP_NUM_LUMPS * sizeof(bsp_file_lump)))
+	{
+		memcpy(&Version, FileData, sizeof(int));
+	}
+
+	if (Version == BSP_VERSION
+		&& BSP_GetLump(FileData, FileLength, BSP_LUMP_PLANES, sizeof(bsp_file_plane), &PlaneData, &NumPlanes)
+		&& BSP_GetLump(FileData, FileLength, BSP_LUMP_NODES, sizeof(bsp_file_node), &NodeData, &NumNodes)
+		&& BSP_GetLump(FileData, FileLength, BSP_LUMP_CLIPNODES, sizeof(bsp_file_clipnode), &ClipNodeData, &NumClipNodes)
+		&& BSP_GetLump(FileData, FileLength, BSP_LUMP_LEAFS, sizeof(bsp_file_leaf), &LeafData, &NumLeafs)
+		&& BSP_GetLump(FileData, FileLength, BSP_LUMP_MODELS, sizeof(bsp_file_model), &ModelData, &NumModels)
+		&& NumModels > 0 && NumPlanes > 0 && NumNodes > 0)
+	{
+		bSuccess = true;
+
+		WorldHulls.Planes.resize(NumPlanes);
+
+		for (int i = 0; i < NumPlanes; i++)
+		{
+			bsp_file_plane FilePlane;
+			memcpy(&FilePlane, PlaneData + (i * sizeof(bsp_file_plane)), sizeof(bsp_file_plane));
+
+			WorldHulls.Planes[i].Normal = Vector(FilePlane.Normal[0], FilePlane.Normal[1], FilePlane.Normal[2]);
+			WorldHulls.Planes[i].Dist = FilePlane.Dist;
+			WorldHulls.Planes[i].Type = FilePlane.Type;
+		}
+
+		// The point hull has no clip nodes of its own, so build them from the render nodes with each leaf replaced by its contents
+		WorldHulls.PointHullNodes.resize(NumNodes);
+		WorldHulls.Nodes.resize(NumNodes);
+		WorldHulls.NumLeafs = NumLeafs;
+
+		for (int i = 0; i < NumNodes && bSuccess; i++)
+		{
+			bsp_file_node FileNode;
+			memcpy(&FileNode, NodeData + (i * sizeof(bsp_file_node)), sizeof(bsp_file_node));
+
+			if (FileNode.PlaneNum < 0 || FileNode.PlaneNum >= NumPlanes) { bSuccess = false; break; }
+
+			WorldHulls.PointHullNodes[i].PlaneNum = FileNode.PlaneNum;
+			WorldHulls.Nodes[i].PlaneNum = FileNode.PlaneNum;
+
+			for (int j = 0; j < 2; j++)
+			{
+				int Child = FileNode.Children[j];
+
+				WorldHulls.Nodes[i].Children[j] = Child;
+
+				if (Child >= 0)
+				{
+					if (Child >= NumNodes) { bSuccess = false; break; }
+					WorldHulls.PointHullNodes[i].Children[j] = Child;
+				}
+				else
+				{
+					int LeafIndex = -1 - Child;
+
+					if (LeafIndex >= NumLeafs) { bSuccess = false; break; }
+
+					bsp_file_leaf FileLeaf;
+					memcpy(&FileLeaf, LeafData + (LeafIndex * sizeof(bsp_file_leaf)), sizeof(bsp_file_leaf));
+
+					WorldHulls.PointHullNodes[i].Children[j] = FileLeaf.Contents;
+				}
+			}
+		}
+
+		WorldHulls.ClipNodes.resize(NumClipNodes);
+
+		for (int i = 0; i < NumClipNodes && bSuccess; i++)
+		{
+			bsp_file_clipnode FileClipNode;
+			memcpy(&FileClipNode, ClipNodeData + (i * sizeof(bsp_file_clipnode)), sizeof(bsp_file_clipnode));
+
+			if (FileClipNode.PlaneNum < 0 || FileClipNode.PlaneNum >= NumPlanes) { bSuccess = false; break; }
+
+			WorldHulls.ClipNodes[i].PlaneNum = FileClipNode.PlaneNum;
+
+			for (int j = 0; j < 2; j++)
+			{
+				if (FileClipNode.Children[j] >= NumClipNodes) { bSuccess = false; break; }
+				WorldHulls.ClipNodes[i].Children[j] = FileClipNode.Children[j];
+			}
+		}
+
+		if (bSuccess)
+		{
+			// Model 0 is the world itself
+			bsp_file_model WorldModel;
+			memcpy(&WorldModel, ModelData, sizeof(bsp_file_model));
+
+			for (int i = 0; i < BSP_MAX_HULLS; i++)
+			{
+				int NumHullNodes = (i == 0) ? NumNodes : NumClipNodes;
+
+				if (WorldModel.HeadNode[i] < 0 || WorldModel.HeadNode[i] >= NumHullNodes) { bSuccess = false; break; }
+
+				WorldHulls.HeadNodes[i] = WorldModel.HeadNode[i];
+			}
+
+			WorldHulls.Mins = Vector(WorldModel.Mins[0], WorldModel.Mins[1], WorldModel.Mins[2]);
+			WorldHulls.Maxs = Vector(WorldModel.Maxs[0], WorldModel.Maxs[1], WorldModel.Maxs[2]);
+
+			const unsigned char* VisData = nullptr;
+			int VisLength = 0;
+
+			// Visibility is optional, without it nothing is rejected by BSP_IsLeafPotentiallyVisible
+			if (bSuccess && BSP_GetLump(FileData, FileLength, BSP_LUMP_VISIBILITY, 1, &VisData, &VisLength) && VisLength > 0)
+			{
+				BSP_LoadPVS(VisData, VisLength, LeafData, NumLeafs, WorldModel.VisLeafs);
+			}
+		}
+	}
+
+	FREE_FILE(FileData);
+
+	if (!bSuccess)
+	{
+		BSP_UnloadWorldHulls();
+
+		char ErrMsg[256];
+		sprintf(ErrMsg, "Failed to read collision hulls from %s\n", FileName);
+		g_engfuncs.pfnServerPrint(ErrMsg);
+
+		return false;
+	}
+
+	WorldHulls.bLoaded = true;
+
+	return true;
+}
+
+void BSP_UnloadWorldHulls()
+{
+	WorldHulls.bLoaded = false;
+	vector<bsp_plane>().swap(WorldHulls.Planes);
+	vector<bsp_clipnode>().swap(WorldHulls.PointHullNodes);
+	vector<bsp_clipnode>().swap(WorldHulls.ClipNodes);
+	vector<bsp_clipnode>().swap(WorldHulls.Nodes);
+	vector<unsigned char>().swap(WorldHulls.PVS);
+	WorldHulls.NumLeafs = 0;
+	WorldHulls.PVSRowBytes = 0;
+}
+
+bool BSP_WorldHullsLoaded()
+{
+	return WorldHulls.bLoaded;
+}
+
+static inline const bsp_clipnode* BSP_GetHullNodes(const int HullNum)
+{
+	return (HullNum == 0) ? WorldHulls.PointHullNodes.data() : WorldHulls.ClipNodes.data();
+}
+
+static inline float BSP_PlaneDist(const bsp_plane& Plane, const Vector& Point)
+{
+	if (Plane.Type < 3)
+	{
+		return Point[Plane.Type] - Plane.Dist;
+	}
+
+	return DotProduct(Plane.Normal, Point) - Plane.Dist;
+}
+
+static int BSP_HullPointContents(const bsp_clipnode* Nodes, int NodeNum, const Vector& Point)
+{
+	while (NodeNum >= 0)
+	{
+		const bsp_clipnode& Node = Nodes[NodeNum];
+		float d = BSP_PlaneDist(WorldHulls.Planes[Node.PlaneNum], Point);
+
+		NodeNum = (d < 0.0f) ? Node.Children[1] : Node.Children[0];
+	}
+
+	return NodeNum;
+}
+
+// Same recursion as the engine's SV_RecursiveHullCheck. Returns false once the trace has been stopped by solid geometry
+static bool BSP_RecursiveHullCheck(const bsp_clipnode* Nodes, const int HeadNode, int NodeNum, float p1f, float p2f, const Vector& p1, const Vector& p2, bsp_trace_result* Result)
+{
+	if (NodeNum < 0)
+	{
+		if (NodeNum == CONTENTS_SOLID)
+		{
+			Result->bStartSolid = true;
+		}
+		else
+		{
+			Result->bAllSolid = false;
+
+			if (NodeNum == CONTENTS_EMPTY)
+			{
+				Result->bInOpen = true;
+			}
+			else if (NodeNum != BSP_CONTENTS_TRANSLUCENT)
+			{
+				Result->bInWater = true;
+			}
+		}
+
+		return true;
+	}
+
+	const bsp_clipnode& Node = Nodes[NodeNum];
+	const bsp_plane& Plane = WorldHulls.Planes[Node.PlaneNum];
+
+	float t1 = BSP_PlaneDist(Plane, p1);
+	float t2 = BSP_PlaneDist(Plane, p2);
+
+	if (t1 >= 0.0f && t2 >= 0.0f)
+	{
+		return BSP_RecursiveHullCheck(Nodes, HeadNode, Node.Children[0], p1f, p2f, p1, p2, Result);
+	}
+
+	if (t1 < 0.0f && t2 < 0.0f)
+	{
+		return BSP_RecursiveHullCheck(Nodes, HeadNode, Node.Children[1], p1f, p2f, p1, p2, Result);
+	}
+
+	// Put the crosspoint BSP_DIST_EPSILON units on the near side
+	float frac = (t1 < 0.0f) ? (t1 + BSP_DIST_EPSILON) / (t1 - t2) : (t1 - BSP_DIST_EPSILON) / (t1 - t2);
+
+	if (frac < 0.0f) { frac = 0.0f; }
+	if (frac > 1.0f) { frac = 1.0f; }
+
+	float midf = p1f + (p2f - p1f) * frac;
+	Vector mid = p1 + (p2 - p1) * frac;
+
+	int side = (t1 < 0.0f) ? 1 : 0;
+
+	// Move up to the node
+	if (!BSP_RecursiveHullCheck(Nodes, HeadNode, Node.Children[side], p1f, midf, p1, mid, Result)) { return false; }
+
+	// Go past the node
+	if (BSP_HullPointContents(Nodes, Node.Children[side ^ 1], mid) != CONTENTS_SOLID)
+	{
+		return BSP_RecursiveHullCheck(Nodes, HeadNode, Node.Children[side ^ 1], midf, p2f, mid, p2, Result);
+	}
+
+	// Never got out of the solid area
+	if (Result->bAllSolid) { return false; }
+
+	// The other side of the node is solid, this is the impact point
+	if (!side)
+	{
+		Result->PlaneNormal = Plane.Normal;
+		Result->PlaneDist = Plane.Dist;
+	}
+	else
+	{
+		Result->PlaneNormal = Plane.Normal * -1.0f;
+		Result->PlaneDist = -Plane.Dist;
+	}
+
+	// Back off until the point is out of solid, in case the epsilon nudge above left it inside
+	while (BSP_HullPointContents(Nodes, HeadNode, mid) == CONTENTS_SOLID)
+	{
+		frac -= 0.1f;
+
+		if (frac < 0.0f)
+		{
+			Result->Fraction = midf;
+			Result->EndPos = mid;
+			return false;
+		}
+
+		midf = p1f + (p2f - p1f) * frac;
+		mid = p1 + (p2 - p1) * frac;
+	}
+
+	Result->Fraction = midf;
+	Result->EndPos = mid;
+
+	return false;
+}
+
+void BSP_TraceHull(const Vector& Start, const Vector& End, int HullNum, bsp_trace_result* Result)
+{
+	*Result = bsp_trace_result();
+	Result->EndPos = End;
+
+	if (!WorldHulls.bLoaded || HullNum < 0 || HullNum >= BSP_MAX_HULLS) { return; }
+
+	const bsp_clipnode* Nodes = BSP_GetHullNodes(HullNum);
+	int HeadNode = WorldHulls.HeadNodes[HullNum];
+
+	Result->bAllSolid = true;
+
+	BSP_RecursiveHullCheck(Nodes, HeadNode, HeadNode, 0.0f, 1.0f, Start, End, Result);
+
+	if (Result->bAllSolid)
+	{
+		Result->bStartSolid = true;
+	}
+
+	if (Result->Fraction >= 1.0f)
+	{
+		Result->EndPos = End;
+	}
+}
+
+void BSP_TraceLine(const Vector& Start, const Vector& End, bsp_trace_result* Result)
+{
+	BSP_TraceHull(Start, End, point_hull, Result);
+}
+
+void BSP_TraceHullBatch(const Vector* Starts, const Vector* Ends, int NumTraces, int HullNum, bsp_trace_result* Results)
+{
+	for (int i = 0; i < NumTraces; i++)
+	{
+		BSP_TraceHull(Starts[i], Ends[i], HullNum, &Results[i]);
+	}
+}
+
+int BSP_PointContents(const Vector& Point, int HullNum)
+{
+	if (!WorldHulls.bLoaded || HullNum < 0 || HullNum >= BSP_MAX_HULLS) { return CONTENTS_EMPTY; }
+
+	return BSP_HullPointContents(BSP_GetHullNodes(HullNum), WorldHulls.HeadNodes[HullNum], Point);
+}
+
+int BSP_GetLeafForPoint(const Vector& Point)
+{
+	if (!WorldHulls.bLoaded) { return -1; }
+
+	int NodeNum = 0;
+
+	while (NodeNum >= 0)
+	{
+		const bsp_clipnode& Node = WorldHulls.Nodes[NodeNum];
+		float d = BSP_PlaneDist(WorldHulls.Planes[Node.PlaneNum], Point);
+
+		NodeNum = (d < 0.0f) ? Node.Children[1] : Node.Children[0];
+	}
+
+	return -1 - NodeNum;
+}
+
+static void BSP_CollectBoxLeafs(int NodeNum, const Vector& Mins, const Vector& Maxs, int* Leafs, const int MaxLeafs, int* NumLeafs)
+{
+	while (NodeNum >= 0)
+	{
+		const bsp_clipnode& Node = WorldHulls.Nodes[NodeNum];
+		const bsp_plane& Plane = WorldHulls.Planes[Node.PlaneNum];
+
+		// Distances to the box corners nearest and furthest along the plane normal
+		Vector Near = Vector((Plane.Normal.x < 0.0f) ? Maxs.x : Mins.x, (Plane.Normal.y < 0.0f) ? Maxs.y : Mins.y, (Plane.Normal.z < 0.0f) ? Maxs.z : Mins.z);
+		Vector Far = Vector((Plane.Normal.x < 0.0f) ? Mins.x : Maxs.x, (Plane.Normal.y < 0.0f) ? Mins.y : Maxs.y, (Plane.Normal.z < 0.0f) ? Mins.z : Maxs.z);
+
+		float NearDist = DotProduct(Plane.Normal, Near) - Plane.Dist;
+		float FarDist = DotProduct(Plane.Normal, Far) - Plane.Dist;
+
+		if (NearDist >= 0.0f)
+		{
+			NodeNum = Node.Children[0];
+		}
+		else if (FarDist < 0.0f)
+		{
+			NodeNum = Node.Children[1];
+		}
+		else
+		{
+			// Box straddles the plane
+			BSP_CollectBoxLeafs(Node.Children[0], Mins, Maxs, Leafs, MaxLeafs, NumLeafs);
+			NodeNum = Node.Children[1];
+		}
+	}
+
+	int LeafNum = -1 - NodeNum;
+
+	// Solid leaf can't see anything
+	if (LeafNum == 0) { return; }
+
+	if (*NumLeafs < MaxLeafs)
+	{
+		Leafs[*NumLeafs] = LeafNum;
+	}
+
+	// Keep counting so the caller can tell the list overflowed
+	(*NumLeafs)++;
+}
+
+int BSP_GetLeafsInBox(const Vector& Mins, const Vector& Maxs, int* Leafs, const int MaxLeafs)
+{
+	if (!WorldHulls.bLoaded) { return -1; }
+
+	int NumLeafs = 0;
+
+	BSP_CollectBoxLeafs(0, Mins, Maxs, Leafs, MaxLeafs, &NumLeafs);
+
+	return (NumLeafs > MaxLeafs) ? -1 : NumLeafs;
+}
+
+bool BSP_IsLeafPotentiallyVisible(const int FromLeaf, const int ToLeaf)
+{
+	// Without visibility data, or from inside solid, nothing can be ruled out
+	if (WorldHulls.PVSRowBytes == 0 || FromLeaf <= 0 || ToLeaf <= 0 || FromLeaf >= WorldHulls.NumLeafs || ToLeaf >= WorldHulls.NumLeafs) { return true; }
+
+	int Bit = ToLeaf - 1;
+
+	if ((Bit >> 3) >= WorldHulls.PVSRowBytes) { return true; }
+
+	return (WorldHulls.PVS[(FromLeaf * WorldHulls.PVSRowBytes) + (Bit >> 3)] & (1 << (Bit & 7))) != 0;
+}
+
+bool BSP_IsBoxPotentiallyVisible(const int FromLeaf, const Vector& Mins, const Vector& Maxs)
+{
+	if (WorldHulls.PVSRowBytes == 0 || FromLeaf <= 0) { return true; }
+
+	int Leafs[BSP_MAX_BOX_LEAFS];
+	int NumLeafs = BSP_GetLeafsInBox(Mins, Maxs, Leafs, BSP_MAX_BOX_LEAFS);
+
+	if (NumLeafs < 0) { return true; }
+
+	for (int i = 0; i < NumLeafs; i++)
+	{
+		if (BSP_IsLeafPotentiallyVisible(FromLeaf, Leafs[i])) { return true; }
+	}
+
+	return false;
+}
+
+// Own random sequence so every comparison run traces the same lines
+static unsigned int ComparisonSeed = 1;
+
+static float BSP_ComparisonRand()
+{
+	ComparisonSeed = ComparisonSeed * 1103515245u + 12345u;
+	return (float)((ComparisonSeed >> 8) & 0xFFFF) / 65535.0f;
+}
+
+void BSP_RunTraceComparison(const int NumTraces)
+{
+	if (NumTraces <= 0)
+	{
+		g_engfuncs.pfnServerPrint("Trace comparison: number of traces must be at least 1\n");
+		return;
+	}
+
+	if (!WorldHulls.bLoaded)
+	{
+		g_engfuncs.pfnServerPrint("No collision hulls loaded for this map\n");
+		return;
+	}
+
+	ComparisonSeed = 1;
+
+	int NumCompared[BSP_MAX_HULLS] = { 0, 0, 0, 0 };
+	int NumMismatched[BSP_MAX_HULLS] = { 0, 0, 0, 0 };
+
+	Vector WorldSize = WorldHulls.Maxs - WorldHulls.Mins;
+
+	for (int i = 0; i < NumTraces; i++)
+	{
+		int HullNum = i % BSP_MAX_HULLS;
+
+		Vector Start = WorldHulls.Mins + Vector(WorldSize.x * BSP_ComparisonRand(), WorldSize.y * BSP_ComparisonRand(), WorldSize.z * BSP_ComparisonRand());
+		Vector End = Start + Vector((BSP_ComparisonRand() - 0.5f) * 1024.0f, (BSP_ComparisonRand() - 0.5f) * 1024.0f, (BSP_ComparisonRand() - 0.5f) * 1024.0f);
+
+		TraceResult EngineResult;
+		TRACE_HULL(Start, End, 1, HullNum, NULL, &EngineResult); // 1 = ignore monsters
+
+		bsp_trace_result BSPResult;
+		BSP_TraceHull(Start, End, HullNum, &BSPResult);
+
+		NumCompared[HullNum]++;
+
+		bool bMismatch = (BSPResult.bAllSolid != (EngineResult.fAllSolid != 0)) || (BSPResult.bStartSolid != (EngineResult.fStartSolid != 0));
+
+		if (!bMismatch && !BSPResult.bAllSolid)
+		{
+			bMismatch = fabsf(BSPResult.Fraction - EngineResult.flFraction) > 0.001f;
+		}
+
+		if (bMismatch)
+		{
+			NumMismatched[HullNum]++;
+		}
+	}
+
+	char StatsMsg[256];
+
+	for (int i = 0; i < BSP_MAX_HULLS; i++)
+	{
+		sprintf(StatsMsg, "Hull %d: %d of %d traces differ from the engine\n", i, NumMismatched[i], NumCompared[i]);
+		g_engfuncs.pfnServerPrint(StatsMsg);
+	}
+
+	g_engfuncs.pfnServerPrint("Brush entities (doors, func_walls etc.) aren't part of the world hulls and account for some differences\n");
+}
@@ -0,0 +1,64 @@
+//
+// EvoBot - Neoptolemus' Natural Selection bot, based on Botman's HPB bot template
+//
+// AvHAIBSP.h
+//
+// Loads the current map's collision hulls from its .bsp so world traces can run without the engine
+//
+
+#pragma once
+
+#ifndef AVH_AI_BSP_H
+#define AVH_AI_BSP_H
+
+#include "AvHAIConstants.h"
+
+static const int BSP_MAX_HULLS = 4; // point_hull, human_hull, large_hull and head_hull
+static const int BSP_MAX_BOX_LEAFS = 32; // Most leafs an entity's bounds can touch before PVS checks give up and assume it's visible
+static const int BSP_MAX_COMPARISON_TRACES = 100000; // Cap on the 'bsptest' trace count, as the whole comparison runs inside one server frame
+
+// Result of a trace against the world hulls. Mirrors the world-related fields of the engine's TraceResult
+typedef struct _BSP_TRACE_RESULT
+{
+	float Fraction = 1.0f; // How far along the trace got before hitting something (0-1)
+	bool bAllSolid = false; // The entire trace was inside solid geometry
+	bool bStartSolid = false; // The trace started inside solid geometry
+	bool bInOpen = false;
+	bool bInWater = false;
+	Vector EndPos = ZERO_VECTOR;
+	Vector PlaneNormal = ZERO_VECTOR; // Normal of the surface that was hit
+	float PlaneDist = 0.0f;
+} bsp_trace_result;
+
+/*	Reads the planes, nodes and clip nodes for the world model out of maps/<MapName>.bsp. Must be called on the game thread,
+	and not while other threads are tracing against the previous map's hulls. Returns false if the file couldn't be read */
+bool BSP_LoadWorldHulls(const char* MapName);
+// Frees the loaded hulls. Same threading rules as BSP_LoadWorldHulls
+void BSP_UnloadWorldHulls();
+bool BSP_WorldHullsLoaded();
+
+/*	Traces against the world geometry only (brush entities such as doors and func_walls are not included). Matches
+	TRACE_HULL with ignore_monsters for the world itself. The hull data is read-only once loaded, so these are safe
+	to call from any thread */
+void BSP_TraceHull(const Vector& Start, const Vector& End, int HullNum, bsp_trace_result* Result);
+// As BSP_TraceHull using point_hull, matching TRACE_LINE against the world
+void BSP_TraceLine(const Vector& Start, const Vector& End, bsp_trace_result* Result);
+// Runs NumTraces hull traces in one go, Results must have room for NumTraces entries
+void BSP_TraceHullBatch(const Vector* Starts, const Vector* Ends, int NumTraces, int HullNum, bsp_trace_result* Results);
+// Returns the CONTENTS_ value at Point in the given hull, or CONTENTS_EMPTY if no hulls are loaded
+int BSP_PointContents(const Vector& Point, int HullNum);
+
+/*	Returns the leaf Point is in, or -1 if no map is loaded. Leaf 0 is the solid leaf outside the playable space.
+	Like the traces, the PVS functions below only read the loaded data and are safe to call from any thread */
+int BSP_GetLeafForPoint(const Vector& Point);
+// Fills Leafs with the non-solid leafs touched by the box. Returns how many were found, or -1 if there were more than MaxLeafs
+int BSP_GetLeafsInBox(const Vector& Mins, const Vector& Maxs, int* Leafs, const int MaxLeafs);
+// False only if the map's PVS says nothing in ToLeaf can be seen from FromLeaf. Returns true if there's no visibility data
+bool BSP_IsLeafPotentiallyVisible(const int FromLeaf, const int ToLeaf);
+// False only if none of the leafs the box touches are potentially visible from FromLeaf
+bool BSP_IsBoxPotentiallyVisible(const int FromLeaf, const Vector& Mins, const Vector& Maxs);
+
+// Compares NumTraces random world traces against the engine's and prints how many disagree. Used to check the loader
+void BSP_RunTraceComparison(const int NumTraces);
+
+#endif
@@ -48,6 +48,8 @@ int CurrentNameIndex = 0;
 
 float BotMaxStuckTime = 15.0f;
 
+int NumNavWorkerThreads = 2;
+
 
 
 float CONFIG_GetMaxStuckTime()
@@ -55,6 +57,11 @@ float CONFIG_GetMaxStuckTime()
     return BotMaxStuckTime;
 }
 
+int CONFIG_GetNumNavWorkerThreads()
+{
+    return NumNavWorkerThreads;
+}
+
 std::string CONFIG_GetBotPrefix()
 {
     return std::string(BotPrefix);
@@ -91,7 +98,14 @@ void CONFIG_ParseConfigFile()
                 sprintf(BotPrefix, value.c_str());
 
                 continue;
-            }  
+            }
+
+            if (!stricmp(keyChar, "NavWorkerThreads"))
+            {
+                NumNavWorkerThreads = atoi(value.c_str());
+
+                continue;
+            }
         }
     }
     else
@@ -120,6 +134,9 @@ void CONFIG_RegenerateIniFile()
     fprintf(NewConfigFile, "# What prefix to put in front of a bot's name (can leave blank)\n");
     fprintf(NewConfigFile, "Prefix=[BOT]\n\n");
 
+    fprintf(NewConfigFile, "# How many threads to run nav mesh queries on (0 runs them all on the game thread, max 8). Takes effect on the next map load\n");
+    fprintf(NewConfigFile, "NavWorkerThreads=2\n\n");
+
     fflush(NewConfigFile);
     fclose(NewConfigFile);
 
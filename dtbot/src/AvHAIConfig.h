@@ -16,6 +16,9 @@ std::string CONFIG_GetBotPrefix();
 // Returns the max time a bot is allowed to be stuck before suiciding (0 means forever)
 float CONFIG_GetMaxStuckTime();
 
+// Returns how many worker threads to spread nav mesh queries across (0 means run them all on the game thread)
+int CONFIG_GetNumNavWorkerThreads();
+
 void CONFIG_RegenerateIniFile();
 
 void CONFIG_PopulateBotNames();
@@ -205,6 +205,15 @@ typedef enum
 	MOVE_TASK_PICKUP
 } BotMovementTaskType;
 
+// Status of a bot's queued path request. See NAV_RequestBotPath
+typedef enum
+{
+	PATH_REQUEST_NONE = 0,	// No path request outstanding
+	PATH_REQUEST_PENDING,	// Request is waiting in the queue or being searched by the sliced path planner
+	PATH_REQUEST_COMPLETE,	// Path has been found and is waiting in PendingPath to be picked up
+	PATH_REQUEST_FAILED		// Path planner could not find a path
+} BotPathRequestStatus;
+
 
 // Dynamic map object type
 enum DynamicMapObjectType
@@ -277,7 +286,9 @@ typedef struct _NAV_STATUS
 
 	int CurrentMoveType = MOVETYPE_NONE; // Tracks the edict's current movement type
 
-	unsigned int CurrentPoly = 0; // Which nav mesh poly the bot is currently on
+	unsigned int CurrentPoly = 0; // Which poly on the bot's own nav mesh it is currently on. Pass to the nav helpers as a start poly hint
+	Vector CurrentPolyLocation = ZERO_VECTOR; // Where on CurrentPoly the bot was when it was last updated. Next update walks from here to the bot's new position
+	int CurrentPolyMeshIndex = -1; // Which nav mesh CurrentPoly belongs to, so a change of profile forces a fresh search
 
 	float LastStuckCheckTime = 0.0f; // Last time the bot checked if it had successfully moved
 	float TotalStuckTime = 0.0f; // Total time the bot has spent stuck
@@ -311,6 +322,11 @@ typedef struct _NAV_STATUS
 
 	std::vector<AvHAIPlayerMoveTask> MovementTasks;
 	AvHAIPlayerMoveTask UnstuckTask;
+
+	BotPathRequestStatus PathRequestStatus = PATH_REQUEST_NONE; // Status of the bot's latest queued path request
+	unsigned int PathRequestId = 0; // Identifies the latest path request, unique across all bots. Results from older requests are thrown away
+	Vector PathRequestDestination = ZERO_VECTOR; // Where the latest path request is headed
+	std::vector<bot_path_node> PendingPath; // Path returned by the path planner, waiting to be picked up
 } nav_status;
 
 typedef struct _BOT_CURRENT_WEAPON_T
@@ -3,6 +3,8 @@
 #include "AvHAIPlayerUtil.h"
 #include "AvHAITactical.h"
 #include "AvHAINavigation.h"
+#include "AvHAIPlayerManager.h"
+#include "AvHAIBSP.h"
 
 #include <enginecallback.h>		// ALERT()
 #include "osdep.h"				// win32 vsnprintf, etc
@@ -13,6 +15,7 @@
 #include "nav_constants.h"
 
 #include <unordered_map>
+#include <algorithm>
 
 #include <fstream>
 
@@ -20,11 +23,284 @@ int m_spriteTexture;
 
 std::unordered_map<const char*, std::string> LocalizedLocationsMap;
 
+static const float TRACE_CACHE_GRID = 0.125f; // Trace endpoints are snapped to this grid when looking up the trace cache
+static const int TRACE_CACHE_SIZE = 1024; // Slots in the per-frame trace cache, must be a power of 2
+static const int TRACE_STATS_MAX_SITES = 15; // How many call sites UTIL_PrintTraceStats lists
+
+typedef struct _TRACE_CACHE_ENTRY
+{
+	unsigned int Frame = 0; // Trace frame this entry was filled in, entries from earlier frames are stale
+	int Start[3] = { 0, 0, 0 }; // Quantised start point
+	int End[3] = { 0, 0, 0 }; // Quantised end point
+	int TraceFlags = 0;
+	int HullNum = -1; // -1 for line traces
+	const edict_t* IgnoreEdict = nullptr;
+	TraceResult Result;
+} trace_cache_entry;
+
+static trace_cache_entry TraceCache[TRACE_CACHE_SIZE];
+static unsigned int TraceCacheFrame = 0;
+static float TraceCacheTime = -1.0f;
+
+static std::vector<trace_site_stats*> TraceSites; // Every call site that has traced at least once
+static unsigned int TotalTraces = 0;
+static unsigned int TotalTraceCacheHits = 0;
+static float TraceStatsStartTime = 0.0f;
+
+static inline int UTIL_QuantiseTraceCoord(const float Value)
+{
+	return (int)floorf((Value / TRACE_CACHE_GRID) + 0.5f);
+}
+
+static void UTIL_RunBrokeredTrace(trace_site_stats* Site, const Vector& vecStart, const Vector& vecEnd, int TraceFlags, int HullNum, edict_t* pentIgnore, TraceResult* ptr)
+{
+	if (!Site->bListed)
+	{
+		TraceSites.push_back(Site);
+		Site->bListed = true;
+	}
+
+	Site->NumTraces++;
+	TotalTraces++;
+
+	// Players and monsters move between bots' updates within a frame, so only world traces are safe to share
+	if (!(TraceFlags & 1))
+	{
+		if (HullNum < 0)
+		{
+			TRACE_LINE(vecStart, vecEnd, TraceFlags, pentIgnore, ptr);
+		}
+		else
+		{
+			TRACE_HULL(vecStart, vecEnd, TraceFlags, HullNum, pentIgnore, ptr);
+		}
+
+		return;
+	}
+
+	// Cached results are only good for the server frame they were traced in
+	if (gpGlobals->time != TraceCacheTime)
+	{
+		TraceCacheTime = gpGlobals->time;
+		TraceCacheFrame++;
+	}
+
+	int QStart[3] = { UTIL_QuantiseTraceCoord(vecStart.x), UTIL_QuantiseTraceCoord(vecStart.y), UTIL_QuantiseTraceCoord(vecStart.z) };
+	int QEnd[3] = { UTIL_QuantiseTraceCoord(vecEnd.x), UTIL_QuantiseTraceCoord(vecEnd.y), UTIL_QuantiseTraceCoord(vecEnd.z) };
+
+	unsigned int Hash = (unsigned int)TraceFlags * 31u + (unsigned int)(HullNum + 1) * 17u;
+	Hash ^= (unsigned int)((size_t)pentIgnore >> 4);
+
+	for (int i = 0; i < 3; i++)
+	{
+		Hash = Hash * 73856093u ^ (unsigned int)QStart[i];
+		Hash = Hash * 19349663u ^ (unsigned int)QEnd[i];
+	}
+
+	Hash ^= Hash >> 15;
+
+	trace_cache_entry* Entry = &TraceCache[Hash & (TRACE_CACHE_SIZE - 1)];
+
+	bool bCacheHit = (Entry->Frame == TraceCacheFrame && Entry->TraceFlags == TraceFlags && Entry->HullNum == HullNum && Entry->IgnoreEdict == pentIgnore
+		&& Entry->Start[0] == QStart[0] && Entry->Start[1] == QStart[1] && Entry->Start[2] == QStart[2]
+		&& Entry->End[0] == QEnd[0] && Entry->End[1] == QEnd[1] && Entry->End[2] == QEnd[2]);
+
+	if (bCacheHit)
+	{
+		*ptr = Entry->Result;
+		// The cached trace may have started a fraction of a unit away, keep the end position on the caller's line
+		ptr->vecEndPos = vecStart + ((vecEnd - vecStart) * ptr->flFraction);
+	}
+	else
+	{
+		if (HullNum < 0)
+		{
+			TRACE_LINE(vecStart, vecEnd, TraceFlags, pentIgnore, ptr);
+		}
+		else
+		{
+			TRACE_HULL(vecStart, vecEnd, TraceFlags, HullNum, pentIgnore, ptr);
+		}
+
+		Entry->Frame = TraceCacheFrame;
+		Entry->TraceFlags = TraceFlags;
+		Entry->HullNum = HullNum;
+		Entry->IgnoreEdict = pentIgnore;
+
+		for (int i = 0; i < 3; i++)
+		{
+			Entry->Start[i] = QStart[i];
+			Entry->End[i] = QEnd[i];
+		}
+
+		Entry->Result = *ptr;
+	}
+
+	if (bCacheHit)
+	{
+		Site->NumCacheHits++;
+		TotalTraceCacheHits++;
+	}
+}
+
+void UTIL_BrokerTraceLine(trace_site_stats* Site, const Vector& vecStart, const Vector& vecEnd, IGNORE_MONSTERS igmon, IGNORE_GLASS ignoreGlass, edict_t* pentIgnore, TraceResult* ptr)
+{
+	UTIL_RunBrokeredTrace(Site, vecStart, vecEnd, (igmon == ignore_monsters ? 1 : 0) | (ignoreGlass ? 0x100 : 0), -1, pentIgnore, ptr);
+}
+
+void UTIL_BrokerTraceLine(trace_site_stats* Site, const Vector& vecStart, const Vector& vecEnd, IGNORE_MONSTERS igmon, edict_t* pentIgnore, TraceResult* ptr)
+{
+	UTIL_RunBrokeredTrace(Site, vecStart, vecEnd, (igmon == ignore_monsters ? 1 : 0), -1, pentIgnore, ptr);
+}
+
+void UTIL_BrokerTraceHull(trace_site_stats* Site, const Vector& vecStart, const Vector& vecEnd, IGNORE_MONSTERS igmon, int HullNum, edict_t* pentIgnore, TraceResult* ptr)
+{
+	UTIL_RunBrokeredTrace(Site, vecStart, vecEnd, (igmon == ignore_monsters ? 1 : 0), HullNum, pentIgnore, ptr);
+}
+
+void UTIL_PrintTraceStats()
+{
+	char StatsMsg[256];
+
+	float Elapsed = gpGlobals->time - TraceStatsStartTime;
+	int NumBots = AIMGR_GetNumAIPlayers();
+	float HitRate = (TotalTraces > 0) ? ((float)TotalTraceCacheHits / (float)TotalTraces) * 100.0f : 0.0f;
+
+	sprintf(StatsMsg, "Traces: %u requested, %u run by the engine, %u from cache (%.1f%% hit rate) over %.1fs\n", TotalTraces, TotalTraces - TotalTraceCacheHits, TotalTraceCacheHits, HitRate, Elapsed);
+	g_engfuncs.pfnServerPrint(StatsMsg);
+
+	if (Elapsed > 0.0f && NumBots > 0)
+	{
+		sprintf(StatsMsg, "Traces per bot per second: %.1f requested, %.1f run by the engine (%d bots)\n", (float)TotalTraces / (float)NumBots / Elapsed, (float)(TotalTraces - TotalTraceCacheHits) / (float)NumBots / Elapsed, NumBots);
+		g_engfuncs.pfnServerPrint(StatsMsg);
+	}
+
+	std::vector<trace_site_stats> Sites;
+
+	for (auto it = TraceSites.begin(); it != TraceSites.end(); it++)
+	{
+		if ((*it)->NumTraces > 0)
+		{
+			Sites.push_back(**it);
+		}
+	}
+
+	std::sort(Sites.begin(), Sites.end(), [](const trace_site_stats& a, const trace_site_stats& b) { return a.NumTraces > b.NumTraces; });
+
+	int NumSitesToShow = (int)Sites.size();
+	if (NumSitesToShow > TRACE_STATS_MAX_SITES) { NumSitesToShow = TRACE_STATS_MAX_SITES; }
+
+	for (int i = 0; i < NumSitesToShow; i++)
+	{
+		// __FILE__ may include the full path, only the file name is useful here
+		const char* FileName = Sites[i].File;
+		const char* Separator = strrchr(FileName, '/');
+		if (Separator) { FileName = Separator + 1; }
+		Separator = strrchr(FileName, '\\');
+		if (Separator) { FileName = Separator + 1; }
+
+		float SiteHitRate = ((float)Sites[i].NumCacheHits / (float)Sites[i].NumTraces) * 100.0f;
+
+		sprintf(StatsMsg, "  %s:%d - %u traces, %.1f%% from cache\n", FileName, Sites[i].Line, Sites[i].NumTraces, SiteHitRate);
+		g_engfuncs.pfnServerPrint(StatsMsg);
+	}
+}
+
+void UTIL_ResetTraceStats()
+{
+	// The sites themselves are statics at each call site, so they stay listed
+	for (auto it = TraceSites.begin(); it != TraceSites.end(); it++)
+	{
+		(*it)->NumTraces = 0;
+		(*it)->NumCacheHits = 0;
+	}
+
+	TotalTraces = 0;
+	TotalTraceCacheHits = 0;
+	TraceStatsStartTime = gpGlobals->time;
+}
+
+// BSP leafs for a player, worked out at most once per frame
+typedef struct _PLAYER_LEAF_CACHE
+{
+	float LastUpdateTime = -1.0f;
+	int EyeLeaf = -1;
+	int NumBoxLeafs = -1; // -1 if the player's bounds touched too many leafs to list
+	int BoxLeafs[BSP_MAX_BOX_LEAFS];
+} player_leaf_cache;
+
+static player_leaf_cache PlayerLeafCache[MAX_PLAYERS + 1];
+
+static player_leaf_cache* UTIL_GetPlayerLeafCache(const edict_t* Player)
+{
+	int PlayerIndex = ENTINDEX(Player);
+
+	if (PlayerIndex < 1 || PlayerIndex > MAX_PLAYERS) { return nullptr; }
+
+	player_leaf_cache* Cache = &PlayerLeafCache[PlayerIndex];
+
+	if (Cache->LastUpdateTime != gpGlobals->time)
+	{
+		Cache->EyeLeaf = BSP_GetLeafForPoint(GetPlayerEyePosition(Player));
+		Cache->NumBoxLeafs = BSP_GetLeafsInBox(Player->v.absmin, Player->v.absmax, Cache->BoxLeafs, BSP_MAX_BOX_LEAFS);
+		Cache->LastUpdateTime = gpGlobals->time;
+	}
+
+	return Cache;
+}
+
+void UTIL_ClearPlayerLeafCache()
+{
+	for (int i = 0; i <= MAX_PLAYERS; i++)
+	{
+		PlayerLeafCache[i].LastUpdateTime = -1.0f;
+	}
+}
+
+void UTIL_InvalidatePlayerLeafCache(const edict_t* Player)
+{
+	int PlayerIndex = ENTINDEX(Player);
+
+	if (PlayerIndex < 1 || PlayerIndex > MAX_PLAYERS) { return; }
+
+	PlayerLeafCache[PlayerIndex].LastUpdateTime = -1.0f;
+}
+
+int UTIL_GetPlayerEyeLeaf(const edict_t* Player)
+{
+	if (FNullEnt(Player)) { return -1; }
+
+	player_leaf_cache* Cache = UTIL_GetPlayerLeafCache(Player);
+
+	return (Cache) ? Cache->EyeLeaf : BSP_GetLeafForPoint(GetPlayerEyePosition(Player));
+}
+
+bool UTIL_IsEntityPotentiallyVisible(const int ViewLeaf, const edict_t* Entity)
+{
+	if (FNullEnt(Entity) || ViewLeaf <= 0) { return true; }
+
+	player_leaf_cache* Cache = (Entity->v.flags & (FL_CLIENT | FL_FAKECLIENT)) ? UTIL_GetPlayerLeafCache(Entity) : nullptr;
+
+	if (!Cache)
+	{
+		return BSP_IsBoxPotentiallyVisible(ViewLeaf, Entity->v.absmin, Entity->v.absmax);
+	}
+
+	if (Cache->NumBoxLeafs < 0) { return true; }
+
+	for (int i = 0; i < Cache->NumBoxLeafs; i++)
+	{
+		if (BSP_IsLeafPotentiallyVisible(ViewLeaf, Cache->BoxLeafs[i])) { return true; }
+	}
+
+	return false;
+}
+
 bool UTIL_QuickTrace(const edict_t* pEdict, const Vector& start, const Vector& end, bool bAllowStartSolid)
 {
 	TraceResult hit;
 	edict_t* IgnoreEdict = (!FNullEnt(pEdict)) ? pEdict->v.pContainingEntity : NULL;
-	UTIL_TraceLine(start, end, ignore_monsters, ignore_glass, IgnoreEdict, &hit);
+	UTIL_BrokeredTraceLine(start, end, ignore_monsters, ignore_glass, IgnoreEdict, &hit);
 	return (hit.flFraction >= 1.0f && !hit.fAllSolid && (bAllowStartSolid || !hit.fStartSolid));
 }
 
@@ -33,7 +309,7 @@ bool UTIL_QuickHullTrace(const edict_t* pEdict, const Vector& start, const Vecto
 	int hullNum = (!FNullEnt(pEdict)) ? GetPlayerHullIndex(pEdict) : point_hull;
 	edict_t* IgnoreEdict = (!FNullEnt(pEdict)) ? pEdict->v.pContainingEntity : NULL;
 	TraceResult hit;
-	UTIL_TraceHull(start, end, ignore_monsters, hullNum, IgnoreEdict, &hit);
+	UTIL_BrokeredTraceHull(start, end, ignore_monsters, hullNum, IgnoreEdict, &hit);
 
 	return (hit.flFraction >= 1.0f && !hit.fAllSolid && (bAllowStartSolid || !hit.fStartSolid));
 }
@@ -42,7 +318,7 @@ bool UTIL_QuickHullTrace(const edict_t* pEdict, const Vector& start, const Vecto
 {
 	TraceResult hit;
 	edict_t* IgnoreEdict = (!FNullEnt(pEdict)) ? pEdict->v.pContainingEntity : NULL;
-	UTIL_TraceHull(start, end, ignore_monsters, hullNum, IgnoreEdict, &hit);
+	UTIL_BrokeredTraceHull(start, end, ignore_monsters, hullNum, IgnoreEdict, &hit);
 
 	return (hit.flFraction >= 1.0f && !hit.fAllSolid && (bAllowStartSolid || !hit.fStartSolid));
 }
@@ -51,7 +327,7 @@ edict_t* UTIL_TraceEntity(const edict_t* pEdict, const Vector& start, const Vect
 {
 	TraceResult hit;
 	edict_t* IgnoreEdict = (!FNullEnt(pEdict)) ? pEdict->v.pContainingEntity : NULL;
-	UTIL_TraceLine(start, end, dont_ignore_monsters, dont_ignore_glass, IgnoreEdict, &hit);
+	UTIL_BrokeredTraceLine(start, end, dont_ignore_monsters, dont_ignore_glass, IgnoreEdict, &hit);
 	return hit.pHit;
 }
 
@@ -59,14 +335,14 @@ edict_t* UTIL_TraceEntityHull(const edict_t* pEdict, const Vector& start, const
 {
 	TraceResult hit;
 	edict_t* IgnoreEdict = (!FNullEnt(pEdict)) ? pEdict->v.pContainingEntity : NULL;
-	UTIL_TraceHull(start, end, dont_ignore_monsters, head_hull, IgnoreEdict, &hit);
+	UTIL_BrokeredTraceHull(start, end, dont_ignore_monsters, head_hull, IgnoreEdict, &hit);
 	return hit.pHit;
 }
 
 Vector UTIL_GetTraceHitLocation(const Vector Start, const Vector End)
 {
 	TraceResult hit;
-	UTIL_TraceHull(Start, End, ignore_monsters, point_hull, NULL, &hit);
+	UTIL_BrokeredTraceHull(Start, End, ignore_monsters, point_hull, NULL, &hit);
 
 	if (hit.flFraction < 1.0f && !hit.fAllSolid)
 	{
@@ -79,7 +355,7 @@ Vector UTIL_GetTraceHitLocation(const Vector Start, const Vector End)
 Vector UTIL_GetHullTraceHitLocation(const Vector Start, const Vector End, int HullNum)
 {
 	TraceResult hit;
-	UTIL_TraceHull(Start, End, ignore_monsters, HullNum, NULL, &hit);
+	UTIL_BrokeredTraceHull(Start, End, ignore_monsters, HullNum, NULL, &hit);
 
 	if (hit.flFraction < 1.0f && !hit.fAllSolid)
 	{
@@ -95,7 +371,7 @@ Vector UTIL_GetGroundLocation(const Vector CheckLocation)
 
 	TraceResult hit;
 
-	UTIL_TraceHull(CheckLocation, (CheckLocation - Vector(0.0f, 0.0f, 1000.0f)), ignore_monsters, head_hull, nullptr, &hit);
+	UTIL_BrokeredTraceHull(CheckLocation, (CheckLocation - Vector(0.0f, 0.0f, 1000.0f)), ignore_monsters, head_hull, nullptr, &hit);
 
 	if (hit.flFraction < 1.0f)
 	{
@@ -151,7 +427,7 @@ Vector UTIL_GetFloorUnderEntity(const edict_t* Edict)
 	Vector EntityCentre = UTIL_GetCentreOfEntity(Edict) + Vector(0.0f, 0.0f, 1.0f);
 	Vector TraceEnd = (EntityCentre - Vector(0.0f, 0.0f, 1000.0f));
 
-	UTIL_TraceHull(EntityCentre, TraceEnd, ignore_monsters, head_hull, Edict->v.pContainingEntity, &hit);
+	UTIL_BrokeredTraceHull(EntityCentre, TraceEnd, ignore_monsters, head_hull, Edict->v.pContainingEntity, &hit);
 
 	if (hit.flFraction < 1.0f)
 	{
@@ -5,8 +5,47 @@
 
 #include "AvHAIConstants.h"
 
+#include <sdk_util.h> // IGNORE_MONSTERS and IGNORE_GLASS for the trace broker
+
 #include <string>
 
+// Trace counts for one UTIL_BrokeredTraceLine or UTIL_BrokeredTraceHull call site
+typedef struct _TRACE_SITE_STATS
+{
+	const char* File = nullptr;
+	int Line = 0;
+	bool bListed = false; // Added to the list UTIL_PrintTraceStats reads on its first trace
+	unsigned int NumTraces = 0;
+	unsigned int NumCacheHits = 0;
+
+	_TRACE_SITE_STATS(const char* InFile, int InLine) : File(InFile), Line(InLine) {}
+} trace_site_stats;
+
+/*	Trace broker: bot traces made through UTIL_BrokeredTraceLine and UTIL_BrokeredTraceHull come through these. Traces that ignore monsters
+	and have the same endpoints (to within TRACE_CACHE_GRID units), flags, hull and ignored entity are only run once per server frame,
+	so several bots checking the same path point share the result. Traces that can hit players are always run, as players move between bots' updates */
+void UTIL_BrokerTraceLine(trace_site_stats* Site, const Vector& vecStart, const Vector& vecEnd, IGNORE_MONSTERS igmon, IGNORE_GLASS ignoreGlass, edict_t* pentIgnore, TraceResult* ptr);
+void UTIL_BrokerTraceLine(trace_site_stats* Site, const Vector& vecStart, const Vector& vecEnd, IGNORE_MONSTERS igmon, edict_t* pentIgnore, TraceResult* ptr);
+void UTIL_BrokerTraceHull(trace_site_stats* Site, const Vector& vecStart, const Vector& vecEnd, IGNORE_MONSTERS igmon, int HullNum, edict_t* pentIgnore, TraceResult* ptr);
+
+// Same arguments as UTIL_TraceLine and UTIL_TraceHull, with each call site keeping its own counters for UTIL_PrintTraceStats
+#define UTIL_BrokeredTraceLine(...) do { static trace_site_stats TraceSite(__FILE__, __LINE__); UTIL_BrokerTraceLine(&TraceSite, __VA_ARGS__); } while (0)
+#define UTIL_BrokeredTraceHull(...) do { static trace_site_stats TraceSite(__FILE__, __LINE__); UTIL_BrokerTraceHull(&TraceSite, __VA_ARGS__); } while (0)
+
+// Prints the trace cache hit rate, traces per bot per second and the busiest call sites since the stats were last reset
+void UTIL_PrintTraceStats();
+// Clears the trace counters and starts a new measurement window
+void UTIL_ResetTraceStats();
+
+// Forgets the cached player leafs, call when the map's hulls are unloaded
+void UTIL_ClearPlayerLeafCache();
+// Forgets one player's cached leafs, call after moving them partway through a frame
+void UTIL_InvalidatePlayerLeafCache(const edict_t* Player);
+// Returns the BSP leaf the player's eyes are in, worked out once per frame. -1 if the map's hulls aren't loaded
+int UTIL_GetPlayerEyeLeaf(const edict_t* Player);
+// False if the map's PVS rules out anything in Entity's bounds being seen from ViewLeaf, so any trace to it would fail
+bool UTIL_IsEntityPotentiallyVisible(const int ViewLeaf, const edict_t* Entity);
+
 
 bool UTIL_QuickTrace(const edict_t* pEdict, const Vector& start, const Vector& end, bool bAllowStartSolid = false);
 bool UTIL_QuickHullTrace(const edict_t* pEdict, const Vector& start, const Vector& end, bool bAllowStartSolid = false);
@@ -0,0 +1,256 @@
+//
+// EvoBot - Neoptolemus' Natural Selection bot, based on Botman's HPB bot template
+//
+// AvHAINavJobs.cpp
+//
+// Runs nav mesh queries on worker threads so they don't eat into the game frame
+//
+
+#include "AvHAINavJobs.h"
+
+#include "DetourNavMesh.h"
+#include "DetourCommon.h"
+#include "DetourNavMeshQuery.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+extern nav_mesh NavMeshes[NUM_NAV_MESHES];
+
+vector<thread> NavWorkers;
+
+mutex NavJobMutex; // Guards everything below
+condition_variable NavJobSignal; // Wakes the workers when jobs are queued, the fence is lowered or they're told to stop
+condition_variable NavFenceSignal; // Wakes the game thread when the last in-flight job finishes while the fence is raised
+
+deque<NavJob> QueuedNavJobs;
+vector<NavJob> CompletedNavJobs;
+
+unsigned int NextNavJobId = 1;
+int NumNavJobsInFlight = 0;
+bool bNavMeshFenceRaised = false;
+bool bStopNavWorkers = false;
+
+void NAV_NavWorkerThread()
+{
+	// Each worker gets its own queries, dtNavMeshQuery is not safe to share between threads
+	dtNavMeshQuery* WorkerQueries[NUM_NAV_MESHES] = { };
+
+	for (int i = 0; i < NUM_NAV_MESHES; i++)
+	{
+		if (!NavMeshes[i].navMesh) { continue; }
+
+		WorkerQueries[i] = dtAllocNavMeshQuery();
+
+		if (WorkerQueries[i] && dtStatusFailed(WorkerQueries[i]->init(NavMeshes[i].navMesh, NAV_WORKER_QUERY_NODES)))
+		{
+			dtFreeNavMeshQuery(WorkerQueries[i]);
+			WorkerQueries[i] = nullptr;
+		}
+	}
+
+	while (true)
+	{
+		NavJob Job;
+
+		{
+			unique_lock<mutex> Lock(NavJobMutex);
+
+			NavJobSignal.wait(Lock, [] { return bStopNavWorkers || (!bNavMeshFenceRaised && !QueuedNavJobs.empty()); });
+
+			if (bStopNavWorkers) { break; }
+
+			Job = move(QueuedNavJobs.front());
+			QueuedNavJobs.pop_front();
+
+			NumNavJobsInFlight++;
+		}
+
+		dtNavMeshQuery* NavQuery = (Job.NavMeshIndex < NUM_NAV_MESHES) ? WorkerQueries[Job.NavMeshIndex] : nullptr;
+
+		NAV_RunNavJob(Job, NavQuery);
+
+		{
+			lock_guard<mutex> Lock(NavJobMutex);
+
+			CompletedNavJobs.push_back(move(Job));
+
+			NumNavJobsInFlight--;
+
+			if (NumNavJobsInFlight == 0) { NavFenceSignal.notify_all(); }
+		}
+	}
+
+	for (int i = 0; i < NUM_NAV_MESHES; i++)
+	{
+		if (WorkerQueries[i]) { dtFreeNavMeshQuery(WorkerQueries[i]); }
+	}
+}
+
+void NAV_StartNavWorkers(int NumWorkers)
+{
+	NAV_StopNavWorkers();
+
+	NumWorkers = dtClamp(NumWorkers, 0, MAX_NAV_WORKER_THREADS);
+
+	if (NumWorkers == 0) { return; }
+
+	bStopNavWorkers = false;
+	bNavMeshFenceRaised = false;
+
+	for (int i = 0; i < NumWorkers; i++)
+	{
+		NavWorkers.push_back(thread(NAV_NavWorkerThread));
+	}
+
+	char WorkerMsg[128];
+	sprintf(WorkerMsg, "Started %d nav worker threads\n", NumWorkers);
+	g_engfuncs.pfnServerPrint(WorkerMsg);
+}
+
+void NAV_StopNavWorkers()
+{
+	if (NavWorkers.empty()) { return; }
+
+	{
+		lock_guard<mutex> Lock(NavJobMutex);
+		bStopNavWorkers = true;
+	}
+
+	NavJobSignal.notify_all();
+
+	for (auto it = NavWorkers.begin(); it != NavWorkers.end(); it++)
+	{
+		if (it->joinable()) { it->join(); }
+	}
+
+	NavWorkers.clear();
+
+	QueuedNavJobs.clear();
+	CompletedNavJobs.clear();
+	NumNavJobsInFlight = 0;
+	bNavMeshFenceRaised = false;
+	bStopNavWorkers = false;
+}
+
+bool NAV_NavWorkersActive()
+{
+	return !NavWorkers.empty();
+}
+
+unsigned int NAV_SubmitNavJob(const NavJob& Job)
+{
+	if (NavWorkers.empty()) { return 0; }
+
+	unsigned int NewJobId = 0;
+
+	{
+		lock_guard<mutex> Lock(NavJobMutex);
+
+		NewJobId = NextNavJobId++;
+
+		// 0 is reserved for "not submitted"
+		if (NextNavJobId == 0) { NextNavJobId = 1; }
+
+		QueuedNavJobs.push_back(Job);
+		QueuedNavJobs.back().JobId = NewJobId;
+	}
+
+	NavJobSignal.notify_one();
+
+	return NewJobId;
+}
+
+int NAV_ProcessCompletedNavJobs(const int MaxJobs)
+{
+	if (NavWorkers.empty() || MaxJobs <= 0) { return 0; }
+
+	vector<NavJob> FinishedJobs;
+
+	{
+		lock_guard<mutex> Lock(NavJobMutex);
+
+		// Oldest first, anything past MaxJobs waits for the next frame
+		const size_t NumJobs = (std::min)(CompletedNavJobs.size(), (size_t)MaxJobs);
+
+		FinishedJobs.assign(CompletedNavJobs.begin(), CompletedNavJobs.begin() + NumJobs);
+		CompletedNavJobs.erase(CompletedNavJobs.begin(), CompletedNavJobs.begin() + NumJobs);
+	}
+
+	for (auto it = FinishedJobs.begin(); it != FinishedJobs.end(); it++)
+	{
+		if (it->OnComplete)
+		{
+			it->OnComplete(*it);
+		}
+	}
+
+	return (int)FinishedJobs.size();
+}
+
+void NAV_RunNavJob(NavJob& Job, dtNavMeshQuery* NavQuery)
+{
+	Job.Status = DT_FAILURE;
+	Job.PolyPath.clear();
+
+	if (!NavQuery) { return; }
+
+	// Tables are only swapped while the fence is raised, so they can't change underneath the job
+	if (Job.NavMeshIndex < NUM_NAV_MESHES)
+	{
+		const vector<const dtLandmarkTable*>& Tables = NavMeshes[Job.NavMeshIndex].LandmarkTables;
+		NavQuery->setLandmarkTables((Tables.size() > 0) ? &Tables[0] : nullptr, (int)Tables.size());
+	}
+
+	dtStatus status;
+
+	if (!Job.StartPoly)
+	{
+		status = NavQuery->findNearestPoly(Job.StartPos, Job.Extents, &Job.Filter, &Job.StartPoly, Job.StartPos);
+
+		if (dtStatusFailed(status) || !Job.StartPoly) { return; }
+	}
+
+	if (!Job.EndPoly)
+	{
+		status = NavQuery->findNearestPoly(Job.EndPos, Job.Extents, &Job.Filter, &Job.EndPoly, Job.EndPos);
+
+		if (dtStatusFailed(status) || !Job.EndPoly) { return; }
+	}
+
+	dtPolyRef PolyPath[MAX_PATH_POLY];
+	int nPathCount = 0;
+
+	Job.Status = NavQuery->findPath(Job.StartPoly, Job.EndPoly, Job.StartPos, Job.EndPos, &Job.Filter, PolyPath, &nPathCount, MAX_PATH_POLY);
+
+	Job.PolyPath.assign(PolyPath, PolyPath + nPathCount);
+}
+
+void NAV_RaiseNavMeshFence()
+{
+	if (NavWorkers.empty()) { return; }
+
+	unique_lock<mutex> Lock(NavJobMutex);
+
+	bNavMeshFenceRaised = true;
+
+	NavFenceSignal.wait(Lock, [] { return NumNavJobsInFlight == 0; });
+}
+
+void NAV_LowerNavMeshFence()
+{
+	if (NavWorkers.empty()) { return; }
+
+	{
+		lock_guard<mutex> Lock(NavJobMutex);
+		bNavMeshFenceRaised = false;
+	}
+
+	NavJobSignal.notify_all();
+}
@@ -0,0 +1,76 @@
+//
+// EvoBot - Neoptolemus' Natural Selection bot, based on Botman's HPB bot template
+//
+// AvHAINavJobs.h
+//
+// Runs nav mesh queries on worker threads so they don't eat into the game frame
+//
+
+#pragma once
+
+#ifndef AVH_AI_NAV_JOBS_H
+#define AVH_AI_NAV_JOBS_H
+
+#include "AvHAINavigation.h"
+
+#include <vector>
+
+static const int MAX_NAV_WORKER_THREADS = 8; // Hard cap regardless of what the config asks for
+static const int NAV_WORKER_QUERY_NODES = 2048; // Node pool size for each worker's nav mesh queries, matches the game thread's queries
+
+typedef enum
+{
+	NAV_JOB_FIND_PATH = 0 // Poly corridor from StartPos to EndPos
+} NavJobType;
+
+struct _NAV_JOB;
+
+// Called on the game thread when a finished job is collected
+typedef void (*NavJobCallback)(struct _NAV_JOB& Job);
+
+// A single nav mesh query to run on a worker thread. All positions are in Detour coordinates
+typedef struct _NAV_JOB
+{
+	unsigned int JobId = 0; // Assigned by NAV_SubmitNavJob
+	NavJobType Type = NAV_JOB_FIND_PATH;
+	unsigned int NavMeshIndex = 0;
+	dtQueryFilter Filter; // Copied so the job isn't affected by changes to the requester's profile while in flight
+	edict_t* Requester = nullptr; // Optional, for the callback's benefit
+	NavJobCallback OnComplete = nullptr;
+
+	// Inputs. If StartPoly or EndPoly are 0 then the nearest poly within Extents is used
+	dtPolyRef StartPoly = 0;
+	dtPolyRef EndPoly = 0;
+	float StartPos[3] = { 0.0f, 0.0f, 0.0f };
+	float EndPos[3] = { 0.0f, 0.0f, 0.0f };
+	float Extents[3] = { 50.0f, 50.0f, 50.0f };
+
+	// Outputs
+	dtStatus Status = DT_FAILURE;
+	std::vector<dtPolyRef> PolyPath; // The poly corridor
+} NavJob;
+
+// Spins up the worker threads, each with its own nav mesh queries. Call after the nav meshes have been loaded. 0 threads means all queries stay on the game thread
+void NAV_StartNavWorkers(int NumWorkers);
+// Stops and joins all worker threads, discarding queued and uncollected jobs. Must be called before the nav meshes are freed
+void NAV_StopNavWorkers();
+// Returns true if there are worker threads available to take jobs
+bool NAV_NavWorkersActive();
+
+// Queues a job for the worker threads. Returns the job ID, or 0 if no workers are running and the caller should run the query itself
+unsigned int NAV_SubmitNavJob(const NavJob& Job);
+// Runs the OnComplete callback for up to MaxJobs finished jobs, oldest first, and returns how many it ran. Call from the game thread once per frame
+int NAV_ProcessCompletedNavJobs(const int MaxJobs);
+
+// Runs a nav job's query using the supplied query object. Used by the workers, but safe to call from the game thread too
+void NAV_RunNavJob(NavJob& Job, dtNavMeshQuery* NavQuery);
+
+/*
+	Blocks new jobs from starting and waits for in-flight ones to finish, so the nav mesh can be safely modified.
+	Only the game thread may modify the nav mesh, and only between raising and lowering the fence.
+*/
+void NAV_RaiseNavMeshFence();
+// Lets the workers resume after NAV_RaiseNavMeshFence
+void NAV_LowerNavMeshFence();
+
+#endif
@@ -14,6 +14,7 @@
 #include "AvHAITactical.h"
 #include "AvHAIWeaponHelper.h"
 #include "AvHAIConfig.h"
+#include "AvHAINavJobs.h"
 
 #include <stdlib.h>
 #include <math.h>
@@ -23,6 +24,7 @@
 
 #include "DetourNavMesh.h"
 #include "DetourCommon.h"
+#include "DetourNode.h"
 #include "DetourTileCache.h"
 #include "DetourTileCacheBuilder.h"
 #include "DetourNavMeshBuilder.h"
@@ -30,12 +32,45 @@
 #include "DetourAlloc.h"
 
 #include <cfloat>
+#include <climits>
+#include <deque>
+#include <unordered_map>
+#include <list>
+#include <thread>
+#include <chrono>
+#include <queue>
+#include <algorithm>
 
 using namespace std;
 
 vector<DynamicMapPrototype> MapObjectPrototypes;
 vector<DynamicMapObject> DynamicMapObjects;
 
+vector<int> DynamicObjectEdictLookup; // Index into DynamicMapObjects for each edict index, -1 if that edict isn't a dynamic object
+vector<vector<int>> DynamicObjectGrid; // Indices into DynamicMapObjects whose swept bounds overlap each grid cell
+vector<unsigned int> DynamicObjectQueryStamps; // Stops objects spanning several cells being returned more than once by a query
+unsigned int DynamicObjectQueryStamp = 0;
+bool bDynamicObjectIndexDirty = true; // Set whenever DynamicMapObjects is added to or removed from, so the index is rebuilt before it's next used
+
+// Last seen entvars for each dynamic object, kept in step with DynamicMapObjects. Objects whose fields haven't changed are only
+// fully updated if they're mid-transition, something they depend on changed, or their idle check comes round
+typedef struct _DYNAMIC_OBJECT_SNAPSHOT
+{
+	vector<edict_t*> Edicts;
+	vector<Vector> Origins;
+	vector<Vector> Velocities;
+	vector<float> NextThinks;
+	vector<float> Healths;
+	vector<int> DeadFlags;
+	vector<unsigned int> SeenChangeCounts; // DynamicObjectChangeCount when the object was last updated
+	vector<float> NextIdleCheckTimes; // When to fully update the object even if nothing changed, as a safety net
+	vector<unsigned char> NeedsUpdate; // Result of the last diff
+	bool bForceFullUpdate = true;
+} dynamic_object_snapshot;
+
+dynamic_object_snapshot DynamicObjectSnapshot;
+unsigned int DynamicObjectChangeCount = 0; // Bumped whenever any dynamic object changes state, type or active status, see NAV_SetDynamicObjectStatus
+
 nav_mesh NavMeshes[NUM_NAV_MESHES] = { }; // Array of nav meshes. Currently only 3 are used (building, onos, and regular)
 
 vector<NavAgentProfile> BaseAgentProfiles;
@@ -46,6 +81,38 @@ extern bool bNavMeshModified;
 
 bool bTileCacheUpToDate = false;
 
+deque<NavPathRequest> PendingPathRequests; // Bot path requests waiting their turn with the sliced path planner
+NavPathRequest ActivePathRequest; // The request the sliced path planner is currently working on
+bool bPathRequestActive = false;
+unordered_map<unsigned int, NavPathRequest> WorkerPathRequests; // Path requests handed to the nav worker threads, keyed by job ID
+unsigned int LastPathRequestId = 0; // Shared by all bots, so a request left queued by a bot which has since been kicked can't match whoever takes its slot
+
+list<NavPathCacheEntry> PathCache; // Most recently used corridors at the front
+unordered_map<NavPathCacheKey, list<NavPathCacheEntry>::iterator, NavPathCacheKeyHash> PathCacheLookup;
+unsigned int PathCacheHits = 0;
+unsigned int PathCacheMisses = 0;
+
+list<nav_flow_field> FlowFields; // Most recently used flow fields at the front
+unordered_map<NavPathCacheKey, unsigned int, NavPathCacheKeyHash> FlowFieldDemand; // How many searches have asked for each goal that doesn't have a flow field yet
+size_t FlowFieldMemory = 0; // Bytes used by everything in FlowFields
+unsigned int FlowFieldHits = 0;
+unsigned int FlowFieldBuilds = 0;
+nav_flow_field_build FlowFieldBuild; // At most one flow field is built at a time, other goals wait until it's finished
+
+vector<nav_landmarks> Landmarks; // One landmark table per nav mesh and distinct base profile filter
+unsigned int LandmarkTableBuilds = 0;
+
+vector<nav_cluster_graph> ClusterGraphs; // One cluster graph per nav mesh and filter that has asked to plan a long path
+unsigned int ClusterGraphBuilds = 0;
+unsigned int ClusterPathSearches = 0;
+
+unsigned char* NavFileData = nullptr; // Contents of the loaded nav file. Compressed tiles point into this, so it lives as long as the tile caches
+size_t NavFileSize = 0;
+
+vector<nav_reachability_islands> ReachabilityIslands; // One set of islands per nav mesh and filter flag combination that has been queried
+
+nav_tilecache_stats TileCacheStats;
+
 struct NavMeshSetHeader
 {
 	int magic;
@@ -87,6 +154,16 @@ struct TileCacheExportHeader
 	int SurfTypesOffset;
 };
 
+struct NavSnapshotHeader
+{
+	int magic = 0;
+	int version = 0;
+	int navMeshVersion = 0; // DT_NAVMESH_VERSION the tiles were built with
+	unsigned int sourceHash = 0; // Hash of the .nav file the tiles were built from
+	int sourceSize = 0;
+	int numNavMeshes = 0;
+};
+
 struct TileCacheTileHeader
 {
 	dtCompressedTileRef tileRef;
@@ -251,14 +328,89 @@ bool UTIL_UpdateTileCache()
 {
 	bool bNewTileCacheUpToDate = true;
 
+	auto UpdateStart = chrono::steady_clock::now();
+	long long ElapsedTime = 0;
+
+	TileCacheStats.UpdateSteps = 0;
+	TileCacheStats.PendingTiles = 0;
+	TileCacheStats.PendingRequests = 0;
+
 	for (int i = 0; i < NUM_NAV_MESHES; i++)
 	{
-		if (NavMeshes[i].tileCache)
+		dtTileCache* TileCache = NavMeshes[i].tileCache;
+
+		// An idle update doesn't touch the nav mesh, so there's nothing to do
+		if (!TileCache || !TileCache->hasPendingUpdates()) { continue; }
+
+		vector<Vector> PathPoints;
+		bool bGatheredPathPoints = false;
+
+		// Nav worker threads must not be reading tiles while they're being rebuilt
+		NAV_RaiseNavMeshFence();
+
+		bool bUpToDate = false;
+
+		// Always do at least one step per mesh so a busy mesh can't starve the others
+		do
 		{
-			bool bUpToDate;
-			NavMeshes[i].tileCache->update(0.0f, NavMeshes[i].navMesh, &bUpToDate);
-			if (!bUpToDate) { bNewTileCacheUpToDate = false; }
-		}
+			if (TileCache->getPendingUpdateCount() > 1)
+			{
+				if (!bGatheredPathPoints)
+				{
+					vector<AvHAIPlayer*> AllBots = AIMGR_GetAllAIPlayers();
+
+					for (auto BotIt = AllBots.begin(); BotIt != AllBots.end(); BotIt++)
+					{
+						AvHAIPlayer* ThisBot = (*BotIt);
+
+						if (ThisBot->BotNavInfo.NavProfile.NavMeshIndex != (unsigned int)i) { continue; }
+
+						const Vector BotLoc = ThisBot->CurrentFloorPosition;
+						PathPoints.push_back(Vector(BotLoc.x, BotLoc.z, -BotLoc.y));
+
+						const vector<bot_path_node>& BotPath = ThisBot->BotNavInfo.CurrentPath;
+						size_t LastNode = dtMin(BotPath.size(), (size_t)ThisBot->BotNavInfo.CurrentPathPoint + TILECACHE_PRIORITY_PATH_NODES);
+
+						for (size_t NodeIndex = ThisBot->BotNavInfo.CurrentPathPoint; NodeIndex < LastNode; NodeIndex++)
+						{
+							const Vector NodeLoc = BotPath[NodeIndex].Location;
+							PathPoints.push_back(Vector(NodeLoc.x, NodeLoc.z, -NodeLoc.y));
+						}
+					}
+
+					bGatheredPathPoints = true;
+				}
+
+				NAV_PrioritiseTileCacheUpdate(i, PathPoints);
+			}
+
+			TileCache->update(0.0f, NavMeshes[i].navMesh, &bUpToDate);
+			TileCacheStats.UpdateSteps++;
+
+			ElapsedTime = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - UpdateStart).count();
+
+		} while (!bUpToDate && ElapsedTime < MAX_TILECACHE_UPDATE_TIME_US);
+
+		NavMeshes[i].Revision++;
+		NAV_LowerNavMeshFence();
+
+		if (!bUpToDate) { bNewTileCacheUpToDate = false; }
+
+		TileCacheStats.PendingTiles += TileCache->getPendingUpdateCount();
+		TileCacheStats.PendingRequests += TileCache->getPendingRequestCount();
+	}
+
+	if (TileCacheStats.UpdateSteps > 0)
+	{
+		TileCacheStats.TimeSpent = (float)ElapsedTime * 0.001f;
+		TileCacheStats.PeakTimeSpent = fmaxf(TileCacheStats.PeakTimeSpent, TileCacheStats.TimeSpent);
+		TileCacheStats.PeakPendingTiles = imaxi(TileCacheStats.PeakPendingTiles, TileCacheStats.PendingTiles);
+
+		if (!bNewTileCacheUpToDate) { TileCacheStats.FramesOverBudget++; }
+	}
+	else
+	{
+		TileCacheStats.TimeSpent = 0.0f;
 	}
 
 	if (!bTileCacheUpToDate && bNewTileCacheUpToDate)
@@ -271,7 +423,57 @@ bool UTIL_UpdateTileCache()
 	return bTileCacheUpToDate;
 }
 
-Vector UTIL_AdjustPointAwayFromNavWall(const Vector Location, const float MaxDistanceFromWall)
+void NAV_PrioritiseTileCacheUpdate(const unsigned int NavMeshIndex, const vector<Vector>& PathPoints)
+{
+	dtTileCache* TileCache = NavMeshes[NavMeshIndex].tileCache;
+
+	if (!TileCache || PathPoints.size() == 0) { return; }
+
+	int NumPending = TileCache->getPendingUpdateCount();
+
+	if (NumPending < 2) { return; }
+
+	int BestIndex = 0;
+	float MinDistSq = FLT_MAX;
+
+	for (int i = 0; i < NumPending; i++)
+	{
+		const dtCompressedTile* Tile = TileCache->getTileByRef(TileCache->getPendingUpdate(i));
+
+		if (!Tile || !Tile->header) { continue; }
+
+		const float* bmin = Tile->header->bmin;
+		const float* bmax = Tile->header->bmax;
+
+		for (auto it = PathPoints.begin(); it != PathPoints.end(); it++)
+		{
+			// Distance from the point to the tile's bounding box, 0 if it's inside
+			float dx = fmaxf(fmaxf(bmin[0] - it->x, it->x - bmax[0]), 0.0f);
+			float dy = fmaxf(fmaxf(bmin[1] - it->y, it->y - bmax[1]), 0.0f);
+			float dz = fmaxf(fmaxf(bmin[2] - it->z, it->z - bmax[2]), 0.0f);
+
+			float DistSq = (dx * dx) + (dy * dy) + (dz * dz);
+
+			if (DistSq < MinDistSq)
+			{
+				MinDistSq = DistSq;
+				BestIndex = i;
+			}
+		}
+
+		// Can't do better than a tile one of the bots is standing in or about to walk through
+		if (MinDistSq == 0.0f) { break; }
+	}
+
+	TileCache->prioritiseUpdate(BestIndex);
+}
+
+const nav_tilecache_stats* NAV_GetTileCacheStats()
+{
+	return &TileCacheStats;
+}
+
+Vector UTIL_AdjustPointAwayFromNavWall(const Vector Location, const float MaxDistanceFromWall, const dtPolyRef PolyHint)
 {
 
 	const dtNavMeshQuery* m_navQuery = UTIL_GetNavMeshQueryForProfile(BaseAgentProfiles[0]);
@@ -283,7 +485,17 @@ Vector UTIL_AdjustPointAwayFromNavWall(const Vector Location, const float MaxDis
 	float HitPos[3] = { 0.0f, 0.0f, 0.0f };
 	float HitNorm[3] = { 0.0f, 0.0f, 0.0f };
 
-	dtPolyRef StartPoly = UTIL_GetNearestPolyRefForLocation(Location);
+	float PolySearchExtents[3] = { 50.0f, 50.0f, 50.0f };
+	float NearestPoint[3] = { 0.0f, 0.0f, 0.0f };
+	dtPolyRef StartPoly = 0;
+
+	NAV_FindNearestPolyWithHint(m_navQuery, PolyHint, Pos, PolySearchExtents, m_navFilter, &StartPoly, NearestPoint);
+
+	// Already far enough from every wall, nothing to adjust
+	if (StartPoly && dtVdist2DSqr(Pos, NearestPoint) < 0.01f && m_navQuery->getAttachedNavMesh()->getPolyClearance(StartPoly) >= MaxDistanceFromWall)
+	{
+		return Location;
+	}
 
 	dtStatus Result = m_navQuery->findDistanceToWall(StartPoly, Pos, MaxDistanceFromWall, m_navFilter, &HitDist, HitPos, HitNorm);
 
@@ -325,7 +537,7 @@ Vector UTIL_GetNearestPointOnNavWall(AvHAIPlayer* pBot, const float MaxRadius)
 	float HitPos[3] = { 0.0f, 0.0f, 0.0f };
 	float HitNorm[3] = { 0.0f, 0.0f, 0.0f };
 
-	dtStatus Result = m_navQuery->findDistanceToWall(pBot->BotNavInfo.CurrentPoly, Pos, MaxRadius, m_navFilter, &HitDist, HitPos, HitNorm);
+	dtStatus Result = m_navQuery->findDistanceToWall(NAV_GetBotPolyHint(pBot, pBot->BotNavInfo.NavProfile.NavMeshIndex), Pos, MaxRadius, m_navFilter, &HitDist, HitPos, HitNorm);
 
 	if (dtStatusSucceed(Result) && HitDist > 0.0f)
 	{
@@ -428,6 +640,18 @@ void GetFullFilePath(char* buffer, const char* mapname)
 	strcpy(buffer, filename);
 }
 
+void GetNavSnapshotFilePath(char* buffer, const char* mapname)
+{
+	char filename[256];
+	char SnapshotName[128];
+
+	strcpy(SnapshotName, mapname);
+	strcat(SnapshotName, ".navcache");
+
+	UTIL_BuildFileName(filename, "addons", "dtbot", "navmeshes", SnapshotName);
+	strcpy(buffer, filename);
+}
+
 
 void ReloadNavMeshes()
 {
@@ -456,6 +680,11 @@ void ReloadNavMeshes()
 
 void UnloadNavMeshes()
 {
+	// Workers hold pointers to the nav meshes, so they have to go first
+	NAV_StopNavWorkers();
+
+	NAV_ClearLandmarks();
+
 	for (int i = 0; i < NUM_NAV_MESHES; i++)
 	{
 		if (NavMeshes[i].navMesh)
@@ -470,6 +699,12 @@ void UnloadNavMeshes()
 			NavMeshes[i].navQuery = nullptr;
 		}
 
+		if (NavMeshes[i].slicedQuery)
+		{
+			dtFreeNavMeshQuery(NavMeshes[i].slicedQuery);
+			NavMeshes[i].slicedQuery = nullptr;
+		}
+
 		if (NavMeshes[i].tileCache)
 		{
 			dtFreeTileCache(NavMeshes[i].tileCache);
@@ -480,6 +715,21 @@ void UnloadNavMeshes()
 		NavMeshes[i].MeshHints.clear();
 	}
 
+	if (NavFileData)
+	{
+		dtFree(NavFileData);
+		NavFileData = nullptr;
+		NavFileSize = 0;
+	}
+
+	NAV_ClearPathRequests();
+	NAV_ClearReachabilityIslands();
+	NAV_ClearPathCache();
+	NAV_ClearFlowFields();
+	NAV_ClearClusterGraphs();
+
+	TileCacheStats = nav_tilecache_stats();
+
 	NavmeshStatus = NAVMESH_STATUS_PENDING;
 }
 
@@ -514,21 +764,41 @@ bool LoadNavMesh(const char* mapname)
 		return false; 
 	}
 
+	// Read the whole file in one go. The compressed tiles are handed to the tile cache in place rather than each being copied into its own buffer
+	fseek(savedFile, 0, SEEK_END);
+	long FileSize = ftell(savedFile);
+	fseek(savedFile, 0, SEEK_SET);
+
+	NavFileData = (FileSize > 0) ? (unsigned char*)dtAlloc(FileSize, DT_ALLOC_PERM) : nullptr;
+
+	if (!NavFileData || fread(NavFileData, FileSize, 1, savedFile) != 1)
+	{
+		// Error or early EOF
+		fclose(savedFile);
+		UnloadNavMeshes();
+		sprintf(SuccMsg, "The nav file for %s is corrupted or incompatible\n", mapname);
+		g_engfuncs.pfnServerPrint(SuccMsg);
+		g_engfuncs.pfnServerPrint("You will need to create one using the Nav Editor tool in the navmeshes folder, or download one\n");
+		return false;
+	}
+
+	fclose(savedFile);
+
+	NavFileSize = (size_t)FileSize;
+
 	LinearAllocator* m_talloc = new LinearAllocator(32000);
 	FastLZCompressor* m_tcomp = new FastLZCompressor;
 	MeshProcess* m_tmproc = new MeshProcess;
 
 	// Read header.
 	TileCacheExportHeader fileHeader;
-	size_t headerReadReturnCode = fread(&fileHeader, sizeof(TileCacheExportHeader), 1, savedFile);
-	if (headerReadReturnCode != 1)
+	if (!NAV_ReadNavFileData(0, &fileHeader, sizeof(TileCacheExportHeader)) || fileHeader.numTileCaches < 0 || fileHeader.numTileCaches > NUM_NAV_MESHES)
 	{
 		// Error or early EOF
 		UnloadNavMeshes();
 		sprintf(SuccMsg, "The nav file for %s is corrupted or incompatible\n", mapname);
 		g_engfuncs.pfnServerPrint(SuccMsg);
 		g_engfuncs.pfnServerPrint("You will need to create one using the Nav Editor tool in the navmeshes folder, or download one\n");
-		fclose(savedFile);
 		return false;
 	}
 	if (fileHeader.magic != TILECACHESET_MAGIC)
@@ -537,7 +807,6 @@ bool LoadNavMesh(const char* mapname)
 		sprintf(SuccMsg, "The nav file for %s is using a different file version than expected\n", mapname);
 		g_engfuncs.pfnServerPrint(SuccMsg);
 		g_engfuncs.pfnServerPrint("You will need to create one using the Nav Editor tool in the navmeshes folder, or download one\n");
-		fclose(savedFile);
 		return false;
 	}
 	if (fileHeader.version != TILECACHESET_VERSION)
@@ -546,34 +815,44 @@ bool LoadNavMesh(const char* mapname)
 		sprintf(SuccMsg, "The nav file for %s is using a different file version than expected\n", mapname);
 		g_engfuncs.pfnServerPrint(SuccMsg);
 		g_engfuncs.pfnServerPrint("You will need to create one using the Nav Editor tool in the navmeshes folder, or download one\n");
-		fclose(savedFile);
 		return false;
 	}
 
-	fseek(savedFile, fileHeader.tileCacheDataOffset, SEEK_SET);
+	// If the tiles were baked on a previous load of this exact nav file, we can skip building them
+	const unsigned int SourceHash = NAV_GetNavFileHash();
+
+	vector<vector<vector<unsigned char>>> SnapshotTiles;
+	bool bSnapshotNeedsWriting = !NAV_ReadNavMeshSnapshot(mapname, SourceHash, fileHeader.numTileCaches, SnapshotTiles);
+
+	if (bSnapshotNeedsWriting)
+	{
+		SnapshotTiles.clear();
+		SnapshotTiles.resize(fileHeader.numTileCaches);
+	}
 
 	for (int i = 0; i < fileHeader.numTileCaches; i++)
 	{
-		fseek(savedFile, fileHeader.tileCacheOffsets[i], SEEK_SET);
+		size_t ReadOffset = (size_t)fileHeader.tileCacheOffsets[i];
 
 		dtFreeNavMesh(NavMeshes[i].navMesh);
 		dtFreeTileCache(NavMeshes[i].tileCache);
 		dtFreeNavMeshQuery(NavMeshes[i].navQuery);
+		dtFreeNavMeshQuery(NavMeshes[i].slicedQuery);
 
 		TileCacheSetHeader tcHeader;
 
-		size_t headerReadReturnCode = fread(&tcHeader, sizeof(TileCacheSetHeader), 1, savedFile);
-		if (headerReadReturnCode != 1)
+		if (!NAV_ReadNavFileData(ReadOffset, &tcHeader, sizeof(TileCacheSetHeader)))
 		{
 			// Error or early EOF
 			UnloadNavMeshes();
 			sprintf(SuccMsg, "The nav file for %s is corrupted or incompatible\n", mapname);
 			g_engfuncs.pfnServerPrint(SuccMsg);
 			g_engfuncs.pfnServerPrint("You will need to create one using the Nav Editor tool in the navmeshes folder, or download one\n");
-			fclose(savedFile);
 			return false;
 		}
 
+		ReadOffset += sizeof(TileCacheSetHeader);
+
 		NavMeshes[i].navMesh = dtAllocNavMesh();
 		if (!NavMeshes[i].navMesh) 
 		{
@@ -581,10 +860,12 @@ bool LoadNavMesh(const char* mapname)
 			UnloadNavMeshes();
 			sprintf(SuccMsg, "Could not allocate memory for nav data.\n", mapname);
 			g_engfuncs.pfnServerPrint(SuccMsg);
-			fclose(savedFile);
 			return false;
 		}
 
+		// Precompute portal geometry per link so the searches don't re-derive it every expansion
+		NavMeshes[i].navMesh->setLinkPortalsEnabled(true);
+
 		NavMeshes[i].tileCache = dtAllocTileCache();
 		if (!NavMeshes[i].tileCache) 
 		{
@@ -592,7 +873,6 @@ bool LoadNavMesh(const char* mapname)
 			UnloadNavMeshes();
 			sprintf(SuccMsg, "Could not allocate memory for nav data.\n", mapname);
 			g_engfuncs.pfnServerPrint(SuccMsg);
-			fclose(savedFile);
 			return false;
 		}
 
@@ -603,7 +883,16 @@ bool LoadNavMesh(const char* mapname)
 			UnloadNavMeshes();
 			sprintf(SuccMsg, "Could not allocate memory for nav data.\n", mapname);
 			g_engfuncs.pfnServerPrint(SuccMsg);
-			fclose(savedFile);
+			return false;
+		}
+
+		NavMeshes[i].slicedQuery = dtAllocNavMeshQuery();
+		if (!NavMeshes[i].slicedQuery)
+		{
+			// Error or early EOF
+			UnloadNavMeshes();
+			sprintf(SuccMsg, "Could not allocate memory for nav data.\n", mapname);
+			g_engfuncs.pfnServerPrint(SuccMsg);
 			return false;
 		}
 
@@ -614,7 +903,6 @@ bool LoadNavMesh(const char* mapname)
 			UnloadNavMeshes();
 			sprintf(SuccMsg, "Failed to initialise nav mesh (bad data?)\n", mapname);
 			g_engfuncs.pfnServerPrint(SuccMsg);
-			fclose(savedFile);
 			return false;
 		}
 
@@ -625,46 +913,74 @@ bool LoadNavMesh(const char* mapname)
 			UnloadNavMeshes();
 			sprintf(SuccMsg, "Failed to initialise tile cache (bad data?)\n", mapname);
 			g_engfuncs.pfnServerPrint(SuccMsg);
-			fclose(savedFile);
 			return false;
 		}
 
+		vector<dtCompressedTileRef> LoadedTiles;
+
 		// Read tiles.
 		for (int ii = 0; ii < tcHeader.numTiles; ++ii)
 		{
 			TileCacheTileHeader tileHeader;
-			size_t tileHeaderReadReturnCode = fread(&tileHeader, sizeof(tileHeader), 1, savedFile);
-			if (tileHeaderReadReturnCode != 1) { continue; }
+			if (!NAV_ReadNavFileData(ReadOffset, &tileHeader, sizeof(tileHeader))) { break; }
+
+			ReadOffset += sizeof(tileHeader);
 
 			if (!tileHeader.tileRef || !tileHeader.dataSize)
 				break;
 
-			unsigned char* data = (unsigned char*)dtAlloc(tileHeader.dataSize, DT_ALLOC_PERM);
-			if (!data) break;
-			memset(data, 0, tileHeader.dataSize);
-			size_t tileDataReadReturnCode = fread(data, tileHeader.dataSize, 1, savedFile);
-			if (tileDataReadReturnCode != 1)
+			if (tileHeader.dataSize < 0 || ReadOffset + tileHeader.dataSize > NavFileSize)
 			{
 				// Error or early EOF
-				dtFree(data);
 				UnloadNavMeshes();
 				sprintf(SuccMsg, "The nav file for %s is corrupted or incompatible\n", mapname);
 				g_engfuncs.pfnServerPrint(SuccMsg);
-				fclose(savedFile);
 				return false;
 			}
 
+			unsigned char* data = &NavFileData[ReadOffset];
+			unsigned char TileFlags = 0;
+
+			ReadOffset += tileHeader.dataSize;
+
+			// The tile cache reads the layer header straight out of the tile data, so it has to be aligned. Copy it out if it isn't
+			if (((uintptr_t)data % sizeof(int)) != 0)
+			{
+				unsigned char* AlignedData = (unsigned char*)dtAlloc(tileHeader.dataSize, DT_ALLOC_PERM);
+				if (!AlignedData) break;
+				memcpy(AlignedData, data, tileHeader.dataSize);
+
+				data = AlignedData;
+				TileFlags = DT_COMPRESSEDTILE_FREE_DATA;
+			}
+
 			dtCompressedTileRef tile = 0;
-			dtStatus addTileStatus = NavMeshes[i].tileCache->addTile(data, tileHeader.dataSize, DT_COMPRESSEDTILE_FREE_DATA, &tile);
-			if (dtStatusFailed(addTileStatus))
+			dtStatus addTileStatus = NavMeshes[i].tileCache->addTile(data, tileHeader.dataSize, TileFlags, &tile);
+			if (dtStatusFailed(addTileStatus) && (TileFlags & DT_COMPRESSEDTILE_FREE_DATA))
 			{
 				dtFree(data);
 			}
 
 			if (tile)
-				NavMeshes[i].tileCache->buildNavMeshTile(tile, NavMeshes[i].navMesh);
+				LoadedTiles.push_back(tile);
+		}
+
+		if (!bSnapshotNeedsWriting && SnapshotTiles[i].size() == LoadedTiles.size())
+		{
+			NAV_AddBakedNavMeshTiles(NavMeshes[i].tileCache, NavMeshes[i].navMesh, LoadedTiles, SnapshotTiles[i]);
+		}
+		else
+		{
+			SnapshotTiles[i].clear();
+			NAV_BuildNavMeshTiles(NavMeshes[i].tileCache, NavMeshes[i].navMesh, LoadedTiles, &SnapshotTiles[i]);
+			bSnapshotNeedsWriting = true;
 		}
 
+		// Per-poly distance to the nearest wall, so wall checks can usually skip findDistanceToWall. Walls are whatever the default profile can't walk on.
+		// Enabled once all tiles are in so each tile's field is only built once, tiles rebuilt later refresh it themselves
+		const dtQueryFilter& ClearanceFilter = GetBaseAgentProfile(NAV_PROFILE_DEFAULT).Filters;
+		NavMeshes[i].navMesh->setPolyClearance(NAV_POLY_CLEARANCE_LIMIT, ClearanceFilter.getIncludeFlags(), ClearanceFilter.getExcludeFlags());
+
 		status = NavMeshes[i].navQuery->init(NavMeshes[i].navMesh, 2048);
 
 		if (dtStatusFailed(status))
@@ -672,16 +988,27 @@ bool LoadNavMesh(const char* mapname)
 			UnloadNavMeshes();
 			sprintf(SuccMsg, "Failed to initialise nav query (bad data?)\n", mapname);
 			g_engfuncs.pfnServerPrint(SuccMsg);
-			fclose(savedFile);
 			return false;
 		}
 
-		fseek(savedFile, tcHeader.OffMeshConsOffset, SEEK_SET);
+		status = NavMeshes[i].slicedQuery->init(NavMeshes[i].navMesh, 2048);
+
+		if (dtStatusFailed(status))
+		{
+			UnloadNavMeshes();
+			sprintf(SuccMsg, "Failed to initialise nav query (bad data?)\n", mapname);
+			g_engfuncs.pfnServerPrint(SuccMsg);
+			return false;
+		}
+
+		ReadOffset = (size_t)tcHeader.OffMeshConsOffset;
 
 		for (int ii = 0; ii < tcHeader.NumOffMeshCons; ii++)
 		{
 			dtOffMeshConnection def;
-			fread(&def, sizeof(dtOffMeshConnection), 1, savedFile);
+			if (!NAV_ReadNavFileData(ReadOffset, &def, sizeof(dtOffMeshConnection))) { break; }
+
+			ReadOffset += sizeof(dtOffMeshConnection);
 
 			Vector Start = Vector(def.pos[0], -def.pos[2], def.pos[1]);
 			Vector End = Vector(def.pos[3], -def.pos[5], def.pos[4]);
@@ -689,135 +1016,346 @@ bool LoadNavMesh(const char* mapname)
 			NAV_AddOffMeshConnectionToNavmesh(i, Start, End, def.area, def.flags, def.bBiDir);
 		}
 
-		fseek(savedFile, tcHeader.NavHintsOffset, SEEK_SET);
+		ReadOffset = (size_t)tcHeader.NavHintsOffset;
 
 		for (int ii = 0; ii < tcHeader.NumNavHints; ii++)
 		{
 			NavHint def;
+			if (!NAV_ReadNavFileData(ReadOffset, &def, sizeof(NavHint))) { break; }
 
-			fread(&def, sizeof(NavHint), 1, savedFile);
+			ReadOffset += sizeof(NavHint);
 
 			Vector Position = Vector(def.Position[0], -def.Position[2], def.Position[1]);
 
 			NAV_AddHintToNavmesh(i, Position, def.HintTypes);
 		}
 	}
-
-	fclose(savedFile);
 	
+	if (bSnapshotNeedsWriting && !NAV_WriteNavMeshSnapshot(mapname, SourceHash, SnapshotTiles))
+	{
+		sprintf(SuccMsg, "Unable to write the nav mesh snapshot for %s, the nav mesh will be rebuilt on every load\n", mapname);
+		g_engfuncs.pfnServerPrint(SuccMsg);
+	}
+
 	sprintf(SuccMsg, "Navigation data for %s loaded successfully\n", mapname);
 	g_engfuncs.pfnServerPrint(SuccMsg);
 
+	NAV_InitLandmarks();
+
+	NAV_StartNavWorkers(CONFIG_GetNumNavWorkerThreads());
+
 	return true;
 }
 
-bool loadNavigationData(const char* mapname)
+bool NAV_ReadNavFileData(const size_t Offset, void* Dest, const size_t Size)
 {
-	// Unload the previous nav meshes if they're still loaded
-	UnloadNavigationData();
-
-	PopulateBaseAgentProfiles();
+	if (!NavFileData || Offset > NavFileSize || Size > NavFileSize - Offset) { return false; }
 
-	if (!LoadNavMesh(mapname))
-	{
-		NavmeshStatus = NAVMESH_STATUS_FAILED;
-		return false;
-	}
-
-	NavmeshStatus = NAVMESH_STATUS_SUCCESS;
-	
-	
+	memcpy(Dest, &NavFileData[Offset], Size);
 
 	return true;
 }
 
-bool NavmeshLoaded()
+void NAV_BuildNavMeshTiles(dtTileCache* TileCache, dtNavMesh* NavMesh, const vector<dtCompressedTileRef>& Tiles, vector<vector<unsigned char>>* BakedTiles)
 {
-	return NavMeshes[0].navMesh != nullptr;
-}
+	const int NumTiles = (int)Tiles.size();
 
-AvHAINavMeshStatus NAV_GetNavMeshStatus()
-{
-	return NavmeshStatus;
-}
+	if (NumTiles == 0) { return; }
 
-Vector UTIL_GetRandomPointOnNavmesh(const AvHAIPlayer* pBot)
-{
-	const dtNavMeshQuery* m_navQuery = UTIL_GetNavMeshQueryForProfile(pBot->BotNavInfo.NavProfile);
-	const dtQueryFilter* m_navFilter = &pBot->BotNavInfo.NavProfile.Filters;
+	const int NumThreads = dtClamp((int)thread::hardware_concurrency(), 1, dtMin(MAX_NAV_WORKER_THREADS, NumTiles));
 
-	if (!m_navQuery)
+	vector<unsigned char*> TileData(NumTiles, nullptr);
+	vector<int> TileDataSize(NumTiles, 0);
+	vector<dtStatus> TileStatus(NumTiles, DT_FAILURE);
+
+	// Building the tile data only reads from the tile cache, so each thread can take a share of the tiles as long as it has its own scratch memory
+	auto BuildTileShare = [&](int ThreadIndex)
 	{
-		return ZERO_VECTOR;
-	}
+		LinearAllocator ThreadAlloc(32000);
 
-	Vector Result;
+		for (int t = ThreadIndex; t < NumTiles; t += NumThreads)
+		{
+			TileStatus[t] = TileCache->buildNavMeshTileData(Tiles[t], &ThreadAlloc, &TileData[t], &TileDataSize[t]);
+		}
+	};
 
-	dtPolyRef refPoly;
+	vector<thread> BuildThreads;
 
-	float result[3];
-	std::memset(result, 0, sizeof(result));
+	for (int ThreadIndex = 1; ThreadIndex < NumThreads; ThreadIndex++)
+	{
+		BuildThreads.push_back(thread(BuildTileShare, ThreadIndex));
+	}
 
-	dtStatus status = m_navQuery->findRandomPoint(m_navFilter, frand, &refPoly, result);
+	BuildTileShare(0);
 
-	if (dtStatusFailed(status))
+	for (auto it = BuildThreads.begin(); it != BuildThreads.end(); it++)
 	{
-		return ZERO_VECTOR;
+		it->join();
 	}
 
-	Result.x = result[0];
-	Result.y = -result[2];
-	Result.z = result[1];
+	if (BakedTiles)
+	{
+		BakedTiles->resize(NumTiles);
+	}
 
-	return Result;
+	// Adding to the nav mesh links tiles to their neighbours, so that part stays single-threaded
+	for (int t = 0; t < NumTiles; t++)
+	{
+		if (dtStatusSucceed(TileStatus[t]))
+		{
+			// The nav mesh writes its links into the tile data, so take the copy first
+			if (BakedTiles && TileData[t])
+			{
+				(*BakedTiles)[t].assign(TileData[t], TileData[t] + TileDataSize[t]);
+			}
+
+			TileCache->addNavMeshTileData(Tiles[t], NavMesh, TileData[t], TileDataSize[t]);
+		}
+	}
 }
 
-Vector UTIL_GetRandomPointOnNavmeshInRadiusOfAreaType(NavMovementFlag Flag, const Vector origin, const float MaxRadius)
+void NAV_AddBakedNavMeshTiles(dtTileCache* TileCache, dtNavMesh* NavMesh, const vector<dtCompressedTileRef>& Tiles, const vector<vector<unsigned char>>& BakedTiles)
 {
-	const dtNavMeshQuery* m_NavQuery = UTIL_GetNavMeshQueryForProfile(GetBaseAgentProfile(NAV_PROFILE_DEFAULT));
-
-	if (!m_NavQuery) { return ZERO_VECTOR; }
+	for (size_t t = 0; t < Tiles.size() && t < BakedTiles.size(); t++)
+	{
+		// Empty means the tile had no polys when it was baked
+		if (BakedTiles[t].empty()) { continue; }
 
-	dtQueryFilter filter;
-	filter.setExcludeFlags(0);
-	filter.setIncludeFlags(Flag);
+		unsigned char* TileData = (unsigned char*)dtAlloc(BakedTiles[t].size(), DT_ALLOC_PERM);
 
-	Vector Result = ZERO_VECTOR;
+		if (!TileData) { continue; }
 
-	float pCheckLoc[3] = { origin.x, origin.z, -origin.y };
+		memcpy(TileData, BakedTiles[t].data(), BakedTiles[t].size());
 
-	dtPolyRef FoundPoly;
-	float NavNearest[3];
+		TileCache->addNavMeshTileData(Tiles[t], NavMesh, TileData, (int)BakedTiles[t].size());
+	}
+}
 
-	dtStatus foundPolyResult = m_NavQuery->findNearestPoly(pCheckLoc, pExtents, &filter, &FoundPoly, NavNearest);
+unsigned int NAV_GetNavFileHash()
+{
+	// FNV-1a
+	unsigned int Hash = 2166136261u;
 
-	if (dtStatusFailed(foundPolyResult))
+	for (size_t i = 0; i < NavFileSize; i++)
 	{
-		return ZERO_VECTOR;
+		Hash = (Hash ^ NavFileData[i]) * 16777619u;
 	}
 
-	dtPolyRef RandomPoly;
-	float RandomPoint[3];
+	return Hash;
+}
 
-	dtStatus foundRandomPointResult = m_NavQuery->findRandomPointAroundCircle(FoundPoly, NavNearest, MaxRadius, &filter, frand, &RandomPoly, RandomPoint);
+bool NAV_ReadNavMeshSnapshot(const char* mapname, const unsigned int SourceHash, const int NumNavMeshes, vector<vector<vector<unsigned char>>>& SnapshotTiles)
+{
+	SnapshotTiles.clear();
+
+	char filename[256];
+	GetNavSnapshotFilePath(filename, mapname);
 
+	FILE* SnapshotFile = fopen(filename, "rb");
 
-	if (dtStatusFailed(foundRandomPointResult))
+	if (!SnapshotFile) { return false; }
+
+	NavSnapshotHeader SnapshotHeader;
+
+	bool bValid = fread(&SnapshotHeader, sizeof(NavSnapshotHeader), 1, SnapshotFile) == 1
+		&& SnapshotHeader.magic == NAVSNAPSHOT_MAGIC
+		&& SnapshotHeader.version == NAVSNAPSHOT_VERSION
+		&& SnapshotHeader.navMeshVersion == DT_NAVMESH_VERSION
+		&& SnapshotHeader.sourceHash == SourceHash
+		&& SnapshotHeader.sourceSize == (int)NavFileSize
+		&& SnapshotHeader.numNavMeshes == NumNavMeshes;
+
+	if (bValid)
 	{
-		return ZERO_VECTOR;
+		SnapshotTiles.resize(NumNavMeshes);
 	}
 
-	Result.x = RandomPoint[0];
-	Result.y = -RandomPoint[2];
-	Result.z = RandomPoint[1];
+	for (int i = 0; bValid && i < NumNavMeshes; i++)
+	{
+		int NumTiles = 0;
+		bValid = fread(&NumTiles, sizeof(int), 1, SnapshotFile) == 1 && NumTiles >= 0;
 
-	return Result;
-}
+		if (!bValid) { break; }
 
-Vector UTIL_GetRandomPointOnNavmeshInRadius(const NavAgentProfile &NavProfile, const Vector origin, const float MaxRadius)
-{
-	const dtNavMeshQuery* m_navQuery = UTIL_GetNavMeshQueryForProfile(NavProfile);
-	const dtQueryFilter* m_navFilter = &NavProfile.Filters;
+		SnapshotTiles[i].resize(NumTiles);
+
+		for (int t = 0; bValid && t < NumTiles; t++)
+		{
+			int DataSize = 0;
+			bValid = fread(&DataSize, sizeof(int), 1, SnapshotFile) == 1 && DataSize >= 0;
+
+			if (bValid && DataSize > 0)
+			{
+				SnapshotTiles[i][t].resize(DataSize);
+				bValid = fread(SnapshotTiles[i][t].data(), DataSize, 1, SnapshotFile) == 1;
+			}
+		}
+	}
+
+	fclose(SnapshotFile);
+
+	if (!bValid)
+	{
+		SnapshotTiles.clear();
+	}
+
+	return bValid;
+}
+
+bool NAV_WriteNavMeshSnapshot(const char* mapname, const unsigned int SourceHash, const vector<vector<vector<unsigned char>>>& SnapshotTiles)
+{
+	char filename[256];
+	GetNavSnapshotFilePath(filename, mapname);
+
+	FILE* SnapshotFile = fopen(filename, "wb");
+
+	if (!SnapshotFile) { return false; }
+
+	NavSnapshotHeader SnapshotHeader;
+	SnapshotHeader.magic = NAVSNAPSHOT_MAGIC;
+	SnapshotHeader.version = NAVSNAPSHOT_VERSION;
+	SnapshotHeader.navMeshVersion = DT_NAVMESH_VERSION;
+	SnapshotHeader.sourceHash = SourceHash;
+	SnapshotHeader.sourceSize = (int)NavFileSize;
+	SnapshotHeader.numNavMeshes = (int)SnapshotTiles.size();
+
+	bool bSuccess = fwrite(&SnapshotHeader, sizeof(NavSnapshotHeader), 1, SnapshotFile) == 1;
+
+	for (auto MeshIt = SnapshotTiles.begin(); bSuccess && MeshIt != SnapshotTiles.end(); MeshIt++)
+	{
+		int NumTiles = (int)MeshIt->size();
+		bSuccess = fwrite(&NumTiles, sizeof(int), 1, SnapshotFile) == 1;
+
+		for (auto TileIt = MeshIt->begin(); bSuccess && TileIt != MeshIt->end(); TileIt++)
+		{
+			int DataSize = (int)TileIt->size();
+			bSuccess = fwrite(&DataSize, sizeof(int), 1, SnapshotFile) == 1;
+
+			if (bSuccess && DataSize > 0)
+			{
+				bSuccess = fwrite(TileIt->data(), DataSize, 1, SnapshotFile) == 1;
+			}
+		}
+	}
+
+	fclose(SnapshotFile);
+
+	// Don't leave a half-written snapshot lying around. It would be rejected anyway, but no point reading it every load
+	if (!bSuccess)
+	{
+		remove(filename);
+	}
+
+	return bSuccess;
+}
+
+bool loadNavigationData(const char* mapname)
+{
+	// Unload the previous nav meshes if they're still loaded
+	UnloadNavigationData();
+
+	PopulateBaseAgentProfiles();
+
+	if (!LoadNavMesh(mapname))
+	{
+		NavmeshStatus = NAVMESH_STATUS_FAILED;
+		return false;
+	}
+
+	NavmeshStatus = NAVMESH_STATUS_SUCCESS;
+	
+	
+
+	return true;
+}
+
+bool NavmeshLoaded()
+{
+	return NavMeshes[0].navMesh != nullptr;
+}
+
+AvHAINavMeshStatus NAV_GetNavMeshStatus()
+{
+	return NavmeshStatus;
+}
+
+Vector UTIL_GetRandomPointOnNavmesh(const AvHAIPlayer* pBot)
+{
+	const dtNavMeshQuery* m_navQuery = UTIL_GetNavMeshQueryForProfile(pBot->BotNavInfo.NavProfile);
+	const dtQueryFilter* m_navFilter = &pBot->BotNavInfo.NavProfile.Filters;
+
+	if (!m_navQuery)
+	{
+		return ZERO_VECTOR;
+	}
+
+	Vector Result;
+
+	dtPolyRef refPoly;
+
+	float result[3];
+	std::memset(result, 0, sizeof(result));
+
+	dtStatus status = m_navQuery->findRandomPoint(m_navFilter, frand, &refPoly, result);
+
+	if (dtStatusFailed(status))
+	{
+		return ZERO_VECTOR;
+	}
+
+	Result.x = result[0];
+	Result.y = -result[2];
+	Result.z = result[1];
+
+	return Result;
+}
+
+Vector UTIL_GetRandomPointOnNavmeshInRadiusOfAreaType(NavMovementFlag Flag, const Vector origin, const float MaxRadius)
+{
+	const dtNavMeshQuery* m_NavQuery = UTIL_GetNavMeshQueryForProfile(GetBaseAgentProfile(NAV_PROFILE_DEFAULT));
+
+	if (!m_NavQuery) { return ZERO_VECTOR; }
+
+	dtQueryFilter filter;
+	filter.setExcludeFlags(0);
+	filter.setIncludeFlags(Flag);
+
+	Vector Result = ZERO_VECTOR;
+
+	float pCheckLoc[3] = { origin.x, origin.z, -origin.y };
+
+	dtPolyRef FoundPoly;
+	float NavNearest[3];
+
+	dtStatus foundPolyResult = m_NavQuery->findNearestPoly(pCheckLoc, pExtents, &filter, &FoundPoly, NavNearest);
+
+	if (dtStatusFailed(foundPolyResult))
+	{
+		return ZERO_VECTOR;
+	}
+
+	dtPolyRef RandomPoly;
+	float RandomPoint[3];
+
+	dtStatus foundRandomPointResult = m_NavQuery->findRandomPointAroundCircle(FoundPoly, NavNearest, MaxRadius, &filter, frand, &RandomPoly, RandomPoint);
+
+
+	if (dtStatusFailed(foundRandomPointResult))
+	{
+		return ZERO_VECTOR;
+	}
+
+	Result.x = RandomPoint[0];
+	Result.y = -RandomPoint[2];
+	Result.z = RandomPoint[1];
+
+	return Result;
+}
+
+Vector UTIL_GetRandomPointOnNavmeshInRadius(const NavAgentProfile &NavProfile, const Vector origin, const float MaxRadius)
+{
+	const dtNavMeshQuery* m_navQuery = UTIL_GetNavMeshQueryForProfile(NavProfile);
+	const dtQueryFilter* m_navFilter = &NavProfile.Filters;
 
 	if (!m_navQuery) { return ZERO_VECTOR; }
 
@@ -937,11 +1475,11 @@ static float frand()
 	return (float)rand() / (float)RAND_MAX;
 }
 
-Vector AdjustPointForPathfinding(unsigned int NavMeshIndex, const Vector Point, const NavAgentProfile& NavProfile)
+Vector AdjustPointForPathfinding(unsigned int NavMeshIndex, const Vector Point, const NavAgentProfile& NavProfile, const dtPolyRef PolyHint)
 {
 	if (vIsZero(Point) || NavMeshIndex > NUM_NAV_MESHES) { return ZERO_VECTOR; }
 
-	Vector ProjectedPoint = UTIL_ProjectPointToNavmesh(NavMeshIndex, Point, NavProfile);
+	Vector ProjectedPoint = UTIL_ProjectPointToNavmesh(NavMeshIndex, Point, NavProfile, Vector(400.0f, 400.0f, 400.0f), PolyHint);
 
 	int PointContents = UTIL_PointContents(ProjectedPoint);
 
@@ -1037,7 +1575,7 @@ dtStatus FindFlightPathToPoint(const NavAgentProfile &NavProfile, Vector FromLoc
 		return (status & DT_STATUS_DETAIL_MASK); // couldn't find a polygon
 	}
 
-	status = m_navQuery->findPath(StartPoly, EndPoly, StartNearest, EndNearest, m_navFilter, PolyPath, &nPathCount, MAX_PATH_POLY);
+	status = NAV_FindPolyPath(NavProfile, StartPoly, EndPoly, StartNearest, EndNearest, PolyPath, &nPathCount, MAX_PATH_POLY);
 
 	if (nPathCount == 0) { return DT_FAILURE; }
 
@@ -1048,7 +1586,7 @@ dtStatus FindFlightPathToPoint(const NavAgentProfile &NavProfile, Vector FromLoc
 
 		m_navQuery->closestPointOnPoly(PolyPath[nPathCount - 1], EndNearest, epos, 0);
 
-		if (dtVdistSqr(EndNearest, epos) > sqrf(MaxAcceptableDistance))
+		if (dtVdistSqr(EndNearest, epos) > sqrf(MaxAcceptableDistance) && !NAV_IsCorridorTruncated(status))
 		{
 			return DT_FAILURE;
 		}
@@ -1231,7 +1769,7 @@ Vector UTIL_FindHighestSuccessfulTracePoint(const Vector TraceFrom, const Vector
 	return CurrentHighest;
 }
 
-dtStatus FindPathClosestToPoint(const NavAgentProfile& NavProfile, const Vector FromLocation, const Vector ToLocation, vector<bot_path_node>& path, float MaxAcceptableDistance)
+dtStatus FindPathClosestToPoint(const NavAgentProfile& NavProfile, const Vector FromLocation, const Vector ToLocation, vector<bot_path_node>& path, float MaxAcceptableDistance, const dtPolyRef StartPolyHint, const NavSearchMode SearchMode)
 {
 	if (NavProfile.bFlyingProfile)
 	{
@@ -1266,7 +1804,7 @@ dtStatus FindPathClosestToPoint(const NavAgentProfile& NavProfile, const Vector
 		return DT_FAILURE;
 	}
 
-	Vector FromFloorLocation = AdjustPointForPathfinding(NavProfile.NavMeshIndex, FromLocation, NavProfile);
+	Vector FromFloorLocation = AdjustPointForPathfinding(NavProfile.NavMeshIndex, FromLocation, NavProfile, StartPolyHint);
 	Vector ToFloorLocation = AdjustPointForPathfinding(NavProfile.NavMeshIndex, ToLocation, NavProfile);
 
 	float pStartPos[3] = { FromFloorLocation.x, FromFloorLocation.z, -FromFloorLocation.y };
@@ -1286,7 +1824,7 @@ dtStatus FindPathClosestToPoint(const NavAgentProfile& NavProfile, const Vector
 	int nVertCount = 0;
 
 	// find the start polygon
-	status = m_navQuery->findNearestPoly(pStartPos, pExtents, m_navFilter, &StartPoly, StartNearest);
+	status = NAV_FindNearestPolyWithHint(m_navQuery, StartPolyHint, pStartPos, pExtents, m_navFilter, &StartPoly, StartNearest);
 	if ((status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK))
 	{
 		return (status & DT_STATUS_DETAIL_MASK); // couldn't find a polygon
@@ -1299,7 +1837,7 @@ dtStatus FindPathClosestToPoint(const NavAgentProfile& NavProfile, const Vector
 		return (status & DT_STATUS_DETAIL_MASK); // couldn't find a polygon
 	}
 
-	status = m_navQuery->findPath(StartPoly, EndPoly, StartNearest, EndNearest, m_navFilter, PolyPath, &nPathCount, MAX_PATH_POLY);
+	status = NAV_FindPolyPath(NavProfile, StartPoly, EndPoly, StartNearest, EndNearest, PolyPath, &nPathCount, MAX_PATH_POLY, SearchMode);
 
 	if (PolyPath[nPathCount - 1] != EndPoly)
 	{
@@ -1308,7 +1846,7 @@ dtStatus FindPathClosestToPoint(const NavAgentProfile& NavProfile, const Vector
 
 		m_navQuery->closestPointOnPoly(PolyPath[nPathCount - 1], EndNearest, epos, 0);
 
-		if (dtVdistSqr(EndNearest, epos) > sqrf(MaxAcceptableDistance))
+		if (dtVdistSqr(EndNearest, epos) > sqrf(MaxAcceptableDistance) && !NAV_IsCorridorTruncated(status))
 		{
 			return DT_FAILURE;
 		}
@@ -1368,7 +1906,7 @@ dtStatus FindPathClosestToPoint(const NavAgentProfile& NavProfile, const Vector
 		TraceStart.y = NextPathNode.Location.y;
 		TraceStart.z = NextPathNode.Location.z;
 
-		UTIL_TraceLine(TraceStart, (TraceStart - Vector(0.0f, 0.0f, 100.0f)), ignore_monsters, ignore_glass, nullptr, &hit);
+		UTIL_BrokeredTraceLine(TraceStart, (TraceStart - Vector(0.0f, 0.0f, 100.0f)), ignore_monsters, ignore_glass, nullptr, &hit);
 
 		if (hit.flFraction < 1.0f)
 		{
@@ -1410,15 +1948,8 @@ dtStatus FindPathClosestToPoint(const NavAgentProfile& NavProfile, const Vector
 	return DT_SUCCESS;
 }
 
-dtStatus FindPathClosestToPoint(AvHAIPlayer* pBot, const BotMoveStyle MoveStyle, const Vector ToLocation, vector<bot_path_node>& path, float MaxAcceptableDistance)
+dtStatus NAV_PrepareBotPathRequest(AvHAIPlayer* pBot, const Vector ToLocation, float MaxAcceptableDistance, NavPathRequest& Request)
 {
-	if (!pBot) { return DT_FAILURE; }
-
-	if (pBot->BotNavInfo.NavProfile.bFlyingProfile)
-	{
-		return FindFlightPathToPoint(pBot->BotNavInfo.NavProfile, pBot->CurrentFloorPosition, ToLocation, path, MaxAcceptableDistance);
-	}
-
 	const dtNavMeshQuery* m_navQuery = UTIL_GetNavMeshQueryForProfile(pBot->BotNavInfo.NavProfile);
 	const dtNavMesh* m_navMesh = UTIL_GetNavMeshForProfile(pBot->BotNavInfo.NavProfile);
 	const dtQueryFilter* m_navFilter = &pBot->BotNavInfo.NavProfile.Filters;
@@ -1440,8 +1971,11 @@ dtStatus FindPathClosestToPoint(AvHAIPlayer* pBot, const BotMoveStyle MoveStyle,
 
 		if (CurrentPathNode.flag == NAV_FLAG_WALK)
 		{
-			bool bFromReachable = UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, CurrentPathNode.Location);
-			bool bToReachable = UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, CurrentPathNode.FromLocation);
+			// Direct reachability is checked on the default profile's nav mesh, so CurrentPoly is only a valid hint if it came from there
+			const dtPolyRef PolyHint = NAV_GetBotPolyHint(pBot, GetBaseAgentProfile(NAV_PROFILE_DEFAULT).NavMeshIndex);
+
+			bool bFromReachable = UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, CurrentPathNode.Location, PolyHint);
+			bool bToReachable = UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, CurrentPathNode.FromLocation, PolyHint);
 			if (bFromReachable && bToReachable)
 			{
 				FromFloorLocation = pBot->CurrentFloorPosition;
@@ -1467,34 +2001,34 @@ dtStatus FindPathClosestToPoint(AvHAIPlayer* pBot, const BotMoveStyle MoveStyle,
 		Vector GeneralDir = UTIL_GetVectorNormal2D(ToLocation - pBot->CurrentFloorPosition);
 		Vector CheckLocation = FromLocation + (GeneralDir * 16.0f);
 
-		Vector FromFloorLocation = AdjustPointForPathfinding(NavMeshIndex, CheckLocation, pBot->BotNavInfo.NavProfile);
+		Vector FromFloorLocation = AdjustPointForPathfinding(NavMeshIndex, CheckLocation, pBot->BotNavInfo.NavProfile, NAV_GetBotPolyHint(pBot, NavMeshIndex));
 
 		if (vIsZero(FromFloorLocation))
 		{
-			FromFloorLocation = AdjustPointForPathfinding(NavMeshIndex, FromLocation, pBot->BotNavInfo.NavProfile);
+			FromFloorLocation = AdjustPointForPathfinding(NavMeshIndex, FromLocation, pBot->BotNavInfo.NavProfile, NAV_GetBotPolyHint(pBot, NavMeshIndex));
 		}
 	}
 
 	DynamicMapObject* LiftReference = UTIL_GetLiftReferenceByEdict(pBot->Edict->v.groundentity);
-	bool bMustDisembarkLiftFirst = false;
-	Vector LiftStart = ZERO_VECTOR;
-	Vector LiftEnd = ZERO_VECTOR;
+	Request.bMustDisembarkLiftFirst = false;
+	Request.LiftStart = ZERO_VECTOR;
+	Request.LiftEnd = ZERO_VECTOR;
 
 	if (LiftReference)
 	{
-		LiftEnd = NAV_GetNearestPlatformDisembarkPoint(pBot->BotNavInfo.NavProfile, pBot->Edict, LiftReference);
+		Request.LiftEnd = NAV_GetNearestPlatformDisembarkPoint(pBot->BotNavInfo.NavProfile, pBot->Edict, LiftReference);
 
-		if (!vIsZero(LiftEnd))
+		if (!vIsZero(Request.LiftEnd))
 		{
-			FromLocation = LiftEnd;
+			FromLocation = Request.LiftEnd;
 
 			NavOffMeshConnection LiftOffMesh = UTIL_GetOffMeshConnectionForPlatform(pBot->BotNavInfo.NavProfile, LiftReference);
 
 			if (LiftOffMesh.IsValid())
 			{
-				LiftStart = (vEquals(LiftEnd, LiftOffMesh.ToLocation, 5.0f)) ? LiftOffMesh.FromLocation : LiftOffMesh.ToLocation;
-				bMustDisembarkLiftFirst = true;
-				FromFloorLocation = LiftEnd;
+				Request.LiftStart = (vEquals(Request.LiftEnd, LiftOffMesh.ToLocation, 5.0f)) ? LiftOffMesh.FromLocation : LiftOffMesh.ToLocation;
+				Request.bMustDisembarkLiftFirst = true;
+				FromFloorLocation = Request.LiftEnd;
 			}
 		}
 	}
@@ -1505,52 +2039,66 @@ dtStatus FindPathClosestToPoint(AvHAIPlayer* pBot, const BotMoveStyle MoveStyle,
 	float pEndPos[3] = { ToFloorLocation.x, ToFloorLocation.z, -ToFloorLocation.y };
 
 	dtStatus status;
-	dtPolyRef StartPoly;
-	float StartNearest[3];
-	dtPolyRef EndPoly;
-	float EndNearest[3];
-	dtPolyRef PolyPath[MAX_PATH_POLY];
-	dtPolyRef StraightPolyPath[MAX_AI_PATH_SIZE];
-	int nPathCount = 0;
-	float StraightPath[MAX_AI_PATH_SIZE * 3];
-	unsigned char straightPathFlags[MAX_AI_PATH_SIZE];
-	std::memset(straightPathFlags, 0, sizeof(straightPathFlags));
-	int nVertCount = 0;
 
 	// find the start polygon
-	status = m_navQuery->findNearestPoly(pStartPos, pExtents, m_navFilter, &StartPoly, StartNearest);
+	status = NAV_FindNearestPolyWithHint(m_navQuery, NAV_GetBotPolyHint(pBot, pBot->BotNavInfo.NavProfile.NavMeshIndex), pStartPos, pExtents, m_navFilter, &Request.StartPoly, Request.StartNearest);
 	if ((status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK))
 	{
 		return (status & DT_STATUS_DETAIL_MASK); // couldn't find a polygon
 	}
 
 	// find the end polygon
-	status = m_navQuery->findNearestPoly(pEndPos, pExtents, m_navFilter, &EndPoly, EndNearest);
+	status = m_navQuery->findNearestPoly(pEndPos, pExtents, m_navFilter, &Request.EndPoly, Request.EndNearest);
 	if ((status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK))
 	{
 		return (status & DT_STATUS_DETAIL_MASK); // couldn't find a polygon
 	}
 
-	status = m_navQuery->findPath(StartPoly, EndPoly, StartNearest, EndNearest, m_navFilter, PolyPath, &nPathCount, MAX_PATH_POLY);
+	Request.Requester = pBot->Edict;
+	Request.NavProfile = pBot->BotNavInfo.NavProfile;
+	Request.FromFloorLocation = FromFloorLocation;
+	Request.MaxAcceptableDistance = MaxAcceptableDistance;
 
-	if (PolyPath[nPathCount - 1] != EndPoly)
+	return DT_SUCCESS;
+}
+
+dtStatus NAV_BuildBotPathFromCorridor(AvHAIPlayer* pBot, NavPathRequest& Request, const dtStatus SearchStatus, const dtPolyRef* PolyPath, const int nPathCount, vector<bot_path_node>& path)
+{
+	const dtNavMeshQuery* m_navQuery = UTIL_GetNavMeshQueryForProfile(Request.NavProfile);
+	const dtNavMesh* m_navMesh = UTIL_GetNavMeshForProfile(Request.NavProfile);
+
+	int NavMeshIndex = Request.NavProfile.NavMeshIndex;
+
+	if (!m_navQuery || !m_navMesh || nPathCount <= 0)
+	{
+		return DT_FAILURE;
+	}
+
+	dtStatus status;
+	dtPolyRef StraightPolyPath[MAX_AI_PATH_SIZE];
+	float StraightPath[MAX_AI_PATH_SIZE * 3];
+	unsigned char straightPathFlags[MAX_AI_PATH_SIZE];
+	std::memset(straightPathFlags, 0, sizeof(straightPathFlags));
+	int nVertCount = 0;
+
+	if (PolyPath[nPathCount - 1] != Request.EndPoly)
 	{
 		float epos[3];
-		dtVcopy(epos, EndNearest);
+		dtVcopy(epos, Request.EndNearest);
 
-		m_navQuery->closestPointOnPoly(PolyPath[nPathCount - 1], EndNearest, epos, 0);
+		m_navQuery->closestPointOnPoly(PolyPath[nPathCount - 1], Request.EndNearest, epos, 0);
 
-		if (dtVdistSqr(EndNearest, epos) > sqrf(MaxAcceptableDistance))
+		if (dtVdistSqr(Request.EndNearest, epos) > sqrf(Request.MaxAcceptableDistance) && !NAV_IsCorridorTruncated(SearchStatus))
 		{
 			return DT_FAILURE;
 		}
 		else
 		{
-			dtVcopy(EndNearest, epos);
+			dtVcopy(Request.EndNearest, epos);
 		}
 	}
 
-	status = m_navQuery->findStraightPath(StartNearest, EndNearest, PolyPath, nPathCount, StraightPath, straightPathFlags, StraightPolyPath, &nVertCount, MAX_AI_PATH_SIZE, DT_STRAIGHTPATH_AREA_CROSSINGS);
+	status = m_navQuery->findStraightPath(Request.StartNearest, Request.EndNearest, PolyPath, nPathCount, StraightPath, straightPathFlags, StraightPolyPath, &nVertCount, MAX_AI_PATH_SIZE, DT_STRAIGHTPATH_AREA_CROSSINGS);
 	if ((status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK))
 	{
 		return (status & DT_STATUS_DETAIL_MASK); // couldn't create a path
@@ -1575,19 +2123,19 @@ dtStatus FindPathClosestToPoint(AvHAIPlayer* pBot, const BotMoveStyle MoveStyle,
 
 	pBot->BotNavInfo.SpecialMovementFlags = 0;
 
-	Vector NodeFromLocation = FromFloorLocation;
+	Vector NodeFromLocation = Request.FromFloorLocation;
 
-	if (bMustDisembarkLiftFirst)
+	if (Request.bMustDisembarkLiftFirst)
 	{
 		bot_path_node StartPathNode;
-		StartPathNode.FromLocation = LiftStart;
-		StartPathNode.Location = LiftEnd;
+		StartPathNode.FromLocation = Request.LiftStart;
+		StartPathNode.Location = Request.LiftEnd;
 		StartPathNode.flag = NAV_FLAG_PLATFORM;
 		StartPathNode.area = NAV_AREA_WALK;
 
 		path.push_back(StartPathNode);
 
-		NodeFromLocation = LiftEnd;
+		NodeFromLocation = Request.LiftEnd;
 	}
 
 	for (int nVert = 0; nVert < nVertCount; nVert++)
@@ -1605,7 +2153,7 @@ dtStatus FindPathClosestToPoint(AvHAIPlayer* pBot, const BotMoveStyle MoveStyle,
 
 		NextPathNode.Location = UTIL_AdjustPointAwayFromNavWall(NextPathNode.Location, 16.0f);
 
-		NextPathNode.Location = AdjustPointForPathfinding(NavMeshIndex, NextPathNode.Location, pBot->BotNavInfo.NavProfile);
+		NextPathNode.Location = AdjustPointForPathfinding(NavMeshIndex, NextPathNode.Location, Request.NavProfile);
 
 		if (CurrFlags != NAV_FLAG_JUMP || NextPathNode.FromLocation.z > NextPathNode.Location.z)
 		{
@@ -1642,226 +2190,2338 @@ dtStatus FindPathClosestToPoint(AvHAIPlayer* pBot, const BotMoveStyle MoveStyle,
 				NextPathNode.requiredZ += 5.0f;
 			}
 
-		}
-		else
-		{
-			NextPathNode.requiredZ = NextPathNode.Location.z;
-		}
+		}
+		else
+		{
+			NextPathNode.requiredZ = NextPathNode.Location.z;
+		}
+
+		NextPathNode.flag = CurrFlags;
+		NextPathNode.area = CurrArea;
+		NextPathNode.poly = StraightPolyPath[nVert];
+
+		m_navMesh->getPolyFlags(StraightPolyPath[nVert], &CurrFlags);
+		m_navMesh->getPolyArea(StraightPolyPath[nVert], &CurrArea);
+
+		NodeFromLocation = NextPathNode.Location;
+
+		path.push_back(NextPathNode);
+	}
+
+	return DT_SUCCESS;
+}
+
+dtStatus FindPathClosestToPoint(AvHAIPlayer* pBot, const BotMoveStyle MoveStyle, const Vector ToLocation, vector<bot_path_node>& path, float MaxAcceptableDistance)
+{
+	if (!pBot) { return DT_FAILURE; }
+
+	if (pBot->BotNavInfo.NavProfile.bFlyingProfile)
+	{
+		return FindFlightPathToPoint(pBot->BotNavInfo.NavProfile, pBot->CurrentFloorPosition, ToLocation, path, MaxAcceptableDistance);
+	}
+
+	NavPathRequest Request;
+
+	dtStatus status = NAV_PrepareBotPathRequest(pBot, ToLocation, MaxAcceptableDistance, Request);
+
+	if (!dtStatusSucceed(status)) { return status; }
+
+	dtPolyRef PolyPath[MAX_PATH_POLY];
+	int nPathCount = 0;
+
+	status = NAV_FindPolyPath(Request.NavProfile, Request.StartPoly, Request.EndPoly, Request.StartNearest, Request.EndNearest, PolyPath, &nPathCount, MAX_PATH_POLY);
+
+	return NAV_BuildBotPathFromCorridor(pBot, Request, status, PolyPath, nPathCount, path);
+}
+
+void NAV_CompletePathRequest(NavPathRequest& Request, const dtStatus SearchStatus, const dtPolyRef* PolyPath, const int nPathCount)
+{
+	AvHAIPlayer* pBot = AIMGR_GetBotPointer(Request.Requester);
+
+	// Bot has left, or has asked for a different path since this was queued
+	if (!pBot || pBot->BotNavInfo.PathRequestId != Request.RequestId || pBot->BotNavInfo.PathRequestStatus != PATH_REQUEST_PENDING) { return; }
+
+	dtStatus BuildStatus = DT_FAILURE;
+
+	if (dtStatusSucceed(SearchStatus))
+	{
+		BuildStatus = NAV_BuildBotPathFromCorridor(pBot, Request, SearchStatus, PolyPath, nPathCount, pBot->BotNavInfo.PendingPath);
+	}
+
+	pBot->BotNavInfo.PathRequestStatus = (dtStatusSucceed(BuildStatus)) ? PATH_REQUEST_COMPLETE : PATH_REQUEST_FAILED;
+}
+
+void NAV_OnPathJobComplete(NavJob& Job)
+{
+	auto Request = WorkerPathRequests.find(Job.JobId);
+
+	if (Request == WorkerPathRequests.end()) { return; }
+
+	if (dtStatusSucceed(Job.Status) && !Job.PolyPath.empty())
+	{
+		NAV_CachePolyPath(Request->second.CacheKey, Job.Status, Job.PolyPath.data(), (int)Job.PolyPath.size());
+	}
+
+	NAV_CompletePathRequest(Request->second, Job.Status, Job.PolyPath.data(), (int)Job.PolyPath.size());
+
+	WorkerPathRequests.erase(Request);
+}
+
+bool NAV_TryQuickPathRequest(NavPathRequest& Request, int* WorkDone)
+{
+	dtPolyRef PolyPath[MAX_PATH_POLY];
+	int nPathCount = 0;
+	dtStatus CachedStatus;
+	int ClusterNodes = 0;
+
+	Request.CacheKey = NAV_MakePathCacheKey(Request.NavProfile, Request.StartPoly, Request.EndPoly);
+
+	bool bFound = NAV_GetCachedPolyPath(Request.CacheKey, PolyPath, &nPathCount, MAX_PATH_POLY, &CachedStatus)
+		|| NAV_GetFlowFieldPolyPath(Request.NavProfile, Request.StartPoly, Request.EndPoly, PolyPath, &nPathCount, MAX_PATH_POLY, &CachedStatus)
+		|| NAV_GetClusterPolyPath(Request.NavProfile, Request.StartPoly, Request.EndPoly, PolyPath, &nPathCount, MAX_PATH_POLY, &CachedStatus, &ClusterNodes);
+
+	// The cluster search costs the same whether or not it found anything
+	*WorkDone = imaxi(ClusterNodes, 1);
+
+	if (!bFound) { return false; }
+
+	NAV_CompletePathRequest(Request, CachedStatus, PolyPath, nPathCount);
+
+	*WorkDone += PATH_REQUEST_FINISH_COST;
+
+	return true;
+}
+
+void NAV_UpdatePathRequests()
+{
+	dtPolyRef PolyPath[MAX_PATH_POLY];
+	int nPathCount = 0;
+	int WorkDone = 0;
+
+	int IterationsRemaining = MAX_PATH_ITERATIONS_PER_FRAME;
+
+	// Hand everything to the worker threads if we have them, the sliced planner is only needed when running single-threaded
+	if (NAV_NavWorkersActive())
+	{
+		// Collect what the workers finished first, at least one a frame so the backlog always drains
+		IterationsRemaining -= NAV_ProcessCompletedNavJobs(imaxi(IterationsRemaining / PATH_REQUEST_FINISH_COST, 1)) * PATH_REQUEST_FINISH_COST;
+
+		while (IterationsRemaining > 0 && !PendingPathRequests.empty())
+		{
+			NavPathRequest Request = PendingPathRequests.front();
+			PendingPathRequests.pop_front();
+
+			AvHAIPlayer* pBot = AIMGR_GetBotPointer(Request.Requester);
+
+			if (!pBot || pBot->BotNavInfo.PathRequestId != Request.RequestId) { continue; }
+
+			bool bFound = NAV_TryQuickPathRequest(Request, &WorkDone);
+
+			IterationsRemaining -= WorkDone;
+
+			if (bFound) { continue; }
+
+			NavJob PathJob;
+			PathJob.Type = NAV_JOB_FIND_PATH;
+			PathJob.NavMeshIndex = Request.NavProfile.NavMeshIndex;
+			PathJob.Filter = Request.NavProfile.Filters;
+			PathJob.Requester = Request.Requester;
+			PathJob.OnComplete = NAV_OnPathJobComplete;
+			PathJob.StartPoly = Request.StartPoly;
+			PathJob.EndPoly = Request.EndPoly;
+			dtVcopy(PathJob.StartPos, Request.StartNearest);
+			dtVcopy(PathJob.EndPos, Request.EndNearest);
+
+			unsigned int JobId = NAV_SubmitNavJob(PathJob);
+
+			if (JobId == 0)
+			{
+				NAV_CompletePathRequest(Request, DT_FAILURE, nullptr, 0);
+				continue;
+			}
+
+			WorkerPathRequests[JobId] = Request;
+		}
+
+		// The workers run the searches, so whatever is left is free for the flow field
+		NAV_UpdateFlowFieldBuild(IterationsRemaining);
+
+		return;
+	}
+
+	while (IterationsRemaining > 0)
+	{
+		if (!bPathRequestActive)
+		{
+			if (PendingPathRequests.empty()) { break; }
+
+			ActivePathRequest = PendingPathRequests.front();
+			PendingPathRequests.pop_front();
+
+			AvHAIPlayer* pBot = AIMGR_GetBotPointer(ActivePathRequest.Requester);
+
+			// No point searching for a path nobody is waiting on
+			if (!pBot || pBot->BotNavInfo.PathRequestId != ActivePathRequest.RequestId) { continue; }
+
+			bool bFound = NAV_TryQuickPathRequest(ActivePathRequest, &WorkDone);
+
+			IterationsRemaining -= WorkDone;
+
+			if (bFound) { continue; }
+
+			dtNavMeshQuery* SlicedQuery = NavMeshes[ActivePathRequest.NavProfile.NavMeshIndex].slicedQuery;
+
+			if (!SlicedQuery)
+			{
+				NAV_CompletePathRequest(ActivePathRequest, DT_FAILURE, nullptr, 0);
+				continue;
+			}
+
+			dtStatus InitStatus = SlicedQuery->initSlicedFindPath(ActivePathRequest.StartPoly, ActivePathRequest.EndPoly, ActivePathRequest.StartNearest, ActivePathRequest.EndNearest, &ActivePathRequest.NavProfile.Filters);
+
+			if (dtStatusFailed(InitStatus))
+			{
+				NAV_CompletePathRequest(ActivePathRequest, InitStatus, nullptr, 0);
+				continue;
+			}
+
+			bPathRequestActive = true;
+
+			// The cluster lookup may have used up the budget, pick the search up next frame
+			if (IterationsRemaining <= 0) { break; }
+		}
+
+		dtNavMeshQuery* SlicedQuery = NavMeshes[ActivePathRequest.NavProfile.NavMeshIndex].slicedQuery;
+
+		int DoneIterations = 0;
+		dtStatus SearchStatus = SlicedQuery->updateSlicedFindPath(IterationsRemaining, &DoneIterations);
+
+		IterationsRemaining -= imaxi(DoneIterations, 1);
+
+		if (dtStatusInProgress(SearchStatus)) { continue; }
+
+		nPathCount = 0;
+
+		if (dtStatusSucceed(SearchStatus))
+		{
+			SearchStatus = SlicedQuery->finalizeSlicedFindPath(PolyPath, &nPathCount, MAX_PATH_POLY);
+
+			if (dtStatusSucceed(SearchStatus) && nPathCount > 0)
+			{
+				NAV_CachePolyPath(ActivePathRequest.CacheKey, SearchStatus, PolyPath, nPathCount);
+			}
+		}
+
+		bPathRequestActive = false;
+
+		NAV_CompletePathRequest(ActivePathRequest, SearchStatus, PolyPath, nPathCount);
+
+		IterationsRemaining -= PATH_REQUEST_FINISH_COST;
+	}
+
+	// Bots waiting on a path come first, the flow field gets whatever they leave
+	NAV_UpdateFlowFieldBuild(imaxi(IterationsRemaining, 0));
+}
+
+dtStatus NAV_RequestBotPath(AvHAIPlayer* pBot, const Vector Destination, vector<bot_path_node>& path, float MaxAcceptableDistance)
+{
+	nav_status* BotNavInfo = &pBot->BotNavInfo;
+
+	if (BotNavInfo->PathRequestStatus != PATH_REQUEST_NONE && vEquals(BotNavInfo->PathRequestDestination, Destination))
+	{
+		switch (BotNavInfo->PathRequestStatus)
+		{
+			case PATH_REQUEST_PENDING:
+				return DT_IN_PROGRESS;
+			case PATH_REQUEST_COMPLETE:
+				path.clear();
+				path.swap(BotNavInfo->PendingPath);
+				BotNavInfo->PathRequestStatus = PATH_REQUEST_NONE;
+				return DT_SUCCESS;
+			default:
+				BotNavInfo->PathRequestStatus = PATH_REQUEST_NONE;
+				return DT_FAILURE;
+		}
+	}
+
+	// Any earlier request is now stale, a new ID means its result will be ignored
+	BotNavInfo->PathRequestId = ++LastPathRequestId;
+	BotNavInfo->PathRequestStatus = PATH_REQUEST_NONE;
+	BotNavInfo->PathRequestDestination = Destination;
+	BotNavInfo->PendingPath.clear();
+
+	NavPathRequest NewRequest;
+
+	dtStatus PrepareStatus = NAV_PrepareBotPathRequest(pBot, Destination, MaxAcceptableDistance, NewRequest);
+
+	if (!dtStatusSucceed(PrepareStatus)) { return DT_FAILURE; }
+
+	NewRequest.RequestId = BotNavInfo->PathRequestId;
+
+	PendingPathRequests.push_back(NewRequest);
+
+	BotNavInfo->PathRequestStatus = PATH_REQUEST_PENDING;
+
+	return DT_IN_PROGRESS;
+}
+
+bool NAV_IsPathRequestPending(const AvHAIPlayer* pBot)
+{
+	return pBot->BotNavInfo.PathRequestStatus == PATH_REQUEST_PENDING;
+}
+
+void NAV_ClearPathRequests()
+{
+	PendingPathRequests.clear();
+	WorkerPathRequests.clear();
+	bPathRequestActive = false;
+
+	// Nothing is going to answer the bots' outstanding requests now, so they need to ask again
+	vector<AvHAIPlayer*> AIPlayers = AIMGR_GetAllAIPlayers();
+
+	for (auto it = AIPlayers.begin(); it != AIPlayers.end(); it++)
+	{
+		(*it)->BotNavInfo.PathRequestId = ++LastPathRequestId;
+		(*it)->BotNavInfo.PathRequestStatus = PATH_REQUEST_NONE;
+		(*it)->BotNavInfo.PendingPath.clear();
+	}
+}
+
+Vector NAV_GetNearestPlatformDisembarkPoint(const NavAgentProfile& NavProfile, edict_t* Rider, DynamicMapObject* LiftReference)
+{
+	if (!LiftReference) { return ZERO_VECTOR; }
+
+	NavOffMeshConnection* NearestConnection = nullptr;
+	float MinDist = 0.0f;
+
+	nav_mesh ChosenNavMesh = NavMeshes[NavProfile.NavMeshIndex];
+
+
+	for (auto it = ChosenNavMesh.MeshConnections.begin(); it != ChosenNavMesh.MeshConnections.end(); it++)
+	{
+		if (!(it->ConnectionFlags & NAV_FLAG_PLATFORM)) { continue; }
+
+		if (it->LinkedObject == LiftReference->Edict)
+		{
+			float ThisDist = fminf(vDist3DSq(it->FromLocation, UTIL_GetClosestPointOnEntityToLocation(it->FromLocation, LiftReference->Edict)), vDist3DSq(it->ToLocation, UTIL_GetClosestPointOnEntityToLocation(it->ToLocation, LiftReference->Edict)));
+
+			if (ThisDist < sqrf(100.0f) && (!NearestConnection || ThisDist < MinDist))
+			{
+				NearestConnection = &(*it);
+				MinDist = ThisDist;
+			}
+		}
+	}
+
+	if (NearestConnection)
+	{
+		Vector NearestPointFromLocation = UTIL_GetClosestPointOnEntityToLocation(NearestConnection->FromLocation, LiftReference->Edict);
+		NearestPointFromLocation.z = Rider->v.origin.z;
+
+		Vector NearestPointToLocation = UTIL_GetClosestPointOnEntityToLocation(NearestConnection->ToLocation, LiftReference->Edict);
+		NearestPointToLocation.z = Rider->v.origin.z;
+
+		float DistFromLocation = vDist3DSq(NearestConnection->FromLocation, NearestPointFromLocation);
+		float DistToLocation = vDist3DSq(NearestConnection->ToLocation, NearestPointToLocation);
+		return (DistFromLocation < DistToLocation) ? NearestConnection->FromLocation : NearestConnection->ToLocation;
+	}
+	else
+	{
+		Vector NearestProjectedPoint = ZERO_VECTOR;
+		Vector LiftCentre = UTIL_GetCentreOfEntity(LiftReference->Edict);
+		float DisembarkHeight = (!FNullEnt(Rider)) ? GetPlayerBottomOfCollisionHull(Rider).z : LiftReference->Edict->v.absmax.z;
+
+		Vector FrontLocation = Vector(LiftReference->Edict->v.absmax.x, LiftCentre.y, DisembarkHeight);
+		Vector RearLocation = Vector(LiftReference->Edict->v.absmin.x, LiftCentre.y, DisembarkHeight);
+		Vector LeftLocation = Vector(LiftCentre.x, LiftReference->Edict->v.absmin.y, DisembarkHeight);
+		Vector RightLocation = Vector(LiftCentre.x, LiftReference->Edict->v.absmax.y, DisembarkHeight);
+
+		float ProjectWidth = fmaxf((LiftReference->Edict->v.absmax.x - LiftReference->Edict->v.absmin.x) * 0.5f, (LiftReference->Edict->v.absmax.y - LiftReference->Edict->v.absmin.y) * 0.5f);
+		ProjectWidth += 100.0f;
+
+		Vector ProjectedLoc = UTIL_ProjectPointToNavmesh(NavProfile.NavMeshIndex, FrontLocation, NavProfile, Vector(ProjectWidth, ProjectWidth, 50.0f));
+
+		if (!vIsZero(ProjectedLoc) && !vPointOverlaps2D(ProjectedLoc, LiftReference->Edict->v.absmin, LiftReference->Edict->v.absmax))
+		{
+			return ProjectedLoc;
+		}
+
+		ProjectedLoc = UTIL_ProjectPointToNavmesh(NavProfile.NavMeshIndex, RearLocation, NavProfile, Vector(ProjectWidth, ProjectWidth, 50.0f));
+
+		if (!vIsZero(ProjectedLoc) && !vPointOverlaps2D(ProjectedLoc, LiftReference->Edict->v.absmin, LiftReference->Edict->v.absmax))
+		{
+			return ProjectedLoc;
+		}
+
+		ProjectedLoc = UTIL_ProjectPointToNavmesh(NavProfile.NavMeshIndex, LeftLocation, NavProfile, Vector(ProjectWidth, ProjectWidth, 50.0f));
+
+		if (!vIsZero(ProjectedLoc) && !vPointOverlaps2D(ProjectedLoc, LiftReference->Edict->v.absmin, LiftReference->Edict->v.absmax))
+		{
+			return ProjectedLoc;
+		}
+
+		ProjectedLoc = UTIL_ProjectPointToNavmesh(NavProfile.NavMeshIndex, RightLocation, NavProfile, Vector(ProjectWidth, ProjectWidth, 50.0f));
+
+		if (!vIsZero(ProjectedLoc) && !vPointOverlaps2D(ProjectedLoc, LiftReference->Edict->v.absmin, LiftReference->Edict->v.absmax))
+		{
+			return ProjectedLoc;
+		}
+
+
+		return ZERO_VECTOR;
+	}
+
+}
+
+DynamicMapObject* UTIL_GetLiftReferenceByEdict(const edict_t* SearchEdict)
+{
+	return UTIL_GetDynamicObjectByEdict(SearchEdict);
+}
+
+NavOffMeshConnection UTIL_GetOffMeshConnectionForPlatform(const NavAgentProfile& NavProfile, DynamicMapObject* LiftRef)
+{
+	NavOffMeshConnection Result;
+
+	if (!LiftRef) { return Result; }
+
+	NavOffMeshConnection* NearestConnection = nullptr;
+	float MinDist = 0.0f;
+
+	nav_mesh ChosenNavMesh = NavMeshes[NavProfile.NavMeshIndex];
+
+	for (auto it = ChosenNavMesh.MeshConnections.begin(); it != ChosenNavMesh.MeshConnections.end(); it++)
+	{
+		if (!(it->ConnectionFlags & NAV_FLAG_PLATFORM)) { continue; }
+
+		if (it->LinkedObject == LiftRef->Edict)
+		{
+			return (*it);
+		}
+	}
+
+	return Result;
+}
+
+bool UTIL_PointIsReachable(const NavAgentProfile &NavProfile, const Vector FromLocation, const Vector ToLocation, const float MaxAcceptableDistance)
+{
+	const dtNavMeshQuery* m_navQuery = UTIL_GetNavMeshQueryForProfile(NavProfile);
+	const dtNavMesh* m_navMesh = UTIL_GetNavMeshForProfile(NavProfile);
+	const dtQueryFilter* m_navFilter = &NavProfile.Filters;
+
+	if (!m_navQuery || vIsZero(FromLocation) || vIsZero(ToLocation))
+	{
+		return false;
+	}
+
+	float pStartPos[3] = { FromLocation.x, FromLocation.z, -FromLocation.y };
+	float pEndPos[3] = { ToLocation.x, ToLocation.z, -ToLocation.y };
+
+	dtStatus status;
+	dtPolyRef StartPoly;
+	float StartNearest[3];
+	dtPolyRef EndPoly;
+	float EndNearest[3];
+	dtPolyRef PolyPath[MAX_PATH_POLY];
+	int nPathCount = 0;
+
+	
+
+	float searchExtents[3] = { MaxAcceptableDistance, 50.0f, MaxAcceptableDistance };
+
+	if (NAV_IsPointInSwimArea(FromLocation) && NAV_IsPointInSwimArea(ToLocation))
+	{
+		if (UTIL_QuickHullTrace(nullptr, FromLocation, ToLocation)) { return true; }
+	}
+
+	// find the start polygon
+	status = m_navQuery->findNearestPoly(pStartPos, searchExtents, m_navFilter, &StartPoly, StartNearest);
+	if ((status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK))
+	{
+		return false; // couldn't find a polygon
+	}
+
+	// find the end polygon
+	status = m_navQuery->findNearestPoly(pEndPos, searchExtents, m_navFilter, &EndPoly, EndNearest);
+	if ((status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK))
+	{
+		return false; // couldn't find a polygon
+	}
+
+	// Same strongly-connected island means a complete path exists, no need to search for it
+	if (NAV_GetPolyReachability(NavProfile, StartPoly, EndPoly) == NAV_REACHABILITY_CONNECTED)
+	{
+		return true;
+	}
+
+	status = NAV_FindPolyPath(NavProfile, StartPoly, EndPoly, StartNearest, EndNearest, PolyPath, &nPathCount, MAX_PATH_POLY, NAV_SEARCH_FAST);
+
+	if (nPathCount == 0)
+	{
+		return false; // couldn't find a path
+	}
+
+	if (PolyPath[nPathCount - 1] != EndPoly && !NAV_IsCorridorTruncated(status))
+	{
+		float epos[3];
+		dtVcopy(epos, EndNearest);
+
+		m_navQuery->closestPointOnPoly(PolyPath[nPathCount - 1], EndNearest, epos, 0);
+
+		if (dtVdistSqr(EndNearest, epos) <= sqrf(MaxAcceptableDistance))
+		{
+			return true;
+		}
+		else
+		{
+			if (NAV_IsPointInSwimArea(epos) && NAV_IsPointInSwimArea(ToLocation))
+			{
+				return true;
+			}
+		}
+
+		// Callers allowing some slack have always been happy with getting as close as the path allows
+		return (MaxAcceptableDistance > 0.0f);
+	}
+
+	return true;
+}
+
+int NAV_GetReachabilityIslandPolyIndex(const nav_reachability_islands* Islands, const dtNavMesh* m_navMesh, const dtPolyRef Ref)
+{
+	unsigned int Salt, TileIndex, PolyIndex;
+	m_navMesh->decodePolyId(Ref, Salt, TileIndex, PolyIndex);
+
+	if (TileIndex >= Islands->TileBase.size()) { return -1; }
+
+	unsigned int Index = Islands->TileBase[TileIndex] + PolyIndex;
+
+	// Catches refs from tiles that have been rebuilt or removed since the islands were labelled
+	if (Index >= Islands->PolyRefs.size() || Islands->PolyRefs[Index] != Ref) { return -1; }
+
+	return (int)Index;
+}
+
+void NAV_StartReachabilityIslandBuild(nav_reachability_islands* Islands, const nav_mesh* NavMesh)
+{
+	Islands->Build = nav_island_build();
+	Islands->Build.bActive = true;
+	Islands->Build.Revision = NavMesh->Revision;
+
+	NAV_StartPolyGraphBuild(&Islands->Build.Graph, NavMesh->navMesh);
+}
+
+int NAV_ContinueReachabilityIslandBuild(nav_reachability_islands* Islands, const dtNavMesh* m_navMesh, const int MaxPolys)
+{
+	nav_island_build& Build = Islands->Build;
+
+	if (!Build.bActive) { return 0; }
+
+	const nav_poly_graph& Graph = Build.Graph;
+
+	int NumDone = 0;
+
+	if (Build.Stage == NAV_ISLAND_BUILD_GRAPH)
+	{
+		NumDone = NAV_ContinuePolyGraphBuild(&Build.Graph, m_navMesh, &Islands->Filter, MaxPolys);
+
+		if (Graph.BuildStage != NAV_POLY_GRAPH_BUILT) { return NumDone; }
+
+		Build.UnionParents.resize(Graph.PolyRefs.size());
+
+		for (unsigned int i = 0; i < Build.UnionParents.size(); i++)
+		{
+			Build.UnionParents[i] = i;
+		}
+
+		Build.Stage = NAV_ISLAND_BUILD_WEAK;
+		Build.NextPoly = 0;
+	}
+
+	// The graph only links passable polys, so the filter doesn't need checking again
+	const unsigned int NumPolys = (unsigned int)Graph.PolyRefs.size();
+	vector<unsigned int>& Parents = Build.UnionParents;
+
+	while (NumDone < MaxPolys)
+	{
+		switch (Build.Stage)
+		{
+			case NAV_ISLAND_BUILD_WEAK:
+			{
+				// Weak islands: union every pair of passable polys joined by a link, regardless of direction
+				if (Build.NextPoly >= NumPolys)
+				{
+					Build.WeakIslandIds.resize(NumPolys, 0);
+					Build.Stage = NAV_ISLAND_BUILD_WEAK_LABEL;
+					Build.NextPoly = 0;
+					break;
+				}
+
+				const unsigned int i = Build.NextPoly++;
+
+				for (unsigned int k = Graph.LinkStart[i]; k < Graph.LinkStart[i + 1]; k++)
+				{
+					unsigned int RootA = i;
+					while (Parents[RootA] != RootA) { Parents[RootA] = Parents[Parents[RootA]]; RootA = Parents[RootA]; }
+
+					unsigned int RootB = Graph.Links[k];
+					while (Parents[RootB] != RootB) { Parents[RootB] = Parents[Parents[RootB]]; RootB = Parents[RootB]; }
+
+					if (RootA != RootB) { Parents[dtMax(RootA, RootB)] = dtMin(RootA, RootB); }
+				}
+
+				NumDone++;
+
+				break;
+			}
+			case NAV_ISLAND_BUILD_WEAK_LABEL:
+			{
+				if (Build.NextPoly >= NumPolys)
+				{
+					vector<unsigned int>().swap(Build.UnionParents);
+
+					Build.StrongIslandIds.resize(NumPolys, 0);
+					Build.VisitOrder.resize(NumPolys, -1);
+					Build.LowLink.resize(NumPolys, 0);
+					Build.bOnStack.resize(NumPolys, false);
+					Build.Stage = NAV_ISLAND_BUILD_STRONG;
+					Build.NextPoly = 0;
+					break;
+				}
+
+				const unsigned int i = Build.NextPoly++;
+
+				if (Graph.bPassable[i])
+				{
+					unsigned int Root = i;
+					while (Parents[Root] != Root) { Root = Parents[Root]; }
+
+					Build.WeakIslandIds[i] = Root + 1;
+				}
+
+				NumDone++;
+
+				break;
+			}
+			case NAV_ISLAND_BUILD_STRONG:
+			{
+				// Strong islands: Tarjan's algorithm following link direction, one step at a time
+				if (Build.CallStack.empty())
+				{
+					if (Build.NextPoly >= NumPolys)
+					{
+						Islands->Revision = Build.Revision;
+						Islands->TileBase.swap(Build.Graph.TileBase);
+						Islands->PolyRefs.swap(Build.Graph.PolyRefs);
+						Islands->WeakIslandIds.swap(Build.WeakIslandIds);
+						Islands->StrongIslandIds.swap(Build.StrongIslandIds);
+						Islands->bLabelled = true;
+
+						// Frees the graph and search state as well
+						Islands->Build = nav_island_build();
+
+						return NumDone;
+					}
+
+					const unsigned int Root = Build.NextPoly++;
+
+					NumDone++;
+
+					if (!Graph.bPassable[Root] || Build.VisitOrder[Root] >= 0) { break; }
+
+					Build.VisitOrder[Root] = Build.LowLink[Root] = Build.NextVisitOrder++;
+					Build.TarjanStack.push_back(Root);
+					Build.bOnStack[Root] = true;
+					Build.CallStack.push_back(pair<unsigned int, unsigned int>(Root, Graph.LinkStart[Root]));
+
+					break;
+				}
+
+				const unsigned int Current = Build.CallStack.back().first;
+
+				NumDone++;
+
+				if (Build.CallStack.back().second < Graph.LinkStart[Current + 1])
+				{
+					const unsigned int Neighbour = Graph.Links[Build.CallStack.back().second++];
+
+					if (Build.VisitOrder[Neighbour] < 0)
+					{
+						Build.VisitOrder[Neighbour] = Build.LowLink[Neighbour] = Build.NextVisitOrder++;
+						Build.TarjanStack.push_back(Neighbour);
+						Build.bOnStack[Neighbour] = true;
+						Build.CallStack.push_back(pair<unsigned int, unsigned int>(Neighbour, Graph.LinkStart[Neighbour]));
+					}
+					else if (Build.bOnStack[Neighbour])
+					{
+						Build.LowLink[Current] = dtMin(Build.LowLink[Current], Build.VisitOrder[Neighbour]);
+					}
+
+					break;
+				}
+
+				// All links visited. If this poly is the root of a strong island, everything above it on the stack belongs to that island
+				if (Build.LowLink[Current] == Build.VisitOrder[Current])
+				{
+					unsigned int Member;
+
+					do
+					{
+						Member = Build.TarjanStack.back();
+						Build.TarjanStack.pop_back();
+						Build.bOnStack[Member] = false;
+						Build.StrongIslandIds[Member] = Build.NextStrongIslandId;
+					} while (Member != Current);
+
+					Build.NextStrongIslandId++;
+				}
+
+				Build.CallStack.pop_back();
+
+				if (!Build.CallStack.empty())
+				{
+					const unsigned int Parent = Build.CallStack.back().first;
+					Build.LowLink[Parent] = dtMin(Build.LowLink[Parent], Build.LowLink[Current]);
+				}
+
+				break;
+			}
+			default:
+				return NumDone;
+		}
+	}
+
+	return NumDone;
+}
+
+void NAV_UpdateReachabilityIslands()
+{
+	// No point labelling tiles that are about to be rebuilt again
+	if (!bTileCacheUpToDate) { return; }
+
+	int PolyBudget = MAX_POLY_GRAPH_POLYS_PER_FRAME;
+
+	for (auto it = ReachabilityIslands.begin(); it != ReachabilityIslands.end() && PolyBudget > 0; it++)
+	{
+		const nav_mesh* NavMesh = &NavMeshes[it->NavMeshIndex];
+
+		if (!NavMesh->navMesh) { continue; }
+
+		if (it->bLabelled && it->Revision == NavMesh->Revision) { continue; }
+
+		if (!it->Build.bActive || it->Build.Revision != NavMesh->Revision)
+		{
+			NAV_StartReachabilityIslandBuild(&(*it), NavMesh);
+		}
+
+		PolyBudget -= NAV_ContinueReachabilityIslandBuild(&(*it), NavMesh->navMesh, PolyBudget);
+	}
+}
+
+NavReachability NAV_GetPolyReachability(const NavAgentProfile& NavProfile, const dtPolyRef StartPoly, const dtPolyRef EndPoly)
+{
+	if (StartPoly == EndPoly) { return NAV_REACHABILITY_CONNECTED; }
+
+	if (NavProfile.NavMeshIndex >= NUM_NAV_MESHES) { return NAV_REACHABILITY_UNKNOWN; }
+
+	const nav_mesh* NavMesh = &NavMeshes[NavProfile.NavMeshIndex];
+
+	// Tiles still being rebuilt will change the links again next frame, so don't label a half-finished mesh
+	if (!NavMesh->navMesh || !UTIL_IsTileCacheUpToDate()) { return NAV_REACHABILITY_UNKNOWN; }
+
+	const unsigned int IncludeFlags = NavProfile.Filters.getIncludeFlags();
+	const unsigned int ExcludeFlags = NavProfile.Filters.getExcludeFlags();
+
+	nav_reachability_islands* Islands = nullptr;
+
+	for (auto it = ReachabilityIslands.begin(); it != ReachabilityIslands.end(); it++)
+	{
+		if (it->NavMeshIndex == NavProfile.NavMeshIndex && it->IncludeFlags == IncludeFlags && it->ExcludeFlags == ExcludeFlags)
+		{
+			Islands = &(*it);
+			break;
+		}
+	}
+
+	if (!Islands)
+	{
+		nav_reachability_islands NewIslands;
+		NewIslands.NavMeshIndex = NavProfile.NavMeshIndex;
+		NewIslands.IncludeFlags = IncludeFlags;
+		NewIslands.ExcludeFlags = ExcludeFlags;
+		NewIslands.Filter = NavProfile.Filters;
+
+		ReachabilityIslands.push_back(NewIslands);
+
+		return NAV_REACHABILITY_UNKNOWN;
+	}
+
+	// Stale labels could say two polys are joined when a rebuilt tile has cut them off, so wait for NAV_UpdateReachabilityIslands to catch up
+	if (!Islands->bLabelled || Islands->Revision != NavMesh->Revision) { return NAV_REACHABILITY_UNKNOWN; }
+
+	int StartIndex = NAV_GetReachabilityIslandPolyIndex(Islands, NavMesh->navMesh, StartPoly);
+	int EndIndex = NAV_GetReachabilityIslandPolyIndex(Islands, NavMesh->navMesh, EndPoly);
+
+	if (StartIndex < 0 || EndIndex < 0) { return NAV_REACHABILITY_UNKNOWN; }
+
+	if (Islands->WeakIslandIds[StartIndex] == 0 || Islands->WeakIslandIds[EndIndex] == 0) { return NAV_REACHABILITY_DISCONNECTED; }
+
+	if (Islands->WeakIslandIds[StartIndex] != Islands->WeakIslandIds[EndIndex]) { return NAV_REACHABILITY_DISCONNECTED; }
+
+	if (Islands->StrongIslandIds[StartIndex] == Islands->StrongIslandIds[EndIndex]) { return NAV_REACHABILITY_CONNECTED; }
+
+	// Same weak island but different strong islands: it depends on which way the one-way connections point, so let the path query decide
+	return NAV_REACHABILITY_UNKNOWN;
+}
+
+void NAV_ClearReachabilityIslands()
+{
+	ReachabilityIslands.clear();
+}
+
+unsigned int NAV_GetFilterHash(const dtQueryFilter* Filter)
+{
+	// FNV-1a over the area costs and flags
+	unsigned int Hash = 2166136261u;
+
+	for (int i = 0; i < DT_MAX_AREAS; i++)
+	{
+		float AreaCost = Filter->getAreaCost(i);
+		unsigned int CostBits;
+		memcpy(&CostBits, &AreaCost, sizeof(CostBits));
+
+		Hash = (Hash ^ CostBits) * 16777619u;
+	}
+
+	Hash = (Hash ^ Filter->getIncludeFlags()) * 16777619u;
+	Hash = (Hash ^ Filter->getExcludeFlags()) * 16777619u;
+
+	return Hash;
+}
+
+NavPathCacheKey NAV_MakePathCacheKey(const NavAgentProfile& NavProfile, const dtPolyRef StartPoly, const dtPolyRef EndPoly)
+{
+	NavPathCacheKey Key;
+	Key.StartPoly = StartPoly;
+	Key.EndPoly = EndPoly;
+	Key.NavMeshIndex = NavProfile.NavMeshIndex;
+	Key.FilterHash = NAV_GetFilterHash(&NavProfile.Filters);
+	Key.Revision = (NavProfile.NavMeshIndex < NUM_NAV_MESHES) ? NavMeshes[NavProfile.NavMeshIndex].Revision : 0;
+
+	return Key;
+}
+
+bool NAV_GetCachedPolyPath(const NavPathCacheKey& Key, dtPolyRef* PolyPath, int* nPathCount, const int MaxPath, dtStatus* Status)
+{
+	auto Found = PathCacheLookup.find(Key);
+
+	if (Found == PathCacheLookup.end())
+	{
+		PathCacheMisses++;
+		return false;
+	}
+
+	PathCacheHits++;
+
+	// Move to the front so it's the last to be evicted
+	PathCache.splice(PathCache.begin(), PathCache, Found->second);
+
+	const NavPathCacheEntry& Entry = *Found->second;
+
+	int NumToCopy = dtMin((int)Entry.PolyPath.size(), MaxPath);
+
+	memcpy(PolyPath, Entry.PolyPath.data(), NumToCopy * sizeof(dtPolyRef));
+	*nPathCount = NumToCopy;
+	*Status = Entry.Status;
+
+	if (NumToCopy < (int)Entry.PolyPath.size())
+	{
+		*Status |= DT_BUFFER_TOO_SMALL;
+	}
+
+	return true;
+}
+
+void NAV_CachePolyPath(const NavPathCacheKey& Key, const dtStatus Status, const dtPolyRef* PolyPath, const int nPathCount)
+{
+	// Don't cache truncated corridors, a caller with a bigger buffer would get the short version
+	if (Status & DT_BUFFER_TOO_SMALL) { return; }
+
+	auto Found = PathCacheLookup.find(Key);
+
+	if (Found != PathCacheLookup.end())
+	{
+		PathCache.erase(Found->second);
+		PathCacheLookup.erase(Found);
+	}
+
+	while (PathCache.size() >= MAX_PATH_CACHE_ENTRIES)
+	{
+		PathCacheLookup.erase(PathCache.back().Key);
+		PathCache.pop_back();
+	}
+
+	NavPathCacheEntry NewEntry;
+	NewEntry.Key = Key;
+	NewEntry.Status = Status;
+	NewEntry.PolyPath.assign(PolyPath, PolyPath + nPathCount);
+
+	PathCache.push_front(NewEntry);
+	PathCacheLookup[Key] = PathCache.begin();
+}
+
+bool NAV_IsCorridorTruncated(const dtStatus Status)
+{
+	return dtStatusSucceed(Status) && (Status & DT_BUFFER_TOO_SMALL) && !(Status & DT_PARTIAL_RESULT);
+}
+
+dtStatus NAV_FindPolyPath(const NavAgentProfile& NavProfile, const dtPolyRef StartPoly, const dtPolyRef EndPoly, const float* StartPos, const float* EndPos, dtPolyRef* PolyPath, int* nPathCount, const int MaxPath, const NavSearchMode SearchMode)
+{
+	const dtNavMeshQuery* m_navQuery = UTIL_GetNavMeshQueryForProfile(NavProfile);
+
+	*nPathCount = 0;
+
+	if (!m_navQuery) { return DT_FAILURE; }
+
+	NavPathCacheKey Key = NAV_MakePathCacheKey(NavProfile, StartPoly, EndPoly);
+
+	dtStatus status;
+
+	if (NAV_GetCachedPolyPath(Key, PolyPath, nPathCount, MaxPath, &status)) { return status; }
+
+	if (NAV_GetFlowFieldPolyPath(NavProfile, StartPoly, EndPoly, PolyPath, nPathCount, MaxPath, &status)) { return status; }
+
+	if (NAV_GetClusterPolyPath(NavProfile, StartPoly, EndPoly, PolyPath, nPathCount, MaxPath, &status)) { return status; }
+
+	unsigned int SearchOptions = (SearchMode == NAV_SEARCH_BIDIRECTIONAL) ? DT_FINDPATH_BIDIRECTIONAL : 0;
+
+	// The landmark heuristic can overestimate a little, so only searches which already trade away the cheapest path use it
+	if (SearchMode == NAV_SEARCH_FAST) { SearchOptions |= DT_FINDPATH_LANDMARKS; }
+
+	float HeuristicWeight = (SearchMode == NAV_SEARCH_FAST) ? NAV_FAST_SEARCH_WEIGHT : 1.0f;
+
+	status = m_navQuery->findPath(StartPoly, EndPoly, StartPos, EndPos, &NavProfile.Filters, PolyPath, nPathCount, MaxPath, SearchOptions, HeuristicWeight);
+
+	if (dtStatusSucceed(status) && *nPathCount > 0 && SearchMode != NAV_SEARCH_FAST)
+	{
+		NAV_CachePolyPath(Key, status, PolyPath, *nPathCount);
+	}
+
+	return status;
+}
+
+void NAV_ClearPathCache()
+{
+	PathCache.clear();
+	PathCacheLookup.clear();
+	PathCacheHits = 0;
+	PathCacheMisses = 0;
+}
+
+int NAV_GetFlatPolyIndex(const vector<dtPolyRef>& TileBaseRefs, const vector<unsigned int>& TileBase, const unsigned int NumPolys, const dtNavMesh* m_navMesh, const dtPolyRef Ref)
+{
+	if (!Ref) { return -1; }
+
+	unsigned int Salt, TileIndex, PolyIndex;
+	m_navMesh->decodePolyId(Ref, Salt, TileIndex, PolyIndex);
+
+	if (TileIndex >= TileBaseRefs.size()) { return -1; }
+
+	// Tile has been rebuilt (or was empty) since the index was built
+	if (TileBaseRefs[TileIndex] == 0 || (Ref & ~(dtPolyRef)PolyIndex) != TileBaseRefs[TileIndex]) { return -1; }
+
+	unsigned int Index = TileBase[TileIndex] + PolyIndex;
+
+	unsigned int TileEnd = (TileIndex + 1 < TileBase.size()) ? TileBase[TileIndex + 1] : NumPolys;
+
+	if (Index >= TileEnd) { return -1; }
+
+	return (int)Index;
+}
+
+int NAV_GetPolyGraphIndex(const nav_poly_graph* Graph, const dtNavMesh* m_navMesh, const dtPolyRef Ref)
+{
+	return NAV_GetFlatPolyIndex(Graph->TileBaseRefs, Graph->TileBase, (unsigned int)Graph->PolyRefs.size(), m_navMesh, Ref);
+}
+
+int NAV_GetFlowFieldPolyIndex(const nav_flow_field* FlowField, const dtNavMesh* m_navMesh, const dtPolyRef Ref)
+{
+	return NAV_GetFlatPolyIndex(FlowField->TileBaseRefs, FlowField->TileBase, (unsigned int)FlowField->Costs.size(), m_navMesh, Ref);
+}
+
+void NAV_BuildPolyGraph(nav_poly_graph* Graph, const dtNavMesh* m_navMesh, const dtQueryFilter* NavFilter)
+{
+	NAV_StartPolyGraphBuild(Graph, m_navMesh);
+
+	while (Graph->BuildStage != NAV_POLY_GRAPH_BUILT)
+	{
+		NAV_ContinuePolyGraphBuild(Graph, m_navMesh, NavFilter, INT_MAX);
+	}
+}
+
+void NAV_StartPolyGraphBuild(nav_poly_graph* Graph, const dtNavMesh* m_navMesh)
+{
+	*Graph = nav_poly_graph();
+
+	if (!m_navMesh)
+	{
+		Graph->BuildStage = NAV_POLY_GRAPH_BUILT;
+		return;
+	}
+
+	const int MaxTiles = m_navMesh->getMaxTiles();
+
+	Graph->TileBaseRefs.resize(MaxTiles, 0);
+	Graph->TileBase.resize(MaxTiles, 0);
+
+	Graph->BuildStage = NAV_POLY_GRAPH_TILES;
+}
+
+int NAV_ContinuePolyGraphBuild(nav_poly_graph* Graph, const dtNavMesh* m_navMesh, const dtQueryFilter* NavFilter, const int MaxPolys)
+{
+	int NumDone = 0;
+
+	while (NumDone < MaxPolys)
+	{
+		const unsigned int NumPolys = (unsigned int)Graph->PolyRefs.size();
+		const unsigned int i = Graph->BuildNext;
+
+		switch (Graph->BuildStage)
+		{
+			case NAV_POLY_GRAPH_TILES:
+			{
+				if (i >= Graph->TileBase.size())
+				{
+					Graph->bPassable.resize(NumPolys, false);
+					Graph->BuildCentres.resize(NumPolys * 3, 0.0f);
+					Graph->BuildStage = NAV_POLY_GRAPH_POLYS;
+					Graph->BuildNext = 0;
+					break;
+				}
+
+				const dtMeshTile* tile = m_navMesh->getTile(i);
+
+				Graph->TileBase[i] = NumPolys;
+				Graph->BuildNext++;
+				NumDone++;
+
+				if (!tile || !tile->header) { break; }
+
+				Graph->TileBaseRefs[i] = m_navMesh->getPolyRefBase(tile);
+
+				for (int j = 0; j < tile->header->polyCount; j++)
+				{
+					Graph->PolyRefs.push_back(Graph->TileBaseRefs[i] | (dtPolyRef)j);
+				}
+
+				NumDone += tile->header->polyCount;
+
+				break;
+			}
+			case NAV_POLY_GRAPH_POLYS:
+			{
+				if (i >= NumPolys)
+				{
+					// Links for poly i are Links[LinkStart[i]] to Links[LinkStart[i + 1] - 1]
+					Graph->LinkStart.resize(NumPolys + 1, 0);
+					Graph->BuildStage = NAV_POLY_GRAPH_LINKS;
+					Graph->BuildNext = 0;
+					break;
+				}
+
+				const dtMeshTile* tile = 0;
+				const dtPoly* poly = 0;
+				m_navMesh->getTileAndPolyByRefUnsafe(Graph->PolyRefs[i], &tile, &poly);
+
+				Graph->bPassable[i] = NavFilter->passFilter(Graph->PolyRefs[i], tile, poly);
+
+				float* Centre = &Graph->BuildCentres[i * 3];
+
+				for (int k = 0; k < poly->vertCount; k++)
+				{
+					dtVadd(Centre, Centre, &tile->verts[poly->verts[k] * 3]);
+				}
+
+				if (poly->vertCount > 0)
+				{
+					dtVscale(Centre, Centre, 1.0f / (float)poly->vertCount);
+				}
+
+				Graph->BuildNext++;
+				NumDone++;
+
+				break;
+			}
+			case NAV_POLY_GRAPH_LINKS:
+			{
+				if (i >= NumPolys)
+				{
+					Graph->LinkStart[NumPolys] = (unsigned int)Graph->Links.size();
+
+					// Same links flipped round, for searching backwards from a goal
+					Graph->ReverseLinkStart.resize(NumPolys + 1, 0);
+					Graph->ReverseLinks.resize(Graph->Links.size(), 0);
+					Graph->ReverseLinkCosts.resize(Graph->Links.size(), 0.0f);
+
+					vector<float>().swap(Graph->BuildCentres);
+
+					Graph->BuildStage = NAV_POLY_GRAPH_REVERSE_COUNT;
+					Graph->BuildNext = 0;
+					break;
+				}
+
+				Graph->LinkStart[i] = (unsigned int)Graph->Links.size();
+				Graph->BuildNext++;
+				NumDone++;
+
+				// Outgoing links between passable polys only
+				if (!Graph->bPassable[i]) { break; }
+
+				const dtMeshTile* tile = 0;
+				const dtPoly* poly = 0;
+				m_navMesh->getTileAndPolyByRefUnsafe(Graph->PolyRefs[i], &tile, &poly);
+
+				for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+				{
+					int NeighbourIndex = NAV_GetPolyGraphIndex(Graph, m_navMesh, tile->links[k].ref);
+
+					if (NeighbourIndex < 0 || !Graph->bPassable[NeighbourIndex]) { continue; }
+
+					const dtMeshTile* NeighbourTile = 0;
+					const dtPoly* NeighbourPoly = 0;
+					m_navMesh->getTileAndPolyByRefUnsafe(tile->links[k].ref, &NeighbourTile, &NeighbourPoly);
+
+					// Crossing from this poly into the neighbour, so it's this poly's area we're paying for
+					Graph->Links.push_back((unsigned int)NeighbourIndex);
+					Graph->LinkCosts.push_back(NavFilter->getCost(&Graph->BuildCentres[i * 3], &Graph->BuildCentres[NeighbourIndex * 3], 0, 0, 0, Graph->PolyRefs[i], tile, poly, tile->links[k].ref, NeighbourTile, NeighbourPoly));
+				}
+
+				break;
+			}
+			case NAV_POLY_GRAPH_REVERSE_COUNT:
+			{
+				if (i >= NumPolys)
+				{
+					Graph->BuildStage = NAV_POLY_GRAPH_REVERSE_START;
+					Graph->BuildNext = 0;
+					break;
+				}
+
+				for (unsigned int k = Graph->LinkStart[i]; k < Graph->LinkStart[i + 1]; k++)
+				{
+					Graph->ReverseLinkStart[Graph->Links[k] + 1]++;
+				}
+
+				Graph->BuildNext++;
+				NumDone++;
+
+				break;
+			}
+			case NAV_POLY_GRAPH_REVERSE_START:
+			{
+				if (i >= NumPolys)
+				{
+					Graph->BuildReverseCount.resize(NumPolys, 0);
+					Graph->BuildStage = NAV_POLY_GRAPH_REVERSE_LINKS;
+					Graph->BuildNext = 0;
+					break;
+				}
+
+				Graph->ReverseLinkStart[i + 1] += Graph->ReverseLinkStart[i];
+
+				Graph->BuildNext++;
+				NumDone++;
+
+				break;
+			}
+			case NAV_POLY_GRAPH_REVERSE_LINKS:
+			{
+				if (i >= NumPolys)
+				{
+					vector<unsigned int>().swap(Graph->BuildReverseCount);
+
+					Graph->BuildStage = NAV_POLY_GRAPH_BUILT;
+					Graph->BuildNext = 0;
+					break;
+				}
+
+				for (unsigned int k = Graph->LinkStart[i]; k < Graph->LinkStart[i + 1]; k++)
+				{
+					const unsigned int Target = Graph->Links[k];
+					const unsigned int Slot = Graph->ReverseLinkStart[Target] + Graph->BuildReverseCount[Target]++;
+
+					Graph->ReverseLinks[Slot] = i;
+					Graph->ReverseLinkCosts[Slot] = Graph->LinkCosts[k];
+				}
+
+				Graph->BuildNext++;
+				NumDone++;
+
+				break;
+			}
+			default:
+				return NumDone;
+		}
+	}
+
+	return NumDone;
+}
+
+void NAV_RunPolyGraphDijkstra(const nav_poly_graph* Graph, const unsigned int Source, const bool bReverse, vector<float>& Costs, vector<int>* Parents)
+{
+	NAV_RunPolyGraphRangeDijkstra(Graph, Source, bReverse, 0, (unsigned int)Graph->PolyRefs.size(), Costs, Parents);
+}
+
+void NAV_RunPolyGraphRangeDijkstra(const nav_poly_graph* Graph, const unsigned int Source, const bool bReverse, const unsigned int RangeStart, const unsigned int RangeEnd, vector<float>& Costs, vector<int>* Parents)
+{
+	const unsigned int NumPolys = RangeEnd - RangeStart;
+
+	Costs.assign(NumPolys, FLT_MAX);
+
+	if (Parents) { Parents->assign(NumPolys, -1); }
+
+	if (Source < RangeStart || Source >= RangeEnd || !Graph->bPassable[Source]) { return; }
+
+	const vector<unsigned int>& LinkStart = (bReverse) ? Graph->ReverseLinkStart : Graph->LinkStart;
+	const vector<unsigned int>& Links = (bReverse) ? Graph->ReverseLinks : Graph->Links;
+	const vector<float>& LinkCosts = (bReverse) ? Graph->ReverseLinkCosts : Graph->LinkCosts;
+
+	// Stale queue entries are skipped rather than updated in place
+	typedef pair<float, unsigned int> PolyGraphQueueEntry;
+	priority_queue<PolyGraphQueueEntry, vector<PolyGraphQueueEntry>, greater<PolyGraphQueueEntry>> OpenList;
+
+	Costs[Source - RangeStart] = 0.0f;
+	OpenList.push(PolyGraphQueueEntry(0.0f, Source));
+
+	while (!OpenList.empty())
+	{
+		const PolyGraphQueueEntry Best = OpenList.top();
+		OpenList.pop();
+
+		const unsigned int Current = Best.second;
+
+		if (Best.first > Costs[Current - RangeStart]) { continue; }
+
+		for (unsigned int k = LinkStart[Current]; k < LinkStart[Current + 1]; k++)
+		{
+			const unsigned int Neighbour = Links[k];
+
+			if (Neighbour < RangeStart || Neighbour >= RangeEnd) { continue; }
+
+			const float NewCost = Best.first + LinkCosts[k];
+
+			if (NewCost < Costs[Neighbour - RangeStart])
+			{
+				Costs[Neighbour - RangeStart] = NewCost;
+				if (Parents) { (*Parents)[Neighbour - RangeStart] = (int)Current; }
+				OpenList.push(PolyGraphQueueEntry(NewCost, Neighbour));
+			}
+		}
+	}
+}
+
+void NAV_StartFlowFieldBuild(nav_flow_field_build* Build, const nav_mesh* NavMesh)
+{
+	Build->Field.Revision = NavMesh->Revision;
+	Build->Stage = NAV_FLOW_FIELD_GRAPH;
+	Build->NextFinishTile = 0;
+	Build->Parents.clear();
+	Build->OpenList.clear();
+
+	NAV_StartPolyGraphBuild(&Build->Graph, NavMesh->navMesh);
+}
+
+void NAV_StartFlowFieldSearch(nav_flow_field_build* Build, const nav_mesh* NavMesh)
+{
+	const dtNavMesh* m_navMesh = NavMesh->navMesh;
+	const nav_poly_graph* Graph = &Build->Graph;
+	nav_flow_field* FlowField = &Build->Field;
+
+	const unsigned int NumPolys = (unsigned int)Graph->PolyRefs.size();
+
+	FlowField->TileBaseRefs = Graph->TileBaseRefs;
+	FlowField->TileBase = Graph->TileBase;
+	FlowField->bTileTouched.assign(Graph->TileBase.size(), false);
+	FlowField->NextPoly.assign(NumPolys, 0);
+	FlowField->Costs.assign(NumPolys, FLT_MAX);
+	Build->Parents.assign(NumPolys, -1);
+	Build->OpenList.clear();
+
+	Build->Stage = NAV_FLOW_FIELD_SEARCH;
+
+	int GoalIndex = NAV_GetPolyGraphIndex(Graph, m_navMesh, Build->GoalPoly);
+
+	if (GoalIndex < 0 || !Graph->bPassable[GoalIndex]) { return; }
+
+	FlowField->Costs[GoalIndex] = 0.0f;
+	Build->OpenList.push_back(pair<float, unsigned int>(0.0f, (unsigned int)GoalIndex));
+}
+
+int NAV_ContinueFlowFieldBuild(nav_flow_field_build* Build, const int MaxIterations)
+{
+	const nav_poly_graph* Graph = &Build->Graph;
+	vector<float>& Costs = Build->Field.Costs;
+	vector<pair<float, unsigned int>>& OpenList = Build->OpenList;
+
+	int Iterations = 0;
+
+	// Searching backwards along the links from the goal gives the cost from every poly to the goal, and which way to go
+	while (!OpenList.empty() && Iterations < MaxIterations)
+	{
+		pop_heap(OpenList.begin(), OpenList.end(), greater<pair<float, unsigned int>>());
+		const pair<float, unsigned int> Best = OpenList.back();
+		OpenList.pop_back();
+
+		Iterations++;
+
+		const unsigned int Current = Best.second;
+
+		if (Best.first > Costs[Current]) { continue; }
+
+		for (unsigned int k = Graph->ReverseLinkStart[Current]; k < Graph->ReverseLinkStart[Current + 1]; k++)
+		{
+			const unsigned int Neighbour = Graph->ReverseLinks[k];
+			const float NewCost = Best.first + Graph->ReverseLinkCosts[k];
+
+			if (NewCost < Costs[Neighbour])
+			{
+				Costs[Neighbour] = NewCost;
+				Build->Parents[Neighbour] = (int)Current;
+				OpenList.push_back(pair<float, unsigned int>(NewCost, Neighbour));
+				push_heap(OpenList.begin(), OpenList.end(), greater<pair<float, unsigned int>>());
+			}
+		}
+	}
+
+	return Iterations;
+}
+
+int NAV_FinishFlowFieldBuild(nav_flow_field_build* Build, const nav_mesh* NavMesh, const int MaxPolys)
+{
+	const dtNavMesh* m_navMesh = NavMesh->navMesh;
+	const nav_poly_graph& Graph = Build->Graph;
+	const vector<int>& Parents = Build->Parents;
+	nav_flow_field* FlowField = &Build->Field;
+
+	const unsigned int NumTiles = (unsigned int)Graph.TileBase.size();
+	const unsigned int NumPolys = (unsigned int)Graph.PolyRefs.size();
+
+	int NumDone = 0;
+
+	for (; Build->NextFinishTile < NumTiles && NumDone < MaxPolys; Build->NextFinishTile++)
+	{
+		const unsigned int i = Build->NextFinishTile;
+		const unsigned int TileEnd = (i + 1 < NumTiles) ? Graph.TileBase[i + 1] : NumPolys;
+
+		NumDone += 1 + (int)(TileEnd - Graph.TileBase[i]);
+
+		bool bReached = false;
+
+		for (unsigned int j = Graph.TileBase[i]; j < TileEnd; j++)
+		{
+			if (Parents[j] >= 0) { FlowField->NextPoly[j] = Graph.PolyRefs[Parents[j]]; }
+
+			bReached = bReached || FlowField->Costs[j] != FLT_MAX;
+		}
+
+		if (!bReached) { continue; }
+
+		// Any rebuilt tile the field reached, or next to one it reached, could change the costs
+		const dtMeshTile* tile = m_navMesh->getTile(i);
+
+		for (int y = tile->header->y - 1; y <= tile->header->y + 1; y++)
+		{
+			for (int x = tile->header->x - 1; x <= tile->header->x + 1; x++)
+			{
+				const dtMeshTile* NearbyTiles[DT_MAX_TOUCHED_TILES];
+				int NumNearbyTiles = m_navMesh->getTilesAt(x, y, NearbyTiles, DT_MAX_TOUCHED_TILES);
+
+				for (int k = 0; k < NumNearbyTiles; k++)
+				{
+					FlowField->bTileTouched[m_navMesh->decodePolyIdTile(m_navMesh->getPolyRefBase(NearbyTiles[k]))] = true;
+				}
+			}
+		}
+	}
+
+	return NumDone;
+}
+
+size_t NAV_GetFlowFieldMemory(const nav_flow_field* FlowField)
+{
+	return (FlowField->NextPoly.size() * (sizeof(dtPolyRef) + sizeof(float))) + (FlowField->TileBaseRefs.size() * (sizeof(dtPolyRef) + sizeof(unsigned int))) + (FlowField->bTileTouched.size() / 8);
+}
+
+nav_flow_field* NAV_GetFlowField(const NavAgentProfile& NavProfile, const dtPolyRef GoalPoly)
+{
+	if (NavProfile.NavMeshIndex >= NUM_NAV_MESHES || !GoalPoly) { return nullptr; }
+
+	const nav_mesh* NavMesh = &NavMeshes[NavProfile.NavMeshIndex];
+
+	const dtNavMesh* m_navMesh = NavMesh->navMesh;
+
+	if (!m_navMesh) { return nullptr; }
+
+	NavPathCacheKey Key = NAV_MakePathCacheKey(NavProfile, 0, GoalPoly);
+	Key.Revision = 0;
+
+	for (auto it = FlowFields.begin(); it != FlowFields.end(); it++)
+	{
+		if (!(it->Key == Key)) { continue; }
+
+		// Only throw the field away if one of the tiles it relies on has been rebuilt
+		if (it->Revision != NavMesh->Revision)
+		{
+			bool bStillValid = true;
+
+			for (unsigned int i = 0; i < it->bTileTouched.size() && bStillValid; i++)
+			{
+				if (!it->bTileTouched[i]) { continue; }
+
+				const dtMeshTile* tile = m_navMesh->getTile(i);
+				const dtPolyRef CurrentBaseRef = (tile && tile->header) ? m_navMesh->getPolyRefBase(tile) : 0;
+
+				bStillValid = (CurrentBaseRef == it->TileBaseRefs[i]);
+			}
+
+			if (!bStillValid)
+			{
+				FlowFieldMemory -= NAV_GetFlowFieldMemory(&(*it));
+				FlowFields.erase(it);
+
+				// Demand has already been shown, so rebuild it straight away
+				FlowFieldDemand[Key] = MIN_FLOW_FIELD_DEMAND - 1;
+				break;
+			}
+
+			it->Revision = NavMesh->Revision;
+		}
+
+		// Move to the front so it's the last to be evicted
+		FlowFields.splice(FlowFields.begin(), FlowFields, it);
+
+		return &FlowFields.front();
+	}
+
+	// Half-built tiles would invalidate the field straight away
+	if (!UTIL_IsTileCacheUpToDate()) { return nullptr; }
+
+	// Already on its way
+	if (FlowFieldBuild.bActive && FlowFieldBuild.Field.Key == Key) { return nullptr; }
+
+	if (FlowFieldDemand.size() >= MAX_FLOW_FIELD_DEMAND_ENTRIES) { FlowFieldDemand.clear(); }
+
+	unsigned int& Demand = FlowFieldDemand[Key];
+	Demand++;
+
+	// Demand is kept while another field is being built, so this goal gets its turn on the next search after that one finishes
+	if (Demand < MIN_FLOW_FIELD_DEMAND || FlowFieldBuild.bActive) { return nullptr; }
+
+	FlowFieldDemand.erase(Key);
+
+	FlowFieldBuild = nav_flow_field_build();
+	FlowFieldBuild.bActive = true;
+	FlowFieldBuild.NavMeshIndex = NavProfile.NavMeshIndex;
+	FlowFieldBuild.Filter = NavProfile.Filters;
+	FlowFieldBuild.GoalPoly = GoalPoly;
+	FlowFieldBuild.Field.Key = Key;
+
+	return nullptr;
+}
+
+int NAV_UpdateFlowFieldBuild(const int MaxIterations)
+{
+	if (!FlowFieldBuild.bActive || MaxIterations <= 0) { return 0; }
+
+	const nav_mesh* NavMesh = &NavMeshes[FlowFieldBuild.NavMeshIndex];
+
+	if (!NavMesh->navMesh)
+	{
+		FlowFieldBuild = nav_flow_field_build();
+		return 0;
+	}
+
+	// Tiles rebuilt partway through would leave the build pointing at polys which no longer exist, so start again
+	if (FlowFieldBuild.Stage != NAV_FLOW_FIELD_QUEUED && FlowFieldBuild.Field.Revision != NavMesh->Revision)
+	{
+		FlowFieldBuild.Stage = NAV_FLOW_FIELD_QUEUED;
+	}
+
+	if (FlowFieldBuild.Stage == NAV_FLOW_FIELD_QUEUED)
+	{
+		if (!bTileCacheUpToDate) { return 0; }
+
+		NAV_StartFlowFieldBuild(&FlowFieldBuild, NavMesh);
+	}
+
+	// Flattening the mesh has its own budget, the search waits until it's done
+	if (FlowFieldBuild.Stage == NAV_FLOW_FIELD_GRAPH)
+	{
+		NAV_ContinuePolyGraphBuild(&FlowFieldBuild.Graph, NavMesh->navMesh, &FlowFieldBuild.Filter, MAX_POLY_GRAPH_POLYS_PER_FRAME);
+
+		if (FlowFieldBuild.Graph.BuildStage != NAV_POLY_GRAPH_BUILT) { return 0; }
+
+		NAV_StartFlowFieldSearch(&FlowFieldBuild, NavMesh);
+	}
+
+	int Iterations = 0;
+
+	if (FlowFieldBuild.Stage == NAV_FLOW_FIELD_SEARCH)
+	{
+		Iterations = NAV_ContinueFlowFieldBuild(&FlowFieldBuild, MaxIterations);
+
+		if (!FlowFieldBuild.OpenList.empty()) { return Iterations; }
+
+		FlowFieldBuild.Stage = NAV_FLOW_FIELD_FINISH;
+	}
+
+	if (Iterations >= MaxIterations) { return Iterations; }
+
+	Iterations += NAV_FinishFlowFieldBuild(&FlowFieldBuild, NavMesh, MaxIterations - Iterations);
+
+	if (FlowFieldBuild.NextFinishTile < FlowFieldBuild.Graph.TileBase.size()) { return Iterations; }
+
+	FlowFieldBuilds++;
+
+	const size_t NewFieldMemory = NAV_GetFlowFieldMemory(&FlowFieldBuild.Field);
+
+	while (!FlowFields.empty() && ((int)FlowFields.size() >= MAX_FLOW_FIELDS || FlowFieldMemory + NewFieldMemory > MAX_FLOW_FIELD_MEMORY))
+	{
+		const nav_flow_field& Oldest = FlowFields.back();
+		FlowFieldMemory -= NAV_GetFlowFieldMemory(&Oldest);
+		FlowFields.pop_back();
+	}
+
+	FlowFields.push_front(std::move(FlowFieldBuild.Field));
+	FlowFieldMemory += NewFieldMemory;
+
+	// Frees the graph and search state as well
+	FlowFieldBuild = nav_flow_field_build();
+
+	return Iterations;
+}
+
+bool NAV_GetFlowFieldPolyPath(const NavAgentProfile& NavProfile, const dtPolyRef StartPoly, const dtPolyRef EndPoly, dtPolyRef* PolyPath, int* nPathCount, const int MaxPath, dtStatus* Status)
+{
+	nav_flow_field* FlowField = NAV_GetFlowField(NavProfile, EndPoly);
+
+	if (!FlowField) { return false; }
+
+	const dtNavMesh* m_navMesh = UTIL_GetNavMeshForProfile(NavProfile);
+
+	int Index = NAV_GetFlowFieldPolyIndex(FlowField, m_navMesh, StartPoly);
+
+	if (Index < 0 || FlowField->Costs[Index] == FLT_MAX) { return false; }
+
+	int NumPolys = 0;
+	dtPolyRef CurrentRef = StartPoly;
+
+	while (NumPolys < MaxPath)
+	{
+		PolyPath[NumPolys++] = CurrentRef;
+
+		if (CurrentRef == EndPoly) { break; }
+
+		CurrentRef = FlowField->NextPoly[Index];
+		Index = NAV_GetFlowFieldPolyIndex(FlowField, m_navMesh, CurrentRef);
+
+		// Shouldn't happen as the whole route was checked when the field was validated, but don't hand back a broken corridor
+		if (Index < 0) { return false; }
+	}
+
+	FlowFieldHits++;
+
+	*nPathCount = NumPolys;
+	*Status = (PolyPath[NumPolys - 1] == EndPoly) ? DT_SUCCESS : (DT_SUCCESS | DT_BUFFER_TOO_SMALL);
+
+	return true;
+}
+
+void NAV_ClearFlowFields()
+{
+	FlowFields.clear();
+	FlowFieldDemand.clear();
+	FlowFieldBuild = nav_flow_field_build();
+	FlowFieldMemory = 0;
+	FlowFieldHits = 0;
+	FlowFieldBuilds = 0;
+}
+
+void NAV_AttachLandmarkTables(const unsigned int NavMeshIndex)
+{
+	nav_mesh* NavMesh = &NavMeshes[NavMeshIndex];
+
+	NavMesh->LandmarkTables.clear();
+
+	for (auto it = Landmarks.begin(); it != Landmarks.end(); it++)
+	{
+		if (it->NavMeshIndex == NavMeshIndex && it->Table)
+		{
+			NavMesh->LandmarkTables.push_back(it->Table);
+		}
+	}
+
+	const dtLandmarkTable* const* Tables = (NavMesh->LandmarkTables.size() > 0) ? &NavMesh->LandmarkTables[0] : nullptr;
+
+	if (NavMesh->navQuery) { NavMesh->navQuery->setLandmarkTables(Tables, (int)NavMesh->LandmarkTables.size()); }
+	if (NavMesh->slicedQuery) { NavMesh->slicedQuery->setLandmarkTables(Tables, (int)NavMesh->LandmarkTables.size()); }
+}
+
+void NAV_InitLandmarks()
+{
+	NAV_ClearLandmarks();
+
+	for (auto it = BaseAgentProfiles.begin(); it != BaseAgentProfiles.end(); it++)
+	{
+		if (it->NavMeshIndex >= NUM_NAV_MESHES || !NavMeshes[it->NavMeshIndex].navMesh) { continue; }
+
+		unsigned int FilterHash = NAV_GetFilterHash(&it->Filters);
+		int NumMeshTables = 0;
+		bool bAlreadyAdded = false;
+
+		for (auto LandmarkIt = Landmarks.begin(); LandmarkIt != Landmarks.end(); LandmarkIt++)
+		{
+			if (LandmarkIt->NavMeshIndex != it->NavMeshIndex) { continue; }
+
+			NumMeshTables++;
+
+			if (LandmarkIt->FilterHash == FilterHash) { bAlreadyAdded = true; }
+		}
+
+		// Queries only hold so many tables. Any profile without one just falls back to the normal heuristic
+		if (bAlreadyAdded || NumMeshTables >= DT_MAX_LANDMARK_TABLES) { continue; }
+
+		nav_landmarks NewLandmarks;
+		NewLandmarks.NavMeshIndex = it->NavMeshIndex;
+		NewLandmarks.FilterHash = FilterHash;
+		NewLandmarks.Filter = it->Filters;
+
+		Landmarks.push_back(NewLandmarks);
+	}
+}
+
+void NAV_StartLandmarkTableBuild(nav_landmarks* LandmarkSet)
+{
+	const nav_mesh* NavMesh = &NavMeshes[LandmarkSet->NavMeshIndex];
+	const dtNavMesh* m_navMesh = NavMesh->navMesh;
+
+	if (LandmarkSet->PendingTable)
+	{
+		dtFreeLandmarkTable(LandmarkSet->PendingTable);
+		LandmarkSet->PendingTable = nullptr;
+	}
+
+	LandmarkSet->PendingRevision = NavMesh->Revision;
+	LandmarkSet->NextLandmark = 0;
+
+	NAV_BuildPolyGraph(&LandmarkSet->PendingGraph, m_navMesh, &LandmarkSet->Filter);
+
+	const nav_poly_graph* Graph = &LandmarkSet->PendingGraph;
+	const unsigned int NumPolys = (unsigned int)Graph->PolyRefs.size();
+
+	LandmarkSet->MinLandmarkCosts.assign(NumPolys, FLT_MAX);
+
+	dtLandmarkTable* NewTable = dtAllocLandmarkTable();
+
+	if (!NewTable) { return; }
+
+	if (dtStatusFailed(NewTable->init((int)Graph->TileBase.size(), (int)NumPolys, NUM_NAV_LANDMARKS, &LandmarkSet->Filter)))
+	{
+		dtFreeLandmarkTable(NewTable);
+		return;
+	}
+
+	for (unsigned int i = 0; i < Graph->TileBase.size(); i++)
+	{
+		if (!Graph->TileBaseRefs[i]) { continue; }
+
+		unsigned int TileEnd = (i + 1 < Graph->TileBase.size()) ? Graph->TileBase[i + 1] : NumPolys;
+
+		NewTable->setTile((int)i, m_navMesh->decodePolyIdSalt(Graph->TileBaseRefs[i]), Graph->TileBase[i], TileEnd - Graph->TileBase[i]);
+	}
+
+	LandmarkSet->PendingTable = NewTable;
+}
+
+int NAV_PickNextLandmark(nav_landmarks* LandmarkSet)
+{
+	const nav_poly_graph* Graph = &LandmarkSet->PendingGraph;
+	const unsigned int NumPolys = (unsigned int)Graph->PolyRefs.size();
+
+	int FirstPassable = -1;
+
+	for (unsigned int i = 0; i < NumPolys && FirstPassable < 0; i++)
+	{
+		if (Graph->bPassable[i]) { FirstPassable = (int)i; }
+	}
+
+	if (FirstPassable < 0) { return -1; }
+
+	vector<float> SeedCosts;
+
+	// Nothing to spread out from yet, so start from whatever is furthest from an arbitrary poly. That tends to be out on the edge of the map
+	const vector<float>& SpreadCosts = (LandmarkSet->NextLandmark == 0) ? SeedCosts : LandmarkSet->MinLandmarkCosts;
+
+	if (LandmarkSet->NextLandmark == 0)
+	{
+		NAV_RunPolyGraphDijkstra(Graph, (unsigned int)FirstPassable, false, SeedCosts, nullptr);
+	}
+	else
+	{
+		// Polys no landmark can reach or be reached from (e.g. a separate island) get no benefit at all, so cover them first
+		for (unsigned int i = 0; i < NumPolys; i++)
+		{
+			if (Graph->bPassable[i] && SpreadCosts[i] == FLT_MAX) { return (int)i; }
+		}
+	}
+
+	int FurthestPoly = -1;
+	float FurthestCost = 0.0f;
+
+	for (unsigned int i = 0; i < NumPolys; i++)
+	{
+		if (!Graph->bPassable[i] || SpreadCosts[i] == FLT_MAX) { continue; }
+
+		if (FurthestPoly < 0 || SpreadCosts[i] > FurthestCost)
+		{
+			FurthestPoly = (int)i;
+			FurthestCost = SpreadCosts[i];
+		}
+	}
+
+	// Every poly is already a landmark or sitting on top of one, more landmarks won't help
+	if (LandmarkSet->NextLandmark > 0 && FurthestCost <= 0.0f) { return -1; }
+
+	return FurthestPoly;
+}
+
+void NAV_SwapInLandmarkTable(nav_landmarks* LandmarkSet)
+{
+	// The workers and the sliced planner may be partway through a search using the old table
+	NAV_RaiseNavMeshFence();
+
+	if (bPathRequestActive && ActivePathRequest.NavProfile.NavMeshIndex == LandmarkSet->NavMeshIndex)
+	{
+		PendingPathRequests.push_front(ActivePathRequest);
+		bPathRequestActive = false;
+	}
+
+	dtLandmarkTable* OldTable = LandmarkSet->Table;
+
+	LandmarkSet->Table = LandmarkSet->PendingTable;
+	LandmarkSet->Revision = LandmarkSet->PendingRevision;
+	LandmarkSet->PendingTable = nullptr;
+
+	NAV_AttachLandmarkTables(LandmarkSet->NavMeshIndex);
+
+	if (OldTable) { dtFreeLandmarkTable(OldTable); }
+
+	NAV_LowerNavMeshFence();
+
+	LandmarkSet->PendingGraph = nav_poly_graph();
+	LandmarkSet->MinLandmarkCosts.clear();
+
+	LandmarkTableBuilds++;
+}
+
+void NAV_UpdateLandmarks()
+{
+	// No point building from tiles that are about to be rebuilt again
+	if (!bTileCacheUpToDate) { return; }
+
+	for (auto it = Landmarks.begin(); it != Landmarks.end(); it++)
+	{
+		const nav_mesh* NavMesh = &NavMeshes[it->NavMeshIndex];
+
+		if (!NavMesh->navMesh) { continue; }
+
+		bool bTableStale = (!it->Table || it->Revision != NavMesh->Revision);
+		bool bPendingStale = (it->PendingTable && it->PendingRevision != NavMesh->Revision);
+
+		if (!bTableStale && !it->PendingTable) { continue; }
+
+		// Building the graph is a whole mesh pass on its own, so the landmarks start next frame
+		if (!it->PendingTable || bPendingStale)
+		{
+			NAV_StartLandmarkTableBuild(&(*it));
+			return;
+		}
+
+		int LandmarkPoly = NAV_PickNextLandmark(&(*it));
+
+		if (LandmarkPoly >= 0)
+		{
+			vector<float> CostsTo;
+			vector<float> CostsFrom;
+
+			NAV_RunPolyGraphDijkstra(&it->PendingGraph, (unsigned int)LandmarkPoly, true, CostsTo, nullptr);
+			NAV_RunPolyGraphDijkstra(&it->PendingGraph, (unsigned int)LandmarkPoly, false, CostsFrom, nullptr);
+
+			it->PendingTable->setLandmarkCosts(it->NextLandmark, &CostsTo[0], &CostsFrom[0]);
+
+			for (unsigned int i = 0; i < it->MinLandmarkCosts.size(); i++)
+			{
+				it->MinLandmarkCosts[i] = fminf(it->MinLandmarkCosts[i], fminf(CostsTo[i], CostsFrom[i]));
+			}
+
+			it->NextLandmark++;
+		}
+
+		// Unused landmarks are left unreachable, which the table ignores
+		if (LandmarkPoly < 0 || it->NextLandmark >= NUM_NAV_LANDMARKS)
+		{
+			NAV_SwapInLandmarkTable(&(*it));
+		}
+
+		// One landmark per frame across all tables
+		return;
+	}
+}
+
+void NAV_ClearLandmarks()
+{
+	for (int i = 0; i < NUM_NAV_MESHES; i++)
+	{
+		NavMeshes[i].LandmarkTables.clear();
+
+		if (NavMeshes[i].navQuery) { NavMeshes[i].navQuery->setLandmarkTables(nullptr, 0); }
+		if (NavMeshes[i].slicedQuery) { NavMeshes[i].slicedQuery->setLandmarkTables(nullptr, 0); }
+	}
+
+	for (auto it = Landmarks.begin(); it != Landmarks.end(); it++)
+	{
+		if (it->Table) { dtFreeLandmarkTable(it->Table); }
+		if (it->PendingTable) { dtFreeLandmarkTable(it->PendingTable); }
+	}
+
+	Landmarks.clear();
+	LandmarkTableBuilds = 0;
+}
+
+void NAV_GetPolyGraphTileRange(const nav_poly_graph* Graph, const unsigned int TileIndex, unsigned int& RangeStart, unsigned int& RangeEnd)
+{
+	RangeStart = Graph->TileBase[TileIndex];
+	RangeEnd = (TileIndex + 1 < Graph->TileBase.size()) ? Graph->TileBase[TileIndex + 1] : (unsigned int)Graph->PolyRefs.size();
+}
+
+void NAV_StartClusterGraphBuild(nav_cluster_graph* Clusters, const nav_mesh* NavMesh)
+{
+	Clusters->Revision = NavMesh->Revision;
+	Clusters->bBuilding = true;
+	Clusters->bComplete = false;
+	Clusters->bPortalsFound = false;
+	Clusters->NextPortalTile = 0;
+	Clusters->NextPortal = 0;
+	Clusters->PolyTiles.clear();
+	Clusters->PolyPortals.clear();
+	Clusters->Portals.clear();
+	Clusters->TilePortalStart.clear();
+	Clusters->PortalLinkStart.clear();
+	Clusters->PortalLinks.clear();
+	Clusters->PortalLinkCosts.clear();
+
+	NAV_StartPolyGraphBuild(&Clusters->Graph, NavMesh->navMesh);
+}
+
+int NAV_FindClusterPortals(nav_cluster_graph* Clusters, const dtNavMesh* m_navMesh, const int MaxPolys)
+{
+	if (!Clusters->bBuilding || Clusters->bPortalsFound) { return 0; }
+
+	const nav_poly_graph* Graph = &Clusters->Graph;
+
+	int NumDone = 0;
+
+	if (Graph->BuildStage != NAV_POLY_GRAPH_BUILT)
+	{
+		NumDone = NAV_ContinuePolyGraphBuild(&Clusters->Graph, m_navMesh, &Clusters->Filter, MaxPolys);
+
+		if (Graph->BuildStage != NAV_POLY_GRAPH_BUILT) { return NumDone; }
+	}
+
+	const unsigned int NumPolys = (unsigned int)Graph->PolyRefs.size();
+	const unsigned int NumTiles = (unsigned int)Graph->TileBase.size();
+
+	if (Clusters->NextPortalTile == 0)
+	{
+		Clusters->PolyTiles.resize(NumPolys, 0);
+		Clusters->PolyPortals.resize(NumPolys, -1);
+		Clusters->TilePortalStart.resize(NumTiles + 1, 0);
+	}
+
+	// Polys are stored tile by tile, so each tile's portals end up next to each other as well
+	for (; Clusters->NextPortalTile < NumTiles && NumDone < MaxPolys; Clusters->NextPortalTile++)
+	{
+		const unsigned int i = Clusters->NextPortalTile;
+
+		Clusters->TilePortalStart[i] = (unsigned int)Clusters->Portals.size();
+
+		unsigned int RangeStart, RangeEnd;
+		NAV_GetPolyGraphTileRange(Graph, i, RangeStart, RangeEnd);
+
+		NumDone += 1 + (int)(RangeEnd - RangeStart);
+
+		for (unsigned int j = RangeStart; j < RangeEnd; j++)
+		{
+			Clusters->PolyTiles[j] = i;
+
+			// Any poly with a link into or out of another tile is a portal, so every crossing joins two portals
+			bool bIsPortal = false;
+
+			for (unsigned int k = Graph->LinkStart[j]; k < Graph->LinkStart[j + 1] && !bIsPortal; k++)
+			{
+				bIsPortal = Graph->Links[k] < RangeStart || Graph->Links[k] >= RangeEnd;
+			}
+
+			for (unsigned int k = Graph->ReverseLinkStart[j]; k < Graph->ReverseLinkStart[j + 1] && !bIsPortal; k++)
+			{
+				bIsPortal = Graph->ReverseLinks[k] < RangeStart || Graph->ReverseLinks[k] >= RangeEnd;
+			}
+
+			if (!bIsPortal) { continue; }
+
+			Clusters->PolyPortals[j] = (int)Clusters->Portals.size();
+			Clusters->Portals.push_back(j);
+		}
+	}
+
+	if (Clusters->NextPortalTile >= NumTiles)
+	{
+		Clusters->TilePortalStart[NumTiles] = (unsigned int)Clusters->Portals.size();
+		Clusters->PortalLinkStart.resize(Clusters->Portals.size() + 1, 0);
+		Clusters->bPortalsFound = true;
+	}
+
+	return NumDone;
+}
+
+int NAV_ContinueClusterGraphBuild(nav_cluster_graph* Clusters, const int MaxPortals)
+{
+	if (!Clusters->bBuilding || !Clusters->bPortalsFound) { return 0; }
+
+	const nav_poly_graph* Graph = &Clusters->Graph;
+	const vector<unsigned int>& PolyTiles = Clusters->PolyTiles;
+	const unsigned int NumPortals = (unsigned int)Clusters->Portals.size();
+
+	vector<float> TileCosts;
+
+	int NumDone = 0;
+
+	// Portals are done in order, so each one's links go on the end of PortalLinks
+	for (; Clusters->NextPortal < NumPortals && NumDone < MaxPortals; Clusters->NextPortal++, NumDone++)
+	{
+		const unsigned int i = Clusters->NextPortal;
+
+		Clusters->PortalLinkStart[i] = (unsigned int)Clusters->PortalLinks.size();
+
+		const unsigned int PortalPoly = Clusters->Portals[i];
+		const unsigned int TileIndex = PolyTiles[PortalPoly];
+
+		unsigned int RangeStart, RangeEnd;
+		NAV_GetPolyGraphTileRange(Graph, TileIndex, RangeStart, RangeEnd);
+
+		// Cheapest route to every other portal without leaving the tile
+		NAV_RunPolyGraphRangeDijkstra(Graph, PortalPoly, false, RangeStart, RangeEnd, TileCosts, nullptr);
+
+		for (unsigned int j = Clusters->TilePortalStart[TileIndex]; j < Clusters->TilePortalStart[TileIndex + 1]; j++)
+		{
+			const float Cost = TileCosts[Clusters->Portals[j] - RangeStart];
+
+			if (j == i || Cost == FLT_MAX) { continue; }
+
+			Clusters->PortalLinks.push_back(j);
+			Clusters->PortalLinkCosts.push_back(Cost);
+		}
+
+		// Crossings into neighbouring tiles
+		for (unsigned int k = Graph->LinkStart[PortalPoly]; k < Graph->LinkStart[PortalPoly + 1]; k++)
+		{
+			if (PolyTiles[Graph->Links[k]] == TileIndex) { continue; }
+
+			Clusters->PortalLinks.push_back((unsigned int)Clusters->PolyPortals[Graph->Links[k]]);
+			Clusters->PortalLinkCosts.push_back(Graph->LinkCosts[k]);
+		}
+	}
+
+	if (Clusters->NextPortal >= NumPortals)
+	{
+		Clusters->PortalLinkStart[NumPortals] = (unsigned int)Clusters->PortalLinks.size();
+		Clusters->PolyTiles.clear();
+		Clusters->PolyTiles.shrink_to_fit();
+		Clusters->bBuilding = false;
+		Clusters->bComplete = true;
+
+		ClusterGraphBuilds++;
+	}
+
+	return NumDone;
+}
+
+nav_cluster_graph* NAV_GetClusterGraph(const NavAgentProfile& NavProfile)
+{
+	if (NavProfile.NavMeshIndex >= NUM_NAV_MESHES) { return nullptr; }
+
+	const nav_mesh* NavMesh = &NavMeshes[NavProfile.NavMeshIndex];
+
+	if (!NavMesh->navMesh) { return nullptr; }
+
+	unsigned int FilterHash = NAV_GetFilterHash(&NavProfile.Filters);
+
+	for (auto it = ClusterGraphs.begin(); it != ClusterGraphs.end(); it++)
+	{
+		if (it->NavMeshIndex == NavProfile.NavMeshIndex && it->FilterHash == FilterHash)
+		{
+			// A stale graph points at polys which may no longer exist, so wait for NAV_UpdateClusterGraphs to catch up
+			return (it->bComplete && it->Revision == NavMesh->Revision) ? &(*it) : nullptr;
+		}
+	}
+
+	nav_cluster_graph NewClusters;
+	NewClusters.NavMeshIndex = NavProfile.NavMeshIndex;
+	NewClusters.FilterHash = FilterHash;
+	NewClusters.Filter = NavProfile.Filters;
+
+	ClusterGraphs.push_back(NewClusters);
+
+	return nullptr;
+}
+
+void NAV_UpdateClusterGraphs()
+{
+	// No point building from tiles that are about to be rebuilt again
+	if (!bTileCacheUpToDate) { return; }
+
+	int PortalBudget = MAX_CLUSTER_PORTALS_PER_FRAME;
+
+	for (auto it = ClusterGraphs.begin(); it != ClusterGraphs.end(); it++)
+	{
+		const nav_mesh* NavMesh = &NavMeshes[it->NavMeshIndex];
+
+		if (!NavMesh->navMesh) { continue; }
+
+		if (it->bComplete && it->Revision == NavMesh->Revision) { continue; }
+
+		if (!it->bBuilding || it->Revision != NavMesh->Revision)
+		{
+			NAV_StartClusterGraphBuild(&(*it), NavMesh);
+		}
+
+		// Flattening the mesh and finding the portals have a poly budget of their own, the portals are linked up once they're done
+		if (!it->bPortalsFound)
+		{
+			NAV_FindClusterPortals(&(*it), NavMesh->navMesh, MAX_POLY_GRAPH_POLYS_PER_FRAME);
+			return;
+		}
+
+		PortalBudget -= NAV_ContinueClusterGraphBuild(&(*it), PortalBudget);
+
+		if (PortalBudget <= 0) { return; }
+	}
+}
+
+bool NAV_GetClusterPolyPath(const NavAgentProfile& NavProfile, const dtPolyRef StartPoly, const dtPolyRef EndPoly, dtPolyRef* PolyPath, int* nPathCount, const int MaxPath, dtStatus* Status, int* NodesVisited)
+{
+	if (NodesVisited) { *NodesVisited = 0; }
+
+	if (MaxPath <= 0) { return false; }
+
+	const dtNavMesh* m_navMesh = UTIL_GetNavMeshForProfile(NavProfile);
+
+	if (!m_navMesh) { return false; }
+
+	const dtMeshTile* StartTile = nullptr;
+	const dtMeshTile* EndTile = nullptr;
+	const dtPoly* Poly = nullptr;
+
+	if (dtStatusFailed(m_navMesh->getTileAndPolyByRef(StartPoly, &StartTile, &Poly))) { return false; }
+	if (dtStatusFailed(m_navMesh->getTileAndPolyByRef(EndPoly, &EndTile, &Poly))) { return false; }
+
+	// findPath copes fine with short hops, the cluster graph is for journeys across the map
+	int TileDist = imaxi(abs(StartTile->header->x - EndTile->header->x), abs(StartTile->header->y - EndTile->header->y));
+
+	if (TileDist < MIN_CLUSTER_PATH_TILES) { return false; }
+
+	nav_cluster_graph* Clusters = NAV_GetClusterGraph(NavProfile);
+
+	if (!Clusters) { return false; }
+
+	const nav_poly_graph* Graph = &Clusters->Graph;
+
+	int StartIndex = NAV_GetPolyGraphIndex(Graph, m_navMesh, StartPoly);
+	int EndIndex = NAV_GetPolyGraphIndex(Graph, m_navMesh, EndPoly);
+
+	if (StartIndex < 0 || EndIndex < 0 || !Graph->bPassable[StartIndex] || !Graph->bPassable[EndIndex]) { return false; }
+
+	const unsigned int StartTileIndex = m_navMesh->decodePolyIdTile(StartPoly);
+	const unsigned int EndTileIndex = m_navMesh->decodePolyIdTile(EndPoly);
+
+	unsigned int StartRangeStart, StartRangeEnd, EndRangeStart, EndRangeEnd;
+	NAV_GetPolyGraphTileRange(Graph, StartTileIndex, StartRangeStart, StartRangeEnd);
+	NAV_GetPolyGraphTileRange(Graph, EndTileIndex, EndRangeStart, EndRangeEnd);
+
+	// Costs from the start poly to the portals of its tile, and from the portals of the end tile to the end poly
+	vector<float> StartCosts, EndCosts;
+	vector<int> StartParents, EndParents;
+
+	NAV_RunPolyGraphRangeDijkstra(Graph, (unsigned int)StartIndex, false, StartRangeStart, StartRangeEnd, StartCosts, &StartParents);
+	NAV_RunPolyGraphRangeDijkstra(Graph, (unsigned int)EndIndex, true, EndRangeStart, EndRangeEnd, EndCosts, &EndParents);
+
+	// Tile searches are counted as visiting every poly in the tile, which is near enough
+	int Visited = (int)((StartRangeEnd - StartRangeStart) + (EndRangeEnd - EndRangeStart));
+
+	// Dijkstra over the portals, with one extra node standing in for the end poly
+	const unsigned int NumPortals = (unsigned int)Clusters->Portals.size();
+	const unsigned int GoalNode = NumPortals;
+
+	vector<float> PortalCosts(NumPortals + 1, FLT_MAX);
+	vector<int> PortalParents(NumPortals + 1, -1);
 
-		NextPathNode.flag = CurrFlags;
-		NextPathNode.area = CurrArea;
-		NextPathNode.poly = StraightPolyPath[nVert];
+	typedef pair<float, unsigned int> PortalQueueEntry;
+	priority_queue<PortalQueueEntry, vector<PortalQueueEntry>, greater<PortalQueueEntry>> OpenList;
 
-		m_navMesh->getPolyFlags(StraightPolyPath[nVert], &CurrFlags);
-		m_navMesh->getPolyArea(StraightPolyPath[nVert], &CurrArea);
+	for (unsigned int i = Clusters->TilePortalStart[StartTileIndex]; i < Clusters->TilePortalStart[StartTileIndex + 1]; i++)
+	{
+		const float Cost = StartCosts[Clusters->Portals[i] - StartRangeStart];
 
-		NodeFromLocation = NextPathNode.Location;
+		if (Cost == FLT_MAX) { continue; }
 
-		path.push_back(NextPathNode);
+		PortalCosts[i] = Cost;
+		OpenList.push(PortalQueueEntry(Cost, i));
 	}
 
-	return DT_SUCCESS;
-}
+	while (!OpenList.empty())
+	{
+		const PortalQueueEntry Best = OpenList.top();
+		OpenList.pop();
 
-Vector NAV_GetNearestPlatformDisembarkPoint(const NavAgentProfile& NavProfile, edict_t* Rider, DynamicMapObject* LiftReference)
-{
-	if (!LiftReference) { return ZERO_VECTOR; }
+		const unsigned int Current = Best.second;
 
-	NavOffMeshConnection* NearestConnection = nullptr;
-	float MinDist = 0.0f;
+		Visited++;
 
-	nav_mesh ChosenNavMesh = NavMeshes[NavProfile.NavMeshIndex];
+		if (Current == GoalNode) { break; }
 
+		if (Best.first > PortalCosts[Current]) { continue; }
 
-	for (auto it = ChosenNavMesh.MeshConnections.begin(); it != ChosenNavMesh.MeshConnections.end(); it++)
-	{
-		if (!(it->ConnectionFlags & NAV_FLAG_PLATFORM)) { continue; }
+		const unsigned int CurrentPoly = Clusters->Portals[Current];
 
-		if (it->LinkedObject == LiftReference->Edict)
+		if (CurrentPoly >= EndRangeStart && CurrentPoly < EndRangeEnd && EndCosts[CurrentPoly - EndRangeStart] != FLT_MAX)
 		{
-			float ThisDist = fminf(vDist3DSq(it->FromLocation, UTIL_GetClosestPointOnEntityToLocation(it->FromLocation, LiftReference->Edict)), vDist3DSq(it->ToLocation, UTIL_GetClosestPointOnEntityToLocation(it->ToLocation, LiftReference->Edict)));
+			const float NewCost = Best.first + EndCosts[CurrentPoly - EndRangeStart];
 
-			if (ThisDist < sqrf(100.0f) && (!NearestConnection || ThisDist < MinDist))
+			if (NewCost < PortalCosts[GoalNode])
 			{
-				NearestConnection = &(*it);
-				MinDist = ThisDist;
+				PortalCosts[GoalNode] = NewCost;
+				PortalParents[GoalNode] = (int)Current;
+				OpenList.push(PortalQueueEntry(NewCost, GoalNode));
+			}
+		}
+
+		for (unsigned int k = Clusters->PortalLinkStart[Current]; k < Clusters->PortalLinkStart[Current + 1]; k++)
+		{
+			const unsigned int Neighbour = Clusters->PortalLinks[k];
+			const float NewCost = Best.first + Clusters->PortalLinkCosts[k];
+
+			if (NewCost < PortalCosts[Neighbour])
+			{
+				PortalCosts[Neighbour] = NewCost;
+				PortalParents[Neighbour] = (int)Current;
+				OpenList.push(PortalQueueEntry(NewCost, Neighbour));
 			}
 		}
 	}
 
-	if (NearestConnection)
-	{
-		Vector NearestPointFromLocation = UTIL_GetClosestPointOnEntityToLocation(NearestConnection->FromLocation, LiftReference->Edict);
-		NearestPointFromLocation.z = Rider->v.origin.z;
+	if (NodesVisited) { *NodesVisited = Visited; }
 
-		Vector NearestPointToLocation = UTIL_GetClosestPointOnEntityToLocation(NearestConnection->ToLocation, LiftReference->Edict);
-		NearestPointToLocation.z = Rider->v.origin.z;
+	// Let findPath have a go, it will at least return the usual partial path
+	if (PortalCosts[GoalNode] == FLT_MAX) { return false; }
 
-		float DistFromLocation = vDist3DSq(NearestConnection->FromLocation, NearestPointFromLocation);
-		float DistToLocation = vDist3DSq(NearestConnection->ToLocation, NearestPointToLocation);
-		return (DistFromLocation < DistToLocation) ? NearestConnection->FromLocation : NearestConnection->ToLocation;
+	vector<unsigned int> ReversedRoute;
+
+	for (int Node = PortalParents[GoalNode]; Node >= 0; Node = PortalParents[Node])
+	{
+		ReversedRoute.push_back((unsigned int)Node);
 	}
-	else
+
+	vector<unsigned int> PortalRoute(ReversedRoute.rbegin(), ReversedRoute.rend());
+
+	ClusterPathSearches++;
+
+	// Refine the route into polys one tile at a time, stopping once the corridor is full so long routes don't refine tiles they'll never use
+	vector<unsigned int> Corridor;
+	vector<unsigned int> Segment;
+
+	for (int Node = (int)Clusters->Portals[PortalRoute.front()]; Node >= 0; Node = StartParents[Node - StartRangeStart])
 	{
-		Vector NearestProjectedPoint = ZERO_VECTOR;
-		Vector LiftCentre = UTIL_GetCentreOfEntity(LiftReference->Edict);
-		float DisembarkHeight = (!FNullEnt(Rider)) ? GetPlayerBottomOfCollisionHull(Rider).z : LiftReference->Edict->v.absmax.z;
+		Segment.push_back((unsigned int)Node);
+	}
 
-		Vector FrontLocation = Vector(LiftReference->Edict->v.absmax.x, LiftCentre.y, DisembarkHeight);
-		Vector RearLocation = Vector(LiftReference->Edict->v.absmin.x, LiftCentre.y, DisembarkHeight);
-		Vector LeftLocation = Vector(LiftCentre.x, LiftReference->Edict->v.absmin.y, DisembarkHeight);
-		Vector RightLocation = Vector(LiftCentre.x, LiftReference->Edict->v.absmax.y, DisembarkHeight);
+	Corridor.insert(Corridor.end(), Segment.rbegin(), Segment.rend());
 
-		float ProjectWidth = fmaxf((LiftReference->Edict->v.absmax.x - LiftReference->Edict->v.absmin.x) * 0.5f, (LiftReference->Edict->v.absmax.y - LiftReference->Edict->v.absmin.y) * 0.5f);
-		ProjectWidth += 100.0f;
+	vector<float> TileCosts;
+	vector<int> TileParents;
 
-		Vector ProjectedLoc = UTIL_ProjectPointToNavmesh(NavProfile.NavMeshIndex, FrontLocation, NavProfile, Vector(ProjectWidth, ProjectWidth, 50.0f));
+	for (unsigned int i = 1; i < PortalRoute.size() && Corridor.size() < (size_t)MaxPath; i++)
+	{
+		const unsigned int FromPoly = Clusters->Portals[PortalRoute[i - 1]];
+		const unsigned int ToPoly = Clusters->Portals[PortalRoute[i]];
 
-		if (!vIsZero(ProjectedLoc) && !vPointOverlaps2D(ProjectedLoc, LiftReference->Edict->v.absmin, LiftReference->Edict->v.absmax))
+		unsigned int RangeStart, RangeEnd;
+		NAV_GetPolyGraphTileRange(Graph, m_navMesh->decodePolyIdTile(Graph->PolyRefs[FromPoly]), RangeStart, RangeEnd);
+
+		// Crossing into the next tile is a single link
+		if (ToPoly < RangeStart || ToPoly >= RangeEnd)
 		{
-			return ProjectedLoc;
+			Corridor.push_back(ToPoly);
+			continue;
 		}
 
-		ProjectedLoc = UTIL_ProjectPointToNavmesh(NavProfile.NavMeshIndex, RearLocation, NavProfile, Vector(ProjectWidth, ProjectWidth, 50.0f));
+		NAV_RunPolyGraphRangeDijkstra(Graph, FromPoly, false, RangeStart, RangeEnd, TileCosts, &TileParents);
 
-		if (!vIsZero(ProjectedLoc) && !vPointOverlaps2D(ProjectedLoc, LiftReference->Edict->v.absmin, LiftReference->Edict->v.absmax))
-		{
-			return ProjectedLoc;
-		}
+		Visited += (int)(RangeEnd - RangeStart);
 
-		ProjectedLoc = UTIL_ProjectPointToNavmesh(NavProfile.NavMeshIndex, LeftLocation, NavProfile, Vector(ProjectWidth, ProjectWidth, 50.0f));
+		Segment.clear();
 
-		if (!vIsZero(ProjectedLoc) && !vPointOverlaps2D(ProjectedLoc, LiftReference->Edict->v.absmin, LiftReference->Edict->v.absmax))
+		for (int Node = (int)ToPoly; Node >= 0 && (unsigned int)Node != FromPoly; Node = TileParents[Node - RangeStart])
 		{
-			return ProjectedLoc;
+			Segment.push_back((unsigned int)Node);
 		}
 
-		ProjectedLoc = UTIL_ProjectPointToNavmesh(NavProfile.NavMeshIndex, RightLocation, NavProfile, Vector(ProjectWidth, ProjectWidth, 50.0f));
+		Corridor.insert(Corridor.end(), Segment.rbegin(), Segment.rend());
+	}
 
-		if (!vIsZero(ProjectedLoc) && !vPointOverlaps2D(ProjectedLoc, LiftReference->Edict->v.absmin, LiftReference->Edict->v.absmax))
+	// Reverse search parents already point towards the end poly
+	if (Corridor.size() < (size_t)MaxPath)
+	{
+		for (int Node = EndParents[Clusters->Portals[PortalRoute.back()] - EndRangeStart]; Node >= 0; Node = EndParents[Node - EndRangeStart])
 		{
-			return ProjectedLoc;
+			Corridor.push_back((unsigned int)Node);
 		}
+	}
 
+	const int NumPolys = dtMin((int)Corridor.size(), MaxPath);
 
-		return ZERO_VECTOR;
+	for (int i = 0; i < NumPolys; i++)
+	{
+		PolyPath[i] = Graph->PolyRefs[Corridor[i]];
 	}
 
-}
+	*nPathCount = NumPolys;
+	*Status = (NumPolys < (int)Corridor.size()) ? (DT_SUCCESS | DT_BUFFER_TOO_SMALL) : DT_SUCCESS;
 
-DynamicMapObject* UTIL_GetLiftReferenceByEdict(const edict_t* SearchEdict)
-{
-	if (FNullEnt(SearchEdict)) { return nullptr; }
+	if (NodesVisited) { *NodesVisited = Visited; }
 
-	for (auto it = DynamicMapObjects.begin(); it != DynamicMapObjects.end(); it++)
-	{
-		if (it->Edict == SearchEdict)
-		{			
-			return &(*it);
-		}
-	}
+	// Truncated corridors are skipped by the cache
+	NAV_CachePolyPath(NAV_MakePathCacheKey(NavProfile, StartPoly, EndPoly), *Status, PolyPath, NumPolys);
 
-	return nullptr;
+	return true;
 }
 
-NavOffMeshConnection UTIL_GetOffMeshConnectionForPlatform(const NavAgentProfile& NavProfile, DynamicMapObject* LiftRef)
+void NAV_ClearClusterGraphs()
 {
-	NavOffMeshConnection Result;
+	ClusterGraphs.clear();
+	ClusterGraphBuilds = 0;
+	ClusterPathSearches = 0;
+}
 
-	if (!LiftRef) { return Result; }
+void NAV_PrintNavStats()
+{
+	char StatsMsg[256];
 
-	NavOffMeshConnection* NearestConnection = nullptr;
-	float MinDist = 0.0f;
+	unsigned int TotalLookups = PathCacheHits + PathCacheMisses;
+	float HitRate = (TotalLookups > 0) ? ((float)PathCacheHits / (float)TotalLookups) * 100.0f : 0.0f;
 
-	nav_mesh ChosenNavMesh = NavMeshes[NavProfile.NavMeshIndex];
+	sprintf(StatsMsg, "Path cache: %d/%d entries, %u hits, %u misses (%.1f%% hit rate)\n", (int)PathCache.size(), MAX_PATH_CACHE_ENTRIES, PathCacheHits, PathCacheMisses, HitRate);
+	g_engfuncs.pfnServerPrint(StatsMsg);
 
-	for (auto it = ChosenNavMesh.MeshConnections.begin(); it != ChosenNavMesh.MeshConnections.end(); it++)
-	{
-		if (!(it->ConnectionFlags & NAV_FLAG_PLATFORM)) { continue; }
+	sprintf(StatsMsg, "Flow fields: %d/%d fields using %.1fKB, %u built, %u corridors read\n", (int)FlowFields.size(), MAX_FLOW_FIELDS, (float)FlowFieldMemory / 1024.0f, FlowFieldBuilds, FlowFieldHits);
+	g_engfuncs.pfnServerPrint(StatsMsg);
 
-		if (it->LinkedObject == LiftRef->Edict)
-		{
-			return (*it);
-		}
+	int NumLandmarkTables = 0;
+
+	for (auto it = Landmarks.begin(); it != Landmarks.end(); it++)
+	{
+		if (it->Table) { NumLandmarkTables++; }
 	}
 
-	return Result;
-}
+	sprintf(StatsMsg, "Landmarks: %d/%d tables ready, %u built\n", NumLandmarkTables, (int)Landmarks.size(), LandmarkTableBuilds);
+	g_engfuncs.pfnServerPrint(StatsMsg);
 
-bool UTIL_PointIsReachable(const NavAgentProfile &NavProfile, const Vector FromLocation, const Vector ToLocation, const float MaxAcceptableDistance)
-{
-	const dtNavMeshQuery* m_navQuery = UTIL_GetNavMeshQueryForProfile(NavProfile);
-	const dtNavMesh* m_navMesh = UTIL_GetNavMeshForProfile(NavProfile);
-	const dtQueryFilter* m_navFilter = &NavProfile.Filters;
+	sprintf(StatsMsg, "Cluster graphs: %d graphs, %u built, %u long paths planned\n", (int)ClusterGraphs.size(), ClusterGraphBuilds, ClusterPathSearches);
+	g_engfuncs.pfnServerPrint(StatsMsg);
 
-	if (!m_navQuery || vIsZero(FromLocation) || vIsZero(ToLocation))
-	{
-		return false;
-	}
+	sprintf(StatsMsg, "Tile cache: %d update steps in %.2fms last frame (budget %.2fms), %d tiles and %d requests pending\n", TileCacheStats.UpdateSteps, TileCacheStats.TimeSpent, (float)MAX_TILECACHE_UPDATE_TIME_US * 0.001f, TileCacheStats.PendingTiles, TileCacheStats.PendingRequests);
+	g_engfuncs.pfnServerPrint(StatsMsg);
 
-	float pStartPos[3] = { FromLocation.x, FromLocation.z, -FromLocation.y };
-	float pEndPos[3] = { ToLocation.x, ToLocation.z, -ToLocation.y };
+	sprintf(StatsMsg, "Tile cache: peak %d tiles pending, peak %.2fms in one frame, %u frames over budget\n", TileCacheStats.PeakPendingTiles, TileCacheStats.PeakTimeSpent, TileCacheStats.FramesOverBudget);
+	g_engfuncs.pfnServerPrint(StatsMsg);
+}
 
-	dtStatus status;
-	dtPolyRef StartPoly;
-	float StartNearest[3];
-	dtPolyRef EndPoly;
-	float EndNearest[3];
-	dtPolyRef PolyPath[MAX_PATH_POLY];
-	int nPathCount = 0;
+// Own random sequence so every benchmark run picks the same start and end points, and the game's rand() is left alone
+static unsigned int BenchmarkSeed = 1;
 
-	
+static float NAV_BenchmarkRand()
+{
+	BenchmarkSeed = BenchmarkSeed * 1103515245u + 12345u;
+	return (float)((BenchmarkSeed >> 8) & 0xFFFF) / 65535.0f;
+}
 
-	float searchExtents[3] = { MaxAcceptableDistance, 50.0f, MaxAcceptableDistance };
+void NAV_RunPathBenchmark(const int NumQueries)
+{
+	char BenchMsg[256];
 
-	if (NAV_IsPointInSwimArea(FromLocation) && NAV_IsPointInSwimArea(ToLocation))
-	{
-		if (UTIL_QuickHullTrace(nullptr, FromLocation, ToLocation)) { return true; }
-	}
+	const NavAgentProfile BaseProfile = GetBaseAgentProfile(NAV_PROFILE_DEFAULT);
+	dtNavMeshQuery* m_navQuery = NavMeshes[BaseProfile.NavMeshIndex].navQuery;
+	const dtQueryFilter* m_navFilter = &BaseProfile.Filters;
 
-	// find the start polygon
-	status = m_navQuery->findNearestPoly(pStartPos, searchExtents, m_navFilter, &StartPoly, StartNearest);
-	if ((status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK))
+	if (NumQueries <= 0)
 	{
-		return false; // couldn't find a polygon
+		g_engfuncs.pfnServerPrint("Path benchmark: number of queries must be at least 1\n");
+		return;
 	}
 
-	// find the end polygon
-	status = m_navQuery->findNearestPoly(pEndPos, searchExtents, m_navFilter, &EndPoly, EndNearest);
-	if ((status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK))
+	if (!m_navQuery)
 	{
-		return false; // couldn't find a polygon
+		g_engfuncs.pfnServerPrint("Path benchmark: no nav mesh loaded\n");
+		return;
 	}
 
-	status = m_navQuery->findPath(StartPoly, EndPoly, StartNearest, EndNearest, m_navFilter, PolyPath, &nPathCount, MAX_PATH_POLY);
+	BenchmarkSeed = 1;
 
-	if (nPathCount == 0)
+	std::vector<dtPolyRef> StartRefs(NumQueries);
+	std::vector<dtPolyRef> EndRefs(NumQueries);
+	std::vector<float> StartPoints(NumQueries * 3);
+	std::vector<float> EndPoints(NumQueries * 3);
+
+	// Pick all the points up front so only the searches themselves are timed
+	for (int i = 0; i < NumQueries; i++)
 	{
-		return false; // couldn't find a path
+		if (dtStatusFailed(m_navQuery->findRandomPoint(m_navFilter, NAV_BenchmarkRand, &StartRefs[i], &StartPoints[i * 3]))) { StartRefs[i] = 0; }
+		if (dtStatusFailed(m_navQuery->findRandomPoint(m_navFilter, NAV_BenchmarkRand, &EndRefs[i], &EndPoints[i * 3]))) { EndRefs[i] = 0; }
 	}
 
-	if (PolyPath[nPathCount - 1] != EndPoly)
+	dtPolyRef PolyPath[MAX_PATH_POLY];
+	int PathCount = 0;
+	int NumRun = 0;
+	int NumFound = 0;
+	double TotalNodes = 0.0;
+
+	auto BenchStart = chrono::steady_clock::now();
+
+	for (int i = 0; i < NumQueries; i++)
 	{
-		float epos[3];
-		dtVcopy(epos, EndNearest);
+		if (!StartRefs[i] || !EndRefs[i]) { continue; }
 
-		m_navQuery->closestPointOnPoly(PolyPath[nPathCount - 1], EndNearest, epos, 0);
+		dtStatus Status = m_navQuery->findPath(StartRefs[i], EndRefs[i], &StartPoints[i * 3], &EndPoints[i * 3], m_navFilter, PolyPath, &PathCount, MAX_PATH_POLY);
 
-		if (dtVdistSqr(EndNearest, epos) <= sqrf(MaxAcceptableDistance))
-		{
-			return true;
-		}
-		else
-		{
-			if (NAV_IsPointInSwimArea(epos) && NAV_IsPointInSwimArea(ToLocation))
-			{
-				return true;
-			}
-		}
+		NumRun++;
+		TotalNodes += m_navQuery->getNodePool()->getNodeCount();
 
+		if (dtStatusSucceed(Status) && !dtStatusDetail(Status, DT_PARTIAL_RESULT)) { NumFound++; }
 	}
 
-	return true;
+	double ElapsedMs = (double)chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - BenchStart).count() * 0.001;
+	double NodesPerSec = (ElapsedMs > 0.0) ? (TotalNodes / ElapsedMs) * 1000.0 : 0.0;
+
+	sprintf(BenchMsg, "Path benchmark: %d queries (%d complete) in %.2fms, %.0f nodes visited, %.0f nodes/sec, %.3fms per query\n", NumRun, NumFound, ElapsedMs, TotalNodes, NodesPerSec, (NumRun > 0) ? ElapsedMs / (double)NumRun : 0.0);
+	g_engfuncs.pfnServerPrint(BenchMsg);
 }
 
 bool HasBotReachedPathPoint(const AvHAIPlayer* pBot)
@@ -1942,7 +4602,7 @@ bool HasBotCompletedFallMove(const AvHAIPlayer* pBot, Vector MoveStart, Vector M
 
 		if (MoveDot > 0.0f)
 		{
-			if (UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, NextMoveDestination)
+			if (UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, NextMoveDestination, NAV_GetBotPolyHint(pBot, GetBaseAgentProfile(NAV_PROFILE_DEFAULT).NavMeshIndex))
 				&& UTIL_QuickTrace(pBot->Edict, pBot->Edict->v.origin, NextMoveDestination)
 				&& fabsf(pBot->CollisionHullBottomLocation.z - MoveEnd.z) < 100.0f) { return true; }
 		}
@@ -1969,7 +4629,7 @@ bool HasBotCompletedJumpMove(const AvHAIPlayer* pBot, Vector MoveStart, Vector M
 			Vector HullTraceEnd = MoveEnd;
 			HullTraceEnd.z = pBot->Edict->v.origin.z;
 
-			if (UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, NextMoveDestination)
+			if (UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, NextMoveDestination, NAV_GetBotPolyHint(pBot, GetBaseAgentProfile(NAV_PROFILE_DEFAULT).NavMeshIndex))
 				&& UTIL_QuickHullTrace(pBot->Edict, pBot->Edict->v.origin, HullTraceEnd, head_hull, false)
 				&& fabsf(pBot->CollisionHullBottomLocation.z - MoveEnd.z) < 100.0f)
 			{
@@ -2221,15 +4881,9 @@ DynamicMapObject* UTIL_GetObjectBlockingPathPoint(const Vector FromLocation, con
 		}
 		else
 		{
-			for (auto it = DynamicMapObjects.begin(); it != DynamicMapObjects.end(); it++)
-			{
-				if (it->Type == MAPOBJECT_PLATFORM || (IgnoreObject && it->Edict == IgnoreObject->Edict)) { continue; }
+			DynamicMapObject* BlockingObject = NAV_GetDynamicObjectIntersectingLine(FromLoc, TargetLoc, IgnoreObject);
 
-				if (vlineIntersectsAABB(FromLoc, TargetLoc, it->Edict->v.absmin, it->Edict->v.absmax))
-				{
-					return &(*it);
-				}
-			}
+			if (BlockingObject) { return BlockingObject; }
 		}
 
 		if (SearchObject != nullptr)
@@ -2241,15 +4895,9 @@ DynamicMapObject* UTIL_GetObjectBlockingPathPoint(const Vector FromLocation, con
 		}
 		else
 		{
-			for (auto it = DynamicMapObjects.begin(); it != DynamicMapObjects.end(); it++)
-			{
-				if (it->Type == MAPOBJECT_PLATFORM || (IgnoreObject && it->Edict == IgnoreObject->Edict)) { continue; }
+			DynamicMapObject* BlockingObject = NAV_GetDynamicObjectIntersectingLine(TargetLoc, ToLoc, IgnoreObject);
 
-				if (vlineIntersectsAABB(TargetLoc, ToLoc, it->Edict->v.absmin, it->Edict->v.absmax))
-				{
-					return &(*it);
-				}
-			}
+			if (BlockingObject) { return BlockingObject; }
 		}
 
 	}
@@ -2266,15 +4914,9 @@ DynamicMapObject* UTIL_GetObjectBlockingPathPoint(const Vector FromLocation, con
 		}
 		else
 		{
-			for (auto it = DynamicMapObjects.begin(); it != DynamicMapObjects.end(); it++)
-			{
-				if (it->Type == MAPOBJECT_PLATFORM || (IgnoreObject && it->Edict == IgnoreObject->Edict)) { continue; }
+			DynamicMapObject* BlockingObject = NAV_GetDynamicObjectIntersectingLine(FromLoc, TargetLoc, IgnoreObject);
 
-				if (vlineIntersectsAABB(FromLoc, TargetLoc, it->Edict->v.absmin, it->Edict->v.absmax))
-				{
-					return &(*it);
-				}
-			}
+			if (BlockingObject) { return BlockingObject; }
 		}
 
 		if (SearchObject != nullptr)
@@ -2286,15 +4928,9 @@ DynamicMapObject* UTIL_GetObjectBlockingPathPoint(const Vector FromLocation, con
 		}
 		else
 		{
-			for (auto it = DynamicMapObjects.begin(); it != DynamicMapObjects.end(); it++)
-			{
-				if (it->Type == MAPOBJECT_PLATFORM || (IgnoreObject && it->Edict == IgnoreObject->Edict)) { continue; }
+			DynamicMapObject* BlockingObject = NAV_GetDynamicObjectIntersectingLine(TargetLoc, ToLoc, IgnoreObject);
 
-				if (vlineIntersectsAABB(TargetLoc, ToLoc, it->Edict->v.absmin, it->Edict->v.absmax))
-				{
-					return &(*it);
-				}
-			}
+			if (BlockingObject) { return BlockingObject; }
 		}
 
 	}
@@ -2310,15 +4946,7 @@ DynamicMapObject* UTIL_GetObjectBlockingPathPoint(const Vector FromLocation, con
 	}
 	else
 	{
-		for (auto it = DynamicMapObjects.begin(); it != DynamicMapObjects.end(); it++)
-		{
-			if (it->Type == MAPOBJECT_PLATFORM || (IgnoreObject && it->Edict == IgnoreObject->Edict)) { continue; }
-
-			if (vlineIntersectsAABB(FromLoc, TargetLoc, it->Edict->v.absmin, it->Edict->v.absmax))
-			{
-				return &(*it);
-			}
-		}
+		return NAV_GetDynamicObjectIntersectingLine(FromLoc, TargetLoc, IgnoreObject);
 	}
 
 	return nullptr;
@@ -2415,7 +5043,7 @@ void CheckAndHandleBreakableObstruction(AvHAIPlayer* pBot, const Vector MoveFrom
 
 	edict_t* BlockingBreakableEdict = nullptr;
 
-	UTIL_TraceLine(pBot->Edict->v.origin, pBot->Edict->v.origin + (MoveDir * 100.0f), dont_ignore_monsters, dont_ignore_glass, pBot->Edict->v.pContainingEntity, &breakableHit);
+	UTIL_BrokeredTraceLine(pBot->Edict->v.origin, pBot->Edict->v.origin + (MoveDir * 100.0f), dont_ignore_monsters, dont_ignore_glass, pBot->Edict->v.pContainingEntity, &breakableHit);
 
 	if (!FNullEnt(breakableHit.pHit))
 	{
@@ -3500,8 +6128,10 @@ bool IsBotOffWalkNode(const AvHAIPlayer* pBot, Vector MoveStart, Vector MoveEnd,
 
 	if (vDist2DSq(pBot->Edict->v.origin, NearestPointOnLine) > sqrf(GetPlayerRadius(pBot->Edict) * 3.0f)) { return true; }
 
-	if (vEquals2D(NearestPointOnLine, MoveStart) && !UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveStart)) { return true; }
-	if (vEquals2D(NearestPointOnLine, MoveEnd) && !UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveEnd)) { return true; }
+	const dtPolyRef PolyHint = NAV_GetBotPolyHint(pBot, GetBaseAgentProfile(NAV_PROFILE_DEFAULT).NavMeshIndex);
+
+	if (vEquals2D(NearestPointOnLine, MoveStart) && !UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveStart, PolyHint)) { return true; }
+	if (vEquals2D(NearestPointOnLine, MoveEnd) && !UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveEnd, PolyHint)) { return true; }
 
 	return false;
 
@@ -3513,7 +6143,9 @@ bool IsBotOffFallNode(const AvHAIPlayer* pBot, Vector MoveStart, Vector MoveEnd,
 
 	Vector NearestPointOnLine = vClosestPointOnLine2D(MoveStart, MoveEnd, pBot->Edict->v.origin);
 
-	if (!UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveStart) && !UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveEnd)) { return true; }
+	const dtPolyRef PolyHint = NAV_GetBotPolyHint(pBot, GetBaseAgentProfile(NAV_PROFILE_DEFAULT).NavMeshIndex);
+
+	if (!UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveStart, PolyHint) && !UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveEnd, PolyHint)) { return true; }
 
 	return false;
 }
@@ -3564,11 +6196,11 @@ void MoveToWithoutNav(AvHAIPlayer* pBot, const Vector Destination)
 
 	TraceResult hit;
 
-	UTIL_TraceHull(stTrcLft, endTrcLft, ignore_monsters, head_hull, pBot->Edict->v.pContainingEntity, &hit);
+	UTIL_BrokeredTraceHull(stTrcLft, endTrcLft, ignore_monsters, head_hull, pBot->Edict->v.pContainingEntity, &hit);
 
 	const bool bumpLeft = (hit.flFraction < 1.0f || hit.fAllSolid > 0 || hit.fStartSolid > 0);
 
-	UTIL_TraceHull(stTrcRt, endTrcRt, ignore_monsters, head_hull, pBot->Edict->v.pContainingEntity, &hit);
+	UTIL_BrokeredTraceHull(stTrcRt, endTrcRt, ignore_monsters, head_hull, pBot->Edict->v.pContainingEntity, &hit);
 
 	const bool bumpRight = (hit.flFraction < 1.0f || hit.fAllSolid > 0 || hit.fStartSolid > 0);
 
@@ -3598,7 +6230,7 @@ void MoveToWithoutNav(AvHAIPlayer* pBot, const Vector Destination)
 
 		while (JumpHeight < MaxScaleHeight && !bFoundJumpHeight)
 		{
-			UTIL_TraceHull(StartTrace, EndTrace, ignore_monsters, head_hull, pBot->Edict->v.pContainingEntity, &JumpTestHit);
+			UTIL_BrokeredTraceHull(StartTrace, EndTrace, ignore_monsters, head_hull, pBot->Edict->v.pContainingEntity, &JumpTestHit);
 
 			if (JumpTestHit.flFraction >= 1.0f && !JumpTestHit.fAllSolid)
 			{
@@ -3682,7 +6314,7 @@ bool UTIL_PointIsDirectlyReachable(const AvHAIPlayer* pBot, const Vector targetP
 	int pathCount = 0;
 
 
-	dtStatus FoundStartPoly = m_navQuery->findNearestPoly(pStartPos, pReachableExtents, m_navFilter, &StartPoly, StartNearest);
+	dtStatus FoundStartPoly = NAV_FindNearestPolyWithHint(m_navQuery, NAV_GetBotPolyHint(pBot, pBot->BotNavInfo.NavProfile.NavMeshIndex), pStartPos, pReachableExtents, m_navFilter, &StartPoly, StartNearest);
 
 	if (!dtStatusSucceed(FoundStartPoly))
 	{
@@ -3739,7 +6371,7 @@ bool UTIL_PointIsDirectlyReachable(const AvHAIPlayer* pBot, const Vector start,
 	dtPolyRef PolyPath[MAX_PATH_POLY];
 	int pathCount = 0;
 
-	dtStatus FoundStartPoly = m_navQuery->findNearestPoly(pStartPos, pReachableExtents, m_navFilter, &StartPoly, StartNearest);
+	dtStatus FoundStartPoly = NAV_FindNearestPolyWithHint(m_navQuery, NAV_GetBotPolyHint(pBot, pBot->BotNavInfo.NavProfile.NavMeshIndex), pStartPos, pReachableExtents, m_navFilter, &StartPoly, StartNearest);
 
 	if (!dtStatusSucceed(FoundStartPoly))
 	{
@@ -3865,77 +6497,136 @@ bool UTIL_PointIsDirectlyReachable(const NavAgentProfile &NavProfile, const Vect
 	return (Height == 0.0f || Height == EndNearest[1]);
 }
 
-bool UTIL_TraceNav(const NavAgentProfile &NavProfile, const Vector start, const Vector target, const float MaxAcceptableDistance)
+bool UTIL_TraceNav(const NavAgentProfile &NavProfile, const Vector start, const Vector target, const float MaxAcceptableDistance, const dtPolyRef StartPolyHint)
+{
+	return UTIL_TraceNavMulti(NavProfile, start, &target, 1, MaxAcceptableDistance, nullptr, StartPolyHint);
+}
+
+// Decides whether a ray cast by UTIL_TraceNavMulti got close enough to the end poly to count as reaching it
+static bool NAV_TraceNavReachedEnd(const dtNavMeshQuery* m_navQuery, const dtRaycastHit& Hit, const dtPolyRef EndPoly, const float* EndNearest, const float MaxAcceptableDistance)
+{
+	if (!Hit.lastRef) { return false; }
+
+	if (Hit.t < 1.0f)
+	{
+		float epos[3];
+		dtVcopy(epos, EndNearest);
+
+		m_navQuery->closestPointOnPoly(Hit.lastRef, EndNearest, epos, 0);
+
+		return dtVdistSqr(EndNearest, epos) <= sqrf(MaxAcceptableDistance);
+	}
+
+	if (EndPoly == Hit.lastRef) { return true; }
+
+	float ClosestPoint[3] = { 0.0f, 0.0f, 0.0f };
+	float Height = 0.0f;
+	m_navQuery->closestPointOnPolyBoundary(Hit.lastRef, EndNearest, ClosestPoint);
+	m_navQuery->getPolyHeight(Hit.lastRef, ClosestPoint, &Height);
+
+	return (Height == 0.0f || Height == EndNearest[1]);
+}
+
+bool UTIL_TraceNavMulti(const NavAgentProfile& NavProfile, const Vector start, const Vector* Targets, const int NumTargets, const float MaxAcceptableDistance, bool* Results, const dtPolyRef StartPolyHint)
 {
 	const dtNavMeshQuery* m_navQuery = UTIL_GetNavMeshQueryForProfile(NavProfile);
-	const dtNavMesh* m_navMesh = UTIL_GetNavMeshForProfile(NavProfile);
 	const dtQueryFilter* m_Filter = &NavProfile.Filters;
 
-	if (!m_navQuery) { return false; }
+	if (Results)
+	{
+		for (int i = 0; i < NumTargets; i++) { Results[i] = false; }
+	}
+
+	if (!m_navQuery || NumTargets <= 0) { return false; }
 
 	float pStartPos[3] = { start.x, start.z, -start.y };
-	float pEndPos[3] = { target.x, target.z, -target.y };
 
 	dtPolyRef StartPoly;
-	dtPolyRef EndPoly;
 	float StartNearest[3] = { 0.0f, 0.0f, 0.0f };
-	float EndNearest[3] = { 0.0f, 0.0f, 0.0f };
-
-	float hitDist;
-	float HitNormal[3];
-
-	dtPolyRef PolyPath[MAX_PATH_POLY];
-	int pathCount = 0;
 
 	float MaxReachableExtents[3] = { MaxAcceptableDistance, 50.0f, MaxAcceptableDistance };
 
-	dtStatus FoundStartPoly = m_navQuery->findNearestPoly(pStartPos, MaxReachableExtents, m_Filter, &StartPoly, StartNearest);
+	dtStatus FoundStartPoly = NAV_FindNearestPolyWithHint(m_navQuery, StartPolyHint, pStartPos, MaxReachableExtents, m_Filter, &StartPoly, StartNearest);
 
 	if (!dtStatusSucceed(FoundStartPoly))
 	{
 		return false;
 	}
 
-	dtStatus FoundEndPoly = m_navQuery->findNearestPoly(pEndPos, MaxReachableExtents, m_Filter, &EndPoly, EndNearest);
+	bool bAllReached = true;
 
-	if (!dtStatusSucceed(FoundEndPoly))
+	// Work through the targets in batches so everything stays on the stack
+	for (int BatchStart = 0; BatchStart < NumTargets; BatchStart += MAX_TRACE_NAV_BATCH)
 	{
-		return false;
-	}
+		const int BatchSize = dtMin(NumTargets - BatchStart, MAX_TRACE_NAV_BATCH);
 
-	// All polys are convex, therefore definitely reachable if start and end points are within the same poly
-	if (StartPoly == EndPoly) { return true; }
+		float EndPositions[MAX_TRACE_NAV_BATCH * 3];
+		float EndNearest[MAX_TRACE_NAV_BATCH * 3];
+		dtPolyRef EndPolys[MAX_TRACE_NAV_BATCH];
 
-	m_navQuery->raycast(StartPoly, StartNearest, EndNearest, m_Filter, &hitDist, HitNormal, PolyPath, &pathCount, MAX_AI_PATH_SIZE);
+		for (int i = 0; i < BatchSize; i++)
+		{
+			const Vector& Target = Targets[BatchStart + i];
+
+			EndPositions[i * 3] = Target.x;
+			EndPositions[i * 3 + 1] = Target.z;
+			EndPositions[i * 3 + 2] = -Target.y;
+		}
+
+		if (!dtStatusSucceed(m_navQuery->findNearestPolys(EndPositions, BatchSize, MaxReachableExtents, m_Filter, EndPolys, EndNearest)))
+		{
+			bAllReached = false;
+			continue;
+		}
+
+		float RayEnds[MAX_TRACE_NAV_BATCH * 3];
+		int RayTargets[MAX_TRACE_NAV_BATCH];
+		dtRaycastHit Hits[MAX_TRACE_NAV_BATCH];
+		int NumRays = 0;
+
+		for (int i = 0; i < BatchSize; i++)
+		{
+			if (!EndPolys[i])
+			{
+				bAllReached = false;
+				continue;
+			}
 
-	if (hitDist < 1.0f)
-	{
-		if (pathCount == 0) { return false; }
+			// All polys are convex, therefore definitely reachable if start and end points are within the same poly
+			if (EndPolys[i] == StartPoly)
+			{
+				if (Results) { Results[BatchStart + i] = true; }
+				continue;
+			}
 
-		float epos[3];
-		dtVcopy(epos, EndNearest);
+			dtVcopy(&RayEnds[NumRays * 3], &EndNearest[i * 3]);
+			Hits[NumRays].path = nullptr;
+			Hits[NumRays].maxPath = 0;
+			RayTargets[NumRays] = i;
+			NumRays++;
+		}
 
-		m_navQuery->closestPointOnPoly(PolyPath[pathCount - 1], EndNearest, epos, 0);
+		if (NumRays == 0) { continue; }
 
-		if (dtVdistSqr(EndNearest, epos) > sqrf(MaxAcceptableDistance))
+		if (!dtStatusSucceed(m_navQuery->raycasts(StartPoly, StartNearest, RayEnds, NumRays, m_Filter, 0, Hits)))
 		{
-			return false;
+			bAllReached = false;
+			continue;
 		}
-		else
+
+		for (int r = 0; r < NumRays; r++)
 		{
-			return true;
-		}
-	}
+			const int i = RayTargets[r];
 
-	if (EndPoly == PolyPath[pathCount - 1]) { return true; }
+			bool bReached = NAV_TraceNavReachedEnd(m_navQuery, Hits[r], EndPolys[i], &EndNearest[i * 3], MaxAcceptableDistance);
 
-	float ClosestPoint[3] = { 0.0f, 0.0f, 0.0f };
-	float Height = 0.0f;
-	m_navQuery->closestPointOnPolyBoundary(PolyPath[pathCount - 1], EndNearest, ClosestPoint);
-	m_navQuery->getPolyHeight(PolyPath[pathCount - 1], ClosestPoint, &Height);
+			if (Results) { Results[BatchStart + i] = bReached; }
 
+			if (!bReached) { bAllReached = false; }
+		}
+	}
 
-	return (Height == 0.0f || Height == EndNearest[1]);
+	return bAllReached;
 }
 
 void UTIL_TraceNavLine(const NavAgentProfile &NavProfile, const Vector Start, const Vector End, nav_hitresult* HitResult)
@@ -4020,7 +6711,7 @@ void UTIL_TraceNavLine(const NavAgentProfile &NavProfile, const Vector Start, co
 	HitResult->TraceEndPoint = HitLocation;
 }
 
-bool UTIL_PointIsDirectlyReachable(const Vector start, const Vector target)
+bool UTIL_PointIsDirectlyReachable(const Vector start, const Vector target, const dtPolyRef StartPolyHint)
 {
 	const dtNavMeshQuery* m_navQuery = UTIL_GetNavMeshQueryForProfile(GetBaseAgentProfile(NAV_PROFILE_DEFAULT));
 	const dtNavMesh* m_navMesh = UTIL_GetNavMeshForProfile(GetBaseAgentProfile(NAV_PROFILE_DEFAULT));
@@ -4043,7 +6734,7 @@ bool UTIL_PointIsDirectlyReachable(const Vector start, const Vector target)
 	int pathCount = 0;
 
 
-	dtStatus FoundStartPoly = m_navQuery->findNearestPoly(pStartPos, pReachableExtents, m_Filter, &StartPoly, StartNearest);
+	dtStatus FoundStartPoly = NAV_FindNearestPolyWithHint(m_navQuery, StartPolyHint, pStartPos, pReachableExtents, m_Filter, &StartPoly, StartNearest);
 
 	if (!dtStatusSucceed(FoundStartPoly))
 	{
@@ -4317,12 +7008,99 @@ void UTIL_UpdateBotMovementStatus(AvHAIPlayer* pBot)
 		pBot->BotNavInfo.CurrentMoveType = pBot->Edict->v.movetype;
 	}
 
-	pBot->BotNavInfo.CurrentPoly = UTIL_GetNearestPolyRefForEntity(pBot->Edict);
+	NAV_UpdateBotCurrentPoly(pBot);
 
 	pBot->CollisionHullBottomLocation = GetPlayerBottomOfCollisionHull(pBot->Edict);
 	pBot->CollisionHullTopLocation = GetPlayerTopOfCollisionHull(pBot->Edict);
 }
 
+float NAV_GetPolyClearance(const NavAgentProfile& NavProfile, const dtPolyRef Poly)
+{
+	const dtNavMesh* m_navMesh = UTIL_GetNavMeshForProfile(NavProfile);
+
+	if (!m_navMesh || !Poly) { return 0.0f; }
+
+	return m_navMesh->getPolyClearance(Poly);
+}
+
+dtStatus NAV_FindNearestPolyWithHint(const dtNavMeshQuery* NavQuery, const dtPolyRef PolyHint, const float* Pos, const float* Extents, const dtQueryFilter* Filter, dtPolyRef* NearestRef, float* NearestPt)
+{
+	if (!NavQuery) { return DT_FAILURE | DT_INVALID_PARAM; }
+
+	if (PolyHint && NavQuery->isValidPolyRef(PolyHint, Filter))
+	{
+		float ClosestPoint[3];
+		bool bPosOverPoly = false;
+
+		if (dtStatusSucceed(NavQuery->closestPointOnPoly(PolyHint, Pos, ClosestPoint, &bPosOverPoly)) && bPosOverPoly && fabsf(ClosestPoint[1] - Pos[1]) <= dtMin(Extents[1], MAX_POLY_HINT_HEIGHT_DIFF))
+		{
+			*NearestRef = PolyHint;
+			dtVcopy(NearestPt, ClosestPoint);
+			return DT_SUCCESS;
+		}
+	}
+
+	return NavQuery->findNearestPoly(Pos, Extents, Filter, NearestRef, NearestPt);
+}
+
+dtPolyRef NAV_GetBotPolyHint(const AvHAIPlayer* pBot, const unsigned int NavMeshIndex)
+{
+	return (pBot->BotNavInfo.CurrentPolyMeshIndex == (int)NavMeshIndex) ? pBot->BotNavInfo.CurrentPoly : 0;
+}
+
+void NAV_UpdateBotCurrentPoly(AvHAIPlayer* pBot)
+{
+	nav_status* BotNavInfo = &pBot->BotNavInfo;
+
+	const dtNavMeshQuery* m_navQuery = UTIL_GetNavMeshQueryForProfile(BotNavInfo->NavProfile);
+	const dtQueryFilter* m_navFilter = &BotNavInfo->NavProfile.Filters;
+
+	if (!m_navQuery || vIsZero(pBot->CurrentFloorPosition))
+	{
+		BotNavInfo->CurrentPoly = 0;
+		return;
+	}
+
+	float NewPos[3] = { pBot->CurrentFloorPosition.x, pBot->CurrentFloorPosition.z, -pBot->CurrentFloorPosition.y };
+	float PolySearchExtents[3] = { 50.0f, 50.0f, 50.0f };
+
+	dtPolyRef PolyHint = 0;
+
+	// Walk from where we were last time to where we are now. Much cheaper than searching the tiles around us, and won't get confused by overlapping floors
+	if (BotNavInfo->CurrentPoly && BotNavInfo->CurrentPolyMeshIndex == (int)BotNavInfo->NavProfile.NavMeshIndex
+		&& vDist2DSq(BotNavInfo->CurrentPolyLocation, pBot->CurrentFloorPosition) < sqrf(MAX_POLY_TRACKING_MOVE_DIST)
+		&& m_navQuery->isValidPolyRef(BotNavInfo->CurrentPoly, m_navFilter))
+	{
+		float StartPos[3] = { BotNavInfo->CurrentPolyLocation.x, BotNavInfo->CurrentPolyLocation.z, -BotNavInfo->CurrentPolyLocation.y };
+		float ResultPos[3];
+		dtPolyRef Visited[MAX_POLY_TRACKING_VISITED];
+		int nVisited = 0;
+
+		dtStatus Result = m_navQuery->moveAlongSurface(BotNavInfo->CurrentPoly, StartPos, NewPos, m_navFilter, ResultPos, Visited, &nVisited, MAX_POLY_TRACKING_VISITED);
+
+		if (dtStatusSucceed(Result) && nVisited > 0)
+		{
+			PolyHint = Visited[nVisited - 1];
+		}
+	}
+
+	// If the walk didn't end up on the poly we're standing on (e.g. we fell off a ledge or got pushed through a gap) then this will do a proper search instead
+	dtPolyRef NewPoly = 0;
+	float NearestPoint[3] = { 0.0f, 0.0f, 0.0f };
+
+	dtStatus Result = NAV_FindNearestPolyWithHint(m_navQuery, PolyHint, NewPos, PolySearchExtents, m_navFilter, &NewPoly, NearestPoint);
+
+	if (dtStatusFailed(Result) || !NewPoly)
+	{
+		BotNavInfo->CurrentPoly = 0;
+		return;
+	}
+
+	BotNavInfo->CurrentPoly = NewPoly;
+	BotNavInfo->CurrentPolyLocation = Vector(NearestPoint[0], -NearestPoint[2], NearestPoint[1]);
+	BotNavInfo->CurrentPolyMeshIndex = BotNavInfo->NavProfile.NavMeshIndex;
+}
+
 
 bool AbortCurrentMove(AvHAIPlayer* pBot, const Vector NewDestination)
 {
@@ -4347,23 +7125,25 @@ bool AbortCurrentMove(AvHAIPlayer* pBot, const Vector NewDestination)
 
 	bool bReverseCourse = (vDist3DSq(DestinationPointOnLine, MoveFrom) < vDist3DSq(DestinationPointOnLine, MoveTo));
 
+	const dtPolyRef PolyHint = NAV_GetBotPolyHint(pBot, GetBaseAgentProfile(NAV_PROFILE_DEFAULT).NavMeshIndex);
+
 	if (flag == NAV_FLAG_PLATFORM)
 	{
 		if (bReverseCourse)
 		{
-			if (UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveFrom)) { return true; }
+			if (UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveFrom, PolyHint)) { return true; }
 			PlatformMove(pBot, MoveTo, MoveFrom, CurrentPathNode.Platform);
 		}
 		else
 		{
-			if (UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveTo)) { return true; }
+			if (UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveTo, PolyHint)) { return true; }
 			PlatformMove(pBot, MoveFrom, MoveTo, CurrentPathNode.Platform);
 		}
 	}
 
 	if (flag == NAV_FLAG_WALK)
 	{
-		if (UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveFrom) || UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveTo))
+		if (UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveFrom, PolyHint) || UTIL_PointIsDirectlyReachable(pBot->CurrentFloorPosition, MoveTo, PolyHint))
 		{
 			return true;
 		}
@@ -4514,7 +7294,10 @@ bool NAV_GenerateNewBasePath(AvHAIPlayer* pBot, const Vector NewDestination, con
 		Vector NavAdjustedDestination = AdjustPointForPathfinding(BotNavInfo->NavProfile.NavMeshIndex, NewDestination, BotNavInfo->NavProfile);
 		if (vIsZero(NavAdjustedDestination)) { return false; }
 
-		PathFindingStatus = FindPathClosestToPoint(pBot, BotNavInfo->MoveStyle, NavAdjustedDestination, PendingPath, MaxAcceptableDist);
+		PathFindingStatus = NAV_RequestBotPath(pBot, NavAdjustedDestination, PendingPath, MaxAcceptableDist);
+
+		// Path planner hasn't got to us yet, carry on as we are until it does
+		if (dtStatusInProgress(PathFindingStatus)) { return true; }
 	}
 
 	BotNavInfo->NextForceRecalc = 0.0f;
@@ -4800,7 +7583,12 @@ void NAV_ProgressMovementTask(AvHAIPlayer* pBot, AvHAIPlayerMoveTask& Task)
 	if (!vEquals(pBot->BotNavInfo.PathDestination, Task.TaskLocation, GetPlayerRadius(pBot->Edict)))
 	{
 		NAV_GeneratePathForTask(pBot, Task);
-		return;
+
+		// If we're still waiting on the new path, keep following the old one rather than standing around
+		if (!NAV_IsPathRequestPending(pBot) || pBot->BotNavInfo.CurrentPathPoint >= pBot->BotNavInfo.CurrentPath.size())
+		{
+			return;
+		}
 	}
 
 	if (pBot->Edict->v.flags & FL_INWATER)
@@ -4910,7 +7698,9 @@ bool NAV_GenerateNewMoveTaskPath(AvHAIPlayer* pBot, const Vector NewDestination,
 		Vector NavAdjustedDestination = AdjustPointForPathfinding(BotNavInfo->NavProfile.NavMeshIndex, NewDestination, BotNavInfo->NavProfile);
 		if (vIsZero(NavAdjustedDestination)) { return false; }
 
-		PathFindingStatus = FindPathClosestToPoint(pBot, BotNavInfo->MoveStyle, NavAdjustedDestination, PendingPath, 100.0f);
+		PathFindingStatus = NAV_RequestBotPath(pBot, NavAdjustedDestination, PendingPath, 100.0f);
+
+		if (dtStatusInProgress(PathFindingStatus)) { return true; }
 	}
 
 	if (dtStatusSucceed(PathFindingStatus))
@@ -5413,7 +8203,7 @@ bool BotIsAtLocation(const AvHAIPlayer* pBot, const Vector Destination)
 	return (vDist2DSq(pBot->Edict->v.origin, Destination) < sqrf(GetPlayerRadius(pBot->Edict)) && fabs(pBot->CurrentFloorPosition.z - Destination.z) <= GetPlayerHeight(pBot->Edict, false));
 }
 
-Vector UTIL_ProjectPointToNavmesh(const int NavmeshIndex, const Vector Location, const NavAgentProfile& NavProfile, const Vector Extents)
+Vector UTIL_ProjectPointToNavmesh(const int NavmeshIndex, const Vector Location, const NavAgentProfile& NavProfile, const Vector Extents, const dtPolyRef PolyHint)
 {
 	if (vIsZero(Location) || NavmeshIndex >= NUM_NAV_MESHES) { return ZERO_VECTOR; }
 
@@ -5432,7 +8222,7 @@ Vector UTIL_ProjectPointToNavmesh(const int NavmeshIndex, const Vector Location,
 	dtPolyRef FoundPoly;
 	float NavNearest[3];
 
-	dtStatus success = m_navQuery->findNearestPoly(pCheckLoc, Extents, m_navFilter, &FoundPoly, NavNearest);
+	dtStatus success = NAV_FindNearestPolyWithHint(m_navQuery, PolyHint, pCheckLoc, Extents, m_navFilter, &FoundPoly, NavNearest);
 
 	if (FoundPoly > 0 && dtStatusSucceed(success))
 	{
@@ -5560,15 +8350,21 @@ void HandlePlayerAvoidance(AvHAIPlayer* pBot, const Vector MoveDestination)
 					float TraceLength = OtherPersonDistFromLine + (fmaxf(MyRadius, OtherPlayerRadius) * 2.0f);
 
 
+					// Trace both avoidance directions together, they share the same start and nearby end points
+					Vector AvoidTargets[2] = { BotLocation + (PreferredMoveDir * TraceLength), BotLocation - (PreferredMoveDir * TraceLength) };
+					bool bCanAvoid[2];
+
+					UTIL_TraceNavMulti(pBot->BotNavInfo.NavProfile, BotLocation, AvoidTargets, 2, 0.0f, bCanAvoid);
+
 					// First see if we have enough room to move in our preferred avoidance direction
-					if (UTIL_TraceNav(pBot->BotNavInfo.NavProfile, BotLocation, BotLocation + (PreferredMoveDir * TraceLength), 0.0f))
+					if (bCanAvoid[0])
 					{
 						pBot->desiredMovementDir = PreferredMoveDir;
 						return;
 					}
 
 					// Then try the opposite direction
-					if (UTIL_TraceNav(pBot->BotNavInfo.NavProfile, BotLocation, BotLocation - (PreferredMoveDir * TraceLength), 0.0f))
+					if (bCanAvoid[1])
 					{
 						pBot->desiredMovementDir = -PreferredMoveDir;
 						return;
@@ -5595,7 +8391,8 @@ float UTIL_GetPathCostBetweenLocations(const NavAgentProfile &NavProfile , const
 	vector<bot_path_node> path;
 	path.clear();
 
-	dtStatus pathFindResult = FindPathClosestToPoint(NavProfile, FromLocation, ToLocation, path, max_ai_use_reach);
+	// Only an estimate, so a slightly longer path is fine
+	dtStatus pathFindResult = FindPathClosestToPoint(NavProfile, FromLocation, ToLocation, path, max_ai_use_reach, 0, NAV_SEARCH_FAST);
 
 	if (!dtStatusSucceed(pathFindResult)) { return 0.0f; }
 
@@ -5610,6 +8407,80 @@ float UTIL_GetPathCostBetweenLocations(const NavAgentProfile &NavProfile , const
 	return sqrtf(result);
 }
 
+void UTIL_GetPathCostsToLocations(const NavAgentProfile& NavProfile, const Vector FromLocation, const vector<Vector>& ToLocations, const vector<float>& MaxDistances, vector<float>& OutCosts)
+{
+	OutCosts.assign(ToLocations.size(), FLT_MAX);
+
+	const dtNavMeshQuery* m_navQuery = UTIL_GetNavMeshQueryForProfile(NavProfile);
+	const dtQueryFilter* m_navFilter = &NavProfile.Filters;
+
+	if (!m_navQuery || vIsZero(FromLocation) || ToLocations.size() == 0) { return; }
+
+	float pStartPos[3] = { FromLocation.x, FromLocation.z, -FromLocation.y };
+	float StartExtents[3] = { max_ai_use_reach, 50.0f, max_ai_use_reach };
+	float StartNearest[3];
+	dtPolyRef StartPoly = 0;
+
+	dtStatus status = m_navQuery->findNearestPoly(pStartPos, StartExtents, m_navFilter, &StartPoly, StartNearest);
+
+	if (dtStatusFailed(status) || !StartPoly) { return; }
+
+	int NumGoals = (int)ToLocations.size();
+
+	vector<dtPolyRef> GoalPolys(NumGoals, 0);
+	vector<float> GoalPositions(NumGoals * 3, 0.0f);
+
+	for (int i = 0; i < NumGoals; i++)
+	{
+		if (vIsZero(ToLocations[i])) { continue; }
+
+		float MaxDist = (i < (int)MaxDistances.size()) ? MaxDistances[i] : max_ai_use_reach;
+
+		float pEndPos[3] = { ToLocations[i].x, ToLocations[i].z, -ToLocations[i].y };
+		float EndExtents[3] = { MaxDist, 50.0f, MaxDist };
+
+		m_navQuery->findNearestPoly(pEndPos, EndExtents, m_navFilter, &GoalPolys[i], &GoalPositions[i * 3]);
+
+		// No point having the search look for somewhere the islands already know can't be reached
+		if (GoalPolys[i] && NAV_GetPolyReachability(NavProfile, StartPoly, GoalPolys[i]) == NAV_REACHABILITY_DISCONNECTED)
+		{
+			GoalPolys[i] = 0;
+		}
+	}
+
+	status = m_navQuery->findPathCostsToPolys(StartPoly, StartNearest, GoalPolys.data(), GoalPositions.data(), NumGoals, m_navFilter, FLT_MAX, OutCosts.data(), nullptr);
+
+	if (dtStatusFailed(status))
+	{
+		OutCosts.assign(ToLocations.size(), FLT_MAX);
+		return;
+	}
+
+	// The search ran out of nodes before it got to everything, so fall back to individual path queries for whatever's left
+	if (dtStatusDetail(status, DT_OUT_OF_NODES))
+	{
+		for (int i = 0; i < NumGoals; i++)
+		{
+			if (!GoalPolys[i] || OutCosts[i] != FLT_MAX) { continue; }
+
+			float MaxDist = (i < (int)MaxDistances.size()) ? MaxDistances[i] : max_ai_use_reach;
+
+			vector<bot_path_node> CheckPath;
+
+			if (!dtStatusSucceed(FindPathClosestToPoint(NavProfile, FromLocation, ToLocations[i], CheckPath, MaxDist, 0, NAV_SEARCH_FAST))) { continue; }
+
+			float PathCost = 0.0f;
+
+			for (auto it = CheckPath.begin(); it != CheckPath.end(); it++)
+			{
+				PathCost += vDist3D(it->FromLocation, it->Location) * NavProfile.Filters.getAreaCost(it->area);
+			}
+
+			OutCosts[i] = PathCost;
+		}
+	}
+}
+
 void ClearBotMovement(AvHAIPlayer* pBot)
 {
 	pBot->BotNavInfo.TargetDestination = ZERO_VECTOR;
@@ -5671,7 +8542,7 @@ float UTIL_FindZHeightForWallClimb(const Vector ClimbStart, const Vector ClimbEn
 
 	Vector StartTrace = ClimbEnd;
 
-	UTIL_TraceLine(ClimbEnd, ClimbEnd - Vector(0.0f, 0.0f, 50.0f), ignore_monsters, nullptr, &hit);
+	UTIL_BrokeredTraceLine(ClimbEnd, ClimbEnd - Vector(0.0f, 0.0f, 50.0f), ignore_monsters, nullptr, &hit);
 
 	if (hit.fAllSolid || hit.fStartSolid || hit.flFraction < 1.0f)
 	{
@@ -5683,7 +8554,7 @@ float UTIL_FindZHeightForWallClimb(const Vector ClimbStart, const Vector ClimbEn
 
 	Vector CurrTraceStart = StartTrace;
 
-	UTIL_TraceHull(StartTrace, EndTrace, ignore_monsters, HullNum, nullptr, &hit);
+	UTIL_BrokeredTraceHull(StartTrace, EndTrace, ignore_monsters, HullNum, nullptr, &hit);
 
 	if (hit.flFraction >= 1.0f && !hit.fAllSolid && !hit.fStartSolid)
 	{
@@ -5698,7 +8569,7 @@ float UTIL_FindZHeightForWallClimb(const Vector ClimbStart, const Vector ClimbEn
 		{
 			CurrTraceStart.z += 1.0f;
 			EndTrace.z = CurrTraceStart.z;
-			UTIL_TraceHull(CurrTraceStart, EndTrace, ignore_monsters, HullNum, nullptr, &hit);
+			UTIL_BrokeredTraceHull(CurrTraceStart, EndTrace, ignore_monsters, HullNum, nullptr, &hit);
 			testCount++;
 		}
 
@@ -5728,6 +8599,10 @@ void ClearBotPath(AvHAIPlayer* pBot)
 	pBot->BotNavInfo.PathDestination = ZERO_VECTOR;
 
 	pBot->BotNavInfo.MovementTasks.clear();
+
+	// Anything still queued will be thrown away when it finishes, as the request is no longer pending
+	pBot->BotNavInfo.PathRequestStatus = PATH_REQUEST_NONE;
+	pBot->BotNavInfo.PendingPath.clear();
 }
 
 void ClearBotStuckMovement(AvHAIPlayer* pBot)
@@ -5986,7 +8861,7 @@ Vector UTIL_GetButtonFloorLocation(const NavAgentProfile& NavProfile, const Vect
 
 		TraceResult Hit;
 
-		UTIL_TraceHull(UserLocation, NearestTriggerPoint, ignore_monsters, head_hull, nullptr, &Hit);
+		UTIL_BrokeredTraceHull(UserLocation, NearestTriggerPoint, ignore_monsters, head_hull, nullptr, &Hit);
 
 		if (Hit.fInWater)
 		{
@@ -6208,6 +9083,8 @@ void NAV_ClearDynamicMapData(bool bOnMapLoad)
 	}
 
 	DynamicMapObjects.clear();
+	bDynamicObjectIndexDirty = true;
+	NAV_ResetDynamicObjectSnapshot();
 	MapObjectPrototypes.clear();
 }
 
@@ -6283,15 +9160,161 @@ DynamicMapObject* UTIL_GetDynamicObjectByEdict(const edict_t* SearchEdict)
 {
 	if (FNullEnt(SearchEdict)) { return nullptr; }
 
-	for (auto it = DynamicMapObjects.begin(); it != DynamicMapObjects.end(); it++)
+	if (bDynamicObjectIndexDirty) { NAV_RebuildDynamicObjectIndex(); }
+
+	int EdictIndex = ENTINDEX((edict_t*)SearchEdict);
+
+	if (EdictIndex < 0 || EdictIndex >= (int)DynamicObjectEdictLookup.size()) { return nullptr; }
+
+	int ObjectIndex = DynamicObjectEdictLookup[EdictIndex];
+
+	return (ObjectIndex >= 0) ? &DynamicMapObjects[ObjectIndex] : nullptr;
+}
+
+void NAV_RebuildDynamicObjectIndex()
+{
+	bDynamicObjectIndexDirty = false;
+
+	DynamicObjectEdictLookup.assign(imaxi(gpGlobals->maxEntities, 1), -1);
+	DynamicObjectGrid.assign(DYNAMIC_OBJECT_GRID_SIZE * DYNAMIC_OBJECT_GRID_SIZE, vector<int>());
+	DynamicObjectQueryStamps.assign(DynamicMapObjects.size(), 0);
+	DynamicObjectQueryStamp = 0;
+
+	const float GridOrigin = -(DYNAMIC_OBJECT_GRID_SIZE * DYNAMIC_OBJECT_GRID_CELL_SIZE * 0.5f);
+
+	for (int i = 0; i < (int)DynamicMapObjects.size(); i++)
 	{
-		if (it->Edict == SearchEdict)
+		DynamicMapObject* ThisObject = &DynamicMapObjects[i];
+
+		if (FNullEnt(ThisObject->Edict)) { continue; }
+
+		int EdictIndex = ENTINDEX(ThisObject->Edict);
+
+		// If two objects share an edict then the first one wins, same as the old linear search
+		if (EdictIndex >= 0 && EdictIndex < (int)DynamicObjectEdictLookup.size() && DynamicObjectEdictLookup[EdictIndex] < 0)
+		{
+			DynamicObjectEdictLookup[EdictIndex] = i;
+		}
+
+		// Swept bounds only ever grow, so an object which moved outside them last time stays covered
+		bool bHasSweptBounds = (ThisObject->SweptMins != ThisObject->SweptMaxs);
+
+		Vector SweptMins = ThisObject->Edict->v.absmin;
+		Vector SweptMaxs = ThisObject->Edict->v.absmax;
+
+		if (bHasSweptBounds)
+		{
+			SweptMins = Vector(fminf(SweptMins.x, ThisObject->SweptMins.x), fminf(SweptMins.y, ThisObject->SweptMins.y), fminf(SweptMins.z, ThisObject->SweptMins.z));
+			SweptMaxs = Vector(fmaxf(SweptMaxs.x, ThisObject->SweptMaxs.x), fmaxf(SweptMaxs.y, ThisObject->SweptMaxs.y), fmaxf(SweptMaxs.z, ThisObject->SweptMaxs.z));
+		}
+
+		// Stop locations are where the centre of the object ends up
+		Vector HalfSize = ThisObject->Edict->v.size * 0.5f;
+
+		for (auto stopIt = ThisObject->StopPoints.begin(); stopIt != ThisObject->StopPoints.end(); stopIt++)
+		{
+			Vector StopMins = stopIt->StopLocation - HalfSize;
+			Vector StopMaxs = stopIt->StopLocation + HalfSize;
+
+			SweptMins = Vector(fminf(SweptMins.x, StopMins.x), fminf(SweptMins.y, StopMins.y), fminf(SweptMins.z, StopMins.z));
+			SweptMaxs = Vector(fmaxf(SweptMaxs.x, StopMaxs.x), fmaxf(SweptMaxs.y, StopMaxs.y), fmaxf(SweptMaxs.z, StopMaxs.z));
+		}
+
+		ThisObject->SweptMins = SweptMins;
+		ThisObject->SweptMaxs = SweptMaxs;
+
+		int MinCellX = dtClamp((int)floorf((SweptMins.x - GridOrigin) / DYNAMIC_OBJECT_GRID_CELL_SIZE), 0, DYNAMIC_OBJECT_GRID_SIZE - 1);
+		int MinCellY = dtClamp((int)floorf((SweptMins.y - GridOrigin) / DYNAMIC_OBJECT_GRID_CELL_SIZE), 0, DYNAMIC_OBJECT_GRID_SIZE - 1);
+		int MaxCellX = dtClamp((int)floorf((SweptMaxs.x - GridOrigin) / DYNAMIC_OBJECT_GRID_CELL_SIZE), 0, DYNAMIC_OBJECT_GRID_SIZE - 1);
+		int MaxCellY = dtClamp((int)floorf((SweptMaxs.y - GridOrigin) / DYNAMIC_OBJECT_GRID_CELL_SIZE), 0, DYNAMIC_OBJECT_GRID_SIZE - 1);
+
+		for (int y = MinCellY; y <= MaxCellY; y++)
 		{
-			return &(*it);
+			for (int x = MinCellX; x <= MaxCellX; x++)
+			{
+				DynamicObjectGrid[(y * DYNAMIC_OBJECT_GRID_SIZE) + x].push_back(i);
+			}
 		}
 	}
+}
 
-	return nullptr;
+void NAV_GetDynamicObjectsInBounds(const Vector MinBounds, const Vector MaxBounds, vector<int>& Results)
+{
+	Results.clear();
+
+	if (bDynamicObjectIndexDirty) { NAV_RebuildDynamicObjectIndex(); }
+
+	if (DynamicMapObjects.size() == 0) { return; }
+
+	const float GridOrigin = -(DYNAMIC_OBJECT_GRID_SIZE * DYNAMIC_OBJECT_GRID_CELL_SIZE * 0.5f);
+
+	int MinCellX = dtClamp((int)floorf((MinBounds.x - GridOrigin) / DYNAMIC_OBJECT_GRID_CELL_SIZE), 0, DYNAMIC_OBJECT_GRID_SIZE - 1);
+	int MinCellY = dtClamp((int)floorf((MinBounds.y - GridOrigin) / DYNAMIC_OBJECT_GRID_CELL_SIZE), 0, DYNAMIC_OBJECT_GRID_SIZE - 1);
+	int MaxCellX = dtClamp((int)floorf((MaxBounds.x - GridOrigin) / DYNAMIC_OBJECT_GRID_CELL_SIZE), 0, DYNAMIC_OBJECT_GRID_SIZE - 1);
+	int MaxCellY = dtClamp((int)floorf((MaxBounds.y - GridOrigin) / DYNAMIC_OBJECT_GRID_CELL_SIZE), 0, DYNAMIC_OBJECT_GRID_SIZE - 1);
+
+	DynamicObjectQueryStamp++;
+
+	// Wrapped around, clear out the old stamps so nothing gets skipped by mistake
+	if (DynamicObjectQueryStamp == 0)
+	{
+		DynamicObjectQueryStamps.assign(DynamicMapObjects.size(), 0);
+		DynamicObjectQueryStamp = 1;
+	}
+
+	for (int y = MinCellY; y <= MaxCellY; y++)
+	{
+		for (int x = MinCellX; x <= MaxCellX; x++)
+		{
+			const vector<int>& Cell = DynamicObjectGrid[(y * DYNAMIC_OBJECT_GRID_SIZE) + x];
+
+			for (auto it = Cell.begin(); it != Cell.end(); it++)
+			{
+				if (DynamicObjectQueryStamps[*it] == DynamicObjectQueryStamp) { continue; }
+
+				DynamicObjectQueryStamps[*it] = DynamicObjectQueryStamp;
+
+				const DynamicMapObject* ThisObject = &DynamicMapObjects[*it];
+
+				if (ThisObject->SweptMaxs.x < MinBounds.x || ThisObject->SweptMins.x > MaxBounds.x
+					|| ThisObject->SweptMaxs.y < MinBounds.y || ThisObject->SweptMins.y > MaxBounds.y
+					|| ThisObject->SweptMaxs.z < MinBounds.z || ThisObject->SweptMins.z > MaxBounds.z)
+				{
+					continue;
+				}
+
+				Results.push_back(*it);
+			}
+		}
+	}
+}
+
+DynamicMapObject* NAV_GetDynamicObjectIntersectingLine(const Vector LineStart, const Vector LineEnd, DynamicMapObject* IgnoreObject)
+{
+	Vector MinBounds = Vector(fminf(LineStart.x, LineEnd.x), fminf(LineStart.y, LineEnd.y), fminf(LineStart.z, LineEnd.z));
+	Vector MaxBounds = Vector(fmaxf(LineStart.x, LineEnd.x), fmaxf(LineStart.y, LineEnd.y), fmaxf(LineStart.z, LineEnd.z));
+
+	vector<int> NearbyObjects;
+	NAV_GetDynamicObjectsInBounds(MinBounds, MaxBounds, NearbyObjects);
+
+	// Candidates come back in grid order, but callers expect the first blocking object in DynamicMapObjects like the old linear search
+	int FirstHit = -1;
+
+	for (auto it = NearbyObjects.begin(); it != NearbyObjects.end(); it++)
+	{
+		if (FirstHit >= 0 && *it > FirstHit) { continue; }
+
+		DynamicMapObject* ThisObject = &DynamicMapObjects[*it];
+
+		if (FNullEnt(ThisObject->Edict) || ThisObject->Type == MAPOBJECT_PLATFORM || (IgnoreObject && ThisObject->Edict == IgnoreObject->Edict)) { continue; }
+
+		if (vlineIntersectsAABB(LineStart, LineEnd, ThisObject->Edict->v.absmin, ThisObject->Edict->v.absmax))
+		{
+			FirstHit = *it;
+		}
+	}
+
+	return (FirstHit >= 0) ? &DynamicMapObjects[FirstHit] : nullptr;
 }
 
 // TODO: Find the topmost point when open, and topmost point when closed, and see how closely they align to the top and bottom point parameters
@@ -6301,10 +9324,21 @@ DynamicMapObject* UTIL_GetClosestPlatformToPoints(const Vector StartPoint, const
 
 	float minDist = 0.0f;
 
+	if (bDynamicObjectIndexDirty) { NAV_RebuildDynamicObjectIndex(); }
+
 	for (auto it = DynamicMapObjects.begin(); it != DynamicMapObjects.end(); it++)
 	{
 		if (it->Type != MAPOBJECT_DOOR && it->Type != MAPOBJECT_PLATFORM) { continue; }
 
+		// The object is inside its swept bounds at every stop point, so it can't score better than the distance to them. Skip the expensive checks if that's already worse than the best
+		if (Result)
+		{
+			float BoundsDistStart = vDist3D(StartPoint, vClosestPointOnAABB(StartPoint, it->SweptMins, it->SweptMaxs));
+			float BoundsDistEnd = vDist3D(EndPoint, vClosestPointOnAABB(EndPoint, it->SweptMins, it->SweptMaxs));
+
+			if (fminf(BoundsDistStart, BoundsDistEnd) > minDist) { continue; }
+		}
+
 		float distTopPoint = FLT_MAX;
 		float distBottomPoint = FLT_MAX;
 
@@ -6549,7 +9583,7 @@ void NAV_AddMoveMovementTask(AvHAIPlayer* pBot, Vector MoveLocation, DynamicMapO
 	NewTask.TaskLocation = MoveLocation;
 
 	vector<bot_path_node> Path;
-	dtStatus PathStatus = FindPathClosestToPoint(pBot->BotNavInfo.NavProfile, pBot->CurrentFloorPosition, MoveLocation, Path, 200.0f);
+	dtStatus PathStatus = FindPathClosestToPoint(pBot->BotNavInfo.NavProfile, pBot->CurrentFloorPosition, MoveLocation, Path, 200.0f, NAV_GetBotPolyHint(pBot, pBot->BotNavInfo.NavProfile.NavMeshIndex));
 
 	if (dtStatusSucceed(PathStatus) && Path.size() > 0)
 	{
@@ -6570,7 +9604,7 @@ void NAV_AddTouchMovementTask(AvHAIPlayer* pBot, edict_t* EntityToTouch, Dynamic
 	NewTask.TriggerToActivate = TriggerToActivate->Edict;
 
 	vector<bot_path_node> Path;
-	dtStatus PathStatus = FindPathClosestToPoint(pBot->BotNavInfo.NavProfile, pBot->CurrentFloorPosition, UTIL_GetCentreOfEntity(EntityToTouch), Path, 200.0f);
+	dtStatus PathStatus = FindPathClosestToPoint(pBot->BotNavInfo.NavProfile, pBot->CurrentFloorPosition, UTIL_GetCentreOfEntity(EntityToTouch), Path, 200.0f, NAV_GetBotPolyHint(pBot, pBot->BotNavInfo.NavProfile.NavMeshIndex));
 
 	if (dtStatusSucceed(PathStatus) && Path.size() > 0)
 	{
@@ -6743,6 +9777,7 @@ void NAV_ClearCachedMapData()
 {
 	MapObjectPrototypes.clear();
 	DynamicMapObjects.clear();
+	bDynamicObjectIndexDirty = true;
 }
 
 void NAV_AddDynamicMapObject(DynamicMapPrototype* Prototype)
@@ -6896,6 +9931,7 @@ void NAV_AddDynamicMapObject(DynamicMapPrototype* Prototype)
 	}
 
 	DynamicMapObjects.push_back(NewObject);
+	bDynamicObjectIndexDirty = true;
 }
 
 void NAV_PopulateDynamicMapObjects()
@@ -7067,6 +10103,7 @@ void NAV_SetDynamicObjectStatus(DynamicMapObject* Object, DynamicMapObjectState
 	if (NewState == Object->State) { return; }
 
 	Object->State = NewState;
+	DynamicObjectChangeCount++;
 
 	if (NewState == OBJECTSTATE_MOVING)
 	{		
@@ -7079,234 +10116,376 @@ void NAV_SetDynamicObjectStatus(DynamicMapObject* Object, DynamicMapObjectState
 	}
 }
 
+void NAV_SetDynamicObjectType(DynamicMapObject* Object, DynamicMapObjectType NewType)
+{
+	if (NewType == Object->Type) { return; }
+
+	Object->Type = NewType;
+	DynamicObjectChangeCount++;
+}
+
+void NAV_SetDynamicObjectActive(DynamicMapObject* Object, const bool bActive)
+{
+	if (bActive == Object->bIsActive) { return; }
+
+	Object->bIsActive = bActive;
+	DynamicObjectChangeCount++;
+}
+
 void NAV_UpdateDynamicMapObjects()
 {
-	for (auto it = DynamicMapObjects.begin(); it != DynamicMapObjects.end();)
+	// Anything which has moved outside the bounds it was indexed with needs re-indexing, or spatial queries could miss it
+	for (auto it = DynamicMapObjects.begin(); it != DynamicMapObjects.end() && !bDynamicObjectIndexDirty; it++)
 	{
-		DynamicMapObject* ThisObject = &(*it);
+		if (FNullEnt(it->Edict)) { continue; }
 
-		if (ThisObject->Type == MAPOBJECT_STATIC)
+		const Vector& AbsMin = it->Edict->v.absmin;
+		const Vector& AbsMax = it->Edict->v.absmax;
+
+		if (AbsMin.x < it->SweptMins.x || AbsMin.y < it->SweptMins.y || AbsMin.z < it->SweptMins.z
+			|| AbsMax.x > it->SweptMaxs.x || AbsMax.y > it->SweptMaxs.y || AbsMax.z > it->SweptMaxs.z)
 		{
-			if (ThisObject->State != OBJECTSTATE_IDLE)
-			{
-				if (ThisObject->Edict->v.velocity.Length() <= 0.0f)
-				{
-					NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_IDLE);
-				}
-			}
+			bDynamicObjectIndexDirty = true;
+		}
+	}
+
+	// Added or removed outside of this function (e.g. map load), so everything needs a full check
+	if (DynamicObjectSnapshot.Edicts.size() != DynamicMapObjects.size())
+	{
+		NAV_ResetDynamicObjectSnapshot();
+	}
+
+	NAV_DiffDynamicObjectSnapshot();
 
+	size_t ObjectIndex = 0;
+
+	for (auto it = DynamicMapObjects.begin(); it != DynamicMapObjects.end();)
+	{
+		if (!DynamicObjectSnapshot.NeedsUpdate[ObjectIndex])
+		{
 			it++;
+			ObjectIndex++;
 			continue;
 		}
 
-		if ((ThisObject->Type == TRIGGER_BREAK && ThisObject->Edict->v.health <= 0))
+		if (!NAV_UpdateDynamicMapObject(&(*it)))
 		{
-			NAV_OnTriggerActivated(ThisObject);
-
 			it = DynamicMapObjects.erase(it);
+			NAV_EraseDynamicObjectSnapshot(ObjectIndex);
+			bDynamicObjectIndexDirty = true;
+			DynamicObjectChangeCount++;
 			continue;
 		}
 
-		if (FNullEnt(ThisObject->Edict) || ThisObject->Edict->v.deadflag != DEAD_NO)
+		DynamicObjectSnapshot.SeenChangeCounts[ObjectIndex] = DynamicObjectChangeCount;
+		DynamicObjectSnapshot.NextIdleCheckTimes[ObjectIndex] = gpGlobals->time + DYNAMIC_OBJECT_IDLE_CHECK_INTERVAL;
+
+		it++;
+		ObjectIndex++;
+	}
+}
+
+bool NAV_UpdateDynamicMapObject(DynamicMapObject* ThisObject)
+{
+	if (ThisObject->Type == MAPOBJECT_STATIC)
+	{
+		if (ThisObject->State != OBJECTSTATE_IDLE)
 		{
-			it = DynamicMapObjects.erase(it);
-			continue;
+			if (ThisObject->Edict->v.velocity.Length() <= 0.0f)
+			{
+				NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_IDLE);
+			}
 		}
 
-		if (ThisObject->Type == TRIGGER_MULTISOURCE)
+		return true;
+	}
+
+	if ((ThisObject->Type == TRIGGER_BREAK && ThisObject->Edict->v.health <= 0))
+	{
+		NAV_OnTriggerActivated(ThisObject);
+
+		return false;
+	}
+
+	if (FNullEnt(ThisObject->Edict) || ThisObject->Edict->v.deadflag != DEAD_NO)
+	{
+		return false;
+	}
+
+	if (ThisObject->Type == TRIGGER_MULTISOURCE)
+	{
+		NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_PREPARING);
+
+		bool bAllTriggersActive = true;
+
+		for (auto triggerIt = ThisObject->Triggers.begin(); triggerIt != ThisObject->Triggers.end(); triggerIt++)
 		{
-			ThisObject->bIsActive = true;
-			NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_PREPARING);
+			DynamicMapObject* ThisTrigger = UTIL_GetDynamicObjectByEdict((*triggerIt));
 
-			for (auto triggerIt = ThisObject->Triggers.begin(); triggerIt != ThisObject->Triggers.end(); triggerIt++)
+			if (ThisTrigger && (!ThisTrigger->bIsActive || ThisTrigger->State == OBJECTSTATE_IDLE))
 			{
-				DynamicMapObject* ThisTrigger = UTIL_GetDynamicObjectByEdict((*triggerIt));
-
-				if (ThisTrigger && (!ThisTrigger->bIsActive || ThisTrigger->State == OBJECTSTATE_IDLE))
-				{
-					ThisObject->bIsActive = false;
-					break;
-				}
+				bAllTriggersActive = false;
+				break;
 			}
-
-			it++;
-			continue;
 		}
 
-		if (!FNullEnt(ThisObject->Master))
-		{
-			DynamicMapObject* Master = UTIL_GetDynamicObjectByEdict(ThisObject->Master);
+		NAV_SetDynamicObjectActive(ThisObject, bAllTriggersActive);
 
-			if (Master)
-			{
-				ThisObject->bIsActive = Master->bIsActive;
-			}
-			else
-			{
-				ThisObject->bIsActive = true;
-			}
+		return true;
+	}
+
+	if (!FNullEnt(ThisObject->Master))
+	{
+		DynamicMapObject* Master = UTIL_GetDynamicObjectByEdict(ThisObject->Master);
+
+		if (Master)
+		{
+			NAV_SetDynamicObjectActive(ThisObject, Master->bIsActive);
 		}
 		else
 		{
-			if (ThisObject->Type != TRIGGER_ENV)
-			{
-				ThisObject->bIsActive = true;
-			}
+			NAV_SetDynamicObjectActive(ThisObject, true);
 		}
-
-		if (ThisObject->Type == TRIGGER_ENV || ThisObject->Type == TRIGGER_MULTISOURCE || ThisObject->Type == TRIGGER_NONE)
+	}
+	else
+	{
+		if (ThisObject->Type != TRIGGER_ENV)
 		{
-			NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_PREPARING);
-			it++;
-			continue;
+			NAV_SetDynamicObjectActive(ThisObject, true);
 		}
+	}
 
-		if (ThisObject->State == OBJECTSTATE_IDLE && ThisObject->Edict->v.nextthink > 0.0f)
-		{
-			NAV_OnTriggerActivated(ThisObject);
-			it++;
-			continue;
-		}
+	if (ThisObject->Type == TRIGGER_ENV || ThisObject->Type == TRIGGER_MULTISOURCE || ThisObject->Type == TRIGGER_NONE)
+	{
+		NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_PREPARING);
+		return true;
+	}
+
+	if (ThisObject->State == OBJECTSTATE_IDLE && ThisObject->Edict->v.nextthink > 0.0f)
+	{
+		NAV_OnTriggerActivated(ThisObject);
+		return true;
+	}
 
-		Vector ObjectCentre = UTIL_GetCentreOfEntity(ThisObject->Edict);
+	Vector ObjectCentre = UTIL_GetCentreOfEntity(ThisObject->Edict);
 
-		if (ThisObject->Edict->v.velocity.Length() > 0.0f)
+	if (ThisObject->Edict->v.velocity.Length() > 0.0f)
+	{
+		NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_MOVING);
+
+		if (ThisObject->StopPoints.size() > 0)
 		{
-			NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_MOVING);
+			DynamicMapObjectStop NextStop = ThisObject->StopPoints[ThisObject->NextStopIndex];
 
-			if (ThisObject->StopPoints.size() > 0)
+			// This object is not going to stop at the next point at all, so we need to check if we've reached it
+			if (!NextStop.bWaitForRetrigger && NextStop.WaitTime == 0.0f)
 			{
-				DynamicMapObjectStop NextStop = ThisObject->StopPoints[ThisObject->NextStopIndex];
-
-				// This object is not going to stop at the next point at all, so we need to check if we've reached it
-				if (!NextStop.bWaitForRetrigger && NextStop.WaitTime == 0.0f)
+				if (vEquals(ObjectCentre, NextStop.StopLocation, 5.0f))
 				{
-					if (vEquals(ObjectCentre, NextStop.StopLocation, 5.0f))
-					{
-						ThisObject->NextStopIndex++;
+					ThisObject->NextStopIndex++;
 
-						if (ThisObject->NextStopIndex >= ThisObject->StopPoints.size())
-						{
-							ThisObject->NextStopIndex = 0;
-						}
+					if (ThisObject->NextStopIndex >= ThisObject->StopPoints.size())
+					{
+						ThisObject->NextStopIndex = 0;
 					}
 				}
 			}
-
-			it++;
-			continue;
 		}
 
-		// We were moving but now we're not
-		if (ThisObject->State == OBJECTSTATE_MOVING && ThisObject->StopPoints.size() > 0)
+		return true;
+	}
+
+	// We were moving but now we're not
+	if (ThisObject->State == OBJECTSTATE_MOVING && ThisObject->StopPoints.size() > 0)
+	{
+		DynamicMapObjectStop NextStop = ThisObject->StopPoints[ThisObject->NextStopIndex];
+
+		if (vEquals(ObjectCentre, NextStop.StopLocation, 1.0f))
 		{
-			DynamicMapObjectStop NextStop = ThisObject->StopPoints[ThisObject->NextStopIndex];
+			ThisObject->NextStopIndex++;
 
-			if (vEquals(ObjectCentre, NextStop.StopLocation, 1.0f))
+			if (ThisObject->NextStopIndex >= ThisObject->StopPoints.size())
 			{
-				ThisObject->NextStopIndex++;
-
-				if (ThisObject->NextStopIndex >= ThisObject->StopPoints.size())
-				{
-					ThisObject->NextStopIndex = 0;
-				}
+				ThisObject->NextStopIndex = 0;
+			}
 
-				if (NextStop.bWaitForRetrigger)
+			if (NextStop.bWaitForRetrigger)
+			{
+				if (ThisObject->Type == MAPOBJECT_DOOR)
 				{
-					if (ThisObject->Type == MAPOBJECT_DOOR)
+					if (NextStop.WaitTime < 0.0f && !ThisObject->bToggleActive)
 					{
-						if (NextStop.WaitTime < 0.0f && !ThisObject->bToggleActive)
-						{
-							ThisObject->Type = MAPOBJECT_STATIC;							
-						}
-						else
-						{
-							NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_IDLE);
-						}
+						NAV_SetDynamicObjectType(ThisObject, MAPOBJECT_STATIC);
 					}
 					else
 					{
 						NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_IDLE);
 					}
-					
 				}
 				else
 				{
-					ThisObject->State = OBJECTSTATE_PREPARING;
+					NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_IDLE);
 				}
+				
 			}
 			else
 			{
-				// This is safety code in case a lift got messed with and deviated from its original move target (e.g. blocked and returns back rather than completes move)
-				DynamicMapObjectStop NewStop;
-				bool bAtStop = false;
+				NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_PREPARING);
+			}
+		}
+		else
+		{
+			// This is safety code in case a lift got messed with and deviated from its original move target (e.g. blocked and returns back rather than completes move)
+			DynamicMapObjectStop NewStop;
+			bool bAtStop = false;
+
+			for (int i = 0; i < ThisObject->StopPoints.size(); i++)
+			{
+				DynamicMapObjectStop CheckStop = ThisObject->StopPoints[i];
 
-				for (int i = 0; i < ThisObject->StopPoints.size(); i++)
+				if (vEquals(ObjectCentre, CheckStop.StopLocation))
 				{
-					DynamicMapObjectStop CheckStop = ThisObject->StopPoints[i];
-
-					if (vEquals(ObjectCentre, CheckStop.StopLocation))
+					bAtStop = true;
+					NewStop = CheckStop;
+					ThisObject->NextStopIndex = i + 1;
+					if (ThisObject->NextStopIndex >= ThisObject->StopPoints.size())
 					{
-						bAtStop = true;
-						NewStop = CheckStop;
-						ThisObject->NextStopIndex = i + 1;
-						if (ThisObject->NextStopIndex >= ThisObject->StopPoints.size())
-						{
-							ThisObject->NextStopIndex = 0;
-						}
-
-						break;
+						ThisObject->NextStopIndex = 0;
 					}
 
+					break;
 				}
 
-				if (!bAtStop || NewStop.bWaitForRetrigger)
-				{
-					NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_IDLE);
-				}
-				else
-				{
-					NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_PREPARING);
-				}
 			}
 
-			it++;
-			continue;
+			if (!bAtStop || NewStop.bWaitForRetrigger)
+			{
+				NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_IDLE);
+			}
+			else
+			{
+				NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_PREPARING);
+			}
 		}
 
-		if (ThisObject->State == OBJECTSTATE_PREPARING && (ThisObject->StopPoints.size() < 2 || vEquals(ThisObject->StopPoints[0].StopLocation, ThisObject->StopPoints[1].StopLocation)))
+		return true;
+	}
+
+	if (ThisObject->State == OBJECTSTATE_PREPARING && (ThisObject->StopPoints.size() < 2 || vEquals(ThisObject->StopPoints[0].StopLocation, ThisObject->StopPoints[1].StopLocation)))
+	{
+		if (gpGlobals->time - ThisObject->LastActivatedTime >= ThisObject->Delay)
 		{
-			if (gpGlobals->time - ThisObject->LastActivatedTime >= ThisObject->Delay)
-			{
-				NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_OPEN);
-				ThisObject->LastActivatedTime = gpGlobals->time;
-				it++;
-				continue;
-			}
+			NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_OPEN);
+			ThisObject->LastActivatedTime = gpGlobals->time;
+			return true;
 		}
+	}
 
-		if (ThisObject->State == OBJECTSTATE_OPEN)
+	if (ThisObject->State == OBJECTSTATE_OPEN)
+	{
+		if (gpGlobals->time - ThisObject->LastActivatedTime >= ThisObject->Wait)
 		{
-			if (gpGlobals->time - ThisObject->LastActivatedTime >= ThisObject->Wait)
-			{
-				NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_IDLE);
-				it++;
-				continue;
-			}
+			NAV_SetDynamicObjectStatus(ThisObject, OBJECTSTATE_IDLE);
+			return true;
 		}
+	}
 
-		if ((ThisObject->Type == MAPOBJECT_DOOR || ThisObject->Type == MAPOBJECT_PLATFORM) && ThisObject->State == OBJECTSTATE_IDLE)
+	if ((ThisObject->Type == MAPOBJECT_DOOR || ThisObject->Type == MAPOBJECT_PLATFORM) && ThisObject->State == OBJECTSTATE_IDLE)
+	{
+		// We have no way of activating this door. It's now a permanent blockage
+		if (ThisObject->Triggers.size() == 0)
 		{
-			// We have no way of activating this door. It's now a permanent blockage
-			if (ThisObject->Triggers.size() == 0)
-			{
-				ThisObject->Type = MAPOBJECT_STATIC;
-				it++;
-				continue;
-			}
+			NAV_SetDynamicObjectType(ThisObject, MAPOBJECT_STATIC);
+			return true;
 		}
+	}
 
-		it++;
+	return true;
+}
+
+void NAV_ResetDynamicObjectSnapshot()
+{
+	size_t NumObjects = DynamicMapObjects.size();
+
+	DynamicObjectSnapshot.Edicts.assign(NumObjects, nullptr);
+	DynamicObjectSnapshot.Origins.assign(NumObjects, ZERO_VECTOR);
+	DynamicObjectSnapshot.Velocities.assign(NumObjects, ZERO_VECTOR);
+	DynamicObjectSnapshot.NextThinks.assign(NumObjects, 0.0f);
+	DynamicObjectSnapshot.Healths.assign(NumObjects, 0.0f);
+	DynamicObjectSnapshot.DeadFlags.assign(NumObjects, DEAD_NO);
+	DynamicObjectSnapshot.SeenChangeCounts.assign(NumObjects, 0);
+	DynamicObjectSnapshot.NextIdleCheckTimes.assign(NumObjects, 0.0f);
+	// Nothing has been checked yet, so everything gets a full update on the first pass
+	DynamicObjectSnapshot.NeedsUpdate.assign(NumObjects, 1);
+	DynamicObjectSnapshot.bForceFullUpdate = true;
+}
+
+void NAV_EraseDynamicObjectSnapshot(const size_t Index)
+{
+	DynamicObjectSnapshot.Edicts.erase(DynamicObjectSnapshot.Edicts.begin() + Index);
+	DynamicObjectSnapshot.Origins.erase(DynamicObjectSnapshot.Origins.begin() + Index);
+	DynamicObjectSnapshot.Velocities.erase(DynamicObjectSnapshot.Velocities.begin() + Index);
+	DynamicObjectSnapshot.NextThinks.erase(DynamicObjectSnapshot.NextThinks.begin() + Index);
+	DynamicObjectSnapshot.Healths.erase(DynamicObjectSnapshot.Healths.begin() + Index);
+	DynamicObjectSnapshot.DeadFlags.erase(DynamicObjectSnapshot.DeadFlags.begin() + Index);
+	DynamicObjectSnapshot.SeenChangeCounts.erase(DynamicObjectSnapshot.SeenChangeCounts.begin() + Index);
+	DynamicObjectSnapshot.NextIdleCheckTimes.erase(DynamicObjectSnapshot.NextIdleCheckTimes.begin() + Index);
+	DynamicObjectSnapshot.NeedsUpdate.erase(DynamicObjectSnapshot.NeedsUpdate.begin() + Index);
+}
+
+void NAV_DiffDynamicObjectSnapshot()
+{
+	const size_t NumObjects = DynamicMapObjects.size();
+	const bool bForceFullUpdate = DynamicObjectSnapshot.bForceFullUpdate;
+
+	DynamicObjectSnapshot.bForceFullUpdate = false;
+
+	for (size_t i = 0; i < NumObjects; i++)
+	{
+		const DynamicMapObject* ThisObject = &DynamicMapObjects[i];
+		edict_t* ObjectEdict = ThisObject->Edict;
+
+		// Freed or killed, the update will remove it
+		if (FNullEnt(ObjectEdict))
+		{
+			DynamicObjectSnapshot.NeedsUpdate[i] = 1;
+			continue;
+		}
+
+		const entvars_t& ObjectVars = ObjectEdict->v;
+
+		bool bChanged = bForceFullUpdate
+			|| DynamicObjectSnapshot.Edicts[i] != ObjectEdict
+			|| DynamicObjectSnapshot.Origins[i] != ObjectVars.origin
+			|| DynamicObjectSnapshot.Velocities[i] != ObjectVars.velocity
+			|| DynamicObjectSnapshot.NextThinks[i] != ObjectVars.nextthink
+			|| DynamicObjectSnapshot.Healths[i] != ObjectVars.health
+			|| DynamicObjectSnapshot.DeadFlags[i] != ObjectVars.deadflag;
+
+		if (bChanged)
+		{
+			DynamicObjectSnapshot.Edicts[i] = ObjectEdict;
+			DynamicObjectSnapshot.Origins[i] = ObjectVars.origin;
+			DynamicObjectSnapshot.Velocities[i] = ObjectVars.velocity;
+			DynamicObjectSnapshot.NextThinks[i] = ObjectVars.nextthink;
+			DynamicObjectSnapshot.Healths[i] = ObjectVars.health;
+			DynamicObjectSnapshot.DeadFlags[i] = ObjectVars.deadflag;
+		}
+
+		// Moving, waiting to move or waiting to close all run on timers or need their stop points tracked, so check them every frame.
+		// Env globals, multisources and the like sit in the preparing state permanently so don't count
+		bool bInTransition = ThisObject->State != OBJECTSTATE_IDLE
+			&& ThisObject->Type != TRIGGER_ENV
+			&& ThisObject->Type != TRIGGER_MULTISOURCE
+			&& ThisObject->Type != TRIGGER_NONE;
+
+		// Multisources and anything with a master depend on other objects, so need checking whenever any object changes state
+		bool bDependencyChanged = (ThisObject->Type == TRIGGER_MULTISOURCE || !FNullEnt(ThisObject->Master))
+			&& DynamicObjectSnapshot.SeenChangeCounts[i] != DynamicObjectChangeCount;
+
+		bool bIdleCheckDue = gpGlobals->time >= DynamicObjectSnapshot.NextIdleCheckTimes[i];
+
+		DynamicObjectSnapshot.NeedsUpdate[i] = (bChanged || bInTransition || bDependencyChanged || bIdleCheckDue) ? 1 : 0;
 	}
 }
 
@@ -7347,12 +10526,13 @@ void NAV_OnTriggerActivated(DynamicMapObject* UsedObject)
 	if (!UsedObject) { return; }
 
 	UsedObject->NumTimesActivated++;
+	DynamicObjectChangeCount++;
 
 	if (UsedObject->Type == TRIGGER_ENV)
 	{
 		if (UsedObject->bToggleActive || UsedObject->NumTimesActivated == 1)
 		{
-			UsedObject->bIsActive = !UsedObject->bIsActive;
+			NAV_SetDynamicObjectActive(UsedObject, !UsedObject->bIsActive);
 		}
 		return;
 	}
@@ -7361,7 +10541,7 @@ void NAV_OnTriggerActivated(DynamicMapObject* UsedObject)
 
 	UsedObject->LastActivatedTime = gpGlobals->time;
 
-	UsedObject->State = OBJECTSTATE_PREPARING;
+	NAV_SetDynamicObjectStatus(UsedObject, OBJECTSTATE_PREPARING);
 
 	for (auto it = UsedObject->Targets.begin(); it != UsedObject->Targets.end(); it++)
 	{
@@ -7487,7 +10667,7 @@ void NAV_LinkDynamicMapObjectsToTriggers()
 		{
 			DynamicMapObject* Master = UTIL_GetDynamicObjectByEdict(objectIt->Master);
 
-			objectIt->bIsActive = Master->bIsActive;
+			NAV_SetDynamicObjectActive(&(*objectIt), Master->bIsActive);
 		}
 	}
 
@@ -7497,7 +10677,7 @@ void NAV_LinkDynamicMapObjectsToTriggers()
 		{
 			DynamicMapObject* Master = UTIL_GetDynamicObjectByEdict(objectIt->Master);
 
-			objectIt->bIsActive = Master->bIsActive;
+			NAV_SetDynamicObjectActive(&(*objectIt), Master->bIsActive);
 		}
 	}
 }
@@ -7846,15 +11026,7 @@ void NAV_SetPrototypeHealth(int EntityIndex, char* Value)
 
 DynamicMapObject* NAV_GetTriggerByEdict(edict_t* Edict)
 {
-	for (auto it = DynamicMapObjects.begin(); it != DynamicMapObjects.end(); it++)
-	{
-		if (it->Edict == Edict)
-		{
-			return &(*it);
-		}
-	}
-
-	return nullptr;
+	return UTIL_GetDynamicObjectByEdict(Edict);
 }
 
 DynamicMapObject* NAV_GetTriggerReachableFromPlatform(float LiftHeight, DynamicMapObject* Platform, const Vector PlatformPosition)
@@ -7879,56 +11051,51 @@ DynamicMapObject* NAV_GetTriggerReachableFromPlatform(float LiftHeight, DynamicM
 	return nullptr;
 }
 
-DynamicMapObject* NAV_GetBestTriggerForObject(DynamicMapObject* ObjectToActivate, Vector ActivateLocation, const NavAgentProfile& NavProfile)
+DynamicMapObject* NAV_GetCheapestWalkableTrigger(DynamicMapObject* ObjectToActivate, const Vector FromLoc, const NavAgentProfile& NavProfile, const vector<DynamicMapObject*>& Candidates)
 {
-	if (ObjectToActivate->Triggers.size() == 0 || !ObjectToActivate || vIsZero(ActivateLocation)) { return nullptr; }
-
-	DynamicMapObject* WinningTrigger = nullptr;
-
-	Vector FromLoc = ActivateLocation;
-
-	float MinDist = FLT_MAX;
+	if (Candidates.size() == 0) { return nullptr; }
 
-	// This object is triggered by itself, such as a door set to USE_ONLY or a func_plat which needs to be touched to activate
-	if (ObjectToActivate->Triggers.size() == 1 && ObjectToActivate->Triggers[0] == ObjectToActivate->Edict) { return UTIL_GetDynamicObjectByEdict(ObjectToActivate->Triggers[0]); }
+	vector<Vector> TriggerLocations;
+	vector<float> MaxDistances;
 
-	for (auto it = ObjectToActivate->Triggers.begin(); it != ObjectToActivate->Triggers.end(); it++)
+	for (auto it = Candidates.begin(); it != Candidates.end(); it++)
 	{
-		DynamicMapObject* ThisTrigger = UTIL_GetDynamicObjectByEdict((*it));
+		DynamicMapObject* ThisTrigger = (*it);
 
-		if (!ThisTrigger || !ThisTrigger->bIsActive) { continue; }
+		Vector TriggerLocation = UTIL_GetButtonFloorLocation(NavProfile, FromLoc, ThisTrigger->Edict);
 
-		// For triggers we can activate from a distance and are in our LOS, short-cut and add them to the list
-		if (ThisTrigger->Type == TRIGGER_SHOOT || ThisTrigger->Type == TRIGGER_BREAK)
+		if (vIsZero(TriggerLocation))
 		{
-			TraceResult hit;
+			TriggerLocation = UTIL_GetClosestPointOnEntityToLocation(FromLoc, ThisTrigger->Edict);
+		}
 
-			UTIL_TraceLine(ActivateLocation + Vector(0.0f, 0.0f, 5.0f), UTIL_GetCentreOfEntity(ThisTrigger->Edict), ignore_monsters, ignore_glass, nullptr, &hit);
+		TriggerLocations.push_back(TriggerLocation);
+		MaxDistances.push_back((ThisTrigger->Type == TRIGGER_BREAK || ThisTrigger->Type == TRIGGER_SHOOT) ? UTIL_MetresToGoldSrcUnits(5.0f) : 64.0f);
+	}
 
-			if (hit.pHit == ThisTrigger->Edict)
-			{
-				float ThisDist = vDist3DSq(FromLoc, UTIL_GetCentreOfEntity(ThisTrigger->Edict));
+	// One search gets the cost to every trigger, instead of a path query each
+	vector<float> Costs;
+	UTIL_GetPathCostsToLocations(NavProfile, FromLoc, TriggerLocations, MaxDistances, Costs);
 
-				if (ThisDist < MinDist)
-				{
-					WinningTrigger = ThisTrigger;
-					MinDist = ThisDist;
-				}
+	// Checking whether the path goes through the object needs the full path, so try the cheapest first and stop at the first one that's fine
+	while (true)
+	{
+		int BestIndex = -1;
 
-				continue;
+		for (int i = 0; i < (int)Costs.size(); i++)
+		{
+			if (Costs[i] < FLT_MAX && (BestIndex < 0 || Costs[i] < Costs[BestIndex]))
+			{
+				BestIndex = i;
 			}
 		}
 
-		Vector TriggerLocation = UTIL_GetButtonFloorLocation(NavProfile, FromLoc, ThisTrigger->Edict);
-
-		if (vIsZero(TriggerLocation))
-		{
-			TriggerLocation = UTIL_GetClosestPointOnEntityToLocation(FromLoc, ThisTrigger->Edict);
-		}
+		if (BestIndex < 0) { return nullptr; }
 
-		float MaxDist = (ThisTrigger->Type == TRIGGER_BREAK || ThisTrigger->Type == TRIGGER_SHOOT) ? UTIL_MetresToGoldSrcUnits(5.0f) : 64.0f;
+		// Unreachable triggers and ones already rejected are left at FLT_MAX
+		Costs[BestIndex] = FLT_MAX;
 
-		if (!UTIL_PointIsReachable(NavProfile, FromLoc, TriggerLocation, MaxDist)) { continue; }
+		Vector TriggerLocation = TriggerLocations[BestIndex];
 
 		if (ObjectToActivate->Type != MAPOBJECT_PLATFORM)
 		{
@@ -7938,7 +11105,7 @@ DynamicMapObject* NAV_GetBestTriggerForObject(DynamicMapObject* ObjectToActivate
 		{
 			vector<bot_path_node> CheckPath;
 
-			dtStatus PathFindStatus = FindPathClosestToPoint(NavProfile, FromLoc, TriggerLocation, CheckPath, MaxDist);
+			dtStatus PathFindStatus = FindPathClosestToPoint(NavProfile, FromLoc, TriggerLocation, CheckPath, MaxDistances[BestIndex]);
 
 			if (!dtStatusSucceed(PathFindStatus)) { continue; }
 
@@ -7959,30 +11126,25 @@ DynamicMapObject* NAV_GetBestTriggerForObject(DynamicMapObject* ObjectToActivate
 			if (bOtherSideOfLift) { continue; }
 		}
 
-		float ThisDist = vDist3DSq(FromLoc, TriggerLocation);
-
-		if (ThisDist < MinDist)
-		{
-			WinningTrigger = ThisTrigger;
-		}
+		return Candidates[BestIndex];
 	}
-
-	return WinningTrigger;
 }
 
-DynamicMapObject* NAV_GetBestTriggerForObject(DynamicMapObject* ObjectToActivate, edict_t* PlayerToTrigger, const NavAgentProfile& NavProfile)
+DynamicMapObject* NAV_GetBestTriggerForObject(DynamicMapObject* ObjectToActivate, Vector ActivateLocation, const NavAgentProfile& NavProfile)
 {
-	if (ObjectToActivate->Triggers.size() == 0 || !ObjectToActivate || FNullEnt(PlayerToTrigger)) { return nullptr; }
+	if (ObjectToActivate->Triggers.size() == 0 || !ObjectToActivate || vIsZero(ActivateLocation)) { return nullptr; }
 
 	DynamicMapObject* WinningTrigger = nullptr;
 
-	Vector FromLoc = GetPlayerBottomOfCollisionHull(PlayerToTrigger);
+	Vector FromLoc = ActivateLocation;
 
-	float MinDist = FLT_MAX;
+	float NearestShootDist = FLT_MAX; // Only used to pick between triggers we can shoot from here
 
 	// This object is triggered by itself, such as a door set to USE_ONLY or a func_plat which needs to be touched to activate
 	if (ObjectToActivate->Triggers.size() == 1 && ObjectToActivate->Triggers[0] == ObjectToActivate->Edict) { return UTIL_GetDynamicObjectByEdict(ObjectToActivate->Triggers[0]); }
 
+	vector<DynamicMapObject*> WalkCandidates;
+
 	for (auto it = ObjectToActivate->Triggers.begin(); it != ObjectToActivate->Triggers.end(); it++)
 	{
 		DynamicMapObject* ThisTrigger = UTIL_GetDynamicObjectByEdict((*it));
@@ -7992,69 +11154,80 @@ DynamicMapObject* NAV_GetBestTriggerForObject(DynamicMapObject* ObjectToActivate
 		// For triggers we can activate from a distance and are in our LOS, short-cut and add them to the list
 		if (ThisTrigger->Type == TRIGGER_SHOOT || ThisTrigger->Type == TRIGGER_BREAK)
 		{
-			if (UTIL_PlayerHasLOSToEntity(PlayerToTrigger, ThisTrigger->Edict, UTIL_MetresToGoldSrcUnits(20.0f), false))
+			TraceResult hit;
+
+			UTIL_BrokeredTraceLine(ActivateLocation + Vector(0.0f, 0.0f, 5.0f), UTIL_GetCentreOfEntity(ThisTrigger->Edict), ignore_monsters, ignore_glass, nullptr, &hit);
+
+			if (hit.pHit == ThisTrigger->Edict)
 			{
-				float ThisDist = vDist3DSq(FromLoc, UTIL_GetCentreOfEntity(ThisTrigger->Edict));
+				float ThisDist = vDist3D(FromLoc, UTIL_GetCentreOfEntity(ThisTrigger->Edict));
 
-				if (ThisDist < MinDist)
+				if (ThisDist < NearestShootDist)
 				{
 					WinningTrigger = ThisTrigger;
-					MinDist = ThisDist;
+					NearestShootDist = ThisDist;
 				}
 
 				continue;
 			}
 		}
 
-		Vector TriggerLocation = UTIL_GetButtonFloorLocation(NavProfile, FromLoc, ThisTrigger->Edict);
+		WalkCandidates.push_back(ThisTrigger);
+	}
 
-		if (vIsZero(TriggerLocation))
-		{
-			TriggerLocation = UTIL_GetClosestPointOnEntityToLocation(FromLoc, ThisTrigger->Edict);
-		}
+	// Triggers are ranked by the path cost to somewhere they can be activated from.
+	// We can already shoot this one from where we are, so nothing we'd have to walk to can beat it
+	if (WinningTrigger) { return WinningTrigger; }
 
-		float MaxDist = (ThisTrigger->Type == TRIGGER_BREAK || ThisTrigger->Type == TRIGGER_SHOOT) ? UTIL_MetresToGoldSrcUnits(5.0f) : 64.0f;
+	return NAV_GetCheapestWalkableTrigger(ObjectToActivate, FromLoc, NavProfile, WalkCandidates);
+}
 
-		if (!UTIL_PointIsReachable(NavProfile, FromLoc, TriggerLocation, MaxDist)) { continue; }
+DynamicMapObject* NAV_GetBestTriggerForObject(DynamicMapObject* ObjectToActivate, edict_t* PlayerToTrigger, const NavAgentProfile& NavProfile)
+{
+	if (ObjectToActivate->Triggers.size() == 0 || !ObjectToActivate || FNullEnt(PlayerToTrigger)) { return nullptr; }
 
-		if (ObjectToActivate->Type != MAPOBJECT_PLATFORM)
-		{
-			if (UTIL_IsPathBlockedByObject(NavProfile, FromLoc, TriggerLocation, ObjectToActivate)) { continue; }
-		}
-		else
-		{
-			vector<bot_path_node> CheckPath;
+	DynamicMapObject* WinningTrigger = nullptr;
+
+	Vector FromLoc = GetPlayerBottomOfCollisionHull(PlayerToTrigger);
 
-			dtStatus PathFindStatus = FindPathClosestToPoint(NavProfile, FromLoc, TriggerLocation, CheckPath, MaxDist);
+	float NearestShootDist = FLT_MAX; // Only used to pick between triggers we can shoot from here
 
-			if (!dtStatusSucceed(PathFindStatus)) { continue; }
+	// This object is triggered by itself, such as a door set to USE_ONLY or a func_plat which needs to be touched to activate
+	if (ObjectToActivate->Triggers.size() == 1 && ObjectToActivate->Triggers[0] == ObjectToActivate->Edict) { return UTIL_GetDynamicObjectByEdict(ObjectToActivate->Triggers[0]); }
 
-			bool bOtherSideOfLift = false;
+	vector<DynamicMapObject*> WalkCandidates;
 
-			for (auto pathIt = CheckPath.begin(); pathIt != CheckPath.end(); pathIt++)
+	for (auto it = ObjectToActivate->Triggers.begin(); it != ObjectToActivate->Triggers.end(); it++)
+	{
+		DynamicMapObject* ThisTrigger = UTIL_GetDynamicObjectByEdict((*it));
+
+		if (!ThisTrigger || !ThisTrigger->bIsActive) { continue; }
+
+		// For triggers we can activate from a distance and are in our LOS, short-cut and add them to the list
+		if (ThisTrigger->Type == TRIGGER_SHOOT || ThisTrigger->Type == TRIGGER_BREAK)
+		{
+			if (UTIL_PlayerHasLOSToEntity(PlayerToTrigger, ThisTrigger->Edict, UTIL_MetresToGoldSrcUnits(20.0f), false))
 			{
-				if (pathIt->flag & NAV_FLAG_PLATFORM)
+				float ThisDist = vDist3D(FromLoc, UTIL_GetCentreOfEntity(ThisTrigger->Edict));
+
+				if (ThisDist < NearestShootDist)
 				{
-					if (UTIL_GetClosestPlatformToPoints(pathIt->FromLocation, pathIt->Location) == ObjectToActivate) 
-					{
-						bOtherSideOfLift = true;
-						break;
-					}
+					WinningTrigger = ThisTrigger;
+					NearestShootDist = ThisDist;
 				}
-			}
 
-			if (bOtherSideOfLift) { continue; }
+				continue;
+			}
 		}
 
-		float ThisDist = vDist3DSq(FromLoc, TriggerLocation);
-
-		if (ThisDist < MinDist)
-		{
-			WinningTrigger = ThisTrigger;
-		}
+		WalkCandidates.push_back(ThisTrigger);
 	}
 
-	return WinningTrigger;
+	// Triggers are ranked by the path cost to somewhere they can be activated from.
+	// We can already shoot this one from where we are, so nothing we'd have to walk to can beat it
+	if (WinningTrigger) { return WinningTrigger; }
+
+	return NAV_GetCheapestWalkableTrigger(ObjectToActivate, FromLoc, NavProfile, WalkCandidates);
 }
 
 void DEBUG_PrintObjectInfo(DynamicMapObject* Object)
@@ -13,6 +13,7 @@
 #include <extdll.h>
 
 #include <string>
+#include <functional>
 
 #include "DetourStatus.h"
 #include "DetourNavMeshQuery.h"
@@ -68,6 +69,8 @@ typedef struct _DYNAMIC_MAP_OBJECT
 	bool bToggleActive = false; // Can this be toggled active/inactive?
 	bool bIsActive = true;
 	int NumTimesActivated = 0; // How many times this object has been triggered
+	Vector SweptMins = ZERO_VECTOR; // Bounds covering every stop point the object can move to, used by the dynamic object spatial index
+	Vector SweptMaxs = ZERO_VECTOR;
 } DynamicMapObject;
 
 // Door reference. Not used, but is a future feature to allow bots to track if a door is open or not, and how to open it etc.
@@ -78,17 +81,261 @@ typedef struct _NAV_HITRESULT
 	Vector TraceEndPoint = ZERO_VECTOR;
 } nav_hitresult;
 
+// Identifies a cached poly corridor. Revision is part of the key so nothing cached before the nav mesh last changed is ever returned
+typedef struct _NAV_PATH_CACHE_KEY
+{
+	dtPolyRef StartPoly = 0;
+	dtPolyRef EndPoly = 0;
+	unsigned int NavMeshIndex = 0;
+	unsigned int FilterHash = 0; // Hash of the filter's area costs and include/exclude flags
+	unsigned int Revision = 0; // Nav mesh revision the corridor was found on
+
+	bool operator==(const _NAV_PATH_CACHE_KEY& Other) const
+	{
+		return StartPoly == Other.StartPoly && EndPoly == Other.EndPoly && NavMeshIndex == Other.NavMeshIndex && FilterHash == Other.FilterHash && Revision == Other.Revision;
+	}
+} NavPathCacheKey;
+
+struct NavPathCacheKeyHash
+{
+	size_t operator()(const NavPathCacheKey& Key) const
+	{
+		size_t Hash = std::hash<dtPolyRef>()(Key.StartPoly);
+		Hash = Hash * 31 + std::hash<dtPolyRef>()(Key.EndPoly);
+		Hash = Hash * 31 + Key.FilterHash;
+		Hash = Hash * 31 + Key.Revision;
+		return Hash * 31 + Key.NavMeshIndex;
+	}
+};
+
+typedef struct _NAV_PATH_CACHE_ENTRY
+{
+	NavPathCacheKey Key;
+	dtStatus Status = DT_FAILURE; // Status returned by findPath, so partial results are still reported as such
+	std::vector<dtPolyRef> PolyPath;
+} NavPathCacheEntry;
+
+// A bot's queued request for the sliced path planner. Holds everything needed to run the search and build the bot's path once it completes
+typedef struct _NAV_PATH_REQUEST
+{
+	unsigned int RequestId = 0; // Matches the bot's PathRequestId while the request is still wanted
+	edict_t* Requester = nullptr; // The bot who asked for the path
+	NavAgentProfile NavProfile; // Copy of the bot's nav profile when the request was made. The sliced query holds a pointer to its filter
+	dtPolyRef StartPoly = 0;
+	dtPolyRef EndPoly = 0;
+	float StartNearest[3] = { 0.0f, 0.0f, 0.0f };
+	float EndNearest[3] = { 0.0f, 0.0f, 0.0f };
+	Vector FromFloorLocation = ZERO_VECTOR; // Where the path starts from, in GoldSrc coordinates
+	float MaxAcceptableDistance = 0.0f; // How close a partial path must get to the destination to be accepted
+	bool bMustDisembarkLiftFirst = false; // Bot is riding a lift and must get off it before following the path
+	Vector LiftStart = ZERO_VECTOR;
+	Vector LiftEnd = ZERO_VECTOR;
+	NavPathCacheKey CacheKey; // Where the corridor is cached once the search finishes
+} NavPathRequest;
+
+typedef enum _NAV_REACHABILITY
+{
+	NAV_REACHABILITY_UNKNOWN = 0, // The islands can't answer this, a full path query is needed
+	NAV_REACHABILITY_CONNECTED, // Both polys are in the same strongly-connected island, so a complete path exists
+	NAV_REACHABILITY_DISCONNECTED // No sequence of links joins the two polys, so no complete path exists
+} NavReachability;
+
+// How hard a path search should try. Cheaper modes suit queries which only need a rough answer
+typedef enum _NAV_SEARCH_MODE
+{
+	NAV_SEARCH_OPTIMAL = 0, // Plain A*, the cheapest path
+	NAV_SEARCH_FAST, // Weighted A* with the landmark heuristic, the path costs roughly NAV_FAST_SEARCH_WEIGHT times the cheapest at worst but far fewer polys are visited
+	NAV_SEARCH_BIDIRECTIONAL // Searches from both ends at once and joins them in the middle. Only saves work on meshes without one-way off-mesh connections
+} NavSearchMode;
+
+// Where a sliced nav_poly_graph build has got to. Each stage after the tiles goes through the polys once
+typedef enum _NAV_POLY_GRAPH_BUILD_STAGE
+{
+	NAV_POLY_GRAPH_NOT_STARTED = 0,
+	NAV_POLY_GRAPH_TILES, // Listing each tile's polys
+	NAV_POLY_GRAPH_POLYS, // Filter checks and poly centres
+	NAV_POLY_GRAPH_LINKS, // Outgoing links and their costs
+	NAV_POLY_GRAPH_REVERSE_COUNT, // Counting each poly's incoming links
+	NAV_POLY_GRAPH_REVERSE_START, // Turning the counts into offsets
+	NAV_POLY_GRAPH_REVERSE_LINKS, // Filling in the reverse links
+	NAV_POLY_GRAPH_BUILT
+} NavPolyGraphBuildStage;
+
+// Flattened copy of the nav mesh's poly links for one filter, for running whole-mesh searches without going through dtNavMeshQuery
+typedef struct _NAV_POLY_GRAPH
+{
+	NavPolyGraphBuildStage BuildStage = NAV_POLY_GRAPH_NOT_STARTED;
+	unsigned int BuildNext = 0; // Next tile or poly for the current build stage
+	std::vector<float> BuildCentres; // Poly centres for the link costs, only kept while building
+	std::vector<unsigned int> BuildReverseCount; // Reverse links filled in so far for each poly, only kept while building
+	std::vector<dtPolyRef> TileBaseRefs; // Base poly ref of each tile when the graph was built, 0 for empty tiles
+	std::vector<unsigned int> TileBase; // Index of each tile's first poly in the arrays below
+	std::vector<dtPolyRef> PolyRefs;
+	std::vector<bool> bPassable; // False if the filter excludes the poly
+	std::vector<unsigned int> LinkStart; // Outgoing links for poly i are Links[LinkStart[i]] to Links[LinkStart[i + 1] - 1]
+	std::vector<unsigned int> Links; // Index of the poly each link leads to
+	std::vector<float> LinkCosts; // Filter cost from this poly's centre to the neighbour's centre
+	std::vector<unsigned int> ReverseLinkStart; // Same links flipped round, for searching backwards from a goal
+	std::vector<unsigned int> ReverseLinks;
+	std::vector<float> ReverseLinkCosts;
+} nav_poly_graph;
+
+// Where a sliced reachability island build has got to
+typedef enum _NAV_ISLAND_BUILD_STAGE
+{
+	NAV_ISLAND_BUILD_GRAPH = 0, // Flattening the nav mesh into Graph
+	NAV_ISLAND_BUILD_WEAK, // Union-find over every link
+	NAV_ISLAND_BUILD_WEAK_LABEL, // Turning the union-find roots into weak island IDs
+	NAV_ISLAND_BUILD_STRONG // Tarjan's algorithm, see CallStack
+} NavIslandBuildStage;
+
+// Search state for relabelling one set of reachability islands a slice at a time
+typedef struct _NAV_ISLAND_BUILD
+{
+	bool bActive = false;
+	unsigned int Revision = 0; // Nav mesh revision the labels are being built from
+	NavIslandBuildStage Stage = NAV_ISLAND_BUILD_GRAPH;
+	unsigned int NextPoly = 0; // Next poly for the current stage
+	nav_poly_graph Graph;
+	std::vector<unsigned int> UnionParents;
+	std::vector<unsigned int> WeakIslandIds;
+	std::vector<unsigned int> StrongIslandIds;
+	std::vector<int> VisitOrder; // -1 if Tarjan's algorithm hasn't reached the poly yet
+	std::vector<int> LowLink;
+	std::vector<bool> bOnStack;
+	std::vector<unsigned int> TarjanStack;
+	std::vector<std::pair<unsigned int, unsigned int>> CallStack; // Poly index, and the next of its graph links to visit. Kept between frames instead of recursing
+	int NextVisitOrder = 0;
+	unsigned int NextStrongIslandId = 1;
+} nav_island_build;
+
+// Connected-component labels for every poly in a nav mesh, for one combination of include/exclude flags.
+// Weak islands ignore link direction, strong islands respect it (one-way off-mesh connections can only be used one way)
+typedef struct _NAV_REACHABILITY_ISLANDS
+{
+	unsigned int NavMeshIndex = 0;
+	unsigned int IncludeFlags = 0;
+	unsigned int ExcludeFlags = 0;
+	dtQueryFilter Filter; // Copy of the first profile's filter with these flags
+	bool bLabelled = false; // False until the first build finishes
+	unsigned int Revision = 0; // The nav mesh revision these labels were built from
+	std::vector<unsigned int> TileBase; // Index of each tile's first poly in the arrays below
+	std::vector<dtPolyRef> PolyRefs; // Used to confirm a poly ref still points at the poly that was labelled
+	std::vector<unsigned int> WeakIslandIds; // 0 means the poly is excluded by the filter
+	std::vector<unsigned int> StrongIslandIds; // 0 means the poly is excluded by the filter
+	nav_island_build Build; // Relabelling for a newer nav mesh revision, swapped in once finished
+} nav_reachability_islands;
+
+/*
+	Cost to reach one goal poly from every poly that can reach it, found with a single reverse Dijkstra search.
+	Any bot heading to the goal can read its corridor straight out of the field instead of running its own A*.
+	Indexed the same way as nav_reachability_islands, but with its own copy of the tile layout so rebuilding an unrelated tile doesn't invalidate it
+*/
+typedef struct _NAV_FLOW_FIELD
+{
+	NavPathCacheKey Key; // StartPoly and Revision are always 0, EndPoly is the goal
+	unsigned int Revision = 0; // Nav mesh revision the field was last checked against
+	std::vector<dtPolyRef> TileBaseRefs; // Base poly ref of each tile when the field was built, 0 for empty tiles. Changes if the tile is rebuilt
+	std::vector<unsigned int> TileBase; // Index of each tile's first poly in the arrays below
+	std::vector<bool> bTileTouched; // Tiles the search reached, plus their neighbours. The field is thrown away if any of these are rebuilt
+	std::vector<dtPolyRef> NextPoly; // Next poly towards the goal, 0 if the poly can't reach the goal (or is the goal)
+	std::vector<float> Costs; // Cost to the goal from this poly's centre, FLT_MAX if it can't reach the goal
+} nav_flow_field;
+
+// Where the queued flow field build has got to
+typedef enum _NAV_FLOW_FIELD_BUILD_STAGE
+{
+	NAV_FLOW_FIELD_QUEUED = 0, // Waiting for the tile cache to settle
+	NAV_FLOW_FIELD_GRAPH, // Flattening the nav mesh into Graph
+	NAV_FLOW_FIELD_SEARCH, // Reverse Dijkstra search from the goal, see OpenList
+	NAV_FLOW_FIELD_FINISH // Filling in next polys and touched tiles, see NextFinishTile
+} NavFlowFieldBuildStage;
+
+// The flow field NAV_UpdateFlowFieldBuild is working on. Every stage is run a slice at a time, so no frame pays for a whole mesh pass
+typedef struct _NAV_FLOW_FIELD_BUILD
+{
+	bool bActive = false; // A goal is queued or being built
+	NavFlowFieldBuildStage Stage = NAV_FLOW_FIELD_QUEUED;
+	unsigned int NextFinishTile = 0; // Next tile to fill in during NAV_FLOW_FIELD_FINISH
+	unsigned int NavMeshIndex = 0;
+	dtQueryFilter Filter; // Copy of the filter of the profile which asked for the field
+	dtPolyRef GoalPoly = 0;
+	nav_flow_field Field; // Costs fill in as the search goes, only added to the flow fields once the search has finished
+	nav_poly_graph Graph;
+	std::vector<int> Parents; // Graph index of the next poly towards the goal, -1 if not reached yet
+	std::vector<std::pair<float, unsigned int>> OpenList; // Min-heap of (cost, graph index). Stale entries are skipped rather than updated in place
+} nav_flow_field_build;
+
+/*
+	Two-level view of the nav mesh for one filter, used to plan long paths. Each tile is a cluster, and every poly with a link
+	into another tile is a portal. Costs between portals in the same tile are precomputed, so a long search only visits portals.
+	Built a slice at a time by NAV_UpdateClusterGraphs, and only used once it's complete for the current nav mesh revision
+*/
+typedef struct _NAV_CLUSTER_GRAPH
+{
+	unsigned int NavMeshIndex = 0;
+	unsigned int FilterHash = 0;
+	dtQueryFilter Filter; // Copy of the first profile's filter with this hash
+	unsigned int Revision = 0; // Nav mesh revision the graph was (or is being) built from
+	bool bBuilding = false; // Graph, portals or portal links are still being built
+	bool bComplete = false; // Every portal is linked up for Revision, so the graph can be searched
+	bool bPortalsFound = false; // Every tile's portals are listed, so they can be linked up, see NextPortal
+	unsigned int NextPortalTile = 0; // Next tile to find the portals of once Graph is built
+	unsigned int NextPortal = 0; // Next portal to work out the links for while building
+	std::vector<unsigned int> PolyTiles; // Tile index of each poly in Graph, only kept while building
+	nav_poly_graph Graph;
+	std::vector<int> PolyPortals; // Portal index of each poly in Graph, -1 if the poly isn't a portal
+	std::vector<unsigned int> Portals; // Graph index of each portal's poly
+	std::vector<unsigned int> TilePortalStart; // Portals in tile i are Portals[TilePortalStart[i]] to Portals[TilePortalStart[i + 1] - 1]
+	std::vector<unsigned int> PortalLinkStart; // Links for portal i are PortalLinks[PortalLinkStart[i]] to PortalLinks[PortalLinkStart[i + 1] - 1]
+	std::vector<unsigned int> PortalLinks; // Portal index each link leads to
+	std::vector<float> PortalLinkCosts; // Cheapest cost without leaving the tile, or the link cost when crossing into the next tile
+} nav_cluster_graph;
+
+/*
+	Landmark distance table for one nav mesh and filter, attached to the nav queries so NAV_SEARCH_FAST searches can use the ALT heuristic.
+	Rebuilt one landmark per frame whenever the nav mesh changes, the old table stays in use until the new one is finished
+*/
+typedef struct _NAV_LANDMARKS
+{
+	unsigned int NavMeshIndex = 0;
+	unsigned int FilterHash = 0;
+	dtQueryFilter Filter; // Copy of the first profile's filter with this hash
+	unsigned int Revision = 0; // Nav mesh revision Table was built from
+	dtLandmarkTable* Table = nullptr; // Attached to the queries, nullptr until the first build finishes
+	dtLandmarkTable* PendingTable = nullptr; // Being built, swapped in once every landmark is done
+	unsigned int PendingRevision = 0; // Nav mesh revision PendingTable is being built from
+	int NextLandmark = 0; // Next landmark to compute in PendingTable
+	nav_poly_graph PendingGraph; // Graph PendingTable is being built from
+	std::vector<float> MinLandmarkCosts; // Cost from each poly to the nearest landmark chosen so far, used to pick the next landmark
+} nav_landmarks;
+
 // Links together a tile cache, nav query and the nav mesh into one handy structure for all your querying needs
 typedef struct _NAV_MESH
 {
 	class dtTileCache* tileCache = nullptr;
 	class dtNavMeshQuery* navQuery = nullptr;
+	class dtNavMeshQuery* slicedQuery = nullptr; // Owned by the sliced path planner, so blocking queries on navQuery never reset a search in progress
 	class dtNavMesh* navMesh = nullptr;
 	std::vector<NavOffMeshConnection> MeshConnections;
 	std::vector<NavHint> MeshHints;
 	std::vector<NavTempObstacle> TempObstacles;
+	unsigned int Revision = 0; // Bumped every time the tile cache modifies the nav mesh, so anything derived from the mesh knows when it is stale
+	std::vector<const dtLandmarkTable*> LandmarkTables; // Landmark tables currently attached to navQuery and slicedQuery, worker queries attach the same ones before each job
 } nav_mesh;
 
+// How much work UTIL_UpdateTileCache did on the last frame, plus a few high water marks
+typedef struct _NAV_TILECACHE_STATS
+{
+	int UpdateSteps = 0; // Tile cache update() calls last frame. Each rebuilds at most one tile
+	int PendingTiles = 0; // Tile rebuilds still queued at the end of last frame
+	int PendingRequests = 0; // Obstacle and off-mesh requests still queued at the end of last frame
+	float TimeSpent = 0.0f; // Milliseconds spent updating tile caches last frame
+	int PeakPendingTiles = 0; // Most tile rebuilds queued at the end of any frame since the nav meshes were loaded
+	float PeakTimeSpent = 0.0f; // Longest frame spent updating tile caches since the nav meshes were loaded
+	unsigned int FramesOverBudget = 0; // Frames which ran out of time with work still pending
+} nav_tilecache_stats;
+
 
 static const int NAVMESHSET_MAGIC = 'M' << 24 | 'S' << 16 | 'E' << 8 | 'T'; //'MSET', used to confirm the nav mesh we're loading is compatible;
 static const int NAVMESHSET_VERSION = 1;
@@ -96,9 +343,16 @@ static const int NAVMESHSET_VERSION = 1;
 static const int TILECACHESET_MAGIC = 'T' << 24 | 'S' << 16 | 'E' << 8 | 'T'; //'TSET', used to confirm the tile cache we're loading is compatible;
 static const int TILECACHESET_VERSION = 4;
 
+static const int NAVSNAPSHOT_MAGIC = 'N' << 24 | 'S' << 16 | 'N' << 8 | 'P'; //'NSNP', identifies a baked nav mesh snapshot written by the plugin
+static const int NAVSNAPSHOT_VERSION = 1; // Bump whenever the tile build process changes, so old snapshots get rebuilt
+
 static const float pExtents[3] = { 400.0f, 50.0f, 400.0f }; // Default extents (in GoldSrc units) to find the nearest spot on the nav mesh
 static const float pReachableExtents[3] = { max_ai_use_reach, max_ai_use_reach, max_ai_use_reach }; // Extents (in GoldSrc units) to determine if something is on the nav mesh
 
+static const float MAX_POLY_TRACKING_MOVE_DIST = 100.0f; // If a bot has moved further than this since its current poly was last updated, assume it teleported and search from scratch
+static const float MAX_POLY_HINT_HEIGHT_DIFF = 18.0f; // A poly hint is only trusted if the point is within this height of it, so we don't snap to the floor above or below
+static const int MAX_POLY_TRACKING_VISITED = 16; // Max polys moveAlongSurface can walk through when updating a bot's current poly
+
 static const int DT_AREA_NULL = 0; // Represents a null area on the nav mesh. Not traversable and considered not on the nav mesh
 static const int DT_AREA_BLOCKED = 3; // Area occupied by an obstruction (e.g. building). Not traversable, but considered to be on the nav mesh
 
@@ -107,6 +361,37 @@ static const int DOOR_START_OPEN = 1;
 
 static const float CHECK_STUCK_INTERVAL = 0.1f; // How frequently should the bot check if it's stuck?
 
+static const int MAX_TILECACHE_UPDATE_TIME_US = 2000; // Microseconds per frame the tile caches may spend rebuilding tiles. Anything left over is picked up next frame
+static const int MAX_TRACE_NAV_BATCH = 8; // Targets UTIL_TraceNavMulti handles per batched query. More are fine, they just take several batches
+static const int TILECACHE_PRIORITY_PATH_NODES = 16; // How far along each bot's path to look when deciding which dirty tile to rebuild first
+
+static const float DYNAMIC_OBJECT_GRID_CELL_SIZE = 512.0f; // Size of each cell in the dynamic object spatial index
+static const int DYNAMIC_OBJECT_GRID_SIZE = 32; // Cells along each side of the spatial index. Covers -8192 to 8192, anything outside is clamped to the edge cells
+
+static const float DYNAMIC_OBJECT_IDLE_CHECK_INTERVAL = 1.0f; // How often (seconds) a dynamic object which hasn't changed gets a full update anyway
+
+static const int MAX_PATH_CACHE_ENTRIES = 256; // Max poly corridors kept in the path cache before the least recently used are evicted
+
+static const int MIN_FLOW_FIELD_DEMAND = 3; // How many path searches to the same goal poly before it's worth building a flow field for it
+static const int MAX_FLOW_FIELDS = 16; // Max flow fields kept before the least recently used are evicted
+static const size_t MAX_FLOW_FIELD_MEMORY = 8 * 1024 * 1024; // Max bytes used by all flow fields combined before the least recently used are evicted
+static const int MAX_FLOW_FIELD_DEMAND_ENTRIES = 1024; // Demand counters are reset when this many different goals are being tracked, so it can't grow forever
+
+static const float NAV_FAST_SEARCH_WEIGHT = 1.25f; // Heuristic weight for NAV_SEARCH_FAST searches, so at most 25% worse than the cheapest path
+static const float NAV_POLY_CLEARANCE_LIMIT = 64.0f; // Per-poly wall clearance is measured up to this far. Wall checks asking for more than this still do a full query
+
+static const int MIN_CLUSTER_PATH_TILES = 4; // How many tiles apart the start and end polys must be before a path is planned over the cluster graph
+static const int MAX_CLUSTER_PORTALS_PER_FRAME = 64; // Portals NAV_UpdateClusterGraphs links up each frame, shared between all cluster graphs. Each is a Dijkstra search over one tile
+
+static const int MAX_NAV_BENCHMARK_QUERIES = 100000; // Cap on the 'navbench' query count, as every query runs inside one server frame
+
+static const int NUM_NAV_LANDMARKS = 8; // Landmarks per landmark table. More gives a tighter heuristic but costs two Dijkstra searches and 8 bytes per poly each
+
+static const int MAX_POLY_GRAPH_POLYS_PER_FRAME = 2048; // Polys each sliced whole-mesh build (poly graphs, cluster portals, reachability islands) gets through per frame
+
+static const int MAX_PATH_ITERATIONS_PER_FRAME = 512; // Max A* iterations the sliced path planner will run each frame, shared between all bots and the flow field build
+static const int PATH_REQUEST_FINISH_COST = 16; // Iterations charged against MAX_PATH_ITERATIONS_PER_FRAME for each path request turned into a bot path
+
 // Returns true if a valid nav mesh has been loaded into memory
 bool NavmeshLoaded();
 // Unloads all data, including loaded nav meshes, nav profiles, all the map data such as buildable structure maps and hive locations.
@@ -117,6 +402,23 @@ void UnloadNavMeshes();
 bool loadNavigationData(const char* mapname);
 // Loads the nav mesh only. Map data such as hive locations, doors etc are not loaded
 bool LoadNavMesh(const char* mapname);
+// Copies Size bytes at Offset in the loaded nav file into Dest. Returns false if the read would run past the end of the file
+bool NAV_ReadNavFileData(const size_t Offset, void* Dest, const size_t Size);
+/*
+	Builds the nav mesh tiles for all the supplied compressed tiles, spreading the decompression and mesh building across all cores.
+	If BakedTiles is supplied, it receives a copy of each tile's data before it's added to the nav mesh, for writing to the snapshot.
+*/
+void NAV_BuildNavMeshTiles(dtTileCache* TileCache, dtNavMesh* NavMesh, const std::vector<dtCompressedTileRef>& Tiles, std::vector<std::vector<unsigned char>>* BakedTiles = nullptr);
+// Adds tiles previously baked by NAV_BuildNavMeshTiles to the nav mesh, skipping the tile build entirely
+void NAV_AddBakedNavMeshTiles(dtTileCache* TileCache, dtNavMesh* NavMesh, const std::vector<dtCompressedTileRef>& Tiles, const std::vector<std::vector<unsigned char>>& BakedTiles);
+// Hash of the loaded nav file, used to tell if a snapshot was baked from the same file
+unsigned int NAV_GetNavFileHash();
+// Full path to the baked nav mesh snapshot for the map (same folder as the .nav file)
+void GetNavSnapshotFilePath(char* buffer, const char* mapname);
+// Reads the baked tiles for every nav mesh from the map's snapshot. Returns false if there is no snapshot, or it wasn't baked from the current nav file
+bool NAV_ReadNavMeshSnapshot(const char* mapname, const unsigned int SourceHash, const int NumNavMeshes, std::vector<std::vector<std::vector<unsigned char>>>& SnapshotTiles);
+// Writes the baked tiles for every nav mesh to the map's snapshot so the next load can skip building them
+bool NAV_WriteNavMeshSnapshot(const char* mapname, const unsigned int SourceHash, const std::vector<std::vector<std::vector<unsigned char>>>& SnapshotTiles);
 // Unloads the nav meshes (UnloadNavMeshes()) and then reloads them (LoadNavMesh). Map data such as doors, hives, locations are not touched.
 void ReloadNavMeshes();
 
@@ -169,6 +471,12 @@ Vector UTIL_GetRandomPointOnNavmeshInDonutIgnoreReachability(const NavAgentProfi
 
 // Roughly estimates the movement cost to move between FromLocation and ToLocation. Uses simple formula of distance between points x cost modifier for that movement
 float UTIL_GetPathCostBetweenLocations(const NavAgentProfile &NavProfile, const Vector FromLocation, const Vector ToLocation);
+/*
+	Works out the path cost from FromLocation to every one of ToLocations with a single Dijkstra search, rather than one path query each.
+	MaxDistances gives how far from each location the nav mesh may end and still count (max_ai_use_reach if empty or too short).
+	OutCosts is filled in the same order as ToLocations, with FLT_MAX for any location that can't be reached
+*/
+void UTIL_GetPathCostsToLocations(const NavAgentProfile& NavProfile, const Vector FromLocation, const std::vector<Vector>& ToLocations, const std::vector<float>& MaxDistances, std::vector<float>& OutCosts);
 
 // Returns true is the bot is grounded, on the nav mesh, and close enough to the Destination to be considered at that point
 bool BotIsAtLocation(const AvHAIPlayer* pBot, const Vector Destination);
@@ -232,8 +540,15 @@ void ClearBotStuck(AvHAIPlayer* pBot);
 // Clears all bot movement data, including the current path, their stuck status. Effectively stops all movement the bot is performing.
 void ClearBotMovement(AvHAIPlayer* pBot);
 
-// Called every bot frame (default is 60fps). Ensures the tile cache is updated after obstacles are placed
+/*
+	Called every bot frame (default is 60fps). Ensures the tile cache is updated after obstacles are placed.
+	Rebuilds dirty tiles until MAX_TILECACHE_UPDATE_TIME_US runs out, tiles closest to the bots' paths first. Returns true once nothing is left pending
+*/
 bool UTIL_UpdateTileCache();
+// Moves the pending tile rebuild closest to any of the points (in Detour coordinates) to the front of the nav mesh's tile cache update queue
+void NAV_PrioritiseTileCacheUpdate(const unsigned int NavMeshIndex, const std::vector<Vector>& PathPoints);
+// Work done by UTIL_UpdateTileCache on the last frame
+const nav_tilecache_stats* NAV_GetTileCacheStats();
 
 void AIDEBUG_DrawOffMeshConnections(unsigned int NavMeshIndex, float DrawTime = 0.0f);
 void AIDEBUG_DrawTemporaryObstacles(unsigned int NavMeshIndex, float DrawTime = 0.0f);
@@ -302,7 +617,7 @@ void MoveToWithoutNav(AvHAIPlayer* pBot, const Vector Destination);
 // Check if there are any players in our way and try to move around them. If we can't, then back up to let them through
 void HandlePlayerAvoidance(AvHAIPlayer* pBot, const Vector MoveDestination);
 
-Vector AdjustPointForPathfinding(unsigned int NavMeshIndex, const Vector Point, const NavAgentProfile& NavProfile = GetBaseAgentProfile(NAV_PROFILE_DEFAULT));
+Vector AdjustPointForPathfinding(unsigned int NavMeshIndex, const Vector Point, const NavAgentProfile& NavProfile = GetBaseAgentProfile(NAV_PROFILE_DEFAULT), const dtPolyRef PolyHint = 0);
 
 // Special path finding that takes the presence of phase gates into account 
 dtStatus FindFlightPathToPoint(const NavAgentProfile& NavProfile, Vector FromLocation, Vector ToLocation, std::vector<bot_path_node>& path, float MaxAcceptableDistance);
@@ -311,7 +626,35 @@ Vector UTIL_FindHighestSuccessfulTracePoint(const Vector TraceFrom, const Vector
 
 // Similar to FindPathToPoint, but you can specify a max acceptable distance for partial results. Will return a failure if it can't reach at least MaxAcceptableDistance away from the ToLocation
 dtStatus FindPathClosestToPoint(AvHAIPlayer* pBot, const BotMoveStyle MoveStyle, const Vector ToLocation, std::vector<bot_path_node>& path, float MaxAcceptableDistance);
-dtStatus FindPathClosestToPoint(const NavAgentProfile& NavProfile, const Vector FromLocation, const Vector ToLocation, std::vector<bot_path_node>& path, float MaxAcceptableDistance);
+
+// Works out the start and end polys for a bot path, taking into account the bot's current path and whether it needs to get off a lift first
+dtStatus NAV_PrepareBotPathRequest(AvHAIPlayer* pBot, const Vector ToLocation, float MaxAcceptableDistance, NavPathRequest& Request);
+// Turns a poly corridor from findPath into the bot's path nodes (straight path, wall adjustment, floor alignment and climb heights)
+// If the search status says the corridor was cut short by MAX_PATH_POLY, the end doesn't have to be near the destination. The bot replans when it gets there
+dtStatus NAV_BuildBotPathFromCorridor(AvHAIPlayer* pBot, NavPathRequest& Request, const dtStatus SearchStatus, const dtPolyRef* PolyPath, const int nPathCount, std::vector<bot_path_node>& path);
+
+/*	Queues a path request for the sliced path planner, or collects the result once the planner has finished with it.
+	Returns DT_IN_PROGRESS while the path is still being planned, and DT_SUCCESS with the path filled in once it's ready.
+	Asking for a different destination replaces any request the bot already has queued.
+*/
+dtStatus NAV_RequestBotPath(AvHAIPlayer* pBot, const Vector Destination, std::vector<bot_path_node>& path, float MaxAcceptableDistance);
+/*	Hands queued path requests to the nav worker threads if they're running, otherwise runs them through the sliced path planner.
+	Cache, flow field and cluster graph lookups, finished worker jobs and building the bot paths all count against MAX_PATH_ITERATIONS_PER_FRAME along with the A* iterations.
+	Requests that don't fit in this frame's budget stay queued, and anything left over goes to the queued flow field build. Call once per frame, before the bots think
+*/
+void NAV_UpdatePathRequests();
+// Tries the path cache, flow field and cluster graph for a request, completing it if one of them has the path. WorkDone gets the iterations to charge against the frame budget either way
+bool NAV_TryQuickPathRequest(NavPathRequest& Request, int* WorkDone);
+// Nav worker callback for path requests handed off by NAV_UpdatePathRequests. Passes the corridor on to NAV_CompletePathRequest
+void NAV_OnPathJobComplete(struct _NAV_JOB& Job);
+// Called by NAV_UpdatePathRequests when a search finishes. Builds the bot's path and hands it back through nav_status
+void NAV_CompletePathRequest(NavPathRequest& Request, const dtStatus SearchStatus, const dtPolyRef* PolyPath, const int nPathCount);
+// Is the bot still waiting on the path planner?
+bool NAV_IsPathRequestPending(const AvHAIPlayer* pBot);
+// Drops all queued path requests. Called when the nav meshes are unloaded
+void NAV_ClearPathRequests();
+// StartPolyHint is optional, if you already know which poly FromLocation is on (e.g. a bot's CurrentPoly) then it saves a nearest poly search
+dtStatus FindPathClosestToPoint(const NavAgentProfile& NavProfile, const Vector FromLocation, const Vector ToLocation, std::vector<bot_path_node>& path, float MaxAcceptableDistance, const dtPolyRef StartPolyHint = 0, const NavSearchMode SearchMode = NAV_SEARCH_OPTIMAL);
 
 DynamicMapObject* UTIL_GetLiftReferenceByEdict(const edict_t* SearchEdict);
 NavOffMeshConnection UTIL_GetOffMeshConnectionForPlatform(const NavAgentProfile& NavProfile, DynamicMapObject* LiftRef);
@@ -346,11 +689,14 @@ float UTIL_PointIsDirectlyReachable_DEBUG(const Vector start, const Vector targe
 */
 bool UTIL_PointIsDirectlyReachable(const AvHAIPlayer* pBot, const Vector targetPoint);
 bool UTIL_PointIsDirectlyReachable(const AvHAIPlayer* pBot, const Vector start, const Vector target);
-bool UTIL_PointIsDirectlyReachable(const Vector start, const Vector target);
+bool UTIL_PointIsDirectlyReachable(const Vector start, const Vector target, const dtPolyRef StartPolyHint = 0);
 bool UTIL_PointIsDirectlyReachable(const NavAgentProfile& NavProfile, const Vector start, const Vector target);
 
 // Will trace along the nav mesh from start to target and return true if the trace reaches within MaxAcceptableDistance
-bool UTIL_TraceNav(const NavAgentProfile& NavProfile, const Vector start, const Vector target, const float MaxAcceptableDistance);
+bool UTIL_TraceNav(const NavAgentProfile& NavProfile, const Vector start, const Vector target, const float MaxAcceptableDistance, const dtPolyRef StartPolyHint = 0);
+/*	Same as UTIL_TraceNav, but from one start point to several targets. The end polys are looked up in one batched query and the rays share the start poly.
+	Results (optional) receives the per-target result of UTIL_TraceNav. Returns true if every target was reached */
+bool UTIL_TraceNavMulti(const NavAgentProfile& NavProfile, const Vector start, const Vector* Targets, const int NumTargets, const float MaxAcceptableDistance, bool* Results = nullptr, const dtPolyRef StartPolyHint = 0);
 
 void UTIL_TraceNavLine(const NavAgentProfile& NavProfile, const Vector Start, const Vector End, nav_hitresult* HitResult);
 
@@ -358,9 +704,10 @@ void UTIL_TraceNavLine(const NavAgentProfile& NavProfile, const Vector Start, co
 	Project point to navmesh:
 	Takes the supplied location in the game world, and returns the nearest point on the nav mesh within the supplied extents.
 	Uses pExtents by default if not supplying one.
+	If PolyHint is supplied and Location is on that poly, the search is skipped.
 	Returns ZERO_VECTOR if not projected successfully
 */
-Vector UTIL_ProjectPointToNavmesh(const int NavmeshIndex, const Vector Location, const NavAgentProfile& NavProfile = GetBaseAgentProfile(NAV_PROFILE_DEFAULT), const Vector Extents = Vector(400.0f, 400.0f, 400.0f));
+Vector UTIL_ProjectPointToNavmesh(const int NavmeshIndex, const Vector Location, const NavAgentProfile& NavProfile = GetBaseAgentProfile(NAV_PROFILE_DEFAULT), const Vector Extents = Vector(400.0f, 400.0f, 400.0f), const dtPolyRef PolyHint = 0);
 
 /*
 	Point is on navmesh:
@@ -371,10 +718,148 @@ bool UTIL_PointIsOnNavmesh(const NavAgentProfile& NavProfile, const Vector Locat
 
 // Sets the BotNavInfo so the bot can track if it's on the ground, in the air, climbing a wall, on a ladder etc.
 void UTIL_UpdateBotMovementStatus(AvHAIPlayer* pBot);
+// Keeps the bot's CurrentPoly up to date by walking it along the nav mesh from where the bot was last time. Only does a full nearest poly search after a teleport or if the walk fails
+void NAV_UpdateBotCurrentPoly(AvHAIPlayer* pBot);
+// Returns the bot's CurrentPoly if it belongs to NavMeshIndex, otherwise 0. Use this rather than CurrentPoly whenever passing it to a query as a poly hint
+dtPolyRef NAV_GetBotPolyHint(const AvHAIPlayer* pBot, const unsigned int NavMeshIndex);
+/*
+	Drop-in replacement for dtNavMeshQuery::findNearestPoly which tries PolyHint first.
+	If Pos lies over PolyHint (and within MAX_POLY_HINT_HEIGHT_DIFF of it) then the hint is used as-is, otherwise falls back to a normal search
+*/
+dtStatus NAV_FindNearestPolyWithHint(const dtNavMeshQuery* NavQuery, const dtPolyRef PolyHint, const float* Pos, const float* Extents, const dtQueryFilter* Filter, dtPolyRef* NearestRef, float* NearestPt);
+// Returns how far anywhere on the poly is from the nearest nav mesh wall, capped at NAV_POLY_CLEARANCE_LIMIT. Reads the clearance field built with each tile, so it's just a lookup
+float NAV_GetPolyClearance(const NavAgentProfile& NavProfile, const dtPolyRef Poly);
 
 // Returns true if a path could be found between From and To location. Cheaper than full path finding, only a rough check to confirm it can be done.
 bool UTIL_PointIsReachable(const NavAgentProfile& NavProfile, const Vector FromLocation, const Vector ToLocation, const float MaxAcceptableDistance);
 
+// Returns the index of a poly in the island label arrays, or -1 if the ref is stale or wasn't labelled
+int NAV_GetReachabilityIslandPolyIndex(const nav_reachability_islands* Islands, const dtNavMesh* m_navMesh, const dtPolyRef Ref);
+// Hashes the filter's area costs and include/exclude flags, so profiles which would produce the same path share cache entries
+unsigned int NAV_GetFilterHash(const dtQueryFilter* Filter);
+// Builds the path cache key for a search between two polys with the supplied profile, against the nav mesh as it is right now
+NavPathCacheKey NAV_MakePathCacheKey(const NavAgentProfile& NavProfile, const dtPolyRef StartPoly, const dtPolyRef EndPoly);
+// Copies a cached corridor into PolyPath if one exists for the key. Returns false on a cache miss
+bool NAV_GetCachedPolyPath(const NavPathCacheKey& Key, dtPolyRef* PolyPath, int* nPathCount, const int MaxPath, dtStatus* Status);
+// Stores a corridor in the path cache, evicting the least recently used entry if full
+void NAV_CachePolyPath(const NavPathCacheKey& Key, const dtStatus Status, const dtPolyRef* PolyPath, const int nPathCount);
+/*
+	Drop-in replacement for dtNavMeshQuery::findPath using the profile's query and filter, which checks the path cache first.
+	The corridor is reused between any start and end points on the same polys, the straight path is still built from the exact positions.
+	NAV_SEARCH_FAST corridors aren't cached, so they're never handed to callers who wanted the cheapest path.
+*/
+dtStatus NAV_FindPolyPath(const NavAgentProfile& NavProfile, const dtPolyRef StartPoly, const dtPolyRef EndPoly, const float* StartPos, const float* EndPos, dtPolyRef* PolyPath, int* nPathCount, const int MaxPath, const NavSearchMode SearchMode = NAV_SEARCH_OPTIMAL);
+// Returns true if the corridor is the start of a complete route that didn't fit in the path buffer, rather than a partial path
+bool NAV_IsCorridorTruncated(const dtStatus Status);
+// Empties the path cache and resets its hit/miss counters
+void NAV_ClearPathCache();
+
+// Flattens the nav mesh's polys and links into the graph, with link costs from the filter
+void NAV_BuildPolyGraph(nav_poly_graph* Graph, const dtNavMesh* m_navMesh, const dtQueryFilter* NavFilter);
+// Empties the graph, ready for NAV_ContinuePolyGraphBuild to flatten the nav mesh into it a slice at a time
+void NAV_StartPolyGraphBuild(nav_poly_graph* Graph, const dtNavMesh* m_navMesh);
+/*
+	Works through up to roughly MaxPolys polys of the graph build started by NAV_StartPolyGraphBuild, and returns how many it got through.
+	The nav mesh must not change until the build is finished, so callers restart it when the nav mesh revision changes
+*/
+int NAV_ContinuePolyGraphBuild(nav_poly_graph* Graph, const dtNavMesh* m_navMesh, const dtQueryFilter* NavFilter, const int MaxPolys);
+// Returns the graph's index for a poly, or -1 if the poly wasn't in the graph or its tile has been rebuilt since
+int NAV_GetPolyGraphIndex(const nav_poly_graph* Graph, const dtNavMesh* m_navMesh, const dtPolyRef Ref);
+// Dijkstra search over the whole graph from Source. If bReverse, Costs holds the cost from each poly to Source instead. Parents is optional
+void NAV_RunPolyGraphDijkstra(const nav_poly_graph* Graph, const unsigned int Source, const bool bReverse, std::vector<float>& Costs, std::vector<int>* Parents);
+// As NAV_RunPolyGraphDijkstra, but only visits polys from RangeStart up to (not including) RangeEnd. Costs and Parents are indexed from RangeStart
+void NAV_RunPolyGraphRangeDijkstra(const nav_poly_graph* Graph, const unsigned int Source, const bool bReverse, const unsigned int RangeStart, const unsigned int RangeEnd, std::vector<float>& Costs, std::vector<int>* Parents);
+// Gets the range of graph indices belonging to a tile's polys
+void NAV_GetPolyGraphTileRange(const nav_poly_graph* Graph, const unsigned int TileIndex, unsigned int& RangeStart, unsigned int& RangeEnd);
+
+// Starts flattening the nav mesh for the build's filter, for the current nav mesh revision
+void NAV_StartFlowFieldBuild(nav_flow_field_build* Build, const nav_mesh* NavMesh);
+// Sets up the field's arrays once the graph is built, and starts the reverse Dijkstra search from the goal poly
+void NAV_StartFlowFieldSearch(nav_flow_field_build* Build, const nav_mesh* NavMesh);
+// Runs up to MaxIterations steps of the build's search. Returns how many were used, the search is finished once its open list is empty
+int NAV_ContinueFlowFieldBuild(nav_flow_field_build* Build, const int MaxIterations);
+// Fills in the finished field's next polys and the tiles it relies on, for roughly MaxPolys polys' worth of tiles. Returns how many polys it got through
+int NAV_FinishFlowFieldBuild(nav_flow_field_build* Build, const nav_mesh* NavMesh, const int MaxPolys);
+/*
+	Advances the queued flow field build, and adds the field once it's finished. The search and finishing pass use up to MaxIterations steps,
+	flattening the nav mesh gets MAX_POLY_GRAPH_POLYS_PER_FRAME polys of its own. Returns how many iterations were used
+*/
+int NAV_UpdateFlowFieldBuild(const int MaxIterations);
+// Returns the flow field's index for a poly, or -1 if the poly wasn't in the field or its tile has been rebuilt since
+int NAV_GetFlowFieldPolyIndex(const nav_flow_field* FlowField, const dtNavMesh* m_navMesh, const dtPolyRef Ref);
+// Roughly how many bytes the flow field's arrays take up, for the flow field memory budget
+size_t NAV_GetFlowFieldMemory(const nav_flow_field* FlowField);
+/*
+	Finds the flow field for the goal poly, checking it's still valid against the nav mesh.
+	If there isn't one and enough searches have asked for this goal, queues it for NAV_UpdateFlowFieldBuild. Returns nullptr if there's no field to use yet
+*/
+nav_flow_field* NAV_GetFlowField(const NavAgentProfile& NavProfile, const dtPolyRef GoalPoly);
+/*
+	Reads the corridor from StartPoly to EndPoly out of EndPoly's flow field, if there is one.
+	Returns false if there's no field for EndPoly yet, or StartPoly can't reach it, in which case run a normal search
+*/
+bool NAV_GetFlowFieldPolyPath(const NavAgentProfile& NavProfile, const dtPolyRef StartPoly, const dtPolyRef EndPoly, dtPolyRef* PolyPath, int* nPathCount, const int MaxPath, dtStatus* Status);
+// Throws away all flow fields and demand counters
+void NAV_ClearFlowFields();
+
+// Empties the cluster graph and starts flattening the nav mesh into its poly graph, for the current nav mesh revision
+void NAV_StartClusterGraphBuild(nav_cluster_graph* Clusters, const nav_mesh* NavMesh);
+// Carries on flattening the nav mesh, then lists every tile's portals, for up to roughly MaxPolys polys. Returns how many polys it got through
+int NAV_FindClusterPortals(nav_cluster_graph* Clusters, const dtNavMesh* m_navMesh, const int MaxPolys);
+// Works out the cheapest cost between each pair of portals in the same tile for up to MaxPortals portals, once the portals are found. Returns how many were done
+int NAV_ContinueClusterGraphBuild(nav_cluster_graph* Clusters, const int MaxPortals);
+/*
+	Returns the cluster graph for the profile's nav mesh and filter, or nullptr if it isn't complete for the current nav mesh yet.
+	Asking for a graph that doesn't exist yet queues it up for NAV_UpdateClusterGraphs to build
+*/
+nav_cluster_graph* NAV_GetClusterGraph(const NavAgentProfile& NavProfile);
+/*
+	Advances any cluster graph builds by up to MAX_CLUSTER_PORTALS_PER_FRAME portals, starting a rebuild if the nav mesh has changed.
+	Flattening the nav mesh and finding the portals get MAX_POLY_GRAPH_POLYS_PER_FRAME polys a frame instead.
+	Waits for the tile cache to finish its pending work first. Called once per frame after UTIL_UpdateTileCache
+*/
+void NAV_UpdateClusterGraphs();
+/*
+	Plans a path between polys far apart by searching the cluster graph first, then refining the chosen portals into polys one tile at a time.
+	Long routes are cut off at MaxPath rather than turned into a partial path, and report DT_BUFFER_TOO_SMALL.
+	Returns false if the polys are close together, can't be joined, or the cluster graph is still being built, in which case run a normal search.
+	NodesVisited is optional, and gets roughly how many polys and portals were searched whether or not a path was found
+*/
+bool NAV_GetClusterPolyPath(const NavAgentProfile& NavProfile, const dtPolyRef StartPoly, const dtPolyRef EndPoly, dtPolyRef* PolyPath, int* nPathCount, const int MaxPath, dtStatus* Status, int* NodesVisited = nullptr);
+// Throws away all cluster graphs
+void NAV_ClearClusterGraphs();
+
+// Sets up an empty landmark table slot for every distinct filter in the base agent profiles. Called after the nav meshes are loaded
+void NAV_InitLandmarks();
+/*
+	Advances any landmark table rebuilds by one landmark, starting a rebuild if the nav mesh has changed since the table was built.
+	Waits for the tile cache to finish its pending work first. Called once per frame after UTIL_UpdateTileCache
+*/
+void NAV_UpdateLandmarks();
+// Detaches and frees all landmark tables. Must be called before the nav queries are freed
+void NAV_ClearLandmarks();
+// Prints nav system statistics (path cache hit rate etc.) to the server console
+void NAV_PrintNavStats();
+// Times NumQueries findPath calls between repeatable random points on the default nav mesh and prints nodes visited per second
+void NAV_RunPathBenchmark(const int NumQueries);
+
+// Starts relabelling the islands for the nav mesh's current revision. The old labels are kept until NAV_ContinueReachabilityIslandBuild finishes
+void NAV_StartReachabilityIslandBuild(nav_reachability_islands* Islands, const nav_mesh* NavMesh);
+// Works through up to roughly MaxPolys polys of the island build, swapping the new labels in once done. Returns how many polys it got through
+int NAV_ContinueReachabilityIslandBuild(nav_reachability_islands* Islands, const dtNavMesh* m_navMesh, const int MaxPolys);
+/*
+	Relabels any islands which are out of date for their nav mesh, MAX_POLY_GRAPH_POLYS_PER_FRAME polys at a time.
+	Waits for the tile cache to finish its pending work first. Called once per frame after UTIL_UpdateTileCache
+*/
+void NAV_UpdateReachabilityIslands();
+/*
+	Uses the reachability islands to determine if EndPoly can be reached from StartPoly without running a path query.
+	Returns NAV_REACHABILITY_UNKNOWN while the islands are missing or out of date, and queues them up for NAV_UpdateReachabilityIslands
+*/
+NavReachability NAV_GetPolyReachability(const NavAgentProfile& NavProfile, const dtPolyRef StartPoly, const dtPolyRef EndPoly);
+// Throws away all reachability islands. Called when the nav meshes are unloaded
+void NAV_ClearReachabilityIslands();
+
 // If the bot has a path, it will work out how far along the path it can see and return the furthest point. Used so that the bot looks ahead along the path rather than just at its next path point
 Vector UTIL_GetFurthestVisiblePointOnPath(const AvHAIPlayer* pBot);
 // For the given viewer location and path, will return the furthest point along the path the viewer could see
@@ -420,10 +905,18 @@ void NAV_PopulateConnectionsAffectedByDynamicObject(DynamicMapObject* Object);
 
 void NAV_ApplyTempObstaclesToObject(DynamicMapObject* Object, const int Area);
 
+// Looks up the dynamic object for an edict in the edict index table. Returns nullptr if the edict isn't a dynamic object
 DynamicMapObject* UTIL_GetDynamicObjectByEdict(const edict_t* SearchEdict);
 DynamicMapObject* UTIL_GetClosestPlatformToPoints(const Vector StartPoint, const Vector EndPoint);
 
-Vector UTIL_AdjustPointAwayFromNavWall(const Vector Location, const float MaxDistanceFromWall);
+// Rebuilds the edict lookup table and spatial grid for DynamicMapObjects. Called automatically when objects are added/removed or move outside their swept bounds
+void NAV_RebuildDynamicObjectIndex();
+// Gets the indices into DynamicMapObjects of every object whose swept bounds overlap the box, in no particular order
+void NAV_GetDynamicObjectsInBounds(const Vector MinBounds, const Vector MaxBounds, std::vector<int>& Results);
+// Returns the first non-platform dynamic object the line passes through, in the same order as DynamicMapObjects
+DynamicMapObject* NAV_GetDynamicObjectIntersectingLine(const Vector LineStart, const Vector LineEnd, DynamicMapObject* IgnoreObject);
+
+Vector UTIL_AdjustPointAwayFromNavWall(const Vector Location, const float MaxDistanceFromWall, const dtPolyRef PolyHint = 0);
 
 const dtOffMeshConnection* DEBUG_FindNearestOffMeshConnectionToPoint(const Vector Point, unsigned int FilterFlags);
 
@@ -446,7 +939,19 @@ void NAV_ClearCachedMapData();
 
 void NAV_AddDynamicMapObject(DynamicMapPrototype* Prototype);
 void NAV_PopulateDynamicMapObjects();
+/*
+	Called every frame. Diffs each dynamic object's entvars against the last snapshot and only runs NAV_UpdateDynamicMapObject on objects
+	which changed, are mid-transition (moving, opening etc.), depend on an object which changed, or are due their DYNAMIC_OBJECT_IDLE_CHECK_INTERVAL check
+*/
 void NAV_UpdateDynamicMapObjects();
+// Updates a single dynamic object's state from its entity. Returns false if the object no longer exists and should be removed
+bool NAV_UpdateDynamicMapObject(DynamicMapObject* ThisObject);
+// Resizes the entvars snapshot to match DynamicMapObjects and flags everything for a full update
+void NAV_ResetDynamicObjectSnapshot();
+// Removes an object's entry from the entvars snapshot, keeping it in step with DynamicMapObjects
+void NAV_EraseDynamicObjectSnapshot(const size_t Index);
+// Compares every dynamic object's entvars against the snapshot in one pass and works out which objects need updating this frame
+void NAV_DiffDynamicObjectSnapshot();
 void NAV_LinkDynamicMapMasters();
 void NAV_LinkDynamicMapObjectsToTriggers();
 void NAV_LinkDynamicMapObjectsToOffmeshConnections();
@@ -463,7 +968,10 @@ void NAV_SetPrototypeTriggerState(int EntityIndex, char* Value);
 void NAV_SetPrototypeTriggerMode(int EntityIndex, char* Value);
 void NAV_AddPrototypeTarget(int EntityIndex, char* Value);
 
+// State, Type and bIsActive of existing dynamic objects must only be changed through these, so objects depending on them know to update
 void NAV_SetDynamicObjectStatus(DynamicMapObject* Object, DynamicMapObjectState NewState);
+void NAV_SetDynamicObjectType(DynamicMapObject* Object, DynamicMapObjectType NewType);
+void NAV_SetDynamicObjectActive(DynamicMapObject* Object, const bool bActive);
 void NAV_OnDynamicMapObjectBecomeIdle(DynamicMapObject* Object);
 void NAV_OnDynamicMapObjectStopIdle(DynamicMapObject* Object);
 
@@ -475,6 +983,8 @@ DynamicMapObject* NAV_GetTriggerByEdict(edict_t* Edict);
 
 DynamicMapObject* NAV_GetBestTriggerForObject(DynamicMapObject* ObjectToActivate, edict_t* PlayerToTrigger, const NavAgentProfile& NavProfile);
 DynamicMapObject* NAV_GetBestTriggerForObject(DynamicMapObject* ObjectToActivate, Vector ActivateLocation, const NavAgentProfile& NavProfile);
+// Out of the candidate triggers, returns the cheapest to walk to from FromLoc which doesn't need to go through (or ride) ObjectToActivate to reach
+DynamicMapObject* NAV_GetCheapestWalkableTrigger(DynamicMapObject* ObjectToActivate, const Vector FromLoc, const NavAgentProfile& NavProfile, const std::vector<DynamicMapObject*>& Candidates);
 
 // Retrieves the nearest trigger for the ObjectToTrigger. Will NOT return a trigger if it requires going through the ObjectToTrigger to reach it.
 DynamicMapObject* NAV_GetNearestTriggerForObjectReachableFromPoint(const NavAgentProfile& NavProfile, DynamicMapObject* ObjectToTrigger, Vector ActivateLocation);
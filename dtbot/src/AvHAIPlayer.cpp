@@ -590,6 +590,9 @@ bool IsEntityVisibleToBot(AvHAIPlayer* pBot, const edict_t* Entity)
 {
 	if (!IsEntityInBotFOV(pBot, Entity)) { return false; }
 
+	// Cheap rejection for anything the map's visibility data says can't be seen from here, before tracing
+	if (!UTIL_IsEntityPotentiallyVisible(UTIL_GetPlayerEyeLeaf(pBot->Edict), Entity)) { return false; }
+
 	float EntityRadius = Entity->v.size.Length2D() * 0.5f;
 	float EntityHeight = Entity->v.absmax.z - Entity->v.absmin.z;
 
@@ -687,15 +690,15 @@ Vector GetVisiblePointOnPlayerFromObserver(edict_t* Observer, edict_t* TargetPla
 	Vector TargetCentre = UTIL_GetCentreOfEntity(TargetPlayer);
 
 	TraceResult hit;
-	UTIL_TraceLine(GetPlayerEyePosition(Observer), TargetCentre, ignore_monsters, ignore_glass, Observer->v.pContainingEntity, &hit);
+	UTIL_BrokeredTraceLine(GetPlayerEyePosition(Observer), TargetCentre, ignore_monsters, ignore_glass, Observer->v.pContainingEntity, &hit);
 
 	if (hit.flFraction >= 1.0f) { return TargetCentre; }
 
-	UTIL_TraceLine(GetPlayerEyePosition(Observer), GetPlayerEyePosition(TargetPlayer), ignore_monsters, ignore_glass, Observer->v.pContainingEntity, &hit);
+	UTIL_BrokeredTraceLine(GetPlayerEyePosition(Observer), GetPlayerEyePosition(TargetPlayer), ignore_monsters, ignore_glass, Observer->v.pContainingEntity, &hit);
 
 	if (hit.flFraction >= 1.0f) { return GetPlayerEyePosition(TargetPlayer); }
 
-	UTIL_TraceLine(GetPlayerEyePosition(Observer), GetPlayerBottomOfCollisionHull(TargetPlayer) + Vector(0.0f, 0.0f, 5.0f), ignore_monsters, ignore_glass, Observer->v.pContainingEntity, &hit);
+	UTIL_BrokeredTraceLine(GetPlayerEyePosition(Observer), GetPlayerBottomOfCollisionHull(TargetPlayer) + Vector(0.0f, 0.0f, 5.0f), ignore_monsters, ignore_glass, Observer->v.pContainingEntity, &hit);
 
 	if (hit.flFraction >= 1.0f) { return GetPlayerBottomOfCollisionHull(TargetPlayer) + Vector(0.0f, 0.0f, 5.0f); }
 
@@ -754,8 +757,8 @@ void StartNewBotFrame(AvHAIPlayer* pBot)
 	{
 		if (UTIL_PointIsReachable(pBot->BotNavInfo.NavProfile, pBot->SpawnLocation, ProjectPoint, 16.0f))
 		{
-			Vector NavPoint = UTIL_ProjectPointToNavmesh(pBot->BotNavInfo.NavProfile.NavMeshIndex, ProjectPoint, pBot->BotNavInfo.NavProfile);
-			UTIL_AdjustPointAwayFromNavWall(NavPoint, 8.0f);
+			Vector NavPoint = UTIL_ProjectPointToNavmesh(pBot->BotNavInfo.NavProfile.NavMeshIndex, ProjectPoint, pBot->BotNavInfo.NavProfile, Vector(400.0f, 400.0f, 400.0f), NAV_GetBotPolyHint(pBot, pBot->BotNavInfo.NavProfile.NavMeshIndex));
+			UTIL_AdjustPointAwayFromNavWall(NavPoint, 8.0f, NAV_GetBotPolyHint(pBot, GetBaseAgentProfile(NAV_PROFILE_PLAYER).NavMeshIndex));
 
 			pBot->BotNavInfo.LastNavMeshPosition = NavPoint;
 
@@ -771,28 +774,25 @@ void StartNewBotFrame(AvHAIPlayer* pBot)
 				TraceEndPoints[2] = pBot->Edict->v.origin + (RightVector * (GetPlayerRadius(pBot->Edict) * 2.0f));
 				TraceEndPoints[3] = pBot->Edict->v.origin - (RightVector * (GetPlayerRadius(pBot->Edict) * 2.0f));
 
-				int NumDirectionsChecked = 0;
+				Vector NavTraceEndPoints[4];
 				bool bHasRoom = true;
 
-				while (NumDirectionsChecked < 4 && bHasRoom)
+				for (int i = 0; i < 4; i++)
 				{
-					Vector EndTrace = TraceEndPoints[NumDirectionsChecked];
-					Vector EndNavTrace = EndTrace;
-					EndNavTrace.z = pBot->CollisionHullBottomLocation.z;
-
-					if (!UTIL_QuickTrace(pBot->Edict, pBot->Edict->v.origin, EndTrace))
+					if (!UTIL_QuickTrace(pBot->Edict, pBot->Edict->v.origin, TraceEndPoints[i]))
 					{
 						bHasRoom = false;
 						break;
 					}
 
-					if (!UTIL_TraceNav(pBot->BotNavInfo.NavProfile, pBot->CurrentFloorPosition, EndNavTrace, 0.0f))
-					{
-						bHasRoom = false;
-						break;
-					}
+					NavTraceEndPoints[i] = TraceEndPoints[i];
+					NavTraceEndPoints[i].z = pBot->CollisionHullBottomLocation.z;
+				}
 
-					NumDirectionsChecked++;
+				// All four nav traces start from the same spot, so do them as one batch. Not needed if the poly we're on is clear of walls for that far anyway
+				if (bHasRoom && NAV_GetPolyClearance(pBot->BotNavInfo.NavProfile, NAV_GetBotPolyHint(pBot, pBot->BotNavInfo.NavProfile.NavMeshIndex)) < GetPlayerRadius(pBot->Edict) * 2.0f)
+				{
+					bHasRoom = UTIL_TraceNavMulti(pBot->BotNavInfo.NavProfile, pBot->CurrentFloorPosition, NavTraceEndPoints, 4, 0.0f, nullptr, NAV_GetBotPolyHint(pBot, pBot->BotNavInfo.NavProfile.NavMeshIndex));
 				}
 
 				if (bHasRoom)
@@ -864,6 +864,7 @@ void OnBotTeleport(AvHAIPlayer* pBot)
 	ClearBotStuck(pBot);
 	ClearBotStuckMovement(pBot);
 	pBot->BotNavInfo.LastOpenLocation = ZERO_VECTOR;
+	pBot->BotNavInfo.CurrentPoly = 0;
 	pBot->LastTeleportTime = gpGlobals->time;
 }
 
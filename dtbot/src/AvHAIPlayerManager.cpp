@@ -3,17 +3,22 @@
 #include "AvHAIMath.h"
 #include "AvHAITactical.h"
 #include "AvHAINavigation.h"
+#include "AvHAINavJobs.h"
 #include "AvHAIConfig.h"
 #include "AvHAIWeaponHelper.h"
 #include "AvHAIHelper.h"
 #include "AvHAIPlayerUtil.h"
+#include "AvHAIBSP.h"
 #include <time.h>
 
 #include <string>
 
 double last_think_time = 0.0;
 
-std::vector<AvHAIPlayer> ActiveAIPlayers;
+// Bot state lives in a fixed slot per client (ENTINDEX - 1) so pointers stay valid and lookups by edict are O(1)
+AvHAIPlayer AIPlayerSlots[MAX_PLAYERS];
+// Dense list of occupied slots in the order bots were added, used for iteration
+std::vector<AvHAIPlayer*> ActiveAIPlayers;
 
 float LastAIPlayerCountUpdate = 0.0f;
 
@@ -79,14 +84,53 @@ std::string BotNames[MAX_PLAYERS] = {	"MrRobot",
 									"TerminalFerocity"
 };
 
+// Returns the slot a client edict maps to in AIPlayerSlots, or -1 if it isn't a client edict
+static int AIMGR_GetSlotForEdict(const edict_t* pEdict)
+{
+	if (!pEdict) { return -1; }
+
+	int Slot = ENTINDEX(pEdict) - 1;
+
+	if (Slot < 0 || Slot >= MAX_PLAYERS) { return -1; }
+
+	return Slot;
+}
+
+// Releases the bot's slot and drops it from the active list. Returns the iterator following the removed entry
+static std::vector<AvHAIPlayer*>::iterator AIMGR_RemoveActiveAIPlayer(std::vector<AvHAIPlayer*>::iterator BotIt)
+{
+	AvHAIPlayer* pBot = (*BotIt);
+
+	if (DebugAIPlayer == pBot)
+	{
+		DebugAIPlayer = nullptr;
+	}
+
+	pBot->Edict = nullptr;
+
+	return ActiveAIPlayers.erase(BotIt);
+}
+
+// Releases every occupied slot and empties the active list
+static void AIMGR_ClearActiveAIPlayers()
+{
+	for (auto BotIt = ActiveAIPlayers.begin(); BotIt != ActiveAIPlayers.end(); BotIt++)
+	{
+		(*BotIt)->Edict = nullptr;
+	}
+
+	ActiveAIPlayers.clear();
+	DebugAIPlayer = nullptr;
+}
+
 void AIMGR_UpdateAIPlayerCounts()
 {
 	for (auto BotIt = ActiveAIPlayers.begin(); BotIt != ActiveAIPlayers.end();)
 	{
 		// If bot has been kicked from the server then remove from active AI player list
-		if (FNullEnt(BotIt->Edict) || BotIt->Edict->free)
+		if (FNullEnt((*BotIt)->Edict) || (*BotIt)->Edict->free)
 		{
-			BotIt = ActiveAIPlayers.erase(BotIt);
+			BotIt = AIMGR_RemoveActiveAIPlayer(BotIt);
 		}
 		else
 		{
@@ -132,7 +176,7 @@ void AIMGR_RemoveAIPlayerFromTeam(int Team)
 	// resources tied up in them or are commanding, which could cause big disruption to the team they're leaving
 
 	int MinValue = 0; // Track the least valuable bot on the desired team.
-	std::vector<AvHAIPlayer>::iterator ItemToRemove = ActiveAIPlayers.end(); // Current bot to be kicked
+	std::vector<AvHAIPlayer*>::iterator ItemToRemove = ActiveAIPlayers.end(); // Current bot to be kicked
 
 	for (auto it = ActiveAIPlayers.begin(); it != ActiveAIPlayers.end(); it++)
 	{
@@ -142,9 +186,9 @@ void AIMGR_RemoveAIPlayerFromTeam(int Team)
 	
 	if (ItemToRemove != ActiveAIPlayers.end())
 	{		
-		AIMGR_KickBot(ItemToRemove->Edict);
+		AIMGR_KickBot((*ItemToRemove)->Edict);
 
-		ActiveAIPlayers.erase(ItemToRemove);
+		AIMGR_RemoveActiveAIPlayer(ItemToRemove);
 	}
 
 }
@@ -224,8 +268,32 @@ void AIMGR_AddAIPlayerToTeam(int Team)
 	BotEnt->v.pitch_speed = 270;  // slightly faster than HLDM of 225
 	BotEnt->v.yaw_speed = 250; // slightly faster than HLDM of 210
 
-	AvHAIPlayer NewAIPlayer;
-	NewAIPlayer.Edict = BotEnt;
+	int BotSlot = AIMGR_GetSlotForEdict(BotEnt);
+
+	if (BotSlot < 0)
+	{
+		g_engfuncs.pfnServerPrint("Failed to create AI player: invalid client index\n");
+		AIMGR_KickBot(BotEnt);
+		return;
+	}
+
+	AvHAIPlayer* NewAIPlayer = &AIPlayerSlots[BotSlot];
+
+	// The engine can hand out a client slot again before we've noticed the previous bot in it was kicked
+	if (NewAIPlayer->Edict)
+	{
+		for (auto BotIt = ActiveAIPlayers.begin(); BotIt != ActiveAIPlayers.end(); BotIt++)
+		{
+			if ((*BotIt) == NewAIPlayer)
+			{
+				AIMGR_RemoveActiveAIPlayer(BotIt);
+				break;
+			}
+		}
+	}
+
+	*NewAIPlayer = AvHAIPlayer();
+	NewAIPlayer->Edict = BotEnt;
 
 	if (ActiveAIPlayers.size() == 0)
 	{
@@ -354,13 +422,13 @@ void AIMGR_UpdateAIPlayers()
 	for (auto BotIt = ActiveAIPlayers.begin(); BotIt != ActiveAIPlayers.end();)
 	{
 		// If bot has been kicked from the server then remove from active AI player list
-		if (FNullEnt(BotIt->Edict) || BotIt->Edict->free)
+		if (FNullEnt((*BotIt)->Edict) || (*BotIt)->Edict->free)
 		{
-			BotIt = ActiveAIPlayers.erase(BotIt);
+			BotIt = AIMGR_RemoveActiveAIPlayer(BotIt);
 			continue;
 		}
 
-		AvHAIPlayer* bot = &(*BotIt);
+		AvHAIPlayer* bot = (*BotIt);
 
 		BotUpdateViewRotation(bot, FrameDelta);
 
@@ -383,6 +451,9 @@ void AIMGR_UpdateAIPlayers()
 		g_engfuncs.pfnRunPlayerMove(bot->Edict, bot->Edict->v.v_angle, bot->ForwardMove,
 			bot->SideMove, bot->UpMove, bot->Button, bot->Impulse, adjustedmsec);
 
+		// Bots updated after this one in the same frame must see where it's moved to
+		UTIL_InvalidatePlayerLeafCache(bot->Edict);
+
 		bot->LastServerUpdateTime = CurrTime;
 
 		BotIt++;
@@ -434,7 +505,7 @@ int AIMGR_GetNumAIPlayersOnTeam(int Team)
 
 	for (auto it = ActiveAIPlayers.begin(); it != ActiveAIPlayers.end(); it++)
 	{
-		if (it->Edict->v.team == Team)
+		if ((*it)->Edict->v.team == Team)
 		{
 			Result++;
 		}
@@ -466,7 +537,7 @@ int AIMGR_AIPlayerExistsOnTeam(int Team)
 {
 	for (auto it = ActiveAIPlayers.begin(); it != ActiveAIPlayers.end(); it++)
 	{
-		if (it->Edict->v.team == Team)
+		if ((*it)->Edict->v.team == Team)
 		{
 			return true;
 		}
@@ -526,10 +597,10 @@ void AIMGR_ClearBotData()
 		{
 			for (auto it = ActiveAIPlayers.begin(); it != ActiveAIPlayers.end();)
 			{
-				if (it->Edict == PlayerEdict && it->Edict)
+				if ((*it)->Edict == PlayerEdict && (*it)->Edict)
 				{
-					AIMGR_KickBot(it->Edict);
-					it = ActiveAIPlayers.erase(it);
+					AIMGR_KickBot((*it)->Edict);
+					it = AIMGR_RemoveActiveAIPlayer(it);
 				}
 				else
 				{
@@ -540,7 +611,7 @@ void AIMGR_ClearBotData()
 	}
 
 	// We shouldn't have any bots in the server when this is called, but this ensures no bots end up "orphans" and no longer tracked by the system
-	ActiveAIPlayers.clear();
+	AIMGR_ClearActiveAIPlayers();
 }
 
 void AIMGR_NewMap()
@@ -552,14 +623,18 @@ void AIMGR_NewMap()
 		UnloadNavigationData();
 	}
 
+	BSP_UnloadWorldHulls();
+	UTIL_ClearPlayerLeafCache();
+
 	UTIL_ClearLocalizations();
+	UTIL_ResetTraceStats();
 	NAV_ClearCachedMapData();
 
 	AITAC_ClearMapAIData(true);
 
 	bMapDataInitialised = false;
 
-	ActiveAIPlayers.clear();
+	AIMGR_ClearActiveAIPlayers();
 
 	AIStartedTime = gpGlobals->time;
 	LastAIPlayerCountUpdate = 0.0f;
@@ -594,6 +669,8 @@ void AIMGR_LoadNavigationData()
 
 	const char* theCStrLevelName = STRING(gpGlobals->mapname);
 
+	BSP_LoadWorldHulls(theCStrLevelName);
+
 	if (!loadNavigationData(theCStrLevelName))
 	{
 		char ErrMsg[128];
@@ -608,19 +685,16 @@ void AIMGR_LoadNavigationData()
 
 AvHAIPlayer* AIMGR_GetBotRefFromPlayer(edict_t* PlayerRef)
 {
-	for (auto BotIt = ActiveAIPlayers.begin(); BotIt != ActiveAIPlayers.end(); BotIt++)
-	{
-		if (BotIt->Edict == PlayerRef) { return &(*BotIt); }
-	}
-
-	return nullptr;
+	return AIMGR_GetBotPointer(PlayerRef);
 }
 
 AvHAIPlayer* AIMGR_GetBotAtIndex(int Index)
 {
-	if (Index < 0 || Index >= ActiveAIPlayers.size()) { return nullptr; }
+	if (Index < 0 || Index >= MAX_PLAYERS) { return nullptr; }
 
-	return &ActiveAIPlayers[Index];
+	if (!AIPlayerSlots[Index].Edict) { return nullptr; }
+
+	return &AIPlayerSlots[Index];
 }
 
 std::vector<AvHAIPlayer*> AIMGR_GetAllAIPlayers()
@@ -631,9 +705,9 @@ std::vector<AvHAIPlayer*> AIMGR_GetAllAIPlayers()
 
 	for (auto BotIt = ActiveAIPlayers.begin(); BotIt != ActiveAIPlayers.end(); BotIt++)
 	{
-		if (FNullEnt(BotIt->Edict)) { continue; }
+		if (FNullEnt((*BotIt)->Edict)) { continue; }
 
-		Result.push_back(&(*BotIt));
+		Result.push_back(*BotIt);
 	}
 
 	return Result;
@@ -664,11 +738,11 @@ std::vector<AvHAIPlayer*> AIMGR_GetAIPlayersOnTeam(int Team)
 
 	for (auto BotIt = ActiveAIPlayers.begin(); BotIt != ActiveAIPlayers.end(); BotIt++)
 	{
-		if (FNullEnt(BotIt->Edict)) { continue; }
+		if (FNullEnt((*BotIt)->Edict)) { continue; }
 
-		if (BotIt->Edict->v.team == Team)
+		if ((*BotIt)->Edict->v.team == Team)
 		{
-			Result.push_back(&(*BotIt));
+			Result.push_back(*BotIt);
 		}
 	}
 
@@ -681,7 +755,7 @@ std::vector<edict_t*> AIMGR_GetNonAIPlayersOnTeam(int Team)
 
 	for (auto it = ActiveAIPlayers.begin(); it != ActiveAIPlayers.end(); it++)
 	{
-		edict_t* ThisPlayer = it->Edict;
+		edict_t* ThisPlayer = (*it)->Edict;
 
 		if (FNullEnt(ThisPlayer)) { continue; }
 
@@ -709,6 +783,10 @@ void AIMGR_UpdateAIMapData()
 	{
 		AITAC_UpdateMapAIData();
 		UTIL_UpdateTileCache();
+		NAV_UpdateLandmarks();
+		NAV_UpdateClusterGraphs();
+		NAV_UpdateReachabilityIslands();
+		NAV_UpdatePathRequests();
 		AITAC_CheckNavMeshModified();
 	}
 }
@@ -736,16 +814,7 @@ void AIMGR_SetDebugAIPlayer(edict_t* AIPlayer)
 		return;
 	}
 
-	for (auto it = ActiveAIPlayers.begin(); it != ActiveAIPlayers.end(); it++)
-	{
-		if (it->Edict == AIPlayer)
-		{
-			DebugAIPlayer = &(*it);
-			return;
-		}
-	}
-
-	DebugAIPlayer = nullptr;
+	DebugAIPlayer = AIMGR_GetBotPointer(AIPlayer);
 }
 
 void AIMGR_ClientConnected(edict_t* NewClient)
@@ -769,31 +838,20 @@ void AIMGR_KickBot(edict_t* BotToKick)
 
 AvHAIPlayer* AIMGR_GetBotPointer(const edict_t* pEdict)
 {
-	for (auto it = ActiveAIPlayers.begin(); it != ActiveAIPlayers.end(); it++)
-	{
-		if (it->Edict == pEdict)
-		{
-			return &(*it);
-		}
-	}
+	int Slot = AIMGR_GetSlotForEdict(pEdict);
+
+	if (Slot < 0 || AIPlayerSlots[Slot].Edict != pEdict) { return nullptr; }
 
-	return nullptr;
+	return &AIPlayerSlots[Slot];
 }
 
 int AIMGR_GetBotIndex(const edict_t* pEdict)
 {
-	int Index = 0;
+	int Slot = AIMGR_GetSlotForEdict(pEdict);
 
-	for (auto it = ActiveAIPlayers.begin(); it != ActiveAIPlayers.end(); it++)
-	{
-		if (it->Edict == pEdict)
-		{
-			return Index;
-		}
-		Index++;
-	}
+	if (Slot < 0 || AIPlayerSlots[Slot].Edict != pEdict) { return -1; }
 
-	return -1;
+	return Slot;
 }
 
 void DTBot_ServerCommand(void)
@@ -826,6 +884,54 @@ void DTBot_ServerCommand(void)
 		return;
 	}
 
+	if (FStrEq(arg1, "navstats"))
+	{
+		NAV_PrintNavStats();
+
+		return;
+	}
+
+	if (FStrEq(arg1, "bsptest"))
+	{
+		int NumTraces = 1000;
+
+		if (arg2 != NULL && isNumber(arg2))
+		{
+			NumTraces = imini(atoi(arg2), BSP_MAX_COMPARISON_TRACES);
+		}
+
+		BSP_RunTraceComparison(NumTraces);
+
+		return;
+	}
+
+	if (FStrEq(arg1, "tracestats"))
+	{
+		if (FStrEq(arg2, "reset"))
+		{
+			UTIL_ResetTraceStats();
+			return;
+		}
+
+		UTIL_PrintTraceStats();
+
+		return;
+	}
+
+	if (FStrEq(arg1, "navbench"))
+	{
+		int NumQueries = 1000;
+
+		if (arg2 != NULL && isNumber(arg2))
+		{
+			NumQueries = imini(atoi(arg2), MAX_NAV_BENCHMARK_QUERIES);
+		}
+
+		NAV_RunPathBenchmark(NumQueries);
+
+		return;
+	}
+
 	if (FStrEq(arg1, "debug"))
 	{
 		edict_t* ListenEdict = AIMGR_GetListenServerEdict();
@@ -68,6 +68,7 @@ void AIMGR_LoadNavigationData();
 void AIMGR_ReloadNavigationData();
 
 AvHAIPlayer* AIMGR_GetBotRefFromPlayer(edict_t* PlayerRef);
+// Returns the bot in the given slot (see AIMGR_GetBotIndex), or nullptr if the slot is unused
 AvHAIPlayer* AIMGR_GetBotAtIndex(int Index);
 
 
@@ -92,6 +93,7 @@ void AIMGR_PlayerSpawned();
 void AIMGR_KickBot(edict_t* BotToKick);
 
 AvHAIPlayer* AIMGR_GetBotPointer(const edict_t* pEdict);
+// Returns the bot's slot index (ENTINDEX - 1), which stays stable for as long as the bot is in the server. -1 if not a bot
 int AIMGR_GetBotIndex(const edict_t* pEdict);
 
 void DTBot_ServerCommand(void);
@@ -265,11 +265,11 @@ bool UTIL_PlayerHasLOSToEntity(const edict_t* Player, const edict_t* Target, con
 
 	if (bUseHullSweep)
 	{
-		UTIL_TraceHull(StartTrace, EndTrace, dont_ignore_monsters, head_hull, Player->v.pContainingEntity, &hit);
+		UTIL_BrokeredTraceHull(StartTrace, EndTrace, dont_ignore_monsters, head_hull, Player->v.pContainingEntity, &hit);
 	}
 	else
 	{
-		UTIL_TraceLine(StartTrace, EndTrace, dont_ignore_monsters, dont_ignore_glass, Player->v.pContainingEntity, &hit);
+		UTIL_BrokeredTraceLine(StartTrace, EndTrace, dont_ignore_monsters, dont_ignore_glass, Player->v.pContainingEntity, &hit);
 	}
 
 
@@ -293,7 +293,7 @@ bool UTIL_PlayerHasLOSToLocation(const edict_t* Player, const Vector Target, con
 
 	TraceResult hit;
 
-	UTIL_TraceLine(StartTrace, Target, ignore_monsters, ignore_glass, Player->v.pContainingEntity, &hit);
+	UTIL_BrokeredTraceLine(StartTrace, Target, ignore_monsters, ignore_glass, Player->v.pContainingEntity, &hit);
 
 	return (hit.flFraction >= 1.0f);
 
@@ -393,7 +393,7 @@ Vector UTIL_GetNearestSurfaceNormal(Vector SearchLocation)
 		float MinDist = 0.0f;
 
 		TraceResult HitResult;
-		UTIL_TraceHull(SearchLocation, Trace1End, ignore_monsters, head_hull, nullptr, &HitResult);
+		UTIL_BrokeredTraceHull(SearchLocation, Trace1End, ignore_monsters, head_hull, nullptr, &HitResult);
 
 		if (HitResult.flFraction < 1.0f)
 		{
@@ -406,7 +406,7 @@ Vector UTIL_GetNearestSurfaceNormal(Vector SearchLocation)
 			}
 		}
 
-		UTIL_TraceHull(SearchLocation, Trace2End, ignore_monsters, head_hull, nullptr, &HitResult);
+		UTIL_BrokeredTraceHull(SearchLocation, Trace2End, ignore_monsters, head_hull, nullptr, &HitResult);
 
 		if (HitResult.flFraction < 1.0f)
 		{
@@ -419,7 +419,7 @@ Vector UTIL_GetNearestSurfaceNormal(Vector SearchLocation)
 			}
 		}
 
-		UTIL_TraceHull(SearchLocation, Trace3End, ignore_monsters, head_hull, nullptr, &HitResult);
+		UTIL_BrokeredTraceHull(SearchLocation, Trace3End, ignore_monsters, head_hull, nullptr, &HitResult);
 
 		if (HitResult.flFraction < 1.0f)
 		{
@@ -432,7 +432,7 @@ Vector UTIL_GetNearestSurfaceNormal(Vector SearchLocation)
 			}
 		}
 
-		UTIL_TraceHull(SearchLocation, Trace4End, ignore_monsters, head_hull, nullptr, &HitResult);
+		UTIL_BrokeredTraceHull(SearchLocation, Trace4End, ignore_monsters, head_hull, nullptr, &HitResult);
 
 		if (HitResult.flFraction < 1.0f)
 		{
@@ -445,7 +445,7 @@ Vector UTIL_GetNearestSurfaceNormal(Vector SearchLocation)
 			}
 		}
 
-		UTIL_TraceHull(SearchLocation, Trace5End, ignore_monsters, head_hull, nullptr, &HitResult);
+		UTIL_BrokeredTraceHull(SearchLocation, Trace5End, ignore_monsters, head_hull, nullptr, &HitResult);
 
 		if (HitResult.flFraction < 1.0f)
 		{
@@ -458,7 +458,7 @@ Vector UTIL_GetNearestSurfaceNormal(Vector SearchLocation)
 			}
 		}
 
-		UTIL_TraceHull(SearchLocation, Trace6End, ignore_monsters, head_hull, nullptr, &HitResult);
+		UTIL_BrokeredTraceHull(SearchLocation, Trace6End, ignore_monsters, head_hull, nullptr, &HitResult);
 
 		if (HitResult.flFraction < 1.0f)
 		{
@@ -471,7 +471,7 @@ Vector UTIL_GetNearestSurfaceNormal(Vector SearchLocation)
 			}
 		}
 
-		UTIL_TraceHull(SearchLocation, Trace7End, ignore_monsters, head_hull, nullptr, &HitResult);
+		UTIL_BrokeredTraceHull(SearchLocation, Trace7End, ignore_monsters, head_hull, nullptr, &HitResult);
 
 		if (HitResult.flFraction < 1.0f)
 		{
@@ -484,7 +484,7 @@ Vector UTIL_GetNearestSurfaceNormal(Vector SearchLocation)
 			}
 		}
 
-		UTIL_TraceHull(SearchLocation, Trace8End, ignore_monsters, head_hull, nullptr, &HitResult);
+		UTIL_BrokeredTraceHull(SearchLocation, Trace8End, ignore_monsters, head_hull, nullptr, &HitResult);
 
 		if (HitResult.flFraction < 1.0f)
 		{
@@ -531,7 +531,7 @@ Vector UTIL_GetNearestLadderNormal(Vector SearchLocation)
 		Vector CentrePoint = UTIL_GetCentreOfEntity(closestLadderRef);
 		CentrePoint.z = SearchLocation.z;
 
-		UTIL_TraceHull(SearchLocation, CentrePoint, ignore_monsters, head_hull, nullptr, &result);
+		UTIL_BrokeredTraceHull(SearchLocation, CentrePoint, ignore_monsters, head_hull, nullptr, &result);
 
 		if (result.flFraction < 1.0f)
 		{
@@ -14,6 +14,7 @@
 #include "AvHAIConstants.h"
 #include "AvHAIPlayerManager.h"
 #include "AvHAIConfig.h"
+#include "AvHAIBSP.h"
 
 #include <float.h>
 
@@ -179,6 +180,7 @@ bool AITAC_AnyPlayersOfTeamInArea(const int Team, const Vector SearchLocation, c
 edict_t* AITAC_GetClosestPlayerOnTeamWithLOS(const int Team, const Vector& Location, float SearchRadius, edict_t* IgnorePlayer)
 {
 	float distSq = sqrf(SearchRadius);
+	int LocationLeaf = BSP_GetLeafForPoint(Location);
 	float MinDist = 0.0f;
 	edict_t* Result = nullptr;
 
@@ -190,7 +192,7 @@ edict_t* AITAC_GetClosestPlayerOnTeamWithLOS(const int Team, const Vector& Locat
 		{
 			float ThisDist = vDist2DSq(PlayerEdict->v.origin, Location);
 
-			if (ThisDist <= distSq && UTIL_QuickTrace(PlayerEdict, GetPlayerEyePosition(PlayerEdict), Location))
+			if (ThisDist <= distSq && BSP_IsLeafPotentiallyVisible(UTIL_GetPlayerEyeLeaf(PlayerEdict), LocationLeaf) && UTIL_QuickTrace(PlayerEdict, GetPlayerEyePosition(PlayerEdict), Location))
 			{
 				if (FNullEnt(Result) || ThisDist < MinDist)
 				{
@@ -208,6 +210,7 @@ edict_t* AITAC_GetClosestPlayerOnTeamWithLOS(const int Team, const Vector& Locat
 bool AITAC_AnyPlayerOnTeamHasLOSToLocation(int Team, const Vector& Location, float SearchRadius, edict_t* IgnorePlayer)
 {
 	float distSq = sqrf(SearchRadius);
+	int LocationLeaf = BSP_GetLeafForPoint(Location);
 
 	for (int i = 1; i <= gpGlobals->maxClients; i++)
 	{
@@ -217,7 +220,7 @@ bool AITAC_AnyPlayerOnTeamHasLOSToLocation(int Team, const Vector& Location, flo
 		{
 			float ThisDist = vDist2DSq(PlayerEdict->v.origin, Location);
 
-			if (ThisDist <= distSq && UTIL_QuickTrace(PlayerEdict, GetPlayerEyePosition(PlayerEdict), Location))
+			if (ThisDist <= distSq && BSP_IsLeafPotentiallyVisible(UTIL_GetPlayerEyeLeaf(PlayerEdict), LocationLeaf) && UTIL_QuickTrace(PlayerEdict, GetPlayerEyePosition(PlayerEdict), Location))
 			{
 				return true;
 			}
@@ -232,6 +235,7 @@ std::vector<edict_t*> AITAC_GetAllPlayersOnTeamWithLOS(int Team, const Vector& L
 	std::vector<edict_t*> Results;
 
 	float distSq = sqrf(SearchRadius);
+	int LocationLeaf = BSP_GetLeafForPoint(Location);
 
 	for (int i = 1; i <= gpGlobals->maxClients; i++)
 	{
@@ -241,7 +245,7 @@ std::vector<edict_t*> AITAC_GetAllPlayersOnTeamWithLOS(int Team, const Vector& L
 		{
 			float ThisDist = vDist2DSq(PlayerEdict->v.origin, Location);
 
-			if (ThisDist <= distSq && UTIL_QuickTrace(PlayerEdict, GetPlayerEyePosition(PlayerEdict), Location))
+			if (ThisDist <= distSq && BSP_IsLeafPotentiallyVisible(UTIL_GetPlayerEyeLeaf(PlayerEdict), LocationLeaf) && UTIL_QuickTrace(PlayerEdict, GetPlayerEyePosition(PlayerEdict), Location))
 			{
 				Results.push_back(PlayerEdict);
 			}
@@ -256,6 +260,7 @@ int AITAC_GetNumPlayersOnTeamWithLOS(int Team, const Vector& Location, float Sea
 	int Result = 0;
 
 	float distSq = sqrf(SearchRadius);
+	int LocationLeaf = BSP_GetLeafForPoint(Location);
 
 	for (int i = 1; i <= gpGlobals->maxClients; i++)
 	{
@@ -265,7 +270,7 @@ int AITAC_GetNumPlayersOnTeamWithLOS(int Team, const Vector& Location, float Sea
 		{
 			float ThisDist = vDist2DSq(PlayerEdict->v.origin, Location);
 
-			if (ThisDist <= distSq && UTIL_QuickTrace(PlayerEdict, GetPlayerEyePosition(PlayerEdict), Location))
+			if (ThisDist <= distSq && BSP_IsLeafPotentiallyVisible(UTIL_GetPlayerEyeLeaf(PlayerEdict), LocationLeaf) && UTIL_QuickTrace(PlayerEdict, GetPlayerEyePosition(PlayerEdict), Location))
 			{
 				Result++;
 			}
@@ -316,6 +321,7 @@ int AITAC_GetNumDeadPlayersOnTeam(const int Team)
 bool AITAC_AnyPlayerOnTeamWithLOS(int Team, const Vector& Location, float SearchRadius)
 {
 	float distSq = sqrf(SearchRadius);
+	int LocationLeaf = BSP_GetLeafForPoint(Location);
 
 	std::vector<edict_t*> Players = AIMGR_GetAllPlayersOnTeam(Team);
 
@@ -325,7 +331,7 @@ bool AITAC_AnyPlayerOnTeamWithLOS(int Team, const Vector& Location, float Search
 
 		if (!IsPlayerActiveInGame(PlayerRef)) { continue; }
 
-		if (vDist2DSq(PlayerRef->v.origin, Location) <= distSq && UTIL_QuickTrace(PlayerRef, GetPlayerEyePosition(PlayerRef), Location))
+		if (vDist2DSq(PlayerRef->v.origin, Location) <= distSq && BSP_IsLeafPotentiallyVisible(UTIL_GetPlayerEyeLeaf(PlayerRef), LocationLeaf) && UTIL_QuickTrace(PlayerRef, GetPlayerEyePosition(PlayerRef), Location))
 		{
 			return true;
 		}
@@ -271,7 +271,7 @@ BotAttackResult PerformAttackLOSCheck(AvHAIPlayer* pBot, const AIWeaponType Weap
 
 	Vector EndTrace = pBot->CurrentEyePosition + (AttackDir * MaxWeaponRange);
 
-	UTIL_TraceLine(StartTrace, EndTrace, dont_ignore_monsters, dont_ignore_glass, pBot->Edict->v.pContainingEntity, &hit);
+	UTIL_BrokeredTraceLine(StartTrace, EndTrace, dont_ignore_monsters, dont_ignore_glass, pBot->Edict->v.pContainingEntity, &hit);
 
 	if (FNullEnt(hit.pHit)) { return ATTACK_OUTOFRANGE; }
 
@@ -307,7 +307,7 @@ BotAttackResult PerformAttackLOSCheck(AvHAIPlayer* pBot, const AIWeaponType Weap
 
 	Vector EndTrace = pBot->CurrentEyePosition + (AttackDir * MaxWeaponRange);
 
-	UTIL_TraceLine(StartTrace, EndTrace, dont_ignore_monsters, dont_ignore_glass, pBot->Edict->v.pContainingEntity, &hit);
+	UTIL_BrokeredTraceLine(StartTrace, EndTrace, dont_ignore_monsters, dont_ignore_glass, pBot->Edict->v.pContainingEntity, &hit);
 
 	if (FNullEnt(hit.pHit)) { return ATTACK_OUTOFRANGE; }
 
@@ -344,7 +344,7 @@ BotAttackResult PerformAttackLOSCheck(const Vector Location, const AIWeaponType
 
 	Vector EndTrace = Location + (AttackDir * MaxWeaponRange);
 
-	UTIL_TraceLine(StartTrace, EndTrace, dont_ignore_monsters, dont_ignore_glass, nullptr, &hit);
+	UTIL_BrokeredTraceLine(StartTrace, EndTrace, dont_ignore_monsters, dont_ignore_glass, nullptr, &hit);
 
 	if (FNullEnt(hit.pHit)) { return ATTACK_OUTOFRANGE; }
 
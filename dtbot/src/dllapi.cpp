@@ -56,6 +56,8 @@ float last_think_time;
 
 extern float last_bot_count_check_time;
 
+extern void ResetBotMsgTable();
+
 bool bInitialFrame = true;
 
 
@@ -142,6 +144,7 @@ int Spawn(edict_t* pent)
 		if (strcmp(pClassname, "worldspawn") == 0)
 		{
 			AIMGR_NewMap();
+			ResetBotMsgTable();
 			bInitialFrame = true;
 		}
 
@@ -49,6 +49,66 @@ void(*botMsgFunction)(void*, int) = NULL;
 void(*botMsgEndFunction)(void*, int) = NULL;
 int botMsgIndex;
 
+// Network message IDs are a single byte, so every user message fits in this table
+static const int MAX_BOT_MSG_TYPES = 256;
+
+// Determines which index is passed to a tracked message's handler
+typedef enum _BOT_MSG_TARGET
+{
+	BOTMSG_TARGET_NONE = 0,	// Broadcast message, handler receives -1
+	BOTMSG_TARGET_PLAYER,	// Sent to a specific player, handler receives the player's entity index
+	BOTMSG_TARGET_BOT		// Only handled when sent to one of our bots, handler receives the bot index
+} BotMsgTarget;
+
+typedef struct _BOT_MSG_ENTRY
+{
+	const char* MsgName = nullptr;
+	void(*MsgFunction)(void*, int) = NULL;
+	void(*ResetFunction)() = NULL;
+	BotMsgTarget Target = BOTMSG_TARGET_NONE;
+} bot_msg_entry;
+
+// All network messages the bot listens to
+static const bot_msg_entry TrackedBotMsgs[] =
+{
+	{ "DeathMsg", BotClient_Valve_DeathMsg, BotClient_Valve_DeathMessage_Reset, BOTMSG_TARGET_NONE },
+	{ "WeaponList", BotClient_Valve_WeaponList, NULL, BOTMSG_TARGET_NONE },
+	{ "WeapPickup", BotClient_Valve_WeapPickup, NULL, BOTMSG_TARGET_PLAYER },
+	{ "AmmoX", BotClient_Valve_AmmoX, BotClient_Valve_AmmoX_Reset, BOTMSG_TARGET_PLAYER },
+	{ "CurWeapon", BotClient_Valve_CurrentWeapon, BotClient_Valve_CurrentWeapon_Reset, BOTMSG_TARGET_PLAYER },
+	{ "Damage", BotClient_Valve_Damage, BotClient_Valve_Damage_Reset, BOTMSG_TARGET_BOT },
+};
+
+// Tracked message for each msg_type, or nullptr if the bot doesn't care about it. Resolved once per map
+static const bot_msg_entry* BotMsgTable[MAX_BOT_MSG_TYPES];
+static bool bBotMsgTableResolved = false;
+
+// Looks up the IDs of all tracked messages. The game only registers its messages once the first client is
+// precached, so this is retried on each message until at least one of them resolves
+static void ResolveBotMsgTable()
+{
+	memset(BotMsgTable, 0, sizeof(BotMsgTable));
+
+	int NumTrackedMsgs = sizeof(TrackedBotMsgs) / sizeof(TrackedBotMsgs[0]);
+
+	for (int i = 0; i < NumTrackedMsgs; i++)
+	{
+		int MsgId = GET_USER_MSG_ID(PLID, TrackedBotMsgs[i].MsgName, NULL);
+
+		if (MsgId > 0 && MsgId < MAX_BOT_MSG_TYPES)
+		{
+			BotMsgTable[MsgId] = &TrackedBotMsgs[i];
+			bBotMsgTableResolved = true;
+		}
+	}
+}
+
+// Called on map change so message IDs are looked up again for the new map
+void ResetBotMsgTable()
+{
+	bBotMsgTableResolved = false;
+}
+
 void pfnChangeLevel(char* s1, char* s2)
 {
 	RETURN_META(MRES_IGNORED);
@@ -79,69 +139,49 @@ void pfnMessageBegin(int msg_dest, int msg_type, const float* pOrigin, edict_t*
 {
 	if (gpGlobals->deathmatch)
 	{
-
-		int index = -1;
-
 		botMsgFunction = NULL;     // no msg function until known otherwise
 		botMsgEndFunction = NULL;  // no msg end function until known otherwise
 		botMsgIndex = -1;       // index of bot receiving message
 
-		if (msg_type == GET_USER_MSG_ID(PLID, "DeathMsg", NULL))
+		if (!bBotMsgTableResolved)
 		{
-			BotClient_Valve_DeathMessage_Reset();
-			botMsgFunction = BotClient_Valve_DeathMsg;
-			RETURN_META(MRES_IGNORED);
+			ResolveBotMsgTable();
 		}
 
-		if (msg_type == GET_USER_MSG_ID(PLID, "WeaponList", NULL))
-		{
-			botMsgFunction = BotClient_Valve_WeaponList;
-			RETURN_META(MRES_IGNORED);
-		}		
-
-
-		if (ed)
-		{
-			if (msg_type == GET_USER_MSG_ID(PLID, "WeapPickup", NULL))
-			{
-				botMsgIndex = ENTINDEX(ed);
-				botMsgFunction = BotClient_Valve_WeapPickup;
-				RETURN_META(MRES_IGNORED);
-			}
+		if (msg_type <= 0 || msg_type >= MAX_BOT_MSG_TYPES) { RETURN_META(MRES_IGNORED); }
 
-			if (msg_type == GET_USER_MSG_ID(PLID, "AmmoX", NULL))
-			{
-				botMsgIndex = ENTINDEX(ed);
-				BotClient_Valve_AmmoX_Reset();
-				botMsgFunction = BotClient_Valve_AmmoX;
-				RETURN_META(MRES_IGNORED);
-			}
+		const bot_msg_entry* MsgEntry = BotMsgTable[msg_type];
 
+		// Not a message the bot cares about
+		if (!MsgEntry) { RETURN_META(MRES_IGNORED); }
 
-			if (msg_type == GET_USER_MSG_ID(PLID, "CurWeapon", NULL))
+		switch (MsgEntry->Target)
+		{
+			case BOTMSG_TARGET_PLAYER:
 			{
+				if (!ed) { RETURN_META(MRES_IGNORED); }
 				botMsgIndex = ENTINDEX(ed);
-				BotClient_Valve_CurrentWeapon_Reset();
-				botMsgFunction = BotClient_Valve_CurrentWeapon;
-				RETURN_META(MRES_IGNORED);
 			}
-
-			index = AIMGR_GetBotIndex(ed);
-
-			// is this message for a bot?
-			if (index != -1)
+			break;
+			case BOTMSG_TARGET_BOT:
 			{
-				botMsgIndex = index;       // index of bot receiving message
-
-				if (msg_type == GET_USER_MSG_ID(PLID, "Damage", NULL))
-				{
-					BotClient_Valve_Damage_Reset();
-					botMsgFunction = BotClient_Valve_Damage;
-				}
+				if (!ed) { RETURN_META(MRES_IGNORED); }
 
+				// is this message for a bot?
+				botMsgIndex = AIMGR_GetBotIndex(ed);
+				if (botMsgIndex == -1) { RETURN_META(MRES_IGNORED); }
 			}
+			break;
+			default:
+				break;
+		}
 
+		if (MsgEntry->ResetFunction)
+		{
+			MsgEntry->ResetFunction();
 		}
+
+		botMsgFunction = MsgEntry->MsgFunction;
 	}
 
 	RETURN_META(MRES_IGNORED);
@@ -166,11 +206,10 @@ void pfnMessageEnd(void)
 
 void pfnWriteByte(int iValue)
 {
-	if (gpGlobals->deathmatch)
+	if (botMsgFunction)
 	{
 		// if this message is for a bot, call the client message function...
-		if (botMsgFunction)
-			(*botMsgFunction)((void*)&iValue, botMsgIndex);
+		(*botMsgFunction)((void*)&iValue, botMsgIndex);
 	}
 
 	RETURN_META(MRES_IGNORED);
@@ -179,11 +218,10 @@ void pfnWriteByte(int iValue)
 
 void pfnWriteChar(int iValue)
 {
-	if (gpGlobals->deathmatch)
+	if (botMsgFunction)
 	{
 		// if this message is for a bot, call the client message function...
-		if (botMsgFunction)
-			(*botMsgFunction)((void*)&iValue, botMsgIndex);
+		(*botMsgFunction)((void*)&iValue, botMsgIndex);
 	}
 
 	RETURN_META(MRES_IGNORED);
@@ -192,11 +230,10 @@ void pfnWriteChar(int iValue)
 
 void pfnWriteShort(int iValue)
 {
-	if (gpGlobals->deathmatch)
+	if (botMsgFunction)
 	{
 		// if this message is for a bot, call the client message function...
-		if (botMsgFunction)
-			(*botMsgFunction)((void*)&iValue, botMsgIndex);
+		(*botMsgFunction)((void*)&iValue, botMsgIndex);
 	}
 
 	RETURN_META(MRES_IGNORED);
@@ -205,11 +242,10 @@ void pfnWriteShort(int iValue)
 
 void pfnWriteLong(int iValue)
 {
-	if (gpGlobals->deathmatch)
+	if (botMsgFunction)
 	{
 		// if this message is for a bot, call the client message function...
-		if (botMsgFunction)
-			(*botMsgFunction)((void*)&iValue, botMsgIndex);
+		(*botMsgFunction)((void*)&iValue, botMsgIndex);
 	}
 
 	RETURN_META(MRES_IGNORED);
@@ -218,11 +254,10 @@ void pfnWriteLong(int iValue)
 
 void pfnWriteAngle(float flValue)
 {
-	if (gpGlobals->deathmatch)
+	if (botMsgFunction)
 	{
 		// if this message is for a bot, call the client message function...
-		if (botMsgFunction)
-			(*botMsgFunction)((void*)&flValue, botMsgIndex);
+		(*botMsgFunction)((void*)&flValue, botMsgIndex);
 	}
 
 	RETURN_META(MRES_IGNORED);
@@ -231,11 +266,10 @@ void pfnWriteAngle(float flValue)
 
 void pfnWriteCoord(float flValue)
 {
-	if (gpGlobals->deathmatch)
+	if (botMsgFunction)
 	{
 		// if this message is for a bot, call the client message function...
-		if (botMsgFunction)
-			(*botMsgFunction)((void*)&flValue, botMsgIndex);
+		(*botMsgFunction)((void*)&flValue, botMsgIndex);
 	}
 
 	RETURN_META(MRES_IGNORED);
@@ -244,11 +278,10 @@ void pfnWriteCoord(float flValue)
 
 void pfnWriteString(const char* sz)
 {
-	if (gpGlobals->deathmatch)
+	if (botMsgFunction)
 	{
 		// if this message is for a bot, call the client message function...
-		if (botMsgFunction)
-			(*botMsgFunction)((void*)sz, botMsgIndex);
+		(*botMsgFunction)((void*)sz, botMsgIndex);
 	}
 
 	RETURN_META(MRES_IGNORED);
@@ -257,11 +290,10 @@ void pfnWriteString(const char* sz)
 
 void pfnWriteEntity(int iValue)
 {
-	if (gpGlobals->deathmatch)
+	if (botMsgFunction)
 	{
 		// if this message is for a bot, call the client message function...
-		if (botMsgFunction)
-			(*botMsgFunction)((void*)&iValue, botMsgIndex);
+		(*botMsgFunction)((void*)&iValue, botMsgIndex);
 	}
 
 	RETURN_META(MRES_IGNORED);
@@ -44,6 +44,7 @@
 
 #include "sdk_util.h"		// UTIL_LogPrintf, etc
 #include "AvHAIPlayerManager.h"
+#include "AvHAINavJobs.h"
 
 // Must provide at least one of these..
 static META_FUNCTIONS gMetaFunctionTable = {
@@ -124,5 +125,8 @@ C_DLLEXPORT int Meta_Attach(PLUG_LOADTIME /* now */,
 C_DLLEXPORT int Meta_Detach(PLUG_LOADTIME /* now */, 
 		PL_UNLOAD_REASON /* reason */) 
 {
+	// Worker threads must not outlive the plugin
+	NAV_StopNavWorkers();
+
 	return(TRUE);
 }